@@ -1,7 +1,23 @@
 ﻿#include "GLSLGen.hpp"
 #include "GLSLGenUtil.hpp"
+#include "GLSLGenC.h"
+#include "GLSLGenDSL.hpp"
+#include "GLSLGenEval.hpp"
+#include "GLSLGenFile.hpp"
+#include "GLSLGenParse.hpp"
+#include "GLSLGenBranch.hpp"
+#include "GLSLGenInline.hpp"
+#include "GLSLGenUnroll.hpp"
+#include "GLSLGenSimplify.hpp"
+#include "GLSLGenSerialize.hpp"
+#include "GLSLGenWatch.hpp"
+#include "GLSLGenSpirv.hpp"
+#include "GLSLGenStatic.hpp"
+#include "GLSLGenTarget.hpp"
 
 #include <fstream>
+#include <format>
+#include <sstream>
 #include <charconv>
 #include <string>
 #include <string_view>
@@ -15,6 +31,11 @@
 #include <random>
 #include <iostream>
 #include <span>
+#include <cmath>
+#include <tuple>
+#include <functional>
+#include <atomic>
+#include <csignal>
 
 #include <jclib/memory.h>
 
@@ -29,541 +50,741 @@ inline void write_text_file(const fs::path& _path, const std::string_view _data)
 };
 inline std::string read_text_file(const fs::path& _path)
 {
-	auto buf = std::array<char, 512>{};
-	auto s = std::string();
-	
-	auto f = std::ifstream(_path);
-	while (f)
-	{
-		f.read(buf.data(), buf.size());
-		s.append(buf.data(), f.gcount());
-	};
-	
-	return s;
+	const auto f = GLSLMappedFile(_path);
+	return std::string(f.text());
 };
 
 
-enum class GLSLStatementType
+void gen_vertex_shader(GLSLGen& _gen)
 {
-	declaration = 1,
-	assignment,
-};
+	auto& _context = _gen.context;
+	auto& _params = _gen.params;
+	_params.version = 330;
 
+	add_builtin_vertex_shader_variables(_context);
+	add_builtin_functions(_context);
 
+	{
+		_context.new_variable("in_pos", GLSLType::glsl_vec3)
+			->set_inout(GLSLInOut::in);
+		_context.new_variable("in_uvs", GLSLType::glsl_vec2)
+			->set_inout(GLSLInOut::in);
+		_context.new_variable("in_col", GLSLType::glsl_vec4)
+			->set_inout(GLSLInOut::in);
 
-struct GLSLStatement
-{
-	using Type = GLSLStatementType;
+		_context.new_variable("frag_uvs", GLSLType::glsl_auto)
+			->set_inout(GLSLInOut::out);
+		_context.new_variable("frag_col", GLSLType::glsl_vec4)
+			->set_inout(GLSLInOut::out);
+	};
 
-	GLSLVariableID dest;
-	GLSLExpression expr;
+	{
+		auto _main = GLSLFunctionBuilder(_params.main_fn);
+		_main.assign(_context, _context.id("frag_uvs"), _context.id("in_uvs"));
+		_main.assign(_context, _context.id("frag_col"), _context.id("in_col"));
+		_main.assign(_context, _context.id("gl_Position"), _context.id("in_pos"));
 
-	/**
-	 * @brief The type of statement.
-	*/
-	GLSLStatementType type;
+		_main.declare(_context, _context.new_variable()->id(),
+			GLSLExpression::make_unique(
+				GLSLExpression::FunctionCall(_context.function_id("cos"))
+				.add_param(
+					GLSLExpression::make_unique(
+						GLSLExpression::Swizzle(_context.id("in_pos"), 0)
+					)
+				)
+			)
+		);
 
-	explicit GLSLStatement(GLSLStatementType _type) :
-		type(_type)
-	{};
+	};
 
+	if (!_params.check())
+	{
+		abort();
+	};
+
+	deduce_auto(_context, _params);
 };
+void gen_fragment_shader(GLSLGen& _gen)
+{
+	auto& _context = _gen.context;
+	auto& _params = _gen.params;
+	_params.version = 330;
 
+	// Add builtins
+	add_builtin_fragment_shader_variables(_gen.context);
+	add_builtin_functions(_gen.context);
 
-struct GLSLFunction
-{
-public:
+	// Define shader
 
-	GLSLFunction& set_name(const std::string& _name)
-	{
-		this->name_ = _name;
-		return *this;
-	};
+	// Inputs
+	_context.new_variable("frag_col", GLSLType::glsl_vec4)->set_inout(GLSLInOut::in);
+	_context.new_variable("frag_uvs", GLSLType::glsl_vec3)->set_inout(GLSLInOut::in);
 
-	std::string_view name() const
-	{
-		return this->name_;
-	}
-	GLSLType return_type() const
-	{
-		return GLSLType::glsl_void;
-	};
+	// Output(s)
+	_context.new_variable("color", GLSLType::glsl_vec4)->set_inout(GLSLInOut::out);
 
-	auto body()
-	{
-		return std::span(this->body_);
-	};
-	auto body() const
-	{
-		return std::span(this->body_);
-	};
+	// Fingers crossed.
+	_context.new_variable("test_texture", GLSLType::glsl_sampler_2D_array);
 
-	void append(GLSLStatement _statement)
 	{
-		this->body_.push_back(std::move(_statement));
+		auto _main = dsl::Builder(_context, _params.main_fn);
+
+		// Get texel color.
+		const auto _texel = _main.declare("texel", dsl::texture(
+			_main.bind<dsl::sampler2DArray>("test_texture"),
+			_main.bind<dsl::vec3>("frag_uvs")));
+
+		// Assign to color output.
+		_main.assign(_main.bind<dsl::vec4>("color"), _texel);
 	};
 
-	GLSLFunction(const std::string& _name) :
-		name_(_name)
-	{};
-	GLSLFunction() = default;
 
-private:
-	std::string name_;
-	std::vector<GLSLStatement> body_{};
+	if (!_params.check())
+	{
+		abort();
+	};
 
+	deduce_auto(_context, _params);
 };
 
-struct GLSLParams
+/**
+ * @brief gen_fragment_shader() written with the compile-time front end.
+*/
+constexpr auto fragment_source_v = cx::make_shader<[](cx::Shader& s)
+{
+	using enum GLSLType;
+	s.input<glsl_vec4>("frag_col");
+	const auto frag_uvs = s.input<glsl_vec3>("frag_uvs");
+	const auto color = s.output<glsl_vec4>("color");
+	const auto test_texture = s.uniform<glsl_sampler_2D_array>("test_texture");
+	const auto texel = s.declare<glsl_vec4>("texel", cx::texture(test_texture, frag_uvs));
+	s.assign(color, texel);
+}>();
+static_assert(fragment_source_v.view().ends_with("\tvec4 texel = texture(test_texture, frag_uvs);\n\tcolor = texel;\n};\n"));
+
+namespace
 {
-public:
+	std::atomic<bool> watch_stop_v{ false };
 
-	auto inputs(bool _builtin = false) const
-	{
-		return this->context_->inputs(_builtin);
-	};
-	auto outputs(bool _builtin = false) const
+	void stop_watching(int)
 	{
-		return this->context_->outputs(_builtin);
-	};
-	auto uniforms() const
-	{
-		return this->context_->uniforms();
+		watch_stop_v.store(true, std::memory_order_relaxed);
 	};
+};
 
-	auto get_name(GLSLVariableID _varID) const
+/**
+ * @brief Runs "--watch" mode.
+ *
+ *	GLSLGen --watch [--vert|--frag <source> <output>]...
+ *
+ * Each source is a GLSL shader of the given stage, regenerated into its output whenever it
+ * is saved. Runs until interrupted.
+*/
+int watch_main(std::span<char* const> _args)
+{
+	auto _targets = std::vector<GLSLWatchTarget>();
+	for (size_t n = 0; n != _args.size(); n += 3)
 	{
-		return this->context_->name(_varID);
+		const auto _stage = std::string_view(_args[n]);
+		if ((_stage != "--vert" && _stage != "--frag") || n + 2 >= _args.size())
+		{
+			std::cerr << "usage: GLSLGen --watch [--vert|--frag <source> <output>]...\n";
+			return 1;
+		};
+
+		auto _target = GLSLWatchTarget();
+		_target.stage = (_stage == "--vert") ? GLSLShaderStage::vertex : GLSLShaderStage::fragment;
+		_target.input = _args[n + 1];
+		_target.output = _args[n + 2];
+
+		std::error_code _err{};
+		if (fs::equivalent(_target.input, _target.output, _err))
+		{
+			std::cerr << _target.input.string() << ": source cannot also be the output\n";
+			return 1;
+		};
+		_targets.push_back(std::move(_target));
 	};
-	auto get_type(GLSLVariableID _varID) const
+	if (_targets.empty())
 	{
-		return this->context_->type(_varID);
+		std::cerr << "usage: GLSLGen --watch [--vert|--frag <source> <output>]...\n";
+		return 1;
 	};
 
-	GLSLVariableID id(const std::string& _name) const
-	{
-		return this->context_->id(_name);
-	};
+	std::signal(SIGINT, stop_watching);
+	std::signal(SIGTERM, stop_watching);
+
+	auto _watcher = GLSLWatcher(std::move(_targets), std::cout);
+	return (_watcher.run(watch_stop_v)) ? 0 : 1;
+};
 
-	GLSLFunction main_fn{ "main" };
+/**
+ * @brief Writes a shader's GLSL to a string.
+*/
+inline std::string emit_glsl(const GLSLGen& _gen)
+{
+	auto _ostr = std::ostringstream();
+	generate_glsl(_gen.context, _gen.params, _ostr);
+	return _ostr.str();
+};
 
-	int version = 330;
+/**
+ * @brief Removes the variable ID comments generate_glsl() writes, IDs differ between contexts.
+*/
+inline std::string without_id_comments(std::string_view _source)
+{
+	auto _out = std::string();
+	auto _lines = std::istringstream(std::string(_source));
+	for (auto _line = std::string(); std::getline(_lines, _line);)
+	{
+		_out += _line.substr(0, _line.find(" // id = "));
+		_out += '\n';
+	};
+	return _out;
+};
 
-	bool check() const
+/**
+ * @brief Runs "--check-spirv" mode.
+ *
+ *	GLSLGen --check-spirv
+ *
+ * Lowers the example shaders to SPIR-V, decodes each module and checks that encoding it
+ * again gives back the same words.
+*/
+int check_spirv_main()
+{
+	const auto _check = [](std::string_view _name, void(*_genFn)(GLSLGen&), GLSLShaderStage _stage) -> bool
 	{
-		for (auto& i : inputs())
+		auto g = GLSLGen();
+		_genFn(g);
+
+		auto _words = std::vector<uint32_t>();
+		auto _module = GLSLSpirvModule();
+		if (!generate_spirv(g.context, g.params, _stage, _words))
 		{
-			for (auto& o : outputs())
-			{
-				if (i.name() == o.name())
-				{
-					return false;
-				};
-			};
+			std::cerr << _name << ": failed to lower to SPIR-V\n";
+			return false;
+		}
+		else if (!decode_spirv(_words, _module))
+		{
+			std::cerr << _name << ": generated module failed to decode\n";
+			return false;
+		}
+		else if (encode_spirv(_module) != _words)
+		{
+			std::cerr << _name << ": encoding the decoded module changed its words\n";
+			return false;
 		};
 
+		std::cout << _name << ": " << _words.size() << " words, round trip ok\n";
 		return true;
 	};
 
-	GLSLParams(GLSLContext& _context) :
-		context_(&_context)
-	{};
-
-private:
-	GLSLContext* context_{};
+	const auto _vertex = _check("vertex", gen_vertex_shader, GLSLShaderStage::vertex);
+	const auto _fragment = _check("fragment", gen_fragment_shader, GLSLShaderStage::fragment);
+	return (_vertex && _fragment) ? 0 : 1;
 };
 
-void add_builtin_vertex_shader_variables(GLSLContext& _context)
+/**
+ * @brief Runs "--check-watch" mode.
+ *
+ *	GLSLGen --check-watch
+ *
+ * Builds sources through the watcher, well-typed ones must build and ill-typed ones only
+ * log an error, a typo in a watched file must not end the watch.
+*/
+int check_watch_main()
 {
-	// Inputs
-	{
-		_context.new_variable("gl_VertexID", GLSLType::glsl_int)
-			->set_builtin()
-			.set_inout(GLSLInOut::in);
+	const auto _dir = fs::temp_directory_path() / "glslgen-check-watch";
+	std::error_code _err{};
+	fs::create_directories(_dir, _err);
+
+	// Statement in main, and whether it should build
+	constexpr std::pair<std::string_view, bool> _cases[] =
+	{
+		{ "float v = cos(in_pos.x);", true },
+		{ "float v = dot(in_pos, in_pos);", true },
+		{ "vec4 v = texture(tex, in_pos.xy);", true },
+		{ "float v = cos(in_pos.x, 2.0);", false },
+		{ "float v = cos();", false },
+		{ "float v = dot(in_pos.xy, 1.0);", false },
 	};
+
+	auto _targets = std::vector<GLSLWatchTarget>();
+	for (size_t n = 0; n != std::size(_cases); ++n)
 	{
-		_context.new_variable("gl_InstanceID", GLSLType::glsl_int)
-			->set_builtin()
-			.set_inout(GLSLInOut::in);
+		auto _target = GLSLWatchTarget();
+		_target.input = _dir / std::format("case{}.vert", n);
+		_target.output = _dir / std::format("case{}.glsl", n);
+		write_text_file(_target.input, std::format("#version 330 core\n\nin vec3 in_pos;\nuniform sampler2D tex;\n\n"
+			"void main()\n{{\n\t{}\n}};\n", _cases[n].first));
+		_targets.push_back(std::move(_target));
 	};
 
-	// Outputs
+	auto _log = std::ostringstream();
+	auto _watcher = GLSLWatcher(_targets, _log);
+
+	bool _ok = true;
+	for (size_t n = 0; n != std::size(_cases); ++n)
 	{
-		_context.new_variable("gl_Position", GLSLType::glsl_vec4)
-			->set_builtin()
-			.set_inout(GLSLInOut::out);
+		_log.str({});
+		const auto _built = _watcher.build(n);
+		const auto _logged = _log.str().find("error") != std::string::npos;
+		if (_built != _cases[n].second || _logged == _cases[n].second)
+		{
+			std::cerr << _cases[n].first << ": expected the build to " << ((_cases[n].second) ? "succeed" : "log an error")
+				<< "\n" << _log.str();
+			_ok = false;
+			continue;
+		};
+		std::cout << _cases[n].first << ": " << ((_built) ? "built" : "error logged") << '\n';
 	};
-};
-void add_builtin_fragment_shader_variables(GLSLContext& _context)
-{
-	// Inputs
-	(*_context.new_variable("gl_FragCoord", GLSLType::glsl_vec4))
-		.set_builtin()
-		.set_inout(GLSLInOut::in);
-	(*_context.new_variable("gl_FrontFacing", GLSLType::glsl_bool))
-		.set_builtin()
-		.set_inout(GLSLInOut::in);
-	(*_context.new_variable("gl_PointCoord", GLSLType::glsl_vec2))
-		.set_builtin()
-		.set_inout(GLSLInOut::in);
-
-	// Outputs
-	(*_context.new_variable("gl_FragDepth", GLSLType::glsl_float))
-		.set_builtin()
-		.set_inout(GLSLInOut::out);
-};
-
-void add_builtin_functions(GLSLContext& _context)
-{
-	(*_context.new_function("sin", GLSLType::glsl_float))
-		.set_builtin()
-		.add_overload(GLSLType::glsl_float, GLSLType::glsl_float);
-	(*_context.new_function("cos", GLSLType::glsl_float))
-		.set_builtin()
-		.add_overload(GLSLType::glsl_float, GLSLType::glsl_float);
-	(*_context.new_function("tan", GLSLType::glsl_float))
-		.set_builtin()
-		.add_overload(GLSLType::glsl_float, GLSLType::glsl_float);
-
-	(*_context.new_function("abs", GLSLType::glsl_float))
-		.set_builtin()
-		.add_overload(GLSLType::glsl_float, GLSLType::glsl_float);
-
-	(*_context.new_function("dot"))
-		.set_builtin()
-		.add_overload(GLSLType::glsl_float, { GLSLGenType::gen_float, GLSLGenType::gen_float })
-		.add_overload(GLSLType::glsl_double, { GLSLGenType::gen_double, GLSLGenType::gen_double });
-
-	(*_context.new_function("texture"))
-		.set_builtin()
-		// texture 2D sampler
-		.add_overload(GLSLType::glsl_vec4, { GLSLType::glsl_sampler_2D, GLSLType::glsl_vec2 })
-		// texture 2D array Sampler
-		.add_overload(GLSLType::glsl_vec4, { GLSLType::glsl_sampler_2D_array, GLSLType::glsl_vec3 });
 
+	fs::remove_all(_dir, _err);
+	return (_ok) ? 0 : 1;
 };
 
-
-bool deduce_auto(GLSLContext& _context, GLSLParams& _params)
+/**
+ * @brief Runs "--check-parse" mode.
+ *
+ *	GLSLGen --check-parse
+ *
+ * Parses statements with calls that must pick the right builtin overload, ill-typed ones that
+ * must be rejected, and GLSL forms the parser supports or must report as outside its subset.
+*/
+int check_parse_main()
 {
-	for (auto& _statement : _params.main_fn.body())
+	// Statement in main, and whether it should parse
+	constexpr std::pair<std::string_view, bool> _cases[] =
+	{
+		{ "float v = dot(in_pos, in_pos);", true },
+		{ "float v = dot(in_pos.xy, in_pos.xy);", true },
+		{ "float v = dot(in_pos.x, 2.0);", true },
+		{ "vec4 v = texture(tex, in_pos.xy);", true },
+		{ "float v = dot(in_pos.xy, 1.0);", false },
+		{ "vec4 v = texture(tex, in_pos);", false },
+
+		// Forms outside the emitter's own output
+		{ "vec4 v = vec4(in_pos, 1.0);", true },
+		{ "vec4 v = mvp * vec4(in_pos, 1.0);", true },
+		{ "vec4 v = vec4(in_pos, 1) * mvp;", true },
+		{ "vec3 v = -in_pos;", true },
+		{ "float v = -in_pos.x * -2.0;", true },
+		{ "vec3 v = mvp * in_pos;", false },
+		{ "vec4 v = vec4(in_pos, 0.5);", false },
+		{ "vec4 v = vec4(in_pos, 1.0); v.xy = in_pos.xy;", false },
+		{ "mat3 m = mat3(mvp);", false },
+	};
+
+	bool _ok = true;
+	for (auto& [_statement, _expected] : _cases)
 	{
-		if (_context.type(_statement.dest) == GLSLType::glsl_auto)
+		auto g = GLSLGen();
+		add_builtin_vertex_shader_variables(g.context);
+		add_builtin_functions(g.context);
+
+		const auto _source = std::format("#version 330 core\n\nin vec3 in_pos;\nuniform sampler2D tex;\nuniform mat4 mvp;\n\n"
+			"void main()\n{{\n\t{}\n}};\n", _statement);
+		const auto _parsed = parse_glsl(_source, g.context, g.params);
+		const auto _good = _parsed && g.params.check();
+		if (_good != _expected)
 		{
-			const auto _resultType = _statement.expr.result_type(_context);
-			_context.set_deduced_type(_statement.dest, _resultType);
+			std::cerr << _statement << ": expected the source to " << ((_expected) ? "parse" : "be rejected")
+				<< ((_parsed) ? std::string() : ", " + _parsed.error) << '\n';
+			_ok = false;
+			continue;
 		};
+		std::cout << _statement << ": " << ((_good) ? "parsed" : "rejected, " + _parsed.error) << '\n';
 	};
-	return true;
+	return (_ok) ? 0 : 1;
 };
 
-void generate_glsl(const GLSLContext& _context, const GLSLParams& _params, std::ostream& _ostr)
+/**
+ * @brief Runs "--check-c-api" mode.
+ *
+ *	GLSLGen --check-c-api
+ *
+ * Defines a shader through the C API, checking a valid call to an overloaded builtin is
+ * accepted and an ill-typed one reported as a type mismatch.
+*/
+int check_c_api_main()
 {
-	_ostr << "#version " << _params.version << " core\n\n";
+	const auto _gen = glsl_gen_create(330);
+	const auto _pos = glsl_gen_new_variable(_gen, "in_pos", GLSL_TYPE_VEC3, GLSL_INOUT_IN);
+	const auto _value = glsl_gen_new_variable(_gen, "v", GLSL_TYPE_FLOAT, GLSL_INOUT_LOCAL);
+	const auto _dot = glsl_gen_find_function(_gen, "dot");
 
+	bool _ok = true;
+	const auto _expect = [&](std::string_view _what, glsl_result _result, glsl_result _expected)
 	{
-		size_t n = 0;
-		for (auto& v : _params.inputs())
+		if (_result != _expected)
 		{
-			_ostr << "in " << v.type() << ' ' << v.name() << "; // id = " << v.id().get() << '\n';
-			++n;
-		};
-		if (n != 0)
-		{
-			_ostr << '\n';
+			std::cerr << _what << ": expected result " << int(_expected) << ", got " << int(_result) << ", "
+				<< glsl_gen_last_error(_gen) << '\n';
+			_ok = false;
+			return;
 		};
+		std::cout << _what << ": ok\n";
 	};
 
 	{
-		size_t n = 0;
-		for (auto& v : _params.outputs())
-		{
-			_ostr << "out " << v.type() << ' ' << v.name() << "; // id = " << v.id().get() << '\n';
-			++n;
-		};
-		if (n != 0)
-		{
-			_ostr << '\n';
-		};
+		glsl_expr_t* _args[] = { glsl_expr_variable(_pos), glsl_expr_variable(_pos) };
+		const auto _call = glsl_expr_call(_gen, _dot, _args, std::size(_args));
+		_expect("dot(vec3, vec3)", (_call) ? glsl_gen_declare(_gen, GLSL_MAIN_FUNCTION, _value, _call) : GLSL_ERROR_TYPE_MISMATCH,
+			GLSL_OK);
 	};
-
-	// Uniforms
 	{
-		for (auto& v : _params.uniforms())
-		{
-			_ostr << "uniform " << v.type() << ' ' << v.name() << ";\n";
-		};
+		glsl_expr_t* _args[] = { glsl_expr_swizzle(_gen, glsl_expr_variable(_pos), "xy"), glsl_expr_float(1.0f) };
+		const auto _call = glsl_expr_call(_gen, _dot, _args, std::size(_args));
+		_expect("dot(vec2, float)", (_call) ? GLSL_OK : GLSL_ERROR_TYPE_MISMATCH, GLSL_ERROR_TYPE_MISMATCH);
+		glsl_expr_destroy(_call);
 	};
 
-	_ostr << _params.main_fn.return_type() << ' '
-		<< _params.main_fn.name() << "()\n{\n";
+	size_t _size = 0;
+	_expect("emit", glsl_gen_emit(_gen, nullptr, 0, &_size), GLSL_ERROR_BUFFER_TOO_SMALL);
+	auto _source = std::string(_size + 1, '\0');
+	_expect("emit", glsl_gen_emit(_gen, _source.data(), _source.size(), &_size), GLSL_OK);
 
-	for (auto& v : _params.main_fn.body())
-	{
-		if (!v.expr.check_validity(_context))
-		{
-			HUBRIS_ASSERT(false);
-		};
+	glsl_gen_destroy(_gen);
+	return (_ok) ? 0 : 1;
+};
 
-		const auto _destID = v.dest;
-		const auto _dest = _params.get_name(_destID);
+/**
+ * @brief Builds a shader for the IR passes to rewrite: a small user function, a loop with a
+ *	constant trip count, a branch on a varying condition and multiplications by 1.
+*/
+void gen_pass_shader(GLSLGen& _gen)
+{
+	auto& _context = _gen.context;
+	auto& _params = _gen.params;
+	_params.version = 330;
 
-		const auto& _expr = v.expr;
+	add_builtin_vertex_shader_variables(_context);
+	add_builtin_functions(_context);
 
-		switch (v.type)
-		{
-		case GLSLStatementType::assignment:
-			_ostr << '\t' << _context.name(v.dest) << " = ";
-			break;
-		case GLSLStatementType::declaration:
-			_ostr << '\t' << _context.type(v.dest) << ' ' << _context.name(v.dest) << " = ";
-			break;
-		default:
-			abort();
-			break;
-		};
+	const auto _pos = _context.new_variable("in_pos", GLSLType::glsl_vec3)->set_inout(GLSLInOut::in).id();
+	const auto _outPos = _context.new_variable("out_pos", GLSLType::glsl_vec3)->set_inout(GLSLInOut::out).id();
+	const auto _outValue = _context.new_variable("out_value", GLSLType::glsl_float)->set_inout(GLSLInOut::out).id();
+
+	// float weight(float x) { return x * 2.0 + 1.0; }
+	auto& _weight = _params.define_function("weight", GLSLType::glsl_float, { { "x", GLSLType::glsl_float } });
+	{
+		auto _body = GLSLFunctionBuilder(_weight);
+		auto _scaled = _body.binary_op(_context, GLSLBinaryOperator::mult, _weight.params()[0], GLSLLiteral(2.0f));
+		_body.return_value(_context, _body.binary_op(_context, GLSLBinaryOperator::add, std::move(_scaled), GLSLLiteral(1.0f)));
+	};
 
-		if (!generate_expression_string(_ostr, _context, v.expr))
+	auto _main = GLSLFunctionBuilder(_params.main_fn);
+	const auto _x = [_pos]() { return GLSLExpression::make_unique(GLSLExpression::Swizzle(_pos, 0)); };
+	const auto _y = [_pos]() { return GLSLExpression::make_unique(GLSLExpression::Swizzle(_pos, 1)); };
+
+	// for (int i = 0; i < 4; i += 1) { sum = sum + in_pos.x; }
+	const auto _sum = _context.new_variable("sum", GLSLType::glsl_float)->id();
+	_main.declare(_context, _sum, GLSLLiteral(0.0f));
+	_main.for_loop(_context, _context.new_variable("i", GLSLType::glsl_int)->id(), 0, GLSLLiteral(4), 1,
+		[&](GLSLFunctionBuilder& _body)
 		{
-			abort();
-		};
+			_body.assign(_context, _sum, _body.binary_op(_context, GLSLBinaryOperator::add, _sum, _x()));
+		});
+
+	// if (in_pos.y < 0.5) { p = in_pos * 2.0; } else { p = in_pos - 1.0; }
+	const auto _p = _context.new_variable("p", GLSLType::glsl_vec3)->id();
+	_main.declare(_context, _p, _pos);
+	_main.if_else(_context, _main.binary_op(_context, GLSLBinaryOperator::lt, _y(), GLSLLiteral(0.5f)),
+		[&](GLSLFunctionBuilder& _then)
+		{
+			_then.assign(_context, _p, _then.binary_op(_context, GLSLBinaryOperator::mult, _pos, GLSLLiteral(2.0f)));
+		},
+		[&](GLSLFunctionBuilder& _else)
+		{
+			_else.assign(_context, _p, _else.binary_op(_context, GLSLBinaryOperator::sub, _pos, GLSLLiteral(1.0f)));
+		});
+
+	_main.assign(_context, _outPos, _main.binary_op(_context, GLSLBinaryOperator::mult, _p, GLSLLiteral(1.0f)));
+	_main.assign(_context, _outValue, GLSLExpression::make_unique(
+		GLSLExpression::FunctionCall(_weight.id()).add_param(_sum).resolve_params(_context)));
 
-		_ostr << ";\n";
+	if (!_params.check())
+	{
+		abort();
 	};
 
-	_ostr << "};\n";
+	deduce_auto(_context, _params);
 };
 
-
-struct GLSLFunctionBuilder
+/**
+ * @brief Runs "--check-ir" mode.
+ *
+ *	GLSLGen --check-ir
+ *
+ * Round trips the example shaders through binary IR, checking the GLSL written from the
+ * loaded copy is identical and that truncated or corrupted buffers fail validate(). The
+ * generated GLSL is parsed back, and a shader is taken through inlining, unrolling, branch
+ * conversion and simplification with the same checks after each pass. The result is run
+ * on the batch evaluator and compared against the values the original computes.
+*/
+int check_ir_main()
 {
-public:
-
-	GLSLFunctionBuilder& append_statement(GLSLStatement _statement)
+	bool _ok = true;
+	const auto _fail = [&_ok](std::string_view _name, std::string_view _what)
 	{
-		this->function_->append(std::move(_statement));
-		return *this;
+		std::cerr << _name << ": " << _what << '\n';
+		_ok = false;
 	};
 
-	GLSLFunctionBuilder& assign(GLSLContext& _context, GLSLVariableID _dest, GLSLExpression::Parameter _param)
+	const auto _checkBinary = [&](std::string_view _name, const GLSLGen& _gen)
 	{
-		auto _statement = GLSLStatement(GLSLStatementType::assignment);
-		_statement.dest = _dest;
-		
-		const auto _paramType = _param.type(_context);
-		const auto _destType = _context.type(_dest);
+		const auto _source = emit_glsl(_gen);
+		const auto _buffer = serialize_ir(_gen.context, _gen.params);
 
-		HUBRIS_ASSERT(_paramType != GLSLType::glsl_error);
-		HUBRIS_ASSERT(_paramType != GLSLType::glsl_auto);
-		HUBRIS_ASSERT(_destType != GLSLType::glsl_error);
+		auto _copy = GLSLGen();
+		if (!deserialize_ir(GLSLBinaryIR(_buffer), _copy.context, _copy.params))
+		{
+			return _fail(_name, "serialized IR failed to load");
+		};
+		if (emit_glsl(_copy) != _source)
+		{
+			return _fail(_name, "GLSL written from the loaded IR differs:\n" + emit_glsl(_copy));
+		};
+
+		for (size_t n = 0; n != _buffer.size(); ++n)
+		{
+			if (GLSLBinaryIR(std::span(_buffer).first(n)).validate())
+			{
+				return _fail(_name, std::format("IR truncated to {} bytes passed validation", n));
+			};
+		};
 
-		if (_paramType == _destType || _destType == GLSLType::glsl_auto)
+		// Header fields and section bounds the loader relies on
+		const auto _corrupt = [&](std::string_view _what, auto _fn)
+		{
+			auto _bytes = _buffer;
+			auto& _header = *reinterpret_cast<GLSLBinaryHeader*>(_bytes.data());
+			_fn(_header);
+			if (GLSLBinaryIR(_bytes).validate())
+			{
+				_fail(_name, std::string("IR with ") + std::string(_what) + " passed validation");
+			};
+		};
+		_corrupt("a bad magic", [](GLSLBinaryHeader& h) { h.magic[0] = 'X'; });
+		_corrupt("a newer major version", [](GLSLBinaryHeader& h) { ++h.version_major; });
+		_corrupt("the other endianness", [](GLSLBinaryHeader& h) { h.endian_tag = 0x0201; });
+		_corrupt("a wrong file size", [](GLSLBinaryHeader& h) { h.file_size += 8; });
+		_corrupt("statements past the end", [](GLSLBinaryHeader& h) { h.statements.count = 0x10000000; });
+		_corrupt("expressions past the end", [](GLSLBinaryHeader& h) { h.expressions.offset = h.file_size; h.expressions.count = 1; });
+		_corrupt("a misaligned section", [](GLSLBinaryHeader& h) { h.variables.offset += 1; });
+
+		// Any single corrupted byte is either rejected or loads IR that can still be written out
+		for (size_t n = 0; n != _buffer.size(); ++n)
 		{
-			if (_destType == GLSLType::glsl_auto)
+			auto _bytes = _buffer;
+			_bytes[n] ^= std::byte{ 0xFF };
+			auto _corrupted = GLSLGen();
+			if (deserialize_ir(GLSLBinaryIR(_bytes), _corrupted.context, _corrupted.params))
 			{
-				_context.set_deduced_type(_dest, _paramType);
+				static_cast<void>(emit_glsl(_corrupted));
 			};
+		};
+	};
 
-			auto _expr = GLSLExpression::Identity();
-			_expr.param = std::move(_param);
-			_statement.expr = std::move(_expr);
+	const auto _checkParse = [&](std::string_view _name, const GLSLGen& _gen, GLSLShaderStage _stage)
+	{
+		const auto _source = emit_glsl(_gen);
+
+		auto _copy = GLSLGen();
+		if (_stage == GLSLShaderStage::vertex)
+		{
+			add_builtin_vertex_shader_variables(_copy.context);
 		}
 		else
 		{
-			_statement.expr = GLSLExpression::Cast(_destType, std::move(_param));
+			add_builtin_fragment_shader_variables(_copy.context);
 		};
+		add_builtin_functions(_copy.context);
 
-		return this->append_statement(std::move(_statement));
+		const auto _parsed = parse_glsl(_source, _copy.context, _copy.params);
+		if (!_parsed)
+		{
+			return _fail(_name, std::format("generated GLSL failed to parse, {}:{}: {}", _parsed.line, _parsed.column, _parsed.error));
+		};
+		if (without_id_comments(emit_glsl(_copy)) != without_id_comments(_source))
+		{
+			return _fail(_name, "GLSL written from the parsed source differs:\n" + emit_glsl(_copy));
+		};
 	};
-	GLSLFunctionBuilder& declare(GLSLContext& _context, GLSLVariableID _dest, GLSLExpression::Parameter _param)
-	{
-		auto _statement = GLSLStatement(GLSLStatementType::declaration);
-		_statement.dest = _dest;
 
-		const auto _destType = _context.type(_dest);
-		const auto _paramType = _param.type(_context);
+	for (auto [_name, _genFn, _stage] : {
+		std::tuple{ "vertex", &gen_vertex_shader, GLSLShaderStage::vertex },
+		std::tuple{ "fragment", &gen_fragment_shader, GLSLShaderStage::fragment } })
+	{
+		auto g = GLSLGen();
+		_genFn(g);
+		_checkBinary(_name, g);
+		_checkParse(_name, g, _stage);
+	};
 
-		HUBRIS_ASSERT(_destType != GLSLType::glsl_error);
-		HUBRIS_ASSERT(_paramType != GLSLType::glsl_error);
+	// Each pass must leave a shader that checks and round trips
+	auto g = GLSLGen();
+	gen_pass_shader(g);
+	_checkBinary("passes", g);
 
-		if (_paramType == _destType || _destType == GLSLType::glsl_auto)
+	const std::pair<std::string_view, std::function<bool(GLSLGen&)>> _passes[] =
+	{
+		{ "inline", [](GLSLGen& g) { return inline_functions(g.context, g.params).calls_inlined != 0; } },
+		{ "unroll", [](GLSLGen& g) { return unroll_loops(g.context, g.params).loops_unrolled != 0; } },
+		{ "branch", [](GLSLGen& g) { return convert_branches(g.context, g.params).branches_converted != 0; } },
+		{ "simplify", [](GLSLGen& g) { return simplify_expressions(g.context, g.params).total() != 0; } },
+	};
+	for (auto& [_name, _pass] : _passes)
+	{
+		if (!_pass(g))
 		{
-			if (_destType == GLSLType::glsl_auto)
-			{
-				_context.set_deduced_type(_dest, _paramType);
-			};
-
-			auto _expr = GLSLExpression::Identity();
-			_expr.param = std::move(_param);
-			_statement.expr = std::move(_expr);
-		}
-		else
+			_fail(_name, "pass did not rewrite anything");
+		};
+		if (!g.params.check())
 		{
-			_statement.expr = GLSLExpression::Cast(_destType, std::move(_param));
+			_fail(_name, "shader failed to check after the pass");
+			continue;
 		};
-
-		return this->append_statement(std::move(_statement));
+		_checkBinary(_name, g);
 	};
+	_checkParse("passes", g, GLSLShaderStage::vertex);
 
-	GLSLExpression::UniqueExpression binary_op(GLSLContext& _context, GLSLBinaryOperator _op,
-		GLSLExpression::Parameter lhs, GLSLExpression::Parameter rhs)
+	// With loops, branches and calls gone the evaluator can run main
+	auto _eval = GLSLBatchEvaluator();
+	if (const auto _compiled = _eval.compile(g.context, g.params.main_fn); !_compiled)
 	{
-		// Check types.
-		const auto _lhsType = lhs.type(_context);
-		const auto _rhsType = rhs.type(_context);
-		
-		if (_lhsType != GLSLType::glsl_auto && _rhsType != GLSLType::glsl_auto)
+		_fail("passes", "evaluator failed to compile main, " + _compiled.error);
+	}
+	else
+	{
+		const float _x[] = { 0.25f, -1.0f, 3.0f };
+		const float _y[] = { 0.0f, 0.75f, 0.5f };
+		const float _z[] = { 1.0f, 2.0f, -0.5f };
+		constexpr auto _count = std::size(_x);
+		float _outX[_count]{};
+		float _outY[_count]{};
+		float _outZ[_count]{};
+		float _outValue[_count]{};
+		_eval.bind_input(g.context.id("in_pos"), { _x, _y, _z });
+		_eval.bind_output(g.context.id("out_pos"), { _outX, _outY, _outZ });
+		_eval.bind_output(g.context.id("out_value"), { _outValue });
+		if (const auto _run = _eval.run(_count); !_run)
 		{
-			// Both parameters are not set to auto, make sure the expression is invocable
-			if (!invocable(_op, _lhsType, _rhsType))
+			_fail("passes", "evaluator failed to run, " + _run.error);
+		};
+
+		for (size_t n = 0; n != _count; ++n)
+		{
+			const auto _map = [&](float v) { return (_y[n] < 0.5f) ? v * 2.0f : v - 1.0f; };
+			const auto _close = [](float a, float b) { return std::abs(a - b) <= 1e-5f * std::max(1.0f, std::abs(b)); };
+			if (!_close(_outX[n], _map(_x[n])) || !_close(_outY[n], _map(_y[n])) || !_close(_outZ[n], _map(_z[n])) ||
+				!_close(_outValue[n], _x[n] * 4.0f * 2.0f + 1.0f))
 			{
-				// NOT invocable, try for a cast?
-				HUBRIS_ASSERT(false);
+				_fail("passes", std::format("invocation {} computed a different result", n));
 			};
 		};
-
-		// Construct the expression
-		return GLSLExpression::make_unique(GLSLExpression::BinaryOp(_op, std::move(lhs), std::move(rhs)));
 	};
 
-	GLSLFunctionBuilder(GLSLFunction& _function) :
-		function_(&_function)
-	{};
-
-private:
-	GLSLFunction* function_;
+	if (_ok)
+	{
+		std::cout << "binary IR, parser and pass round trips ok\n";
+	};
+	return (_ok) ? 0 : 1;
 };
 
-
-struct GLSLGen
+/**
+ * @brief Runs "--check-static" mode.
+ *
+ *	GLSLGen --check-static
+ *
+ * Checks that fragment_source_v, generated at compile time, is what generate_glsl() writes
+ * for gen_fragment_shader() once the variable ID comments are removed.
+*/
+int check_static_main()
 {
-	GLSLContext context;
-	GLSLParams params;
+	auto g = GLSLGen();
+	gen_fragment_shader(g);
+	const auto _runtime = without_id_comments(emit_glsl(g));
 
-	GLSLGen() :
-		context(),
-		params(this->context)
-	{};
+	if (_runtime != fragment_source_v.view())
+	{
+		std::cerr << "fragment: compile-time source differs from generate_glsl()\n" << fragment_source_v.view()
+			<< "---\n" << _runtime;
+		return 1;
+	};
+	std::cout << "fragment: compile-time source matches\n";
+	return 0;
 };
 
-void gen_vertex_shader(GLSLGen& _gen)
+/**
+ * @brief Most the example shaders may cost, generating them fails if a change pushes one over.
+*/
+constexpr auto example_budget_v = GLSLCostBudget{ .alu = 64.0, .transcendental = 8.0, .texture = 4.0, .interpolants = 8 };
+
+/**
+ * @brief Writes an example shader's source for its own version, checked against example_budget_v.
+ * @return False if nothing was written, the reasons are logged.
+*/
+bool write_example_shader(const fs::path& _outPath, void(*_genFn)(GLSLGen&), GLSLShaderStage _stage)
 {
-	auto& _context = _gen.context;
-	auto& _params = _gen.params;
-	_params.version = 330;
+	auto g = GLSLGen();
+	_genFn(g);
 
-	add_builtin_vertex_shader_variables(_context);
-	add_builtin_functions(_context);
+	auto _target = GLSLTarget::from_params(g.params);
+	_target.budget = example_budget_v;
+	const auto _outputs = generate_glsl_targets(g.context, g.params, _stage, std::span<const GLSLTarget>(&_target, 1));
 
+	const auto& _output = _outputs.front();
+	if (!_output.ok())
 	{
-		_context.new_variable("in_pos", GLSLType::glsl_vec3)
-			->set_inout(GLSLInOut::in);
-		_context.new_variable("in_uvs", GLSLType::glsl_vec2)
-			->set_inout(GLSLInOut::in);
-		_context.new_variable("in_col", GLSLType::glsl_vec4)
-			->set_inout(GLSLInOut::in);
-
-		_context.new_variable("frag_uvs", GLSLType::glsl_auto)
-			->set_inout(GLSLInOut::out);
-		_context.new_variable("frag_col", GLSLType::glsl_vec4)
-			->set_inout(GLSLInOut::out);
+		for (auto& _reasons : { &_output.missing, &_output.over_budget })
+		{
+			for (auto& v : *_reasons)
+			{
+				std::cerr << _outPath.filename().string() << ": " << v << '\n';
+			};
+		};
+		return false;
 	};
 
-	{
-		auto _main = GLSLFunctionBuilder(_params.main_fn);
-		_main.assign(_context, _context.id("frag_uvs"), _context.id("in_uvs"));
-		_main.assign(_context, _context.id("frag_col"), _context.id("in_col"));
-		_main.assign(_context, _context.id("gl_Position"), _context.id("in_pos"));
-
-		_main.declare(_context, _context.new_variable()->id(),
-			GLSLExpression::make_unique(
-				GLSLExpression::FunctionCall(_context.function_id("cos"))
-				.add_param(
-					GLSLExpression::make_unique(
-						GLSLExpression::Swizzle(_context.id("in_pos"), 0, 1)
-					)
-				)
-			)
-		);
+	write_text_file(_outPath, _output.source);
+	return true;
+};
 
+int main(int _nargs, char* _vargs[])
+{
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--watch")
+	{
+		return watch_main(std::span<char* const>(_vargs + 2, _vargs + _nargs));
 	};
-
-	if (!_params.check())
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-spirv")
 	{
-		abort();
+		return check_spirv_main();
 	};
-
-	deduce_auto(_context, _params);
-};
-void gen_fragment_shader(GLSLGen& _gen)
-{
-	auto& _context = _gen.context;
-	auto& _params = _gen.params;
-	_params.version = 330;
-
-	// Add builtins
-	add_builtin_fragment_shader_variables(_gen.context);
-	add_builtin_functions(_gen.context);
-
-	// Define shader
-
-	// Inputs
-	_context.new_variable("frag_col", GLSLType::glsl_vec4)->set_inout(GLSLInOut::in);
-	_context.new_variable("frag_uvs", GLSLType::glsl_vec3)->set_inout(GLSLInOut::in);
-
-	// Output(s)
-	_context.new_variable("color", GLSLType::glsl_vec4)->set_inout(GLSLInOut::out);
-
-	// Fingers crossed.
-	_context.new_variable("test_texture", GLSLType::glsl_sampler_2D_array);
-
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-watch")
 	{
-		auto _main = GLSLFunctionBuilder(_params.main_fn);
-
-		// Get texel color.
-		auto _texel = _context.new_variable("texel",
-			GLSLType::glsl_vec4);
-
-		_main.declare(_context, _texel->id(),
-			GLSLExpression::make_unique
-			(
-				GLSLExpression::FunctionCall(_context.function_id("texture"))
-					.add_param(_context.id("test_texture"))
-					.add_param(_context.id("frag_uvs"))
-					.resolve_params(_context)
-			)
-		);
-
-		// Assign to color output.
-		_main.assign(_context, _context.id("color"), _texel->id());
+		return check_watch_main();
 	};
-
-
-	if (!_params.check())
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-parse")
 	{
-		abort();
+		return check_parse_main();
 	};
-
-	deduce_auto(_context, _params);
-};
-
-int main()
-{
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-c-api")
 	{
-		const auto _outPath = fs::path(PROJECT_SOURCE_ROOT "/vertex.glsl");
-		auto g = GLSLGen();
-		gen_vertex_shader(g);
-		auto f = std::ofstream(_outPath);
-		generate_glsl(g.context, g.params, f);
-	}
-
+		return check_c_api_main();
+	};
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-ir")
 	{
-		const auto _outPath = fs::path(PROJECT_SOURCE_ROOT "/fragment.glsl");
-		auto g = GLSLGen();
-		gen_fragment_shader(g);
-		auto f = std::ofstream(_outPath);
-		generate_glsl(g.context, g.params, f);
+		return check_ir_main();
+	};
+	if (_nargs >= 2 && std::string_view(_vargs[1]) == "--check-static")
+	{
+		return check_static_main();
 	};
 
-	return 0;
+	const auto _vertex = write_example_shader(PROJECT_SOURCE_ROOT "/vertex.glsl", gen_vertex_shader, GLSLShaderStage::vertex);
+	const auto _fragment = write_example_shader(PROJECT_SOURCE_ROOT "/fragment.glsl", gen_fragment_shader,
+		GLSLShaderStage::fragment);
+	return (_vertex && _fragment) ? 0 : 1;
 };
@@ -0,0 +1,167 @@
+/*
+	Counting allocation hook, replaces the global operator new and delete.
+
+	Only built when GLSL_GEN_ALLOC_HOOK is defined to 1. Every allocation carries a small
+	header holding its size and the stats active when it was made. A free is subtracted from
+	the live byte count of those stats only, and only while they are the ones active on the
+	freeing thread: that keeps them alive and unshared, frees outside their scope go uncounted.
+*/
+
+#include "GLSLGenStats.hpp"
+
+#ifndef GLSL_GEN_ALLOC_HOOK
+	#define GLSL_GEN_ALLOC_HOOK 0
+#endif
+
+#if GLSL_GEN_ALLOC_HOOK && GLSL_GEN_STATS
+
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+
+namespace glsl
+{
+	namespace
+	{
+		struct AllocHeader
+		{
+			void* base;
+			size_t size;
+			// Stats active when allocated, null if none
+			GLSLStats* owner;
+		};
+
+		// Header space in front of default aligned allocations, keeps the result aligned
+		constexpr size_t alloc_header_space_v =
+			(sizeof(AllocHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+		AllocHeader* alloc_header(void* _ptr) noexcept
+		{
+			return static_cast<AllocHeader*>(_ptr) - 1;
+		};
+
+		void* counted_alloc(size_t _size, size_t _align) noexcept
+		{
+			const auto _space = (_align <= alignof(std::max_align_t)) ? alloc_header_space_v :
+				alloc_header_space_v + _align;
+
+			const auto _base = std::malloc(_size + _space);
+			if (!_base)
+			{
+				return nullptr;
+			};
+
+			auto _ptr = static_cast<std::byte*>(_base) + alloc_header_space_v;
+			if (_align > alignof(std::max_align_t))
+			{
+				const auto _addr = reinterpret_cast<uintptr_t>(_ptr);
+				_ptr += (_align - _addr % _align) % _align;
+			};
+
+			const auto _stats = impl::active_stats_;
+			*alloc_header(_ptr) = AllocHeader{ _base, _size, _stats };
+			if (_stats)
+			{
+				_stats->add_allocation(impl::alloc_site_, _size);
+			};
+			return _ptr;
+		};
+
+		void counted_free(void* _ptr) noexcept
+		{
+			if (!_ptr)
+			{
+				return;
+			};
+
+			const auto _header = *alloc_header(_ptr);
+			if (_header.owner && _header.owner == impl::active_stats_)
+			{
+				_header.owner->add_deallocation(_header.size);
+			};
+			std::free(_header.base);
+		};
+
+		void* counted_alloc_or_throw(size_t _size, size_t _align)
+		{
+			while (true)
+			{
+				if (const auto _ptr = counted_alloc(_size, _align); _ptr)
+				{
+					return _ptr;
+				};
+
+				const auto _handler = std::get_new_handler();
+				if (!_handler)
+				{
+					throw std::bad_alloc();
+				};
+				_handler();
+			};
+		};
+	};
+
+	bool allocation_hook_installed() noexcept
+	{
+		return true;
+	};
+};
+
+void* operator new(size_t _size)
+{
+	return glsl::counted_alloc_or_throw(_size, alignof(std::max_align_t));
+};
+void* operator new[](size_t _size)
+{
+	return glsl::counted_alloc_or_throw(_size, alignof(std::max_align_t));
+};
+void* operator new(size_t _size, std::align_val_t _align)
+{
+	return glsl::counted_alloc_or_throw(_size, static_cast<size_t>(_align));
+};
+void* operator new[](size_t _size, std::align_val_t _align)
+{
+	return glsl::counted_alloc_or_throw(_size, static_cast<size_t>(_align));
+};
+void* operator new(size_t _size, const std::nothrow_t&) noexcept
+{
+	return glsl::counted_alloc(_size, alignof(std::max_align_t));
+};
+void* operator new[](size_t _size, const std::nothrow_t&) noexcept
+{
+	return glsl::counted_alloc(_size, alignof(std::max_align_t));
+};
+void* operator new(size_t _size, std::align_val_t _align, const std::nothrow_t&) noexcept
+{
+	return glsl::counted_alloc(_size, static_cast<size_t>(_align));
+};
+void* operator new[](size_t _size, std::align_val_t _align, const std::nothrow_t&) noexcept
+{
+	return glsl::counted_alloc(_size, static_cast<size_t>(_align));
+};
+
+void operator delete(void* _ptr) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr) noexcept { glsl::counted_free(_ptr); };
+void operator delete(void* _ptr, size_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr, size_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete(void* _ptr, std::align_val_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr, std::align_val_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete(void* _ptr, size_t, std::align_val_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr, size_t, std::align_val_t) noexcept { glsl::counted_free(_ptr); };
+void operator delete(void* _ptr, const std::nothrow_t&) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr, const std::nothrow_t&) noexcept { glsl::counted_free(_ptr); };
+void operator delete(void* _ptr, std::align_val_t, const std::nothrow_t&) noexcept { glsl::counted_free(_ptr); };
+void operator delete[](void* _ptr, std::align_val_t, const std::nothrow_t&) noexcept { glsl::counted_free(_ptr); };
+
+#else
+
+namespace glsl
+{
+	bool allocation_hook_installed() noexcept
+	{
+		return false;
+	};
+};
+
+#endif
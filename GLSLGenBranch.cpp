@@ -0,0 +1,308 @@
+#include "GLSLGenBranch.hpp"
+
+#include <map>
+#include <set>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief Finds the variables that may hold a different value in each invocation.
+		*/
+		struct UniformityAnalysis
+		{
+			const GLSLContext* context;
+			const GLSLParams* params;
+
+			// Locals found to vary, anything not local is judged by its qualifiers
+			std::set<GLSLVariableID> varying{};
+
+			bool is_uniform(GLSLVariableID _id) const
+			{
+				const auto _var = this->context->find(_id);
+				if (!_var)
+				{
+					return false;
+				};
+				if (_var->uniform() || _var->is_const())
+				{
+					return true;
+				};
+				if (_var->inout() != GLSLInOut::local || _var->builtin())
+				{
+					return false;
+				};
+				return !this->varying.contains(_id);
+			};
+
+			bool is_uniform(const GLSLExpression& _expr) const
+			{
+				bool _uniform = true;
+				for_each_expression(_expr, [this, &_uniform](const GLSLExpression& _node)
+					{
+						if (!_uniform)
+						{
+							return;
+						};
+
+						// User functions may read anything, only builtins are looked through
+						if (_node.type() == GLSLExpressionType::function_call)
+						{
+							const auto _function = this->context->find(_node.get<GLSLExpression::FunctionCall>().function);
+							if (!_function || !_function->builtin())
+							{
+								_uniform = false;
+								return;
+							};
+						};
+						for_each_param(_node, [this, &_uniform](const GLSLExpression::Parameter& _param)
+							{
+								if (_param.is_variable() && !this->is_uniform(_param.id()))
+								{
+									_uniform = false;
+								};
+							});
+					});
+				return _uniform;
+			};
+
+			/**
+			 * @brief Marks the locals written with varying values.
+			 * @param _underVarying Set within loops or branches on varying conditions.
+			 * @return True if anything new was marked.
+			*/
+			bool visit(std::span<const GLSLStatement> _statements, bool _underVarying)
+			{
+				bool _changed = false;
+				for (auto& _statement : _statements)
+				{
+					const auto _uniformExpr = this->is_uniform(_statement.expr);
+					if (_statement.has_dest() && (_underVarying || !_uniformExpr) &&
+						this->varying.insert(_statement.dest).second)
+					{
+						_changed = true;
+					};
+
+					const auto _nestedVarying = _underVarying || !_uniformExpr;
+					_changed = this->visit(_statement.body, _nestedVarying) || _changed;
+					_changed = this->visit(_statement.else_body, _nestedVarying) || _changed;
+				};
+				return _changed;
+			};
+
+			/**
+			 * @brief Runs the analysis over the whole shader.
+			 *
+			 * Locals start out uniform and are marked as their writes are found to vary, until
+			 * nothing changes. Callers are not looked at, so everything written within user
+			 * functions is varying, parameters included.
+			*/
+			void run()
+			{
+				for (auto& _function : this->params->functions)
+				{
+					for (auto _param : _function.params())
+					{
+						this->varying.insert(_param);
+					};
+				};
+
+				bool _changed = true;
+				while (_changed)
+				{
+					_changed = this->visit(this->params->globals, false);
+					for (auto& _function : this->params->functions)
+					{
+						_changed = this->visit(_function.body(), true) || _changed;
+					};
+					_changed = this->visit(this->params->main_fn.body(), false) || _changed;
+				};
+			};
+		};
+
+		GLSLExpression::Parameter to_parameter(GLSLExpression&& _expr)
+		{
+			if (_expr.type() == GLSLExpressionType::identity)
+			{
+				return std::move(_expr.get<GLSLExpression::Identity>().param);
+			};
+			return GLSLExpression::Parameter(GLSLExpression::make_unique(std::move(_expr)));
+		};
+
+		struct IfConverter
+		{
+			GLSLContext* context;
+			const GLSLIfConvertOptions* options;
+			const UniformityAnalysis* uniformity;
+			GLSLIfConvertStats stats{};
+
+			/**
+			 * @brief Checks if an arm can be evaluated unconditionally.
+			 *
+			 * Its expressions are then evaluated whichever arm is taken, so they must not call
+			 * user functions, which may write globals or outputs.
+			*/
+			bool is_convertible(std::span<const GLSLStatement> _arm) const
+			{
+				for (auto& _statement : _arm)
+				{
+					if (_statement.type != GLSLStatementType::declaration &&
+						_statement.type != GLSLStatementType::assignment)
+					{
+						return false;
+					};
+					if (calls_user_functions(*this->context, _statement.expr))
+					{
+						return false;
+					};
+					if (_statement.type == GLSLStatementType::declaration)
+					{
+						continue;
+					};
+
+					// Writing a builtin output at all can change its meaning, ie. gl_FragDepth
+					const auto _var = this->context->find(_statement.dest);
+					if (!_var || _var->builtin())
+					{
+						return false;
+					};
+				};
+				return true;
+			};
+
+			/**
+			 * @brief Appends an arm's statements, assignments only taking effect on its side of the condition.
+			*/
+			void append_arm(std::vector<GLSLStatement>& _arm, GLSLVariableID _condition, bool _taken,
+				std::vector<GLSLStatement>& _out)
+			{
+				auto& _context = *this->context;
+
+				// Declarations move out of the arm's scope, fresh variables keep their names unique
+				auto _with = std::map<GLSLVariableID, GLSLExpression::Parameter>();
+				for (auto& _statement : _arm)
+				{
+					if (!_with.empty())
+					{
+						// Clone first, pooled nodes may be shared with other statements
+						_statement.expr = _statement.expr.clone();
+						substitute_variables(_statement.expr, _with);
+					};
+					if (_statement.type == GLSLStatementType::declaration)
+					{
+						const auto _local = _context.new_variable(_context.type(_statement.dest))->id();
+						_with.insert_or_assign(_statement.dest, GLSLExpression::Parameter(_local));
+						_statement.dest = _local;
+						_out.push_back(std::move(_statement));
+						continue;
+					};
+
+					auto _value = to_parameter(std::move(_statement.expr));
+					if (_value.is_variable() && _value.id() == _statement.dest)
+					{
+						// Assigns the variable to itself, the select would pick it either way
+						continue;
+					};
+					auto _current = GLSLExpression::Parameter(_statement.dest);
+					auto _select = (_taken) ?
+						GLSLExpression::Select(_condition, std::move(_value), std::move(_current)) :
+						GLSLExpression::Select(_condition, std::move(_current), std::move(_value));
+
+					auto _assign = GLSLStatement(GLSLStatementType::assignment);
+					_assign.dest = _statement.dest;
+					_assign.expr = GLSLExpression(std::move(_select));
+					_out.push_back(std::move(_assign));
+				};
+			};
+
+			/**
+			 * @brief Appends a branch to a statement list, converted into selects if worthwhile.
+			*/
+			void convert(GLSLStatement& _branch, std::vector<GLSLStatement>& _out)
+			{
+				auto& _context = *this->context;
+
+				if (this->uniformity->is_uniform(_branch.expr))
+				{
+					++this->stats.branches_uniform;
+					_out.push_back(std::move(_branch));
+					return;
+				};
+				if (!this->is_convertible(_branch.body) || !this->is_convertible(_branch.else_body) ||
+					statement_size(_branch.body) + statement_size(_branch.else_body) > this->options->max_size)
+				{
+					++this->stats.branches_kept;
+					_out.push_back(std::move(_branch));
+					return;
+				};
+
+				// The arms may write what the condition reads, evaluate it once up front unless
+				// it is a variable left alone by both
+				auto _condition = GLSLVariableID();
+				if (_branch.expr.type() == GLSLExpressionType::identity)
+				{
+					const auto& _param = _branch.expr.get<GLSLExpression::Identity>().param;
+					const auto _written = [&_param](const GLSLStatement& v) { return v.dest == _param.id(); };
+					if (_param.is_variable() && std::ranges::none_of(_branch.body, _written) &&
+						std::ranges::none_of(_branch.else_body, _written))
+					{
+						_condition = _param.id();
+					};
+				};
+				if (!_condition)
+				{
+					_condition = _context.new_variable(GLSLType::glsl_bool)->id();
+					auto _declare = GLSLStatement(GLSLStatementType::declaration);
+					_declare.dest = _condition;
+					_declare.expr = std::move(_branch.expr);
+					_out.push_back(std::move(_declare));
+				};
+
+				this->append_arm(_branch.body, _condition, true, _out);
+				this->append_arm(_branch.else_body, _condition, false, _out);
+				++this->stats.branches_converted;
+			};
+
+			/**
+			 * @brief Converts the branches within a statement list, innermost first.
+			*/
+			std::vector<GLSLStatement> convert_statements(std::span<GLSLStatement> _statements)
+			{
+				auto _out = std::vector<GLSLStatement>();
+				_out.reserve(_statements.size());
+
+				for (auto& _statement : _statements)
+				{
+					_statement.body = this->convert_statements(_statement.body);
+					_statement.else_body = this->convert_statements(_statement.else_body);
+					if (_statement.type == GLSLStatementType::if_else)
+					{
+						this->convert(_statement, _out);
+						continue;
+					};
+					_out.push_back(std::move(_statement));
+				};
+
+				return _out;
+			};
+		};
+	};
+
+	GLSLIfConvertStats convert_branches(GLSLContext& _context, GLSLParams& _params, const GLSLIfConvertOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		auto _uniformity = UniformityAnalysis{ &_context, &_params };
+		_uniformity.run();
+
+		auto _converter = IfConverter{ &_context, &_options, &_uniformity };
+		for (auto& _function : _params.functions)
+		{
+			_function.set_body(_converter.convert_statements(_function.body()));
+		};
+		_params.main_fn.set_body(_converter.convert_statements(_params.main_fn.body()));
+		return _converter.stats;
+	};
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <cstddef>
+
+namespace glsl
+{
+	/**
+	 * @brief Heuristic used to decide which branches are converted into selects.
+	*/
+	struct GLSLIfConvertOptions
+	{
+		/**
+		 * @brief Largest pair of arms converted, both arms counted together in statements plus
+		 *	expression nodes, see statement_size(). Both arms are evaluated once converted.
+		*/
+		size_t max_size = 16;
+	};
+
+	/**
+	 * @brief Summary of what convert_branches() did with each branch.
+	*/
+	struct GLSLIfConvertStats
+	{
+		size_t branches_converted = 0;
+
+		// Kept, the condition only reads uniforms so every invocation takes the same arm
+		size_t branches_uniform = 0;
+
+		// Kept, too large or the arms hold loops, branches, user function calls or writes to builtins
+		size_t branches_kept = 0;
+	};
+
+	/**
+	 * @brief Rewrites short branches on varying conditions into branchless selects.
+	 *
+	 * Invocations taking different arms of a branch diverge, which costs both arms on most
+	 * GPUs anyway. A branch whose arms only declare and assign variables is replaced by its
+	 * arms one after the other, each assignment picking between its new value and the
+	 * variable's current one with "c ? a : b". The condition is evaluated once ahead of them.
+	 *
+	 * Both arms' expressions are then evaluated whichever arm is taken, so arms calling user
+	 * functions are never converted, those may write globals or outputs.
+	 *
+	 * Branches on uniform conditions are coherent and cheap, they stay branches. A condition
+	 * is uniform if it only reads literals, uniforms, constants and locals that are only ever
+	 * assigned uniform values outside of varying control flow, through builtin calls.
+	 *
+	 * Inner branches are visited first, so a branch holding only convertible branches may be
+	 * converted as a whole.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @param _options Conversion heuristic.
+	 * @return Conversion statistics.
+	*/
+	GLSLIfConvertStats convert_branches(GLSLContext& _context, GLSLParams& _params, const GLSLIfConvertOptions& _options = {});
+};
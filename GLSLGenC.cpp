@@ -0,0 +1,624 @@
+#include "GLSLGenC.h"
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenStream.hpp"
+
+#include <new>
+#include <array>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <string_view>
+
+using namespace glsl;
+
+struct glsl_gen_t
+{
+	GLSLGen gen{};
+
+	// Message for glsl_gen_last_error()
+	std::string error{};
+};
+
+struct glsl_expr_t
+{
+	GLSLExpression::Parameter param;
+};
+
+namespace
+{
+	// The C enums are part of the ABI, they must keep matching the C++ ones.
+	static_assert(static_cast<int>(GLSLType::glsl_auto) == GLSL_TYPE_AUTO);
+	static_assert(static_cast<int>(GLSLType::glsl_void) == GLSL_TYPE_VOID);
+	static_assert(static_cast<int>(GLSLType::glsl_bool) == GLSL_TYPE_BOOL);
+	static_assert(static_cast<int>(GLSLType::glsl_int) == GLSL_TYPE_INT);
+	static_assert(static_cast<int>(GLSLType::glsl_float) == GLSL_TYPE_FLOAT);
+	static_assert(static_cast<int>(GLSLType::glsl_vec2) == GLSL_TYPE_VEC2);
+	static_assert(static_cast<int>(GLSLType::glsl_vec3) == GLSL_TYPE_VEC3);
+	static_assert(static_cast<int>(GLSLType::glsl_vec4) == GLSL_TYPE_VEC4);
+	static_assert(static_cast<int>(GLSLType::glsl_double) == GLSL_TYPE_DOUBLE);
+	static_assert(static_cast<int>(GLSLType::glsl_dvec2) == GLSL_TYPE_DVEC2);
+	static_assert(static_cast<int>(GLSLType::glsl_dvec3) == GLSL_TYPE_DVEC3);
+	static_assert(static_cast<int>(GLSLType::glsl_dvec4) == GLSL_TYPE_DVEC4);
+	static_assert(static_cast<int>(GLSLType::glsl_mat4) == GLSL_TYPE_MAT4);
+	static_assert(static_cast<int>(GLSLType::glsl_sampler_2D) == GLSL_TYPE_SAMPLER_2D);
+	static_assert(static_cast<int>(GLSLType::glsl_sampler_2D_array) == GLSL_TYPE_SAMPLER_2D_ARRAY);
+
+	static_assert(static_cast<int>(GLSLInOut::local) == GLSL_INOUT_LOCAL);
+	static_assert(static_cast<int>(GLSLInOut::in) == GLSL_INOUT_IN);
+	static_assert(static_cast<int>(GLSLInOut::out) == GLSL_INOUT_OUT);
+
+	static_assert(static_cast<int>(GLSLBinaryOperator::add) == GLSL_OP_ADD);
+	static_assert(static_cast<int>(GLSLBinaryOperator::sub) == GLSL_OP_SUB);
+	static_assert(static_cast<int>(GLSLBinaryOperator::mult) == GLSL_OP_MUL);
+	static_assert(static_cast<int>(GLSLBinaryOperator::div) == GLSL_OP_DIV);
+	static_assert(static_cast<int>(GLSLBinaryOperator::eq) == GLSL_OP_EQ);
+	static_assert(static_cast<int>(GLSLBinaryOperator::neq) == GLSL_OP_NEQ);
+	static_assert(static_cast<int>(GLSLBinaryOperator::lt) == GLSL_OP_LT);
+	static_assert(static_cast<int>(GLSLBinaryOperator::le) == GLSL_OP_LE);
+	static_assert(static_cast<int>(GLSLBinaryOperator::gt) == GLSL_OP_GT);
+	static_assert(static_cast<int>(GLSLBinaryOperator::ge) == GLSL_OP_GE);
+
+	using ExprHandle = std::unique_ptr<glsl_expr_t>;
+
+	/**
+	 * @brief Destroys an array of expressions when leaving scope.
+	*/
+	struct ArgsGuard
+	{
+		glsl_expr_t* const* args;
+		size_t count;
+
+		~ArgsGuard()
+		{
+			for (size_t n = 0; n != this->count; ++n)
+			{
+				delete this->args[n];
+			};
+		};
+	};
+
+	/**
+	 * @brief Thrown by the entry points to fail with a result code, caught by guard().
+	*/
+	struct CError
+	{
+		glsl_result result;
+		const char* what;
+	};
+
+	/**
+	 * @brief Runs an entry point's body, turning exceptions into a result.
+	 * @param _gen Generator to record the error on, may be null.
+	 * @param _onError Returned on failure.
+	 * @param _fn Body.
+	*/
+	template <typename T, typename FnT>
+	T guard(const glsl_gen_t* _gen, T _onError, FnT&& _fn) noexcept
+	{
+		auto _record = [_gen](const char* _what) noexcept
+		{
+			if (_gen)
+			{
+				try
+				{
+					const_cast<glsl_gen_t*>(_gen)->error = _what;
+				}
+				catch (...)
+				{
+				};
+			};
+		};
+
+		try
+		{
+			_record("");
+			return _fn();
+		}
+		catch (const CError& e)
+		{
+			_record(e.what);
+			if constexpr (std::is_same_v<T, glsl_result>)
+			{
+				return e.result;
+			}
+			else
+			{
+				return _onError;
+			};
+		}
+		catch (const std::bad_alloc&)
+		{
+			_record("out of memory");
+		}
+		catch (const std::exception& e)
+		{
+			_record(e.what());
+		}
+		catch (...)
+		{
+			_record("unknown error");
+		};
+
+		if constexpr (std::is_same_v<T, glsl_result>)
+		{
+			return GLSL_ERROR_INTERNAL;
+		}
+		else
+		{
+			return _onError;
+		};
+	};
+
+	void require(bool _condition, glsl_result _result, const char* _what)
+	{
+		if (!_condition)
+		{
+			throw CError{ _result, _what };
+		};
+	};
+
+	bool is_value_type(glsl_type _type)
+	{
+		return _type > GLSL_TYPE_VOID && _type <= GLSL_TYPE_SAMPLER_2D_ARRAY;
+	};
+
+	glsl_expr_t* make_expr(GLSLExpression::Parameter _param)
+	{
+		return new glsl_expr_t{ std::move(_param) };
+	};
+
+	/**
+	 * @brief Gets the type of an expression, which must be known.
+	*/
+	GLSLType known_type(const GLSLContext& _context, const glsl_expr_t* _expr)
+	{
+		require(_expr != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "expression is null");
+
+		// Variable handles are not checked when made, nested expressions were checked by the call making them
+		require(!_expr->param.is_variable() || _context.find(_expr->param.id()) != nullptr, GLSL_ERROR_NOT_FOUND,
+			"variable does not exist");
+		const auto _type = _expr->param.type(_context);
+		require(_type != GLSLType::glsl_error, GLSL_ERROR_TYPE_MISMATCH, "expression is not valid");
+		require(_type != GLSLType::glsl_auto, GLSL_ERROR_TYPE_MISMATCH, "expression type is not deduced yet");
+		return _type;
+	};
+
+	GLSLFunction& statement_function(glsl_gen_t* _gen, glsl_fn_t _function)
+	{
+		if (_function == GLSL_MAIN_FUNCTION)
+		{
+			return _gen->gen.params.main_fn;
+		};
+		const auto _out = _gen->gen.params.find_function(GLSLFunctionID(_function));
+		require(_out != nullptr, GLSL_ERROR_NOT_FOUND, "function is not defined");
+		return *_out;
+	};
+
+	glsl_result append_statement(glsl_gen_t* _gen, GLSLStatementType _type, glsl_fn_t _function, glsl_var_t _dest,
+		glsl_expr_t* _value)
+	{
+		auto _expr = ExprHandle(_value);
+		return guard(_gen, GLSL_ERROR_INTERNAL, [&]() -> glsl_result
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+
+				auto& _context = _gen->gen.context;
+				auto& _fn = statement_function(_gen, _function);
+				const auto _valueType = known_type(_context, _expr.get());
+
+				auto _destType = GLSLType::glsl_error;
+				if (_type == GLSLStatementType::return_value)
+				{
+					_destType = _fn.return_type();
+					require(_destType != GLSLType::glsl_void, GLSL_ERROR_TYPE_MISMATCH, "function returns void");
+				}
+				else
+				{
+					const auto _var = _context.find(GLSLVariableID(_dest));
+					require(_var != nullptr, GLSL_ERROR_NOT_FOUND, "variable does not exist");
+					_destType = _var->type();
+				};
+				require(_destType == GLSLType::glsl_auto || is_implicitly_convertible_to(_valueType, _destType),
+					GLSL_ERROR_TYPE_MISMATCH, "value is not convertible to the destination type");
+
+				// Calls are only checked here, expressions don't know the function they end up in
+				if (_expr->param.is_expression())
+				{
+					for_each_expression(_expr->param.expr(), [&](const GLSLExpression& _node)
+						{
+							require(_node.type() != GLSLExpressionType::function_call ||
+								_gen->gen.params.may_call(_fn, _node.get<GLSLExpression::FunctionCall>().function),
+								GLSL_ERROR_INVALID_ARGUMENT, "function may only call functions defined before it");
+						});
+				};
+
+				auto _builder = GLSLFunctionBuilder(_fn);
+				switch (_type)
+				{
+				case GLSLStatementType::declaration:
+					_builder.declare(_context, GLSLVariableID(_dest), std::move(_expr->param));
+					break;
+				case GLSLStatementType::assignment:
+					_builder.assign(_context, GLSLVariableID(_dest), std::move(_expr->param));
+					break;
+				case GLSLStatementType::return_value:
+					_builder.return_value(_context, std::move(_expr->param));
+					break;
+				default:
+					require(false, GLSL_ERROR_INVALID_ARGUMENT, "loops and branches are not appended as single statements");
+					break;
+				};
+				return GLSL_OK;
+			});
+	};
+
+	/**
+	 * @brief Checks the shader and deduces auto types, run before emitting.
+	*/
+	void prepare(glsl_gen_t* _gen)
+	{
+		require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+		require(_gen->gen.params.check(), GLSL_ERROR_CHECK_FAILED, "shader check failed");
+		require(deduce_auto(_gen->gen.context, _gen->gen.params), GLSL_ERROR_CHECK_FAILED, "could not deduce auto types");
+
+		// Declared auto but never written, the emitter has no type to declare them with
+		require(std::ranges::none_of(_gen->gen.context.variables(), [](const GLSLVariable& v)
+			{
+				return !v.builtin() && v.type() == GLSLType::glsl_auto;
+			}), GLSL_ERROR_CHECK_FAILED, "variable type was never deduced");
+	};
+};
+
+extern "C"
+{
+	uint32_t glsl_gen_api_version(void)
+	{
+		return GLSL_GEN_C_API_VERSION;
+	};
+
+
+
+	glsl_gen_t* glsl_gen_create(int _version)
+	{
+		return guard<glsl_gen_t*>(nullptr, nullptr, [_version]()
+			{
+				auto _gen = std::make_unique<glsl_gen_t>();
+				_gen->gen.params.version = _version;
+				add_builtin_functions(_gen->gen.context);
+				return _gen.release();
+			});
+	};
+	void glsl_gen_destroy(glsl_gen_t* _gen)
+	{
+		delete _gen;
+	};
+	const char* glsl_gen_last_error(const glsl_gen_t* _gen)
+	{
+		return (_gen) ? _gen->error.c_str() : "generator is null";
+	};
+	glsl_result glsl_gen_add_builtin_variables(glsl_gen_t* _gen, glsl_stage _stage)
+	{
+		return guard(_gen, GLSL_ERROR_INTERNAL, [=]()
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+				switch (_stage)
+				{
+				case GLSL_STAGE_VERTEX:
+					add_builtin_vertex_shader_variables(_gen->gen.context);
+					break;
+				case GLSL_STAGE_FRAGMENT:
+					add_builtin_fragment_shader_variables(_gen->gen.context);
+					break;
+				default:
+					require(false, GLSL_ERROR_INVALID_ARGUMENT, "unknown shader stage");
+				};
+				return GLSL_OK;
+			});
+	};
+
+
+
+	glsl_var_t glsl_gen_new_variable(glsl_gen_t* _gen, const char* _name, glsl_type _type, glsl_inout _inout)
+	{
+		return guard<glsl_var_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr && _name != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or name is null");
+				require(_type == GLSL_TYPE_AUTO || is_value_type(_type), GLSL_ERROR_INVALID_ARGUMENT, "invalid type");
+				require(_inout >= GLSL_INOUT_LOCAL && _inout <= GLSL_INOUT_OUT, GLSL_ERROR_INVALID_ARGUMENT, "invalid storage");
+				require(_gen->gen.context.find(std::string_view(_name)) == nullptr, GLSL_ERROR_INVALID_ARGUMENT,
+					"name already declared");
+
+				auto _var = _gen->gen.context.new_variable(_name, static_cast<GLSLType>(_type));
+				_var->set_inout(static_cast<GLSLInOut>(_inout));
+				return _var->id().get();
+			});
+	};
+	glsl_var_t glsl_gen_new_uniform(glsl_gen_t* _gen, const char* _name, glsl_type _type)
+	{
+		return guard<glsl_var_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr && _name != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or name is null");
+				require(is_value_type(_type), GLSL_ERROR_INVALID_ARGUMENT, "invalid type");
+				require(_gen->gen.context.find(std::string_view(_name)) == nullptr, GLSL_ERROR_INVALID_ARGUMENT,
+					"name already declared");
+
+				auto _var = _gen->gen.context.new_variable(_name, static_cast<GLSLType>(_type));
+				_var->set_uniform();
+				return _var->id().get();
+			});
+	};
+	glsl_var_t glsl_gen_find_variable(const glsl_gen_t* _gen, const char* _name)
+	{
+		return guard<glsl_var_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr && _name != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or name is null");
+				const auto _var = _gen->gen.context.find(std::string_view(_name));
+				return (_var) ? _var->id().get() : 0;
+			});
+	};
+	glsl_fn_t glsl_gen_find_function(const glsl_gen_t* _gen, const char* _name)
+	{
+		return guard<glsl_fn_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr && _name != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or name is null");
+				const auto _fn = _gen->gen.context.find_function(std::string_view(_name));
+				return (_fn) ? _fn->id().get() : 0;
+			});
+	};
+	glsl_fn_t glsl_gen_define_function(glsl_gen_t* _gen, const char* _name, glsl_type _returnType,
+		const char* const* _paramNames, const glsl_type* _paramTypes, size_t _paramCount)
+	{
+		return guard<glsl_fn_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr && _name != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or name is null");
+				require(_paramCount == 0 || (_paramNames != nullptr && _paramTypes != nullptr), GLSL_ERROR_INVALID_ARGUMENT,
+					"parameter arrays are null");
+				require(_returnType == GLSL_TYPE_VOID || is_value_type(_returnType), GLSL_ERROR_INVALID_ARGUMENT,
+					"invalid return type");
+				require(_gen->gen.context.find_function(std::string_view(_name)) == nullptr, GLSL_ERROR_INVALID_ARGUMENT,
+					"function already declared");
+
+				auto _params = std::vector<std::pair<std::string_view, GLSLType>>{};
+				_params.reserve(_paramCount);
+				for (size_t n = 0; n != _paramCount; ++n)
+				{
+					require(_paramNames[n] != nullptr && is_value_type(_paramTypes[n]), GLSL_ERROR_INVALID_ARGUMENT,
+						"invalid parameter");
+					_params.push_back({ _paramNames[n], static_cast<GLSLType>(_paramTypes[n]) });
+				};
+
+				auto& _function = _gen->gen.params.define_function(_name, static_cast<GLSLType>(_returnType),
+					std::span<const std::pair<std::string_view, GLSLType>>(_params));
+				return _function.id().get();
+			});
+	};
+	glsl_var_t glsl_gen_function_param(const glsl_gen_t* _gen, glsl_fn_t _function, size_t _index)
+	{
+		return guard<glsl_var_t>(_gen, 0, [=]()
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+				const auto _fn = _gen->gen.params.find_function(GLSLFunctionID(_function));
+				require(_fn != nullptr, GLSL_ERROR_NOT_FOUND, "function is not defined");
+				require(_index < _fn->params().size(), GLSL_ERROR_INVALID_ARGUMENT, "parameter index out of range");
+				return _fn->params()[_index].get();
+			});
+	};
+
+
+
+	glsl_expr_t* glsl_expr_variable(glsl_var_t _var)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]()
+			{
+				require(_var != 0, GLSL_ERROR_INVALID_ARGUMENT, "variable is null");
+				return make_expr(GLSLVariableID(_var));
+			});
+	};
+	glsl_expr_t* glsl_expr_int(int _value)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]() { return make_expr(GLSLLiteral(_value)); });
+	};
+	glsl_expr_t* glsl_expr_float(float _value)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]() { return make_expr(GLSLLiteral(_value)); });
+	};
+	glsl_expr_t* glsl_expr_double(double _value)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]() { return make_expr(GLSLLiteral(_value)); });
+	};
+	glsl_expr_t* glsl_expr_bool(int _value)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]() { return make_expr(GLSLLiteral(_value != 0)); });
+	};
+	glsl_expr_t* glsl_expr_vec(const float* _values, size_t _count)
+	{
+		return guard<glsl_expr_t*>(nullptr, nullptr, [=]()
+			{
+				require(_values != nullptr && _count >= 2 && _count <= 4, GLSL_ERROR_INVALID_ARGUMENT, "invalid vector");
+				auto _parts = std::array<float, 4>{};
+				std::copy_n(_values, _count, _parts.begin());
+				const auto _type = static_cast<GLSLType>(static_cast<int>(GLSLType::glsl_vec2) + static_cast<int>(_count) - 2);
+				return make_expr(GLSLLiteral(_type, _parts));
+			});
+	};
+
+	glsl_expr_t* glsl_expr_binary(glsl_gen_t* _gen, glsl_binary_op _op, glsl_expr_t* _lhs, glsl_expr_t* _rhs)
+	{
+		auto _lhsExpr = ExprHandle(_lhs);
+		auto _rhsExpr = ExprHandle(_rhs);
+		return guard<glsl_expr_t*>(_gen, nullptr, [&]()
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+				require(_op >= GLSL_OP_ADD && _op <= GLSL_OP_GE, GLSL_ERROR_INVALID_ARGUMENT, "invalid operator");
+
+				const auto _operator = static_cast<GLSLBinaryOperator>(_op);
+				const auto _lhsType = known_type(_gen->gen.context, _lhsExpr.get());
+				const auto _rhsType = known_type(_gen->gen.context, _rhsExpr.get());
+				require(invocable(_operator, _lhsType, _rhsType), GLSL_ERROR_TYPE_MISMATCH, "operator is not defined for these types");
+
+				return make_expr(GLSLExpression::make_unique(
+					GLSLExpression::BinaryOp(_operator, std::move(_lhsExpr->param), std::move(_rhsExpr->param))));
+			});
+	};
+	glsl_expr_t* glsl_expr_call(glsl_gen_t* _gen, glsl_fn_t _function, glsl_expr_t* const* _args, size_t _count)
+	{
+		// Arguments are owned from here on, whatever happens
+		const auto _argsGuard = ArgsGuard{ _args, (_args) ? _count : 0 };
+
+		return guard<glsl_expr_t*>(_gen, nullptr, [&]()
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+				require(_count == 0 || _args != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "argument array is null");
+
+				auto& _context = _gen->gen.context;
+				const auto _decl = _context.find(GLSLFunctionID(_function));
+				require(_decl != nullptr, GLSL_ERROR_NOT_FOUND, "function does not exist");
+
+				auto _types = std::vector<GLSLType>(_count);
+				for (size_t n = 0; n != _count; ++n)
+				{
+					_types[n] = known_type(_context, _args[n]);
+				};
+				// Arguments must convert implicitly, like in the DSL. find_best_overload() also
+				// accepts explicit casts and may return an overload rated as no match.
+				const auto _overload = _decl->find_best_overload(_types);
+				require(_overload != nullptr && _overload->params.size() == _count, GLSL_ERROR_TYPE_MISMATCH,
+					"no overload matches the arguments");
+				for (size_t n = 0; n != _count; ++n)
+				{
+					using Convertability = GLSLFunctionParameter::Convertability;
+					require(_overload->params[n].convertability_from(_types[n]) >= Convertability::implicit,
+						GLSL_ERROR_TYPE_MISMATCH, "no overload matches the arguments");
+				};
+
+				auto _call = GLSLExpression::FunctionCall(GLSLFunctionID(_function));
+				_call.params.reserve(_count);
+				for (size_t n = 0; n != _count; ++n)
+				{
+					_call.params.push_back(std::move(_args[n]->param));
+				};
+				_call.resolve_params(_context);
+				require(_call.result_type(_context) != GLSLType::glsl_error, GLSL_ERROR_TYPE_MISMATCH,
+					"no overload matches the arguments");
+				return make_expr(GLSLExpression::make_unique(std::move(_call)));
+			});
+	};
+	glsl_expr_t* glsl_expr_swizzle(glsl_gen_t* _gen, glsl_expr_t* _value, const char* _components)
+	{
+		auto _expr = ExprHandle(_value);
+		return guard<glsl_expr_t*>(_gen, nullptr, [&]()
+			{
+				require(_gen != nullptr && _components != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator or components are null");
+
+				const auto _type = known_type(_gen->gen.context, _expr.get());
+				require(is_vector(_type), GLSL_ERROR_TYPE_MISMATCH, "only vectors can be swizzled");
+
+				const auto _names = std::string_view(_components);
+				require(!_names.empty() && _names.size() <= 4, GLSL_ERROR_INVALID_ARGUMENT, "swizzle must have 1 to 4 components");
+
+				auto _indexes = std::array<uint8_t, 4>{ 255, 255, 255, 255 };
+				for (size_t n = 0; n != _names.size(); ++n)
+				{
+					const auto _index = std::string_view("xyzw").find(_names[n]);
+					require(_index < vec_size(_type), GLSL_ERROR_INVALID_ARGUMENT, "swizzle component out of range");
+					_indexes[n] = static_cast<uint8_t>(_index);
+				};
+
+				const auto [n0, n1, n2, n3] = _indexes;
+				return make_expr(GLSLExpression::make_unique(GLSLExpression::Swizzle(std::move(_expr->param), n0, n1, n2, n3)));
+			});
+	};
+	glsl_expr_t* glsl_expr_cast(glsl_gen_t* _gen, glsl_type _type, glsl_expr_t* _value)
+	{
+		auto _expr = ExprHandle(_value);
+		return guard<glsl_expr_t*>(_gen, nullptr, [&]()
+			{
+				require(_gen != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "generator is null");
+				require(is_value_type(_type), GLSL_ERROR_INVALID_ARGUMENT, "invalid type");
+				const auto _fromType = known_type(_gen->gen.context, _expr.get());
+				// Rejects void calls and samplers, which have no constructor
+				require(is_castable_to(_fromType, static_cast<GLSLType>(_type)), GLSL_ERROR_TYPE_MISMATCH,
+					"value is not castable to the type");
+				return make_expr(GLSLExpression::make_unique(
+					GLSLExpression::Cast(static_cast<GLSLType>(_type), std::move(_expr->param))));
+			});
+	};
+	void glsl_expr_destroy(glsl_expr_t* _expr)
+	{
+		delete _expr;
+	};
+
+
+
+	glsl_result glsl_gen_declare(glsl_gen_t* _gen, glsl_fn_t _function, glsl_var_t _dest, glsl_expr_t* _value)
+	{
+		return append_statement(_gen, GLSLStatementType::declaration, _function, _dest, _value);
+	};
+	glsl_result glsl_gen_assign(glsl_gen_t* _gen, glsl_fn_t _function, glsl_var_t _dest, glsl_expr_t* _value)
+	{
+		return append_statement(_gen, GLSLStatementType::assignment, _function, _dest, _value);
+	};
+	glsl_result glsl_gen_return(glsl_gen_t* _gen, glsl_fn_t _function, glsl_expr_t* _value)
+	{
+		return append_statement(_gen, GLSLStatementType::return_value, _function, 0, _value);
+	};
+
+
+
+	glsl_result glsl_gen_emit(glsl_gen_t* _gen, char* _buffer, size_t _capacity, size_t* _outSize)
+	{
+		return guard(_gen, GLSL_ERROR_INTERNAL, [=]()
+			{
+				require(_buffer != nullptr || _capacity == 0, GLSL_ERROR_INVALID_ARGUMENT, "buffer is null");
+				prepare(_gen);
+
+				// Copy what fits, keep counting the rest so the caller learns the required size.
+				size_t _size = 0;
+				auto _emitter = GLSLChunkedEmitter(_gen->gen.context, _gen->gen.params);
+				for (auto _chunk : _emitter)
+				{
+					if (_size < _capacity)
+					{
+						std::memcpy(_buffer + _size, _chunk.data(), std::min(_chunk.size(), _capacity - _size));
+					};
+					_size += _chunk.size();
+				};
+
+				if (_outSize)
+				{
+					*_outSize = _size;
+				};
+				if (_size >= _capacity)
+				{
+					if (_capacity != 0)
+					{
+						_buffer[_capacity - 1] = '\0';
+					};
+					throw CError{ GLSL_ERROR_BUFFER_TOO_SMALL, "buffer too small" };
+				};
+				_buffer[_size] = '\0';
+				return GLSL_OK;
+			});
+	};
+	glsl_result glsl_gen_emit_stream(glsl_gen_t* _gen, size_t _chunkSize, glsl_emit_fn _fn, void* _user)
+	{
+		return guard(_gen, GLSL_ERROR_INTERNAL, [=]()
+			{
+				require(_fn != nullptr, GLSL_ERROR_INVALID_ARGUMENT, "callback is null");
+				prepare(_gen);
+
+				const auto _size = (_chunkSize != 0) ? _chunkSize : GLSLChunkedEmitter::default_chunk_size_v;
+				auto _emitter = GLSLChunkedEmitter(_gen->gen.context, _gen->gen.params, _size);
+				for (auto _chunk : _emitter)
+				{
+					require(_fn(_chunk.data(), _chunk.size(), _user) == 0, GLSL_ERROR_CANCELLED, "emitting was cancelled");
+				};
+				return GLSL_OK;
+			});
+	};
+};
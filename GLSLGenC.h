@@ -0,0 +1,327 @@
+#ifndef GLSL_GEN_C_H
+#define GLSL_GEN_C_H
+
+/** @file */
+
+/*
+	C interface to the generator, for generating shaders in-process.
+
+		glsl_gen_t* _gen = glsl_gen_create(330);
+		glsl_gen_add_builtin_variables(_gen, GLSL_STAGE_FRAGMENT);
+
+		glsl_var_t _uvs = glsl_gen_new_variable(_gen, "frag_uvs", GLSL_TYPE_VEC3, GLSL_INOUT_IN);
+		glsl_var_t _color = glsl_gen_new_variable(_gen, "color", GLSL_TYPE_VEC4, GLSL_INOUT_OUT);
+		glsl_var_t _tex = glsl_gen_new_uniform(_gen, "test_texture", GLSL_TYPE_SAMPLER_2D_ARRAY);
+
+		glsl_expr_t* _args[2] = { glsl_expr_variable(_tex), glsl_expr_variable(_uvs) };
+		glsl_gen_assign(_gen, GLSL_MAIN_FUNCTION, _color,
+			glsl_expr_call(_gen, glsl_gen_find_function(_gen, "texture"), _args, 2));
+
+		size_t _size = 0;
+		glsl_gen_emit(_gen, NULL, 0, &_size);	// _size is now the required capacity
+		...
+		glsl_gen_destroy(_gen);
+
+	The ABI is stable: handles are opaque, enum values are fixed and only ever added to,
+	and functions are only ever added. GLSL_GEN_C_API_VERSION is bumped when functions are
+	added, glsl_gen_api_version() returns the version of the library actually loaded.
+
+	No function aborts or throws. Failures return NULL, 0 or an error result, and
+	glsl_gen_last_error() describes the last failure on a generator.
+
+	A generator is not thread safe, separate generators can be used from separate threads.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(GLSL_GEN_C_SHARED)
+	#if defined(_WIN32)
+		#if defined(GLSL_GEN_C_BUILD)
+			#define GLSL_GEN_API __declspec(dllexport)
+		#else
+			#define GLSL_GEN_API __declspec(dllimport)
+		#endif
+	#else
+		#define GLSL_GEN_API __attribute__((visibility("default")))
+	#endif
+#else
+	#define GLSL_GEN_API
+#endif
+
+#define GLSL_GEN_C_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A context and the shader being defined in it.
+*/
+typedef struct glsl_gen_t glsl_gen_t;
+
+/**
+ * @brief An expression owned by the caller, consumed when passed to a function taking one.
+*/
+typedef struct glsl_expr_t glsl_expr_t;
+
+/**
+ * @brief Variable ID, 0 is never a valid variable.
+*/
+typedef uint32_t glsl_var_t;
+
+/**
+ * @brief Function ID, 0 is never a valid function and names main in statement functions.
+*/
+typedef uint32_t glsl_fn_t;
+
+#define GLSL_MAIN_FUNCTION ((glsl_fn_t)0)
+
+typedef enum glsl_result
+{
+	GLSL_OK = 0,
+	GLSL_ERROR_INVALID_ARGUMENT = 1,
+	GLSL_ERROR_TYPE_MISMATCH = 2,
+	GLSL_ERROR_NOT_FOUND = 3,
+	GLSL_ERROR_BUFFER_TOO_SMALL = 4,
+	GLSL_ERROR_CHECK_FAILED = 5,
+	GLSL_ERROR_INTERNAL = 6,
+	GLSL_ERROR_CANCELLED = 7,
+} glsl_result;
+
+typedef enum glsl_type
+{
+	GLSL_TYPE_AUTO = 0,
+	GLSL_TYPE_VOID = 1,
+	GLSL_TYPE_BOOL = 2,
+	GLSL_TYPE_INT = 3,
+	GLSL_TYPE_FLOAT = 4,
+	GLSL_TYPE_VEC2 = 5,
+	GLSL_TYPE_VEC3 = 6,
+	GLSL_TYPE_VEC4 = 7,
+	GLSL_TYPE_DOUBLE = 8,
+	GLSL_TYPE_DVEC2 = 9,
+	GLSL_TYPE_DVEC3 = 10,
+	GLSL_TYPE_DVEC4 = 11,
+	GLSL_TYPE_MAT4 = 12,
+	GLSL_TYPE_SAMPLER_2D = 13,
+	GLSL_TYPE_SAMPLER_2D_ARRAY = 14,
+} glsl_type;
+
+typedef enum glsl_inout
+{
+	GLSL_INOUT_LOCAL = 0,
+	GLSL_INOUT_IN = 1,
+	GLSL_INOUT_OUT = 2,
+} glsl_inout;
+
+typedef enum glsl_binary_op
+{
+	GLSL_OP_ADD = 0,
+	GLSL_OP_SUB = 1,
+	GLSL_OP_MUL = 2,
+	GLSL_OP_DIV = 3,
+	GLSL_OP_EQ = 4,
+	GLSL_OP_NEQ = 5,
+	GLSL_OP_LT = 6,
+	GLSL_OP_LE = 7,
+	GLSL_OP_GT = 8,
+	GLSL_OP_GE = 9,
+} glsl_binary_op;
+
+typedef enum glsl_stage
+{
+	GLSL_STAGE_VERTEX = 0,
+	GLSL_STAGE_FRAGMENT = 1,
+} glsl_stage;
+
+/**
+ * @brief Receives emitted source, see glsl_gen_emit_stream().
+ * @param _data Chunk of source, not null terminated.
+ * @param _size Size of the chunk in bytes.
+ * @param _user User pointer given to glsl_gen_emit_stream().
+ * @return Zero to continue, anything else stops emitting.
+*/
+typedef int (*glsl_emit_fn)(const char* _data, size_t _size, void* _user);
+
+GLSL_GEN_API uint32_t glsl_gen_api_version(void);
+
+
+
+/*
+	Generators
+*/
+
+/**
+ * @brief Creates a generator with the builtin functions already declared.
+ * @param _version GLSL version written to the output, ie. 330.
+ * @return New generator, or NULL if out of memory.
+*/
+GLSL_GEN_API glsl_gen_t* glsl_gen_create(int _version);
+
+/**
+ * @brief Destroys a generator, does nothing for NULL.
+*/
+GLSL_GEN_API void glsl_gen_destroy(glsl_gen_t* _gen);
+
+/**
+ * @brief Describes the last failure on a generator.
+ * @return Null terminated message, empty if nothing failed. Valid until the next call on the generator.
+*/
+GLSL_GEN_API const char* glsl_gen_last_error(const glsl_gen_t* _gen);
+
+/**
+ * @brief Declares the builtin variables of a shader stage, ie. gl_Position.
+*/
+GLSL_GEN_API glsl_result glsl_gen_add_builtin_variables(glsl_gen_t* _gen, glsl_stage _stage);
+
+
+
+/*
+	Symbols
+*/
+
+/**
+ * @brief Adds a variable.
+ * @param _name Null terminated name.
+ * @param _type Type, GLSL_TYPE_AUTO to deduce it from the first statement writing the variable.
+ * @param _inout Storage.
+ * @return The variable, or 0 on failure.
+*/
+GLSL_GEN_API glsl_var_t glsl_gen_new_variable(glsl_gen_t* _gen, const char* _name, glsl_type _type, glsl_inout _inout);
+
+/**
+ * @brief Adds a uniform variable.
+*/
+GLSL_GEN_API glsl_var_t glsl_gen_new_uniform(glsl_gen_t* _gen, const char* _name, glsl_type _type);
+
+/**
+ * @brief Finds a variable by name, including builtins.
+ * @return The variable, or 0 if not found.
+*/
+GLSL_GEN_API glsl_var_t glsl_gen_find_variable(const glsl_gen_t* _gen, const char* _name);
+
+/**
+ * @brief Finds a function by name, including builtins.
+ * @return The function, or 0 if not found.
+*/
+GLSL_GEN_API glsl_fn_t glsl_gen_find_function(const glsl_gen_t* _gen, const char* _name);
+
+/**
+ * @brief Defines a function, its statements are added with the statement functions.
+ * @param _name Null terminated name.
+ * @param _returnType Return type.
+ * @param _paramNames Parameter names, _paramCount entries.
+ * @param _paramTypes Parameter types, _paramCount entries.
+ * @param _paramCount Number of parameters.
+ * @return The function, or 0 on failure.
+*/
+GLSL_GEN_API glsl_fn_t glsl_gen_define_function(glsl_gen_t* _gen, const char* _name, glsl_type _returnType,
+	const char* const* _paramNames, const glsl_type* _paramTypes, size_t _paramCount);
+
+/**
+ * @brief Gets the variable bound to a parameter of a defined function.
+ * @return The variable, or 0 on failure.
+*/
+GLSL_GEN_API glsl_var_t glsl_gen_function_param(const glsl_gen_t* _gen, glsl_fn_t _function, size_t _index);
+
+
+
+/*
+	Expressions
+
+	Functions taking expressions always take ownership of them, even when they fail.
+	glsl_expr_variable() does not check its handle, the function consuming the expression
+	fails with GLSL_ERROR_NOT_FOUND if the variable does not exist.
+*/
+
+GLSL_GEN_API glsl_expr_t* glsl_expr_variable(glsl_var_t _var);
+GLSL_GEN_API glsl_expr_t* glsl_expr_int(int _value);
+GLSL_GEN_API glsl_expr_t* glsl_expr_float(float _value);
+GLSL_GEN_API glsl_expr_t* glsl_expr_double(double _value);
+GLSL_GEN_API glsl_expr_t* glsl_expr_bool(int _value);
+
+/**
+ * @brief Float vector literal.
+ * @param _values Components, _count entries.
+ * @param _count Number of components, 2 to 4.
+ * @return The literal, or NULL on failure.
+*/
+GLSL_GEN_API glsl_expr_t* glsl_expr_vec(const float* _values, size_t _count);
+
+/**
+ * @brief Binary operation, the operand types must be valid for the operator.
+ * @return The expression, or NULL on failure.
+*/
+GLSL_GEN_API glsl_expr_t* glsl_expr_binary(glsl_gen_t* _gen, glsl_binary_op _op, glsl_expr_t* _lhs, glsl_expr_t* _rhs);
+
+/**
+ * @brief Function call, arguments are converted to the best matching overload.
+ * @param _args Arguments, _count entries.
+ * @return The expression, or NULL if no overload matches.
+*/
+GLSL_GEN_API glsl_expr_t* glsl_expr_call(glsl_gen_t* _gen, glsl_fn_t _function, glsl_expr_t* const* _args, size_t _count);
+
+/**
+ * @brief Vector swizzle.
+ * @param _components Null terminated components, 1 to 4 of "xyzw".
+ * @return The expression, or NULL on failure.
+*/
+GLSL_GEN_API glsl_expr_t* glsl_expr_swizzle(glsl_gen_t* _gen, glsl_expr_t* _value, const char* _components);
+
+/**
+ * @brief Explicit conversion, samplers and void values cannot be converted.
+ * @return The expression, or NULL on failure.
+*/
+GLSL_GEN_API glsl_expr_t* glsl_expr_cast(glsl_gen_t* _gen, glsl_type _type, glsl_expr_t* _value);
+
+/**
+ * @brief Destroys an expression that was not passed to another function, does nothing for NULL.
+*/
+GLSL_GEN_API void glsl_expr_destroy(glsl_expr_t* _expr);
+
+
+
+/*
+	Statements
+
+	Appended to a defined function, or to main for GLSL_MAIN_FUNCTION. Values must be
+	implicitly convertible to the destination's type and are converted if needed. A function
+	may only call builtins and functions defined before it, GLSL_ERROR_INVALID_ARGUMENT otherwise.
+*/
+
+GLSL_GEN_API glsl_result glsl_gen_declare(glsl_gen_t* _gen, glsl_fn_t _function, glsl_var_t _dest, glsl_expr_t* _value);
+GLSL_GEN_API glsl_result glsl_gen_assign(glsl_gen_t* _gen, glsl_fn_t _function, glsl_var_t _dest, glsl_expr_t* _value);
+GLSL_GEN_API glsl_result glsl_gen_return(glsl_gen_t* _gen, glsl_fn_t _function, glsl_expr_t* _value);
+
+
+
+/*
+	Emission
+
+	Auto types are deduced and the shader is checked before the first emit.
+*/
+
+/**
+ * @brief Writes the GLSL source into a caller buffer.
+ * @param _buffer Output buffer, may be NULL if _capacity is 0.
+ * @param _capacity Size of the buffer in bytes.
+ * @param _outSize Set to the source size in bytes without the null terminator, also on GLSL_ERROR_BUFFER_TOO_SMALL.
+ * @return GLSL_OK if the source and a null terminator fit, GLSL_ERROR_BUFFER_TOO_SMALL if not.
+*/
+GLSL_GEN_API glsl_result glsl_gen_emit(glsl_gen_t* _gen, char* _buffer, size_t _capacity, size_t* _outSize);
+
+/**
+ * @brief Writes the GLSL source in chunks without holding it all in memory.
+ * @param _chunkSize Size of the chunks, 0 for the default.
+ * @param _fn Called once per chunk.
+ * @param _user Passed to _fn.
+ * @return GLSL_OK, or GLSL_ERROR_CANCELLED if _fn stopped emitting.
+*/
+GLSL_GEN_API glsl_result glsl_gen_emit_stream(glsl_gen_t* _gen, size_t _chunkSize, glsl_emit_fn _fn, void* _user);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,310 @@
+#include "GLSLGenCost.hpp"
+
+#include <map>
+#include <format>
+#include <utility>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief Gets the rows and columns of a type, vectors are a single column and scalars 1x1.
+		*/
+		std::pair<size_t, size_t> matrix_shape(GLSLType _type)
+		{
+			if (is_matrix(_type))
+			{
+				// Matrices are square, their column type gives both
+				const auto _rows = vec_size(element_type(_type));
+				return { _rows, _rows };
+			};
+			return { vec_size(_type), 1 };
+		};
+
+		size_t component_count(GLSLType _type)
+		{
+			const auto [_rows, _columns] = matrix_shape(_type);
+			return _rows * _columns;
+		};
+
+		/**
+		 * @brief Gets the multiplications in a linear algebra product, rows times columns times
+		 *	the inner dimension. A vector on the left is a row.
+		*/
+		size_t product_size(GLSLType _lhs, GLSLType _rhs)
+		{
+			auto _lhsShape = matrix_shape(_lhs);
+			if (!is_matrix(_lhs))
+			{
+				std::swap(_lhsShape.first, _lhsShape.second);
+			};
+			const auto _rhsShape = matrix_shape(_rhs);
+			return _lhsShape.first * _rhsShape.second * _lhsShape.second;
+		};
+
+		/**
+		 * @brief Gets the scalar type a type is made of, ie. float for vec3 and mat4.
+		*/
+		GLSLType scalar_type(GLSLType _type)
+		{
+			while (is_vector(_type) || is_matrix(_type))
+			{
+				_type = element_type(_type);
+			};
+			return _type;
+		};
+
+		/**
+		 * @brief Gets the vec4 slots an interpolated variable takes.
+		*/
+		size_t interpolant_slots(GLSLType _type)
+		{
+			if (is_matrix(_type))
+			{
+				return 4;
+			};
+			return (_type == GLSLType::glsl_dvec3 || _type == GLSLType::glsl_dvec4) ? 2 : 1;
+		};
+
+		void add_cost(GLSLShaderCost& _to, const GLSLShaderCost& _from, double _times)
+		{
+			_to.alu += _from.alu * _times;
+			_to.transcendental += _from.transcendental * _times;
+			_to.texture += _from.texture * _times;
+			_to.unbounded_loops += _from.unbounded_loops;
+		};
+
+		struct CostEstimator
+		{
+			const GLSLContext* context;
+			const GLSLParams* params;
+			const GLSLCostOptions* options;
+
+			// Cost of each user function's body, found on its first call
+			std::map<GLSLFunctionID, GLSLShaderCost> functions{};
+
+			void node(const GLSLExpression& _node, GLSLShaderCost& _cost)
+			{
+				auto& _context = *this->context;
+				switch (_node.type())
+				{
+				case GLSLExpressionType::binary_op:
+				{
+					auto& _op = _node.get<GLSLExpression::BinaryOp>();
+					const auto _lhs = _op.lhs.type(_context);
+					const auto _rhs = _op.rhs.type(_context);
+					const auto _result = double(component_count(_node.result_type(_context)));
+					switch (_op.op)
+					{
+					case GLSLBinaryOperator::add:
+					case GLSLBinaryOperator::sub:
+						_cost.alu += _result;
+						break;
+					case GLSLBinaryOperator::mult:
+						// A product with a matrix is a dot product per result component, scaling one is not
+						if ((is_matrix(_lhs) || is_matrix(_rhs)) && !is_scalar(_lhs) && !is_scalar(_rhs))
+						{
+							_cost.alu += double(product_size(_lhs, _rhs));
+						}
+						else
+						{
+							_cost.alu += _result;
+						};
+						break;
+					case GLSLBinaryOperator::div:
+						_cost.alu += _result;
+						_cost.transcendental += _result;
+						break;
+					default:
+						_cost.alu += double(std::max(component_count(_lhs), component_count(_rhs)));
+						break;
+					};
+				};
+				break;
+
+				case GLSLExpressionType::select:
+					_cost.alu += double(component_count(_node.result_type(_context)));
+					break;
+
+				case GLSLExpressionType::cast:
+				{
+					auto& _cast = _node.get<GLSLExpression::Cast>();
+					const auto _to = _cast.to_type();
+					if (scalar_type(_to) != scalar_type(_cast.param.type(_context)))
+					{
+						_cost.alu += double(component_count(_to));
+					};
+				};
+				break;
+
+				case GLSLExpressionType::function_call:
+					this->call(_node.get<GLSLExpression::FunctionCall>(), _cost);
+					break;
+
+				default:
+					break;
+				};
+			};
+
+			void call(const GLSLExpression::FunctionCall& _call, GLSLShaderCost& _cost)
+			{
+				const auto _decl = this->context->find(_call.function);
+				if (!_decl)
+				{
+					return;
+				};
+				if (!_decl->builtin())
+				{
+					// Loops are counted once where they are defined, see estimate_cost()
+					auto _body = this->function_cost(_call.function);
+					_body.unbounded_loops = 0;
+					add_cost(_cost, _body, 1.0);
+					return;
+				};
+
+				auto _types = std::vector<GLSLType>();
+				size_t _width = 1;
+				for (auto& _param : _call.params)
+				{
+					_types.push_back(_param.type(*this->context));
+					_width = std::max(_width, component_count(_types.back()));
+				};
+				const auto _overload = _decl->find_best_overload(_types);
+				if (!_overload)
+				{
+					return;
+				};
+
+				const auto& _annotated = _overload->cost;
+				const auto _times = (_annotated.per_component) ? double(_width) : 1.0;
+				_cost.alu += _annotated.alu * _times;
+				_cost.transcendental += _annotated.transcendental * _times;
+				_cost.texture += _annotated.texture * _times;
+			};
+
+			const GLSLShaderCost& function_cost(GLSLFunctionID _id)
+			{
+				if (const auto it = this->functions.find(_id); it != this->functions.end())
+				{
+					return it->second;
+				};
+
+				// Entered before walking the body so a call back into the function ends here, the
+				// map keeps references stable while other functions are added
+				auto& _entry = this->functions.try_emplace(_id).first->second;
+				auto _cost = GLSLShaderCost{};
+				if (const auto _function = this->params->find_function(_id); _function)
+				{
+					this->statements(_function->body(), _cost);
+				};
+				_entry = _cost;
+				return _entry;
+			};
+
+			void expression(const GLSLExpression& _expr, GLSLShaderCost& _cost)
+			{
+				for_each_expression(_expr, [&](const GLSLExpression& _node)
+					{
+						this->node(_node, _cost);
+					});
+			};
+
+			void statements(std::span<const GLSLStatement> _statements, GLSLShaderCost& _cost)
+			{
+				for (auto& _statement : _statements)
+				{
+					switch (_statement.type)
+					{
+					case GLSLStatementType::for_loop:
+					{
+						auto _trips = this->options->loop_iterations;
+						if (const auto _known = loop_trip_count(_statement); _known)
+						{
+							_trips = double(*_known);
+						}
+						else
+						{
+							++_cost.unbounded_loops;
+						};
+
+						// The bound is tested once more than the body runs, the increment once per run
+						auto _test = GLSLShaderCost{};
+						this->expression(_statement.expr, _test);
+						_test.alu += 1.0;
+						add_cost(_cost, _test, _trips + 1.0);
+
+						auto _body = GLSLShaderCost{};
+						this->statements(_statement.body, _body);
+						_body.alu += 1.0;
+						add_cost(_cost, _body, _trips);
+					};
+					break;
+
+					case GLSLStatementType::if_else:
+						this->expression(_statement.expr, _cost);
+						this->statements(_statement.body, _cost);
+						this->statements(_statement.else_body, _cost);
+						break;
+
+					default:
+						this->expression(_statement.expr, _cost);
+						break;
+					};
+				};
+			};
+		};
+	};
+
+	void GLSLShaderCost::write(std::ostream& _ostr) const
+	{
+		_ostr << std::format("alu {}, transcendental {}, texture {}, interpolants {}", this->alu, this->transcendental,
+			this->texture, this->interpolants);
+		if (this->unbounded_loops != 0)
+		{
+			_ostr << std::format(", {} loops with an assumed trip count", this->unbounded_loops);
+		};
+		_ostr << '\n';
+	};
+
+	GLSLShaderCost estimate_cost(const GLSLContext& _context, const GLSLParams& _params, GLSLShaderStage _stage,
+		const GLSLCostOptions& _options)
+	{
+		auto _estimator = CostEstimator{ &_context, &_params, &_options };
+		auto _cost = GLSLShaderCost{};
+		_estimator.statements(_params.globals, _cost);
+		_estimator.statements(_params.main_fn.body(), _cost);
+		for (auto& _function : _params.functions)
+		{
+			_cost.unbounded_loops += _estimator.function_cost(_function.id()).unbounded_loops;
+		};
+
+		const auto _interpolated = (_stage == GLSLShaderStage::fragment) ? GLSLInOut::in : GLSLInOut::out;
+		for (auto& _var : _context.variables())
+		{
+			if (!_var.builtin() && _var.inout() == _interpolated)
+			{
+				_cost.interpolants += interpolant_slots(_var.type());
+			};
+		};
+		return _cost;
+	};
+
+	std::vector<std::string> find_budget_overruns(const GLSLShaderCost& _cost, const GLSLCostBudget& _budget)
+	{
+		auto _overruns = std::vector<std::string>();
+		const auto _check = [&_overruns](std::string_view _name, auto _value, auto _limit)
+		{
+			if (_value > _limit)
+			{
+				_overruns.push_back(std::format("{} {} over budget {}", _name, _value, _limit));
+			};
+		};
+		_check("alu", _cost.alu, _budget.alu);
+		_check("transcendental", _cost.transcendental, _budget.transcendental);
+		_check("texture", _cost.texture, _budget.texture);
+		_check("interpolants", _cost.interpolants, _budget.interpolants);
+		return _overruns;
+	};
+};
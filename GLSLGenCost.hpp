@@ -0,0 +1,82 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+namespace glsl
+{
+	/**
+	 * @brief Estimated cost of running a shader once, see estimate_cost().
+	*/
+	struct GLSLShaderCost
+	{
+		// Plain arithmetic instructions, per component
+		double alu = 0.0;
+
+		// Special function unit instructions, ie. sin(), pow() and divisions
+		double transcendental = 0.0;
+
+		// Texture fetches
+		double texture = 0.0;
+
+		// Vec4 slots interpolated between the stages, the fragment shader's inputs or the vertex shader's outputs
+		size_t interpolants = 0;
+
+		// Loops without a constant trip count, counted as GLSLCostOptions::loop_iterations iterations.
+		// Each is counted once where it is written, however many times its function is called.
+		size_t unbounded_loops = 0;
+
+		/**
+		 * @brief Writes the cost on one line.
+		*/
+		void write(std::ostream& _ostr) const;
+	};
+
+	/**
+	 * @brief Assumptions made by estimate_cost() where the IR does not tell.
+	*/
+	struct GLSLCostOptions
+	{
+		/**
+		 * @brief Iterations counted for loops whose trip count is not constant.
+		*/
+		double loop_iterations = 16.0;
+	};
+
+	/**
+	 * @brief Estimates a shader's cost from its IR, without compiling it.
+	 *
+	 * Builtin calls cost what their overload is annotated with (see GLSLFunctionCost), user
+	 * functions what their body costs. Operators cost one ALU instruction per component of
+	 * their result, per component of their operands for comparisons. Products with a matrix
+	 * cost rows times columns times the inner dimension, ie. 64 for mat4 * mat4 and 16 for
+	 * mat4 * vec4.
+	 * Divisions add a reciprocal per component. Casts between int, float and double cost one
+	 * instruction per component, other casts and swizzles are free.
+	 *
+	 * Loop bodies are counted once per iteration, along with the loop's test and increment.
+	 * Both arms of a branch are counted, as invocations taking different arms run both.
+	 * Global initializers are counted once.
+	 *
+	 * The estimate ranks shaders and catches regressions, it does not predict timings.
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters, auto types must be deduced.
+	 * @param _stage Stage of the shader, decides which variables are interpolants.
+	 * @param _options Assumptions for what the IR does not tell.
+	*/
+	GLSLShaderCost estimate_cost(const GLSLContext& _context, const GLSLParams& _params, GLSLShaderStage _stage,
+		const GLSLCostOptions& _options = {});
+
+	/**
+	 * @brief Lists the parts of a cost over budget.
+	 * @return One message per exceeded limit, ie. "texture 6 over budget 4", empty if within budget.
+	*/
+	std::vector<std::string> find_budget_overruns(const GLSLShaderCost& _cost, const GLSLCostBudget& _budget);
+};
@@ -0,0 +1,379 @@
+#include "GLSLGenCpp.hpp"
+
+#include <set>
+#include <ostream>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief Vector types and GLSL builtins used by the generated code.
+		*/
+		constexpr std::string_view cpp_prelude_v = R"(
+template <typename T, size_t N>
+struct tvec
+{
+	T v[N];
+
+	constexpr T& operator[](size_t n) { return this->v[n]; };
+	constexpr const T& operator[](size_t n) const { return this->v[n]; };
+
+	constexpr tvec() : v{} {};
+	constexpr explicit tvec(T s) : v{}
+	{
+		for (size_t n = 0; n != N; ++n) { this->v[n] = s; };
+	};
+	template <typename... Ts> requires (sizeof...(Ts) == N && N > 1)
+	constexpr tvec(Ts... vs) : v{ static_cast<T>(vs)... } {};
+};
+
+using vec2 = tvec<float, 2>;
+using vec3 = tvec<float, 3>;
+using vec4 = tvec<float, 4>;
+using dvec2 = tvec<double, 2>;
+using dvec3 = tvec<double, 3>;
+using dvec4 = tvec<double, 4>;
+
+template <typename T>
+struct vec_traits
+{
+	using value_type = T;
+	static constexpr size_t size = 1;
+};
+template <typename T, size_t N>
+struct vec_traits<tvec<T, N>>
+{
+	using value_type = T;
+	static constexpr size_t size = N;
+};
+
+#define GLSL_CPP_BINARY_OP(op) \
+	template <typename T, size_t N> constexpr tvec<T, N> operator op(const tvec<T, N>& a, const tvec<T, N>& b) \
+	{ tvec<T, N> r; for (size_t n = 0; n != N; ++n) { r[n] = a[n] op b[n]; }; return r; }; \
+	template <typename T, size_t N> constexpr tvec<T, N> operator op(const tvec<T, N>& a, T b) \
+	{ tvec<T, N> r; for (size_t n = 0; n != N; ++n) { r[n] = a[n] op b; }; return r; }; \
+	template <typename T, size_t N> constexpr tvec<T, N> operator op(T a, const tvec<T, N>& b) \
+	{ tvec<T, N> r; for (size_t n = 0; n != N; ++n) { r[n] = a op b[n]; }; return r; };
+GLSL_CPP_BINARY_OP(+)
+GLSL_CPP_BINARY_OP(-)
+GLSL_CPP_BINARY_OP(*)
+GLSL_CPP_BINARY_OP(/)
+#undef GLSL_CPP_BINARY_OP
+
+template <typename T, size_t N>
+constexpr bool operator==(const tvec<T, N>& a, const tvec<T, N>& b)
+{
+	for (size_t n = 0; n != N; ++n) { if (a[n] != b[n]) { return false; }; };
+	return true;
+};
+
+#define GLSL_CPP_UNARY_FN(fn) \
+	inline float fn(float a) { return std::fn(a); }; \
+	inline double fn(double a) { return std::fn(a); }; \
+	template <typename T, size_t N> inline tvec<T, N> fn(const tvec<T, N>& a) \
+	{ tvec<T, N> r; for (size_t n = 0; n != N; ++n) { r[n] = std::fn(a[n]); }; return r; };
+GLSL_CPP_UNARY_FN(sin)
+GLSL_CPP_UNARY_FN(cos)
+GLSL_CPP_UNARY_FN(tan)
+GLSL_CPP_UNARY_FN(abs)
+#undef GLSL_CPP_UNARY_FN
+
+inline float pow(float a, float b) { return std::pow(a, b); };
+inline double pow(double a, double b) { return std::pow(a, b); };
+template <typename T, size_t N> inline tvec<T, N> pow(const tvec<T, N>& a, const tvec<T, N>& b)
+{ tvec<T, N> r; for (size_t n = 0; n != N; ++n) { r[n] = std::pow(a[n], b[n]); }; return r; };
+
+constexpr float dot(float a, float b) { return a * b; };
+constexpr double dot(double a, double b) { return a * b; };
+template <typename T, size_t N>
+constexpr T dot(const tvec<T, N>& a, const tvec<T, N>& b)
+{
+	T r = a[0] * b[0];
+	for (size_t n = 1; n != N; ++n) { r += a[n] * b[n]; };
+	return r;
+};
+
+template <size_t... Ns, typename T, size_t N>
+constexpr auto swizzle(const tvec<T, N>& a)
+{
+	if constexpr (sizeof...(Ns) == 1)
+	{
+		constexpr size_t indexes[] = { Ns... };
+		return a[indexes[0]];
+	}
+	else
+	{
+		return tvec<T, sizeof...(Ns)>(a[Ns]...);
+	};
+};
+
+// Same rules as the GLSL emitter: scalars splat, missing components are 0 except w which is 1.
+template <typename To, typename From>
+constexpr To cast(const From& a)
+{
+	using value_type = typename vec_traits<To>::value_type;
+	constexpr size_t to_size = vec_traits<To>::size;
+	constexpr size_t from_size = vec_traits<From>::size;
+
+	if constexpr (to_size == 1)
+	{
+		if constexpr (from_size == 1) { return static_cast<To>(a); }
+		else { return static_cast<To>(a[0]); };
+	}
+	else
+	{
+		To r{};
+		for (size_t n = 0; n != to_size; ++n)
+		{
+			if constexpr (from_size == 1) { r[n] = static_cast<value_type>(a); }
+			else if (n < from_size) { r[n] = static_cast<value_type>(a[n]); }
+			else { r[n] = static_cast<value_type>((n == 3) ? 1 : 0); };
+		};
+		return r;
+	};
+};
+
+)";
+
+		/**
+		 * @brief Gets the C++ type of a single component.
+		 * @return Component type name, empty if the type has no C++ mapping.
+		*/
+		constexpr std::string_view cpp_component_type(GLSLType _type)
+		{
+			switch (_type)
+			{
+			case GLSLType::glsl_bool:
+				return "bool";
+			case GLSLType::glsl_int:
+				return "int";
+			case GLSLType::glsl_float:
+				[[fallthrough]];
+			case GLSLType::glsl_vec2:
+				[[fallthrough]];
+			case GLSLType::glsl_vec3:
+				[[fallthrough]];
+			case GLSLType::glsl_vec4:
+				return "float";
+			case GLSLType::glsl_double:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec2:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec3:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec4:
+				return "double";
+			default:
+				return std::string_view();
+			};
+		};
+
+		/**
+		 * @brief Collects every variable a function reads or writes.
+		*/
+		std::set<GLSLVariableID> referenced_variables(const GLSLFunction& _function)
+		{
+			auto _out = std::set<GLSLVariableID>{};
+			for_each_statement(_function.body(), [&_out](const GLSLStatement& v)
+				{
+					if (v.has_dest())
+					{
+						_out.insert(v.dest);
+					};
+					for_each_expression(v.expr, [&_out](const GLSLExpression& _expr)
+						{
+							for_each_param(_expr, [&_out](const GLSLExpression::Parameter& _param)
+								{
+									if (_param.is_variable())
+									{
+										_out.insert(_param.id());
+									};
+								});
+						});
+				});
+			return _out;
+		};
+	};
+
+	bool generate_cpp(const GLSLContext& _context, const GLSLParams& _params, std::ostream& _ostr,
+		std::string_view _namespace)
+	{
+		// Pick the kernel's interface before writing anything.
+		const auto _referenced = referenced_variables(_params.main_fn);
+		auto _inputs = std::vector<const GLSLVariable*>{};
+		auto _outputs = std::vector<const GLSLVariable*>{};
+		auto _uniforms = std::vector<const GLSLVariable*>{};
+		for (auto& v : _context.variables())
+		{
+			if (v.builtin() && !_referenced.contains(v.id()))
+			{
+				continue;
+			};
+
+			if (v.uniform())
+			{
+				_uniforms.push_back(&v);
+			}
+			else if (v.inout() == GLSLInOut::in)
+			{
+				_inputs.push_back(&v);
+			}
+			else if (v.inout() == GLSLInOut::out)
+			{
+				_outputs.push_back(&v);
+			}
+			else
+			{
+				continue;
+			};
+
+			if (cpp_component_type(v.type()).empty())
+			{
+				return false;
+			};
+		};
+
+		_ostr << "// Generated from GLSL IR, do not edit.\n";
+		_ostr << "#pragma once\n\n#include <cmath>\n#include <cstddef>\n\n";
+		_ostr << "#ifndef GLSL_CPP_RESTRICT\n\t#define GLSL_CPP_RESTRICT __restrict\n#endif\n\n";
+		_ostr << "namespace " << _namespace << "\n{\n";
+		_ostr << cpp_prelude_v << '\n';
+
+		// Constants
+		for (auto& v : _params.globals)
+		{
+			generate_statement_string(_ostr, _context, v, GLSLLanguage::cpp);
+		};
+		if (!_params.globals.empty())
+		{
+			_ostr << '\n';
+		};
+
+		// Functions
+		for (auto& _function : _params.functions)
+		{
+			_ostr << "inline " << _function.return_type() << ' ' << _function.name() << '(';
+			size_t n = 0;
+			for (auto& _param : _function.params())
+			{
+				_ostr << ((n++ != 0) ? ", " : "") << _context.type(_param) << ' ' << _context.name(_param);
+			};
+			_ostr << ")\n{\n";
+			for (auto& v : _function.body())
+			{
+				_ostr << '\t';
+				generate_statement_string(_ostr, _context, v, GLSLLanguage::cpp);
+			};
+			_ostr << "};\n\n";
+		};
+
+		// Interface, one array per component for inputs and outputs.
+		_ostr << "struct io\n{\n";
+		for (auto v : _inputs)
+		{
+			_ostr << "\tconst " << cpp_component_type(v->type()) << "* " << v->name() << '[' << vec_size(v->type()) << "];\n";
+		};
+		for (auto v : _outputs)
+		{
+			_ostr << '\t' << cpp_component_type(v->type()) << "* " << v->name() << '[' << vec_size(v->type()) << "];\n";
+		};
+		for (auto v : _uniforms)
+		{
+			_ostr << '\t' << v->type() << ' ' << v->name() << "{};\n";
+		};
+		_ostr << "};\n\n";
+
+		// Kernel, every component array is its own restrict pointer so the loop can be vectorized
+		// without runtime alias checks.
+		const auto _component = [&_ostr](const GLSLVariable& _var, size_t n) -> std::ostream&
+		{
+			return _ostr << '_' << _var.name() << n;
+		};
+
+		_ostr << "inline void run_block(size_t _count";
+		for (auto v : _inputs)
+		{
+			for (size_t n = 0; n != vec_size(v->type()); ++n)
+			{
+				_ostr << ",\n\tconst " << cpp_component_type(v->type()) << "* GLSL_CPP_RESTRICT ";
+				_component(*v, n);
+			};
+		};
+		for (auto v : _outputs)
+		{
+			for (size_t n = 0; n != vec_size(v->type()); ++n)
+			{
+				_ostr << ",\n\t" << cpp_component_type(v->type()) << "* GLSL_CPP_RESTRICT ";
+				_component(*v, n);
+			};
+		};
+		for (auto v : _uniforms)
+		{
+			_ostr << ",\n\tconst " << v->type() << ' ' << v->name();
+		};
+		_ostr << ")\n{\n";
+
+		_ostr << "\tfor (size_t _i = 0; _i != _count; ++_i)\n\t{\n";
+		for (auto v : _inputs)
+		{
+			_ostr << "\t\tconst " << v->type() << ' ' << v->name() << " = ";
+			if (vec_size(v->type()) == 1)
+			{
+				_component(*v, 0) << "[_i];\n";
+				continue;
+			};
+
+			_ostr << v->type() << '(';
+			for (size_t n = 0; n != vec_size(v->type()); ++n)
+			{
+				_ostr << ((n != 0) ? ", " : "");
+				_component(*v, n) << "[_i]";
+			};
+			_ostr << ");\n";
+		};
+		for (auto v : _outputs)
+		{
+			_ostr << "\t\t" << v->type() << ' ' << v->name() << "{};\n";
+		};
+		for (auto& v : _params.main_fn.body())
+		{
+			_ostr << "\t\t";
+			generate_statement_string(_ostr, _context, v, GLSLLanguage::cpp, 2);
+		};
+		for (auto v : _outputs)
+		{
+			for (size_t n = 0; n != vec_size(v->type()); ++n)
+			{
+				_ostr << "\t\t";
+				_component(*v, n) << "[_i] = " << v->name();
+				if (vec_size(v->type()) != 1)
+				{
+					_ostr << '[' << n << ']';
+				};
+				_ostr << ";\n";
+			};
+		};
+		_ostr << "\t};\n};\n\n";
+
+		_ostr << "inline void run(const io& _io, size_t _count)\n{\n\trun_block(_count";
+		for (auto& _list : { &_inputs, &_outputs })
+		{
+			for (auto v : *_list)
+			{
+				for (size_t n = 0; n != vec_size(v->type()); ++n)
+				{
+					_ostr << ", _io." << v->name() << '[' << n << ']';
+				};
+			};
+		};
+		for (auto v : _uniforms)
+		{
+			_ostr << ", _io." << v->name();
+		};
+		_ostr << ");\n};\n";
+
+		_ostr << "};\n";
+		return true;
+	};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <iosfwd>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Writes a shader as a self contained C++ header.
+	 *
+	 * Everything is placed in the given namespace. The output holds a small vector
+	 * prelude, the shader's constants and functions, an "io" struct and a "run" kernel.
+	 * The io struct has one array per component for every input and output,
+	 * ie. "const float* in_pos[3]", plus a plain value for every uniform.
+	 * run(io, count) loops over the invocations and evaluates main for each one. The
+	 * loop body is straight line code over small structs, which compilers can vectorize.
+	 *
+	 * Supported types are bool, int, float, double and their vector forms. Builtin
+	 * inputs and outputs only appear in the io struct if main references them.
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters, must be resolved.
+	 * @param _ostr Output stream.
+	 * @param _namespace Namespace to wrap the generated code in.
+	 * @return True on success, false if the shader uses a type with no C++ mapping (samplers, matrices).
+	*/
+	bool generate_cpp(const GLSLContext& _context, const GLSLParams& _params, std::ostream& _ostr,
+		std::string_view _namespace = "glsl_shader");
+};
@@ -0,0 +1,631 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenStatic.hpp"
+
+#include <array>
+#include <tuple>
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+/*
+	Typed expression builder for the runtime IR.
+
+	Expressions written with the types in glsl::dsl are checked at compile time and turned
+	into GLSLExpression trees when they are used in a statement:
+
+		auto b = glsl::dsl::Builder(_context, _params.main_fn);
+		const auto frag_uvs = b.variable<dsl::vec3>("frag_uvs", GLSLInOut::in);
+		const auto color = b.variable<dsl::vec4>("color", GLSLInOut::out);
+		const auto tex = b.variable<dsl::sampler2DArray>("test_texture");
+		const auto texel = b.declare("texel", dsl::texture(tex, frag_uvs));
+		b.assign(color, texel * 0.5f);
+
+	Operators and builtin wrappers return small expression nodes which carry their GLSL type
+	as a template parameter and hold their operands by value, building an expression allocates
+	nothing. Type rules are the ones from glsl::cx (GLSLGenStatic.hpp), so a mismatch fails to
+	compile rather than hitting an assert in GLSLFunctionBuilder.
+
+	A statement materializes its node tree in a single pass: one GLSLExpression per operator,
+	call, swizzle or conversion and none for variables and literals. Implicit conversions are
+	inserted from the static types, the context is never asked for a type and resolve_params()
+	is not needed.
+*/
+
+namespace glsl
+{
+	namespace dsl
+	{
+		/*
+			Type tags, Var<vec3> is a vec3 variable. The C++ scalar types name their GLSL equivalents.
+		*/
+
+		struct vec2 {};
+		struct vec3 {};
+		struct vec4 {};
+		struct dvec2 {};
+		struct dvec3 {};
+		struct dvec4 {};
+		struct mat4 {};
+		struct sampler2D {};
+		struct sampler2DArray {};
+
+#define GLSL_DSL_TYPE_TAGS(X) \
+		X(bool, glsl_bool) \
+		X(int, glsl_int) \
+		X(float, glsl_float) \
+		X(double, glsl_double) \
+		X(vec2, glsl_vec2) \
+		X(vec3, glsl_vec3) \
+		X(vec4, glsl_vec4) \
+		X(dvec2, glsl_dvec2) \
+		X(dvec3, glsl_dvec3) \
+		X(dvec4, glsl_dvec4) \
+		X(mat4, glsl_mat4) \
+		X(sampler2D, glsl_sampler_2D) \
+		X(sampler2DArray, glsl_sampler_2D_array)
+
+		template <typename T>
+		struct type_tag;
+		template <GLSLType TypeV>
+		struct tag_type;
+
+#define GLSL_DSL_TYPE_TAG(tagName, typeName) \
+		template <> struct type_tag<tagName> { static constexpr GLSLType value = GLSLType::typeName; }; \
+		template <> struct tag_type<GLSLType::typeName> { using type = tagName; };
+		GLSL_DSL_TYPE_TAGS(GLSL_DSL_TYPE_TAG)
+#undef GLSL_DSL_TYPE_TAG
+
+		/**
+		 * @brief GLSL type named by a tag.
+		*/
+		template <typename T>
+		constexpr GLSLType type_tag_v = type_tag<T>::value;
+
+		/**
+		 * @brief Tag naming a GLSL type.
+		*/
+		template <GLSLType TypeV>
+		using tag_type_t = typename tag_type<TypeV>::type;
+
+
+
+		/**
+		 * @brief Builtin functions with DSL wrappers, see add_builtin_functions().
+		*/
+		enum class Builtin : uint8_t
+		{
+			sin,
+			cos,
+			tan,
+			abs,
+			dot,
+			texture,
+		};
+		constexpr size_t builtin_count_v = 6;
+
+		constexpr std::string_view builtin_name(Builtin _fn)
+		{
+			constexpr std::string_view _names[] = { "sin", "cos", "tan", "abs", "dot", "texture" };
+			return _names[static_cast<size_t>(_fn)];
+		};
+
+		/**
+		 * @brief IDs of the builtin functions, looked up once per Builder instead of once per call.
+		*/
+		struct Builtins
+		{
+		public:
+
+			GLSLFunctionID id(Builtin _fn) const noexcept
+			{
+				return this->ids_[static_cast<size_t>(_fn)];
+			};
+
+			/**
+			 * @param _context Context the builtins were added to with add_builtin_functions().
+			*/
+			explicit Builtins(const GLSLContext& _context)
+			{
+				for (size_t n = 0; n != builtin_count_v; ++n)
+				{
+					this->ids_[n] = _context.function_id(std::string(builtin_name(static_cast<Builtin>(n))));
+					HUBRIS_ASSERT(this->ids_[n] != GLSLFunctionID());
+				};
+			};
+
+		private:
+			std::array<GLSLFunctionID, builtin_count_v> ids_{};
+		};
+
+
+
+		template <typename T>
+		concept dsl_node = requires
+		{
+			{ std::remove_cvref_t<T>::type_v } -> std::convertible_to<GLSLType>;
+			{ std::remove_cvref_t<T>::is_leaf_v } -> std::convertible_to<bool>;
+		};
+
+		template <typename ExprT, uint8_t... Ns>
+		struct SwizzleNode;
+
+		/**
+		 * @brief Common base of the expression nodes, provides the swizzle members.
+		 *
+		 * Nodes are built with build() which consumes them, leaves produce a variable or literal
+		 * parameter and every other node also provides build_expression() for use as the root
+		 * of a statement.
+		 *
+		 * @tparam DerivedT Node type.
+		 * @tparam TypeV GLSL type of the node's result.
+		*/
+		template <typename DerivedT, GLSLType TypeV>
+		struct Node
+		{
+		public:
+			static constexpr GLSLType type_v = TypeV;
+			static constexpr bool is_leaf_v = false;
+
+			/**
+			 * @brief Swizzles a vector.
+			 * @tparam Ns Component indexes, 0 to 3.
+			*/
+			template <uint8_t... Ns> requires (cx::is_vector_type(TypeV) && sizeof...(Ns) >= 1 && sizeof...(Ns) <= 4 &&
+				((Ns < vec_size(TypeV)) && ...))
+			SwizzleNode<DerivedT, Ns...> swizzle() const
+			{
+				return SwizzleNode<DerivedT, Ns...>(static_cast<const DerivedT&>(*this));
+			};
+
+			auto x() const { return this->template swizzle<0>(); };
+			auto y() const { return this->template swizzle<1>(); };
+			auto z() const { return this->template swizzle<2>(); };
+			auto w() const { return this->template swizzle<3>(); };
+			auto xy() const { return this->template swizzle<0, 1>(); };
+			auto xz() const { return this->template swizzle<0, 2>(); };
+			auto yz() const { return this->template swizzle<1, 2>(); };
+			auto xyz() const { return this->template swizzle<0, 1, 2>(); };
+
+			/**
+			 * @brief Builds the node as a parameter, allocating its expression.
+			*/
+			GLSLExpression::Parameter build(const Builtins& _builtins) &&
+			{
+				return GLSLExpression::make_unique(static_cast<DerivedT&&>(*this).build_expression(_builtins));
+			};
+		};
+
+		/**
+		 * @brief Typed handle to a variable in the context.
+		*/
+		template <typename T>
+		struct Var : public Node<Var<T>, type_tag_v<T>>
+		{
+		public:
+			static constexpr bool is_leaf_v = true;
+
+			GLSLVariableID id() const noexcept { return this->id_; };
+
+			GLSLExpression::Parameter build(const Builtins&) &&
+			{
+				return GLSLExpression::Parameter(this->id_);
+			};
+
+			/**
+			 * @brief Wraps a variable ID, the variable's type is not checked (see Builder::bind()).
+			*/
+			explicit Var(GLSLVariableID _id) :
+				id_(_id)
+			{};
+
+		private:
+			GLSLVariableID id_;
+		};
+
+		/**
+		 * @brief Literal value, created from C++ scalars or with vec().
+		*/
+		template <GLSLType TypeV>
+		struct Literal : public Node<Literal<TypeV>, TypeV>
+		{
+		public:
+			static constexpr bool is_leaf_v = true;
+
+			GLSLLiteral value;
+
+			GLSLExpression::Parameter build(const Builtins&) &&
+			{
+				return GLSLExpression::Parameter(std::move(this->value));
+			};
+
+			explicit Literal(GLSLLiteral _value) :
+				value(std::move(_value))
+			{};
+		};
+
+		/**
+		 * @brief Typed handle to an expression that has already been built.
+		 *
+		 * Use Builder::materialize() to keep an expression around as a runtime value, ie. to
+		 * return it from a helper without spelling out its node type. Copying an Expr clones
+		 * the expression.
+		*/
+		template <typename T>
+		struct Expr : public Node<Expr<T>, type_tag_v<T>>
+		{
+		public:
+			static constexpr bool is_leaf_v = true;
+
+			GLSLExpression::Parameter build(const Builtins&) &&
+			{
+				return std::move(this->param_);
+			};
+
+			/**
+			 * @brief Wraps a runtime parameter, the caller vouches for its type.
+			*/
+			explicit Expr(GLSLExpression::Parameter _param) :
+				param_(std::move(_param))
+			{};
+
+			Expr(const Expr& other) :
+				param_(other.param_.clone())
+			{};
+			Expr& operator=(const Expr& other)
+			{
+				this->param_ = other.param_.clone();
+				return *this;
+			};
+			Expr(Expr&& other) noexcept = default;
+			Expr& operator=(Expr&& other) noexcept = default;
+
+		private:
+			GLSLExpression::Parameter param_;
+		};
+
+		template <typename ExprT, uint8_t... Ns>
+		struct SwizzleNode : public Node<SwizzleNode<ExprT, Ns...>,
+			cx::vector_type_of(cx::element_type_of(ExprT::type_v), sizeof...(Ns))>
+		{
+		public:
+			ExprT what;
+
+			GLSLExpression build_expression(const Builtins& _builtins) &&
+			{
+				return GLSLExpression::Swizzle(std::move(this->what).build(_builtins), Ns...);
+			};
+
+			explicit SwizzleNode(ExprT _what) :
+				what(std::move(_what))
+			{};
+		};
+
+		template <GLSLBinaryOperator OpV, typename L, typename R>
+		struct BinaryNode : public Node<BinaryNode<OpV, L, R>, cx::binary_result_type(OpV, L::type_v, R::type_v)>
+		{
+		public:
+			L lhs;
+			R rhs;
+
+			GLSLExpression build_expression(const Builtins& _builtins) &&
+			{
+				return GLSLExpression::BinaryOp(OpV, std::move(this->lhs).build(_builtins),
+					std::move(this->rhs).build(_builtins));
+			};
+
+			BinaryNode(L _lhs, R _rhs) :
+				lhs(std::move(_lhs)), rhs(std::move(_rhs))
+			{};
+		};
+
+		template <GLSLType ToV, typename ExprT>
+		struct CastNode : public Node<CastNode<ToV, ExprT>, ToV>
+		{
+		public:
+			ExprT what;
+
+			GLSLExpression build_expression(const Builtins& _builtins) &&
+			{
+				return GLSLExpression::Cast(ToV, std::move(this->what).build(_builtins));
+			};
+
+			explicit CastNode(ExprT _what) :
+				what(std::move(_what))
+			{};
+		};
+
+		template <Builtin FnV, GLSLType ResultV, typename... Args>
+		struct CallNode : public Node<CallNode<FnV, ResultV, Args...>, ResultV>
+		{
+		public:
+			std::tuple<Args...> args;
+
+			GLSLExpression build_expression(const Builtins& _builtins) &&
+			{
+				auto _call = GLSLExpression::FunctionCall(_builtins.id(FnV));
+				_call.params.reserve(sizeof...(Args));
+				std::apply([&_call, &_builtins](Args&... _args)
+					{
+						(_call.params.push_back(std::move(_args).build(_builtins)), ...);
+					}, this->args);
+				return _call;
+			};
+
+			explicit CallNode(Args... _args) :
+				args(std::move(_args)...)
+			{};
+		};
+
+
+
+		/**
+		 * @brief Converts an operand into a node, C++ scalars become literals.
+		*/
+		template <typename T> requires dsl_node<T>
+		std::remove_cvref_t<T> to_node(T&& _node)
+		{
+			return std::forward<T>(_node);
+		};
+		inline Literal<GLSLType::glsl_int> to_node(int _value) { return Literal<GLSLType::glsl_int>(_value); };
+		inline Literal<GLSLType::glsl_float> to_node(float _value) { return Literal<GLSLType::glsl_float>(_value); };
+		inline Literal<GLSLType::glsl_double> to_node(double _value) { return Literal<GLSLType::glsl_double>(_value); };
+		inline Literal<GLSLType::glsl_bool> to_node(bool _value) { return Literal<GLSLType::glsl_bool>(_value); };
+
+		template <typename T>
+		concept dsl_operand = dsl_node<T> || std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+		template <typename T>
+		using node_t = decltype(to_node(std::declval<T>()));
+
+		template <typename T>
+		constexpr GLSLType node_type_v = node_t<T>::type_v;
+
+		/**
+		 * @brief Vector literal, ie. vec(1.0f, 2.0f, 3.0f) is a vec3.
+		*/
+		template <typename... Ts> requires (sizeof...(Ts) >= 2 && sizeof...(Ts) <= 4 && (std::is_arithmetic_v<Ts> && ...))
+		auto vec(Ts... _values)
+		{
+			return Literal<cx::vector_type_of(GLSLType::glsl_float, sizeof...(Ts))>(GLSLLiteral(static_cast<float>(_values)...));
+		};
+
+		/**
+		 * @brief Explicit conversion, emitted as a Cast expression.
+		*/
+		template <typename T, typename ExprT> requires (dsl_operand<ExprT>)
+		auto cast(ExprT&& _expr)
+		{
+			if constexpr (type_tag_v<T> == node_type_v<ExprT>)
+			{
+				return to_node(std::forward<ExprT>(_expr));
+			}
+			else
+			{
+				return CastNode<type_tag_v<T>, node_t<ExprT>>(to_node(std::forward<ExprT>(_expr)));
+			};
+		};
+
+		/**
+		 * @brief Converts an operand for use where a type is expected, like GLSLFunctionBuilder::assign() does.
+		*/
+		template <GLSLType ToV, typename ExprT> requires (dsl_operand<ExprT> && cx::is_implicitly_convertible(node_type_v<ExprT>, ToV))
+		auto convert(ExprT&& _expr)
+		{
+			return cast<tag_type_t<ToV>>(std::forward<ExprT>(_expr));
+		};
+
+#define GLSL_DSL_BINARY_OP(op, name) \
+		template <dsl_operand L, dsl_operand R> requires ((dsl_node<L> || dsl_node<R>) && \
+			cx::is_binary_invocable(GLSLBinaryOperator::name, node_type_v<L>, node_type_v<R>)) \
+		auto operator op(L&& lhs, R&& rhs) \
+		{ \
+			return BinaryNode<GLSLBinaryOperator::name, node_t<L>, node_t<R>>( \
+				to_node(std::forward<L>(lhs)), to_node(std::forward<R>(rhs))); \
+		};
+		GLSL_DSL_BINARY_OP(+, add)
+		GLSL_DSL_BINARY_OP(-, sub)
+		GLSL_DSL_BINARY_OP(*, mult)
+		GLSL_DSL_BINARY_OP(/, div)
+		GLSL_DSL_BINARY_OP(==, eq)
+		GLSL_DSL_BINARY_OP(!=, neq)
+		GLSL_DSL_BINARY_OP(<, lt)
+		GLSL_DSL_BINARY_OP(<=, le)
+		GLSL_DSL_BINARY_OP(>, gt)
+		GLSL_DSL_BINARY_OP(>=, ge)
+#undef GLSL_DSL_BINARY_OP
+
+		/*
+			Builtin functions, the overloads match add_builtin_functions().
+		*/
+
+#define GLSL_DSL_FLOAT_FN(fn) \
+		template <dsl_operand T> requires (cx::is_implicitly_convertible(node_type_v<T>, GLSLType::glsl_float)) \
+		auto fn(T&& _value) \
+		{ \
+			using arg_type = decltype(convert<GLSLType::glsl_float>(std::forward<T>(_value))); \
+			return CallNode<Builtin::fn, GLSLType::glsl_float, arg_type>(convert<GLSLType::glsl_float>(std::forward<T>(_value))); \
+		};
+		GLSL_DSL_FLOAT_FN(sin)
+		GLSL_DSL_FLOAT_FN(cos)
+		GLSL_DSL_FLOAT_FN(tan)
+		GLSL_DSL_FLOAT_FN(abs)
+#undef GLSL_DSL_FLOAT_FN
+
+		template <dsl_node L, dsl_node R> requires (node_type_v<L> == node_type_v<R> &&
+			(cx::is_float_category(node_type_v<L>) || cx::is_double_category(node_type_v<L>)))
+		auto dot(L&& lhs, R&& rhs)
+		{
+			constexpr auto _resultType = cx::is_double_category(node_type_v<L>) ? GLSLType::glsl_double : GLSLType::glsl_float;
+			return CallNode<Builtin::dot, _resultType, node_t<L>, node_t<R>>(to_node(std::forward<L>(lhs)), to_node(std::forward<R>(rhs)));
+		};
+
+		template <dsl_node SamplerT, dsl_node CoordT> requires (
+			(node_type_v<SamplerT> == GLSLType::glsl_sampler_2D && cx::is_implicitly_convertible(node_type_v<CoordT>, GLSLType::glsl_vec2)) ||
+			(node_type_v<SamplerT> == GLSLType::glsl_sampler_2D_array && cx::is_implicitly_convertible(node_type_v<CoordT>, GLSLType::glsl_vec3)))
+		auto texture(SamplerT&& _sampler, CoordT&& _coord)
+		{
+			constexpr auto _coordType = (node_type_v<SamplerT> == GLSLType::glsl_sampler_2D) ? GLSLType::glsl_vec2 : GLSLType::glsl_vec3;
+			using coord_type = decltype(convert<_coordType>(std::forward<CoordT>(_coord)));
+			return CallNode<Builtin::texture, GLSLType::glsl_vec4, node_t<SamplerT>, coord_type>(
+				to_node(std::forward<SamplerT>(_sampler)), convert<_coordType>(std::forward<CoordT>(_coord)));
+		};
+
+
+
+		/**
+		 * @brief Appends statements written with the DSL to a function.
+		 *
+		 * Statements are added directly without the runtime type checks done by
+		 * GLSLFunctionBuilder, their types were checked when they were compiled.
+		*/
+		struct Builder
+		{
+		public:
+
+			GLSLContext& context() const noexcept { return *this->context_; };
+			const Builtins& builtins() const noexcept { return this->builtins_; };
+
+			/**
+			 * @brief Adds a new variable to the context.
+			 * @param _name Variable name.
+			 * @param _inout Storage, local by default.
+			 * @return Handle to the new variable.
+			*/
+			template <typename T>
+			Var<T> variable(const std::string& _name, GLSLInOut _inout = GLSLInOut::local)
+			{
+				auto _var = this->context_->new_variable(_name, type_tag_v<T>);
+				_var->set_inout(_inout);
+				return Var<T>(_var->id());
+			};
+
+			/**
+			 * @brief Adds a uniform variable to the context.
+			*/
+			template <typename T>
+			Var<T> uniform(const std::string& _name)
+			{
+				auto _var = this->context_->new_variable(_name, type_tag_v<T>);
+				_var->set_uniform();
+				return Var<T>(_var->id());
+			};
+
+			/**
+			 * @brief Gets a typed handle to an existing variable, ie. a builtin.
+			 *
+			 * This is the one place the DSL checks a type at runtime, the variable's type must
+			 * already be known and match.
+			 *
+			 * @param _name Variable name.
+			 * @return Handle to the variable.
+			*/
+			template <typename T>
+			Var<T> bind(const std::string& _name) const
+			{
+				const auto _id = this->context_->id(_name);
+				HUBRIS_ASSERT(this->context_->type(_id) == type_tag_v<T>);
+				return Var<T>(_id);
+			};
+
+			/**
+			 * @brief Builds an expression now, keeping it as a typed runtime value.
+			*/
+			template <dsl_node ExprT>
+			Expr<tag_type_t<node_type_v<ExprT>>> materialize(ExprT&& _expr) const
+			{
+				return Expr<tag_type_t<node_type_v<ExprT>>>(to_node(std::forward<ExprT>(_expr)).build(this->builtins_));
+			};
+
+			template <typename T, dsl_operand ExprT> requires (cx::is_implicitly_convertible(node_type_v<ExprT>, type_tag_v<T>))
+			Builder& assign(const Var<T>& _dest, ExprT&& _value)
+			{
+				return this->append(GLSLStatementType::assignment, _dest.id(),
+					convert<type_tag_v<T>>(std::forward<ExprT>(_value)));
+			};
+
+			template <typename T, dsl_operand ExprT> requires (cx::is_implicitly_convertible(node_type_v<ExprT>, type_tag_v<T>))
+			Builder& declare(const Var<T>& _dest, ExprT&& _value)
+			{
+				return this->append(GLSLStatementType::declaration, _dest.id(),
+					convert<type_tag_v<T>>(std::forward<ExprT>(_value)));
+			};
+
+			/**
+			 * @brief Declares a new local variable of the value's type.
+			 * @param _name Variable name.
+			 * @param _value Initial value.
+			 * @return Handle to the new variable.
+			*/
+			template <dsl_operand ExprT>
+			Var<tag_type_t<node_type_v<ExprT>>> declare(const std::string& _name, ExprT&& _value)
+			{
+				const auto _var = this->variable<tag_type_t<node_type_v<ExprT>>>(_name);
+				this->declare(_var, std::forward<ExprT>(_value));
+				return _var;
+			};
+
+			/**
+			 * @brief Declares a new, automatically named, local variable of the value's type.
+			*/
+			template <dsl_operand ExprT>
+			Var<tag_type_t<node_type_v<ExprT>>> declare(ExprT&& _value)
+			{
+				const auto _var = Var<tag_type_t<node_type_v<ExprT>>>(this->context_->new_variable(node_type_v<ExprT>)->id());
+				this->declare(_var, std::forward<ExprT>(_value));
+				return _var;
+			};
+
+			/**
+			 * @brief Returns a value from the function.
+			 *
+			 * The function's return type is runtime data, so it is asserted to match instead.
+			*/
+			template <dsl_operand ExprT>
+			Builder& return_value(ExprT&& _value)
+			{
+				HUBRIS_ASSERT(this->function_->return_type() == node_type_v<ExprT>);
+				return this->append(GLSLStatementType::return_value, GLSLVariableID(), to_node(std::forward<ExprT>(_value)));
+			};
+
+			/**
+			 * @param _context Context holding the symbols, builtin functions must already be added.
+			 * @param _function Function to append statements to.
+			*/
+			Builder(GLSLContext& _context, GLSLFunction& _function) :
+				context_(&_context),
+				function_(&_function),
+				builtins_(_context)
+			{};
+
+		private:
+
+			template <dsl_node ExprT>
+			Builder& append(GLSLStatementType _type, GLSLVariableID _dest, ExprT&& _value)
+			{
+				auto _statement = GLSLStatement(_type);
+				_statement.dest = _dest;
+				if constexpr (std::remove_cvref_t<ExprT>::is_leaf_v)
+				{
+					_statement.expr = GLSLExpression::Identity(std::move(_value).build(this->builtins_));
+				}
+				else
+				{
+					_statement.expr = std::move(_value).build_expression(this->builtins_);
+				};
+				this->function_->append(std::move(_statement));
+				return *this;
+			};
+
+			GLSLContext* context_;
+			GLSLFunction* function_;
+			Builtins builtins_;
+		};
+
+#undef GLSL_DSL_TYPE_TAGS
+	};
+};
@@ -0,0 +1,790 @@
+#include "GLSLGenEval.hpp"
+
+#include <bit>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief Gets the number of float components the evaluator uses for a type.
+		 * @return Component count, or 0 if the type is not supported.
+		*/
+		constexpr uint8_t eval_width(GLSLType _type)
+		{
+			switch (_type)
+			{
+			case GLSLType::glsl_bool:
+				[[fallthrough]];
+			case GLSLType::glsl_float:
+				return 1;
+			case GLSLType::glsl_vec2:
+				return 2;
+			case GLSLType::glsl_vec3:
+				return 3;
+			case GLSLType::glsl_vec4:
+				return 4;
+			default:
+				return 0;
+			};
+		};
+	};
+
+	/**
+	 * @brief Lowers statements into row operations.
+	 *
+	 * Every value is described by the rows holding its components, so swizzles, scalar
+	 * splats and casts only reorder row indices and never emit an operation. Temporaries
+	 * live for a single statement and are numbered separately, they are placed after the
+	 * variable and constant rows once the whole function has been compiled.
+	*/
+	struct GLSLBatchEvaluator::Compiler
+	{
+	public:
+
+		static constexpr uint32_t temp_flag_v = 0x80000000;
+
+		struct Value
+		{
+			std::array<uint32_t, 4> rows{};
+			// 0 if the value failed to compile.
+			uint8_t width = 0;
+		};
+
+		const GLSLContext& context;
+		GLSLBatchEvaluator& eval;
+
+		// Float bit pattern to row.
+		std::map<uint32_t, uint32_t> constants{};
+		std::vector<std::pair<uint32_t, float>> constant_rows{};
+
+		uint32_t fixed_rows = 0;
+		uint32_t temps = 0;
+		uint32_t max_temps = 0;
+
+		std::string error{};
+
+		bool fail(std::string_view _what)
+		{
+			if (this->error.empty())
+			{
+				this->error = _what;
+			};
+			return false;
+		};
+		Value fail_value(std::string_view _what)
+		{
+			this->fail(_what);
+			return Value{};
+		};
+
+		uint32_t constant(float _value)
+		{
+			const auto _bits = std::bit_cast<uint32_t>(_value);
+			if (const auto it = this->constants.find(_bits); it != this->constants.end())
+			{
+				return it->second;
+			};
+
+			const auto _row = this->fixed_rows++;
+			this->constants.insert({ _bits, _row });
+			this->constant_rows.push_back({ _row, _value });
+			return _row;
+		};
+
+		uint32_t temp()
+		{
+			const auto _row = temp_flag_v | this->temps++;
+			this->max_temps = std::max(this->max_temps, this->temps);
+			return _row;
+		};
+
+		Slot* slot(GLSLVariableID _id)
+		{
+			if (const auto it = this->eval.slots_.find(_id); it != this->eval.slots_.end())
+			{
+				return &it->second;
+			};
+
+			const auto _var = this->context.find(_id);
+			if (!_var)
+			{
+				this->fail("unknown variable");
+				return nullptr;
+			};
+
+			const auto _width = eval_width(_var->type());
+			if (_width == 0)
+			{
+				this->fail("unsupported type for variable '" + std::string(_var->name()) + "'");
+				return nullptr;
+			};
+
+			auto _slot = Slot{};
+			_slot.inout = _var->inout();
+			_slot.uniform = _var->uniform();
+			_slot.width = _width;
+			_slot.first_row = this->fixed_rows;
+			this->fixed_rows += _width;
+
+			return &this->eval.slots_.insert({ _id, _slot }).first->second;
+		};
+
+		void emit(OpCode _code, uint32_t _dst, uint32_t _a, uint32_t _b = 0, uint32_t _c = 0)
+		{
+			this->eval.ops_.push_back(Op{ _code, _dst, _a, _b, _c });
+		};
+
+		Value compile(const GLSLLiteral& _literal)
+		{
+			auto _out = Value{};
+			switch (_literal.type())
+			{
+			case GLSLType::glsl_bool:
+				_out.width = 1;
+				_out.rows[0] = this->constant(_literal.vec1<bool>() ? 1.0f : 0.0f);
+				break;
+			case GLSLType::glsl_int:
+				_out.width = 1;
+				_out.rows[0] = this->constant((float)_literal.vec1<int>());
+				break;
+			default:
+				_out.width = eval_width(_literal.type());
+				if (_out.width == 0)
+				{
+					return this->fail_value("unsupported literal type");
+				};
+				for (uint8_t n = 0; n != _out.width; ++n)
+				{
+					_out.rows[n] = this->constant(_literal.arr<float>()[n]);
+				};
+				break;
+			};
+			return _out;
+		};
+
+		Value compile(const GLSLExpression::Parameter& _param)
+		{
+			if (_param.is_expression())
+			{
+				return this->compile(_param.expr());
+			}
+			else if (_param.is_literal())
+			{
+				return this->compile(_param.literal());
+			};
+
+			const auto _slot = this->slot(_param.id());
+			if (!_slot)
+			{
+				return Value{};
+			};
+
+			auto _out = Value{};
+			_out.width = _slot->width;
+			for (uint8_t n = 0; n != _out.width; ++n)
+			{
+				_out.rows[n] = _slot->first_row + n;
+			};
+			return _out;
+		};
+
+		Value compile_unary(OpCode _code, const Value& _value)
+		{
+			auto _out = Value{};
+			_out.width = _value.width;
+			for (uint8_t n = 0; n != _out.width; ++n)
+			{
+				_out.rows[n] = this->temp();
+				this->emit(_code, _out.rows[n], _value.rows[n]);
+			};
+			return _out;
+		};
+
+		Value compile(const GLSLExpression::FunctionCall& _call)
+		{
+			const auto _decl = this->context.find(_call.function);
+			if (!_decl)
+			{
+				return this->fail_value("unknown function");
+			};
+			if (!_decl->builtin())
+			{
+				return this->fail_value("call to user function '" + std::string(_decl->name()) + "', inline it first");
+			};
+
+			auto _params = std::vector<Value>{};
+			for (auto& v : _call.params)
+			{
+				_params.push_back(this->compile(v));
+				if (_params.back().width == 0)
+				{
+					return Value{};
+				};
+			};
+
+			const auto _name = _decl->name();
+			if (_params.size() == 1)
+			{
+				if (_name == "sin") { return this->compile_unary(OpCode::sin, _params[0]); };
+				if (_name == "cos") { return this->compile_unary(OpCode::cos, _params[0]); };
+				if (_name == "tan") { return this->compile_unary(OpCode::tan, _params[0]); };
+				if (_name == "abs") { return this->compile_unary(OpCode::abs, _params[0]); };
+			}
+			else if (_params.size() == 2 && _name == "pow")
+			{
+				const auto& a = _params[0];
+				const auto& b = _params[1];
+				if (a.width != b.width)
+				{
+					return this->fail_value("mismatched pow operand sizes");
+				};
+
+				auto _out = Value{};
+				_out.width = a.width;
+				for (uint8_t n = 0; n != _out.width; ++n)
+				{
+					_out.rows[n] = this->temp();
+					this->emit(OpCode::pow, _out.rows[n], a.rows[n], b.rows[n]);
+				};
+				return _out;
+			}
+			else if (_params.size() == 2 && _name == "dot")
+			{
+				const auto& a = _params[0];
+				const auto& b = _params[1];
+				if (a.width != b.width)
+				{
+					return this->fail_value("mismatched dot operand sizes");
+				};
+
+				auto _out = Value{};
+				_out.width = 1;
+				_out.rows[0] = this->temp();
+				this->emit(OpCode::mul, _out.rows[0], a.rows[0], b.rows[0]);
+				for (uint8_t n = 1; n != a.width; ++n)
+				{
+					this->emit(OpCode::mad, _out.rows[0], a.rows[n], b.rows[n], _out.rows[0]);
+				};
+				return _out;
+			};
+
+			return this->fail_value("unsupported builtin '" + std::string(_name) + "'");
+		};
+
+		Value compile(const GLSLExpression::BinaryOp& _op)
+		{
+			auto _code = OpCode::copy;
+			switch (_op.op)
+			{
+			case GLSLBinaryOperator::add:
+				_code = OpCode::add;
+				break;
+			case GLSLBinaryOperator::sub:
+				_code = OpCode::sub;
+				break;
+			case GLSLBinaryOperator::mult:
+				_code = OpCode::mul;
+				break;
+			case GLSLBinaryOperator::div:
+				_code = OpCode::div;
+				break;
+			case GLSLBinaryOperator::eq:
+				[[fallthrough]];
+			case GLSLBinaryOperator::neq:
+				return this->compile_equality(_op);
+			case GLSLBinaryOperator::lt:
+				_code = OpCode::lt;
+				break;
+			case GLSLBinaryOperator::le:
+				_code = OpCode::le;
+				break;
+			case GLSLBinaryOperator::gt:
+				_code = OpCode::gt;
+				break;
+			case GLSLBinaryOperator::ge:
+				_code = OpCode::ge;
+				break;
+			default:
+				return this->fail_value("unsupported operator");
+			};
+
+			const auto a = this->compile(_op.lhs);
+			const auto b = this->compile(_op.rhs);
+			if (a.width == 0 || b.width == 0)
+			{
+				return Value{};
+			};
+			if (a.width != b.width && a.width != 1 && b.width != 1)
+			{
+				return this->fail_value("mismatched operand sizes");
+			};
+
+			// Scalars are broadcast by reusing their single row for every component.
+			auto _out = Value{};
+			_out.width = std::max(a.width, b.width);
+			for (uint8_t n = 0; n != _out.width; ++n)
+			{
+				_out.rows[n] = this->temp();
+				this->emit(_code, _out.rows[n],
+					a.rows[(a.width == 1) ? 0 : n],
+					b.rows[(b.width == 1) ? 0 : n]);
+			};
+			return _out;
+		};
+
+		/**
+		 * @brief Compiles == and !=, vectors are equal when every component is.
+		*/
+		Value compile_equality(const GLSLExpression::BinaryOp& _op)
+		{
+			const auto a = this->compile(_op.lhs);
+			const auto b = this->compile(_op.rhs);
+			if (a.width == 0 || b.width == 0)
+			{
+				return Value{};
+			};
+			if (a.width != b.width)
+			{
+				return this->fail_value("mismatched operand sizes");
+			};
+
+			auto _out = Value{};
+			_out.width = 1;
+			_out.rows[0] = this->temp();
+			if (a.width == 1)
+			{
+				this->emit((_op.op == GLSLBinaryOperator::eq) ? OpCode::eq : OpCode::neq, _out.rows[0], a.rows[0], b.rows[0]);
+				return _out;
+			};
+
+			// Components are 0.0 or 1.0, their product is the and of them
+			this->emit(OpCode::eq, _out.rows[0], a.rows[0], b.rows[0]);
+			for (uint8_t n = 1; n != a.width; ++n)
+			{
+				const auto _component = this->temp();
+				this->emit(OpCode::eq, _component, a.rows[n], b.rows[n]);
+				this->emit(OpCode::mul, _out.rows[0], _out.rows[0], _component);
+			};
+			if (_op.op == GLSLBinaryOperator::neq)
+			{
+				this->emit(OpCode::sub, _out.rows[0], this->constant(1.0f), _out.rows[0]);
+			};
+			return _out;
+		};
+
+		Value compile(const GLSLExpression::Select& _select)
+		{
+			const auto _condition = this->compile(_select.condition);
+			const auto a = this->compile(_select.if_true);
+			const auto b = this->compile(_select.if_false);
+			if (_condition.width == 0 || a.width == 0 || b.width == 0)
+			{
+				return Value{};
+			};
+			if (_condition.width != 1 || a.width != b.width)
+			{
+				return this->fail_value("mismatched select operand sizes");
+			};
+
+			// Both sides are evaluated for every lane and picked between per lane
+			auto _out = Value{};
+			_out.width = a.width;
+			for (uint8_t n = 0; n != _out.width; ++n)
+			{
+				_out.rows[n] = this->temp();
+				this->emit(OpCode::select, _out.rows[n], _condition.rows[0], a.rows[n], b.rows[n]);
+			};
+			return _out;
+		};
+
+		Value compile(const GLSLExpression& _expr)
+		{
+			switch (_expr.type())
+			{
+			case GLSLExpressionType::identity:
+				return this->compile(_expr.get<GLSLExpression::Identity>().param);
+
+			case GLSLExpressionType::cast:
+			{
+				const auto& _cast = _expr.get<GLSLExpression::Cast>();
+				const auto _width = eval_width(_cast.to_type());
+				if (_width == 0)
+				{
+					return this->fail_value("unsupported cast type");
+				};
+
+				const auto _from = this->compile(_cast.param);
+				if (_from.width == 0)
+				{
+					return Value{};
+				};
+
+				// Same padding as the emitter, missing components are 0 except w which is 1.
+				auto _out = Value{};
+				_out.width = _width;
+				for (uint8_t n = 0; n != _width; ++n)
+				{
+					if (_from.width == 1)
+					{
+						_out.rows[n] = _from.rows[0];
+					}
+					else if (n < _from.width)
+					{
+						_out.rows[n] = _from.rows[n];
+					}
+					else
+					{
+						_out.rows[n] = this->constant((n == 3) ? 1.0f : 0.0f);
+					};
+				};
+				return _out;
+			};
+
+			case GLSLExpressionType::function_call:
+				return this->compile(_expr.get<GLSLExpression::FunctionCall>());
+
+			case GLSLExpressionType::binary_op:
+				return this->compile(_expr.get<GLSLExpression::BinaryOp>());
+
+			case GLSLExpressionType::select:
+				return this->compile(_expr.get<GLSLExpression::Select>());
+
+			case GLSLExpressionType::swizzle:
+			{
+				const auto& _swizzle = _expr.get<GLSLExpression::Swizzle>();
+				const auto _from = this->compile(_swizzle.what);
+				if (_from.width == 0)
+				{
+					return Value{};
+				};
+
+				auto _out = Value{};
+				for (auto v : _swizzle.swizzle_)
+				{
+					if (v == 255)
+					{
+						break;
+					};
+					if (v >= _from.width)
+					{
+						return this->fail_value("swizzle out of range");
+					};
+					_out.rows[_out.width++] = _from.rows[v];
+				};
+				return _out;
+			};
+
+			default:
+				return this->fail_value("unsupported expression");
+			};
+		};
+
+		bool compile(const GLSLStatement& _statement)
+		{
+			this->temps = 0;
+
+			if (_statement.type == GLSLStatementType::return_value)
+			{
+				return this->fail("return statements are not supported");
+			};
+			if (_statement.type == GLSLStatementType::for_loop)
+			{
+				return this->fail("loops are not supported, unroll them first");
+			};
+			if (_statement.type == GLSLStatementType::if_else)
+			{
+				return this->fail("branches are not supported");
+			};
+
+			const auto _dest = this->slot(_statement.dest);
+			if (!_dest)
+			{
+				return false;
+			};
+			if (_dest->inout == GLSLInOut::in || _dest->uniform)
+			{
+				return this->fail("cannot write to an input or uniform");
+			};
+
+			auto _value = this->compile(_statement.expr);
+			if (_value.width == 0)
+			{
+				return false;
+			};
+			if (_value.width != _dest->width)
+			{
+				return this->fail("mismatched assignment size");
+			};
+
+			// Writing a permutation of the destination into itself must go through temporaries.
+			const auto _first = _dest->first_row;
+			const auto _last = _first + _dest->width;
+			bool _overlaps = false;
+			for (uint8_t n = 0; n != _value.width; ++n)
+			{
+				const auto _row = _value.rows[n];
+				if (_row >= _first && _row < _last && _row != _first + n)
+				{
+					_overlaps = true;
+				};
+			};
+			if (_overlaps)
+			{
+				for (uint8_t n = 0; n != _value.width; ++n)
+				{
+					const auto _temp = this->temp();
+					this->emit(OpCode::copy, _temp, _value.rows[n]);
+					_value.rows[n] = _temp;
+				};
+			};
+
+			for (uint8_t n = 0; n != _value.width; ++n)
+			{
+				if (_value.rows[n] != _first + n)
+				{
+					this->emit(OpCode::copy, _first + n, _value.rows[n]);
+				};
+			};
+			return true;
+		};
+
+		/**
+		 * @brief Places the temporaries and fills the constant rows.
+		*/
+		void finish()
+		{
+			const auto _place = [this](uint32_t& _row)
+			{
+				if (_row & temp_flag_v)
+				{
+					_row = this->fixed_rows + (_row & ~temp_flag_v);
+				};
+			};
+			for (auto& v : this->eval.ops_)
+			{
+				_place(v.dst);
+				_place(v.a);
+				_place(v.b);
+				_place(v.c);
+			};
+
+			this->eval.rows_.resize(this->fixed_rows + this->max_temps);
+			for (auto& [_row, _value] : this->constant_rows)
+			{
+				this->eval.rows_[_row].lanes.fill(_value);
+			};
+		};
+
+		Compiler(const GLSLContext& _context, GLSLBatchEvaluator& _eval) :
+			context(_context),
+			eval(_eval)
+		{};
+	};
+
+
+
+	GLSLEvalResult GLSLBatchEvaluator::compile(const GLSLContext& _context, const GLSLFunction& _function)
+	{
+		this->ops_.clear();
+		this->rows_.clear();
+		this->slots_.clear();
+
+		auto _compiler = Compiler(_context, *this);
+		for (auto& v : _function.body())
+		{
+			if (!_compiler.compile(v))
+			{
+				break;
+			};
+		};
+
+		auto _result = GLSLEvalResult();
+		if (!_compiler.error.empty())
+		{
+			this->ops_.clear();
+			this->slots_.clear();
+			_result.error = std::move(_compiler.error);
+			return _result;
+		};
+
+		_compiler.finish();
+		_result.good = true;
+		return _result;
+	};
+
+	bool GLSLBatchEvaluator::bind_input(GLSLVariableID _id, std::initializer_list<const float*> _components)
+	{
+		const auto it = this->slots_.find(_id);
+		if (it == this->slots_.end() || it->second.inout != GLSLInOut::in || it->second.width != _components.size())
+		{
+			return false;
+		};
+
+		auto& _slot = it->second;
+		std::ranges::copy(_components, _slot.in.begin());
+		_slot.bound = true;
+		return true;
+	};
+
+	bool GLSLBatchEvaluator::bind_output(GLSLVariableID _id, std::initializer_list<float*> _components)
+	{
+		const auto it = this->slots_.find(_id);
+		if (it == this->slots_.end() || it->second.inout != GLSLInOut::out || it->second.width != _components.size())
+		{
+			return false;
+		};
+
+		auto& _slot = it->second;
+		std::ranges::copy(_components, _slot.out.begin());
+		_slot.bound = true;
+		return true;
+	};
+
+	bool GLSLBatchEvaluator::set_uniform(GLSLVariableID _id, std::initializer_list<float> _value)
+	{
+		const auto it = this->slots_.find(_id);
+		if (it == this->slots_.end() || !it->second.uniform || it->second.width != _value.size())
+		{
+			return false;
+		};
+
+		// Uniform rows are never written by the program, filling them once is enough.
+		auto& _slot = it->second;
+		auto _row = _slot.first_row;
+		for (auto v : _value)
+		{
+			this->rows_[_row++].lanes.fill(v);
+		};
+		_slot.bound = true;
+		return true;
+	};
+
+	GLSLEvalResult GLSLBatchEvaluator::run(size_t _count)
+	{
+		auto _result = GLSLEvalResult();
+
+		auto _inputs = std::vector<const Slot*>{};
+		auto _outputs = std::vector<const Slot*>{};
+		for (auto& [_id, _slot] : this->slots_)
+		{
+			if ((_slot.inout == GLSLInOut::in || _slot.uniform) && !_slot.bound)
+			{
+				_result.error = "unbound input or uniform";
+				return _result;
+			};
+
+			if (_slot.inout == GLSLInOut::in)
+			{
+				_inputs.push_back(&_slot);
+			}
+			else if (_slot.inout == GLSLInOut::out && _slot.bound)
+			{
+				_outputs.push_back(&_slot);
+			};
+		};
+
+		const auto _start = std::chrono::steady_clock::now();
+
+		auto _rows = this->rows_.data();
+		for (size_t _offset = 0; _offset < _count; _offset += glsl_eval_lanes_v)
+		{
+			const auto _lanes = std::min(glsl_eval_lanes_v, _count - _offset);
+
+			for (auto _slot : _inputs)
+			{
+				for (uint8_t c = 0; c != _slot->width; ++c)
+				{
+					std::copy_n(_slot->in[c] + _offset, _lanes, _rows[_slot->first_row + c].lanes.data());
+				};
+			};
+
+			for (auto& op : this->ops_)
+			{
+				float* const d = _rows[op.dst].lanes.data();
+				const float* const a = _rows[op.a].lanes.data();
+				const float* const b = _rows[op.b].lanes.data();
+				const float* const c = _rows[op.c].lanes.data();
+
+				switch (op.code)
+				{
+				case OpCode::copy:
+					std::copy_n(a, glsl_eval_lanes_v, d);
+					break;
+				case OpCode::add:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = a[n] + b[n]; };
+					break;
+				case OpCode::sub:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = a[n] - b[n]; };
+					break;
+				case OpCode::mul:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = a[n] * b[n]; };
+					break;
+				case OpCode::div:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = a[n] / b[n]; };
+					break;
+				case OpCode::mad:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = a[n] * b[n] + c[n]; };
+					break;
+				case OpCode::sin:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = std::sin(a[n]); };
+					break;
+				case OpCode::cos:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = std::cos(a[n]); };
+					break;
+				case OpCode::tan:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = std::tan(a[n]); };
+					break;
+				case OpCode::abs:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = std::abs(a[n]); };
+					break;
+				case OpCode::pow:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = std::pow(a[n], b[n]); };
+					break;
+				case OpCode::eq:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] == b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::neq:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] != b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::lt:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] < b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::le:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] <= b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::gt:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] > b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::ge:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] >= b[n]) ? 1.0f : 0.0f; };
+					break;
+				case OpCode::select:
+					for (size_t n = 0; n != glsl_eval_lanes_v; ++n) { d[n] = (a[n] != 0.0f) ? b[n] : c[n]; };
+					break;
+				default:
+					abort();
+					break;
+				};
+			};
+
+			for (auto _slot : _outputs)
+			{
+				for (uint8_t c = 0; c != _slot->width; ++c)
+				{
+					std::copy_n(_rows[_slot->first_row + c].lanes.data(), _lanes, _slot->out[c] + _offset);
+				};
+			};
+		};
+
+		const auto _end = std::chrono::steady_clock::now();
+
+		_result.good = true;
+		_result.invocations = _count;
+		_result.seconds = std::chrono::duration<double>(_end - _start).count();
+		return _result;
+	};
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <map>
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+
+namespace glsl
+{
+	/**
+	 * @brief Number of invocations evaluated together.
+	 *
+	 * Every operation runs over a full block of lanes with a fixed trip count, which lets
+	 * the compiler vectorize the inner loops.
+	*/
+	constexpr size_t glsl_eval_lanes_v = 64;
+
+	/**
+	 * @brief Outcome of compiling or running a batch evaluation.
+	*/
+	struct GLSLEvalResult
+	{
+		bool good = false;
+
+		/**
+		 * @brief Description of the first error, empty on success.
+		*/
+		std::string error{};
+
+		/**
+		 * @brief Number of invocations run and how long it took.
+		*/
+		size_t invocations = 0;
+		double seconds = 0.0;
+
+		/**
+		 * @brief Evaluation throughput.
+		 * @return Invocations per second, 0 if no time was measured.
+		*/
+		double invocations_per_second() const
+		{
+			return (this->seconds > 0.0) ? (double)this->invocations / this->seconds : 0.0;
+		};
+
+		explicit operator bool() const noexcept { return this->good; };
+	};
+
+	/**
+	 * @brief Runs a function on the CPU over many invocations at once.
+	 *
+	 * Inputs, outputs and results are structure-of-arrays: each component of a variable is
+	 * its own float array with one entry per invocation. Only float based types (float,
+	 * vec2, vec3 and vec4) and bool are supported, along with the sin, cos, tan, abs, pow and dot builtins.
+	 * Bools are stored as 0.0 or 1.0, comparisons produce them and selects pick per lane.
+	 * The function must be resolved (see deduce_auto()) and may not call user functions.
+	*/
+	struct GLSLBatchEvaluator
+	{
+	public:
+
+		/**
+		 * @brief Compiles a function into a lane program, replacing any previous program and bindings.
+		 * @param _context Context holding the symbols.
+		 * @param _function Function to evaluate, usually the shader's main function.
+		 * @return Result, check "good" before binding or running.
+		*/
+		GLSLEvalResult compile(const GLSLContext& _context, const GLSLFunction& _function);
+
+		/**
+		 * @brief Binds the source arrays for an input variable.
+		 * @param _id Input variable ID.
+		 * @param _components One array per component, each with at least as many entries as invocations run.
+		 * @return True on success, false if the variable is not an input of the program or the component count differs.
+		*/
+		bool bind_input(GLSLVariableID _id, std::initializer_list<const float*> _components);
+
+		/**
+		 * @brief Binds the destination arrays for an output variable, unbound outputs are not written.
+		 * @param _id Output variable ID.
+		 * @param _components One array per component, each with at least as many entries as invocations run.
+		 * @return True on success, false if the variable is not an output of the program or the component count differs.
+		*/
+		bool bind_output(GLSLVariableID _id, std::initializer_list<float*> _components);
+
+		/**
+		 * @brief Sets the value of a uniform, shared by every invocation.
+		 * @param _id Uniform variable ID.
+		 * @param _value Component values.
+		 * @return True on success, false if the variable is not a uniform of the program or the component count differs.
+		*/
+		bool set_uniform(GLSLVariableID _id, std::initializer_list<float> _value);
+
+		/**
+		 * @brief Runs the program, every input and uniform must be bound.
+		 * @param _count Number of invocations.
+		 * @return Result with the time taken.
+		*/
+		GLSLEvalResult run(size_t _count);
+
+		GLSLBatchEvaluator() = default;
+
+	private:
+
+		enum class OpCode : uint8_t
+		{
+			copy,
+			add,
+			sub,
+			mul,
+			div,
+			// dst = a * b + c
+			mad,
+			sin,
+			cos,
+			tan,
+			abs,
+			pow,
+			// dst = 1.0 if the comparison holds, 0.0 otherwise
+			eq,
+			neq,
+			lt,
+			le,
+			gt,
+			ge,
+			// dst = a != 0.0 ? b : c
+			select,
+		};
+
+		struct Op
+		{
+			OpCode code;
+			uint32_t dst;
+			uint32_t a;
+			uint32_t b;
+			uint32_t c;
+		};
+
+		struct alignas(64) Row
+		{
+			std::array<float, glsl_eval_lanes_v> lanes;
+		};
+
+		struct Slot
+		{
+			GLSLInOut inout = GLSLInOut::local;
+			bool uniform = false;
+			bool bound = false;
+			uint8_t width = 0;
+			uint32_t first_row = 0;
+			std::array<const float*, 4> in{};
+			std::array<float*, 4> out{};
+		};
+
+		struct Compiler;
+
+		std::vector<Op> ops_{};
+		std::vector<Row> rows_{};
+		std::map<GLSLVariableID, Slot> slots_{};
+	};
+};
@@ -0,0 +1,230 @@
+#include "GLSLGenFile.hpp"
+
+#include <fstream>
+#include <utility>
+#include <iterator>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+namespace glsl
+{
+	bool GLSLMappedFile::open(const std::filesystem::path& _path)
+	{
+		this->close();
+
+#ifdef _WIN32
+		const auto _file = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		};
+
+		LARGE_INTEGER _size{};
+		if (!GetFileSizeEx(_file, &_size))
+		{
+			CloseHandle(_file);
+			return false;
+		};
+
+		if (_size.QuadPart == 0)
+		{
+			// Cannot map an empty file, treat it as an empty mapping.
+			CloseHandle(_file);
+			this->good_ = true;
+			return true;
+		};
+
+		const auto _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(_file);
+		if (!_mapping)
+		{
+			return false;
+		};
+
+		const auto _view = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(_mapping);
+		if (!_view)
+		{
+			return false;
+		};
+
+		this->data_ = _view;
+		this->size_ = (size_t)_size.QuadPart;
+#else
+		const auto _fd = ::open(_path.c_str(), O_RDONLY);
+		if (_fd < 0)
+		{
+			return false;
+		};
+
+		struct stat _stat{};
+		if (::fstat(_fd, &_stat) != 0)
+		{
+			::close(_fd);
+			return false;
+		};
+
+		if (_stat.st_size == 0)
+		{
+			// Cannot map an empty file, treat it as an empty mapping.
+			::close(_fd);
+			this->good_ = true;
+			return true;
+		};
+
+		const auto _view = ::mmap(nullptr, (size_t)_stat.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		::close(_fd);
+		if (_view == MAP_FAILED)
+		{
+			return false;
+		};
+
+		this->data_ = _view;
+		this->size_ = (size_t)_stat.st_size;
+#endif
+
+		this->good_ = true;
+		return true;
+	};
+
+	void GLSLMappedFile::close() noexcept
+	{
+		if (this->data_)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(this->data_);
+#else
+			::munmap(const_cast<void*>(this->data_), this->size_);
+#endif
+		};
+
+		this->data_ = nullptr;
+		this->size_ = 0;
+		this->good_ = false;
+	};
+
+	GLSLMappedFile::GLSLMappedFile(GLSLMappedFile&& other) noexcept :
+		data_(std::exchange(other.data_, nullptr)),
+		size_(std::exchange(other.size_, 0)),
+		good_(std::exchange(other.good_, false))
+	{};
+	GLSLMappedFile& GLSLMappedFile::operator=(GLSLMappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->close();
+			this->data_ = std::exchange(other.data_, nullptr);
+			this->size_ = std::exchange(other.size_, 0);
+			this->good_ = std::exchange(other.good_, false);
+		};
+		return *this;
+	};
+
+	GLSLMappedFile::~GLSLMappedFile()
+	{
+		this->close();
+	};
+
+
+
+	GLSLFileCache::MappedFile GLSLFileCache::get(const std::filesystem::path& _path)
+	{
+		std::error_code _err{};
+		const auto _key = std::filesystem::weakly_canonical(_path, _err);
+		if (_err)
+		{
+			return nullptr;
+		};
+
+		const auto _writeTime = std::filesystem::last_write_time(_key, _err);
+		if (_err)
+		{
+			return nullptr;
+		};
+		const auto _size = std::filesystem::file_size(_key, _err);
+		if (_err)
+		{
+			return nullptr;
+		};
+
+		// Reuse the mapping if the file has not changed since it was mapped
+		if (const auto it = this->entries_.find(_key); it != this->entries_.end())
+		{
+			if (it->second.write_time == _writeTime && it->second.size == _size)
+			{
+				return it->second.file;
+			};
+		};
+
+		auto _file = std::make_shared<GLSLMappedFile>(_key);
+		if (!_file->good())
+		{
+			this->entries_.erase(_key);
+			return nullptr;
+		};
+
+		this->entries_.insert_or_assign(_key, Entry{ _file, _writeTime, _size });
+		return _file;
+	};
+
+	void GLSLFileCache::erase(const std::filesystem::path& _path)
+	{
+		std::error_code _err{};
+		const auto _key = std::filesystem::weakly_canonical(_path, _err);
+		this->entries_.erase(_err ? _path : _key);
+	};
+
+
+	bool read_file(const std::filesystem::path& _path, std::string& _out)
+	{
+		auto _file = std::ifstream(_path, std::ios::binary);
+		if (!_file)
+		{
+			return false;
+		};
+		_out.assign(std::istreambuf_iterator<char>(_file), std::istreambuf_iterator<char>());
+		return !_file.bad();
+	};
+
+	bool write_file_atomic(const std::filesystem::path& _path, std::string_view _data)
+	{
+		auto _tempPath = _path;
+		_tempPath += ".tmp";
+
+		{
+			auto _file = std::ofstream(_tempPath, std::ios::binary | std::ios::trunc);
+			_file.write(_data.data(), (std::streamsize)_data.size());
+			_file.close();
+			if (!_file)
+			{
+				std::error_code _err{};
+				std::filesystem::remove(_tempPath, _err);
+				return false;
+			};
+		};
+
+		// Rename replaces the destination in a single step on both POSIX and Windows
+		std::error_code _err{};
+		std::filesystem::rename(_tempPath, _path, _err);
+		if (_err)
+		{
+			std::filesystem::remove(_tempPath, _err);
+			return false;
+		};
+		return true;
+	};
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+/** @file */
+
+#include <map>
+#include <span>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Read-only memory mapping of a whole file.
+	 *
+	 * The mapping is released when the object is destroyed. Empty files are valid and
+	 * produce an empty, but good, mapping.
+	 *
+	 * The file must not shrink while mapped, touching a page past its new end raises SIGBUS
+	 * on POSIX. Read files other programs may be editing with read_file() instead.
+	*/
+	struct GLSLMappedFile
+	{
+	public:
+
+		/**
+		 * @brief Checks if the file was successfully mapped.
+		 * @return True if mapped, false otherwise.
+		*/
+		bool good() const noexcept { return this->good_; };
+		explicit operator bool() const noexcept { return this->good(); };
+
+		const std::byte* data() const noexcept { return static_cast<const std::byte*>(this->data_); };
+		size_t size() const noexcept { return this->size_; };
+
+		std::span<const std::byte> bytes() const noexcept
+		{
+			return std::span<const std::byte>(this->data(), this->size());
+		};
+		std::string_view text() const noexcept
+		{
+			return std::string_view(static_cast<const char*>(this->data_), this->size_);
+		};
+
+		/**
+		 * @brief Maps a file into memory.
+		 * @param _path Path to the file.
+		 * @return True on success, false otherwise.
+		*/
+		bool open(const std::filesystem::path& _path);
+
+		/**
+		 * @brief Releases the mapping, does nothing if nothing is mapped.
+		*/
+		void close() noexcept;
+
+		GLSLMappedFile() = default;
+		explicit GLSLMappedFile(const std::filesystem::path& _path)
+		{
+			this->open(_path);
+		};
+
+		GLSLMappedFile(const GLSLMappedFile& other) = delete;
+		GLSLMappedFile& operator=(const GLSLMappedFile& other) = delete;
+
+		GLSLMappedFile(GLSLMappedFile&& other) noexcept;
+		GLSLMappedFile& operator=(GLSLMappedFile&& other) noexcept;
+
+		~GLSLMappedFile();
+
+	private:
+		const void* data_ = nullptr;
+		size_t size_ = 0;
+		bool good_ = false;
+	};
+
+	/**
+	 * @brief Caches memory mapped files by path.
+	 *
+	 * A cached mapping is reused until the file's size or last write time changes. Handed
+	 * out mappings stay valid for as long as they are held, even if the cache remaps or
+	 * drops the entry.
+	*/
+	struct GLSLFileCache
+	{
+	public:
+
+		using MappedFile = std::shared_ptr<const GLSLMappedFile>;
+
+		/**
+		 * @brief Gets the mapping for a file, mapping it if not cached or out of date.
+		 * @param _path Path to the file.
+		 * @return Mapped file, or null if the file could not be mapped.
+		*/
+		MappedFile get(const std::filesystem::path& _path);
+
+		/**
+		 * @brief Drops a single cached file.
+		 * @param _path Path to the file.
+		*/
+		void erase(const std::filesystem::path& _path);
+
+		/**
+		 * @brief Drops every cached file.
+		*/
+		void clear()
+		{
+			this->entries_.clear();
+		};
+
+		size_t size() const noexcept
+		{
+			return this->entries_.size();
+		};
+
+		GLSLFileCache() = default;
+
+	private:
+
+		struct Entry
+		{
+			MappedFile file;
+			std::filesystem::file_time_type write_time;
+			uintmax_t size;
+		};
+
+		std::map<std::filesystem::path, Entry> entries_{};
+	};
+
+	/**
+	 * @brief Reads a whole file into a string.
+	 *
+	 * Unlike a mapping, the copy is unaffected by the file being truncated or rewritten while
+	 * or after it is read.
+	 *
+	 * @param _path Path to the file to read.
+	 * @param _out Set to the file's contents.
+	 * @return True on success, false otherwise.
+	*/
+	bool read_file(const std::filesystem::path& _path, std::string& _out);
+
+	/**
+	 * @brief Replaces a file's contents atomically.
+	 *
+	 * The data is written to a temporary file next to the destination which is then renamed
+	 * over it, so readers see either the old or the new contents and never a partial file.
+	 *
+	 * @param _path Path to the file to write.
+	 * @param _data Contents to write.
+	 * @return True on success, false otherwise. The destination is untouched on failure.
+	*/
+	bool write_file_atomic(const std::filesystem::path& _path, std::string_view _data);
+};
@@ -0,0 +1,556 @@
+#include "GLSLGenInline.hpp"
+
+#include <map>
+#include <set>
+#include <format>
+#include <algorithm>
+
+namespace glsl
+{
+	const GLSLCallGraph::Node* GLSLCallGraph::find(GLSLFunctionID _function) const
+	{
+		const auto it = std::ranges::find(this->nodes, _function, &Node::function);
+		return (it != this->nodes.end()) ? &*it : nullptr;
+	};
+
+	namespace
+	{
+		/**
+		 * @brief Calls a function for every call within an expression tree, parents before children.
+		 * @param _fn Invoked with each call and whether it sits within the operands of a select,
+		 *	which are only evaluated if chosen.
+		*/
+		template <typename FnT>
+		void for_each_call(const GLSLExpression& _expr, bool _conditional, FnT&& _fn)
+		{
+			if (_expr.type() == GLSLExpressionType::function_call)
+			{
+				_fn(_expr.get<GLSLExpression::FunctionCall>(), _conditional);
+			};
+
+			const auto _visit = [&_fn](const GLSLExpression::Parameter& _param, bool _conditionalParam)
+			{
+				if (_param.is_expression())
+				{
+					for_each_call(_param.expr(), _conditionalParam, _fn);
+				};
+			};
+			if (_expr.type() == GLSLExpressionType::select)
+			{
+				const auto& _select = _expr.get<GLSLExpression::Select>();
+				_visit(_select.condition, _conditional);
+				_visit(_select.if_true, true);
+				_visit(_select.if_false, true);
+				return;
+			};
+			for_each_param(_expr, [&_visit, _conditional](const GLSLExpression::Parameter& _param)
+				{
+					_visit(_param, _conditional);
+				});
+		};
+	};
+
+	GLSLCallGraph build_call_graph(const GLSLParams& _params)
+	{
+		auto _graph = GLSLCallGraph();
+		_graph.nodes.reserve(_params.functions.size() + 1);
+		for (auto& _function : _params.functions)
+		{
+			_graph.nodes.push_back(GLSLCallGraph::Node{ _function.id() });
+		};
+		_graph.nodes.push_back(GLSLCallGraph::Node{});
+
+		// Null caller for globals
+		const auto _visit = [&_graph](std::span<const GLSLStatement> _body, GLSLCallGraph::Node* _caller)
+		{
+			for_each_statement(_body, [&](const GLSLStatement& _statement)
+				{
+					const auto _inBound = _statement.type == GLSLStatementType::for_loop;
+					for_each_call(_statement.expr, false, [&](const GLSLExpression::FunctionCall& _call, bool _conditional)
+						{
+							const auto _id = _call.function;
+							const auto it = std::ranges::find(_graph.nodes, _id, &GLSLCallGraph::Node::function);
+							if (!_id || it == _graph.nodes.end())
+							{
+								// Builtin
+								return;
+							};
+
+							++it->call_sites;
+							if (!_caller)
+							{
+								it->called_from_globals = true;
+							}
+							else if (std::ranges::find(_caller->callees, _id) == _caller->callees.end())
+							{
+								_caller->callees.push_back(_id);
+							};
+							it->called_from_loop_bound = it->called_from_loop_bound || _inBound;
+							it->called_from_select = it->called_from_select || _conditional;
+						});
+				});
+		};
+
+		_visit(_params.globals, nullptr);
+		for (size_t n = 0; n != _params.functions.size(); ++n)
+		{
+			_visit(_params.functions[n].body(), &_graph.nodes[n]);
+		};
+		_visit(_params.main_fn.body(), &_graph.nodes.back());
+
+		return _graph;
+	};
+
+
+
+	namespace
+	{
+		/**
+		 * @brief Checks if a function ends in its only return, loop bodies never return.
+		*/
+		bool is_inlinable(const GLSLFunction& _function)
+		{
+			const auto _body = _function.body();
+			if (_function.return_type() == GLSLType::glsl_void || _body.empty() ||
+				_body.back().type != GLSLStatementType::return_value)
+			{
+				return false;
+			};
+			return std::ranges::count(_body, GLSLStatementType::return_value, &GLSLStatement::type) == 1;
+		};
+
+		/**
+		 * @brief Writable variables an expression or a function reads and writes.
+		*/
+		struct Effects
+		{
+			std::set<GLSLVariableID> reads{};
+			std::set<GLSLVariableID> writes{};
+
+			// Calls a user function, which may touch anything
+			bool calls = false;
+		};
+
+		/**
+		 * @brief Adds what an expression reads, calls to one function are counted instead.
+		 * @return Number of calls made to _skip.
+		*/
+		size_t add_effects(const GLSLContext& _context, const GLSLExpression& _expr, GLSLFunctionID _skip, Effects& _effects)
+		{
+			size_t _skipped = 0;
+			for_each_expression(_expr, [&](const GLSLExpression& _node)
+				{
+					if (_node.type() == GLSLExpressionType::function_call)
+					{
+						const auto _id = _node.get<GLSLExpression::FunctionCall>().function;
+						const auto _function = _context.find(_id);
+						if (_id == _skip)
+						{
+							++_skipped;
+						}
+						else if (!_function || !_function->builtin())
+						{
+							_effects.calls = true;
+						};
+					};
+					for_each_param(_node, [&](const GLSLExpression::Parameter& _param)
+						{
+							if (!_param.is_variable())
+							{
+								return;
+							};
+							const auto _var = _context.find(_param.id());
+							if (_var && _var->can_write())
+							{
+								_effects.reads.insert(_param.id());
+							};
+						});
+				});
+			return _skipped;
+		};
+
+		/**
+		 * @brief Gets what a function's calls touch outside of its own parameters and locals.
+		*/
+		Effects function_effects(const GLSLContext& _context, const GLSLFunction& _function)
+		{
+			auto _locals = std::set<GLSLVariableID>(_function.params().begin(), _function.params().end());
+			for_each_statement(_function.body(), [&_locals](const GLSLStatement& _statement)
+				{
+					if (_statement.type == GLSLStatementType::declaration || _statement.type == GLSLStatementType::for_loop)
+					{
+						_locals.insert(_statement.dest);
+					};
+				});
+
+			auto _effects = Effects();
+			for_each_statement(_function.body(), [&](const GLSLStatement& _statement)
+				{
+					if (_statement.has_dest() && !_locals.contains(_statement.dest))
+					{
+						_effects.writes.insert(_statement.dest);
+					};
+					add_effects(_context, _statement.expr, GLSLFunctionID(), _effects);
+				});
+			std::erase_if(_effects.reads, [&_locals](GLSLVariableID v) { return _locals.contains(v); });
+			return _effects;
+		};
+
+		/**
+		 * @brief Checks if a function's statements may move ahead of every statement calling it.
+		 *
+		 * An inlined call runs before the rest of its statement and its return expression is
+		 * read within it, afterwards. That only gives the same results if nothing else in the
+		 * statement, arguments included, writes what the callee reads or touches what it writes.
+		*/
+		bool is_order_safe(const GLSLContext& _context, const GLSLParams& _params, const GLSLFunction& _function)
+		{
+			const auto _callee = function_effects(_context, _function);
+			const auto _writes = _callee.calls || !_callee.writes.empty();
+
+			bool _safe = true;
+			const auto _visit = [&](std::span<const GLSLStatement> _body)
+			{
+				for_each_statement(_body, [&](const GLSLStatement& _statement)
+					{
+						auto _others = Effects();
+						const auto _count = add_effects(_context, _statement.expr, _function.id(), _others);
+						if (_count == 0)
+						{
+							return;
+						};
+
+						// Copies of a function writing anything would all run before either result is read
+						const auto _conflict =
+							(_writes && _count > 1) ||
+							(_others.calls && (_writes || !_callee.reads.empty())) ||
+							(_callee.calls && !_others.reads.empty()) ||
+							std::ranges::any_of(_callee.writes, [&_others](GLSLVariableID v) { return _others.reads.contains(v); });
+						_safe = _safe && !_conflict;
+					});
+			};
+			for (auto& _caller : _params.functions)
+			{
+				_visit(_caller.body());
+			};
+			_visit(_params.main_fn.body());
+			return _safe;
+		};
+
+		/**
+		 * @brief Turns an expression into a parameter, unwrapping identities.
+		*/
+		GLSLExpression::Parameter to_parameter(GLSLExpression&& _expr)
+		{
+			if (_expr.type() == GLSLExpressionType::identity)
+			{
+				return std::move(_expr.get<GLSLExpression::Identity>().param);
+			};
+			return GLSLExpression::Parameter(GLSLExpression::make_unique(std::move(_expr)));
+		};
+		GLSLExpression to_expression(GLSLExpression::Parameter&& _param)
+		{
+			if (_param.is_expression())
+			{
+				return GLSLExpression(std::move(_param.expr()));
+			};
+			return GLSLExpression(GLSLExpression::Identity(std::move(_param)));
+		};
+
+		struct Inliner
+		{
+			GLSLContext* context;
+
+			// Functions being inlined, their bodies have had their own calls inlined already
+			std::map<GLSLFunctionID, const GLSLFunction*> inlined{};
+
+			size_t calls = 0;
+
+			const GLSLFunction* inlined_callee(const GLSLExpression& _expr) const
+			{
+				if (_expr.type() != GLSLExpressionType::function_call)
+				{
+					return nullptr;
+				};
+				const auto it = this->inlined.find(_expr.get<GLSLExpression::FunctionCall>().function);
+				return (it != this->inlined.end()) ? it->second : nullptr;
+			};
+
+			bool has_inlined_call(const GLSLExpression& _expr) const
+			{
+				bool _found = false;
+				for_each_expression(_expr, [this, &_found](const GLSLExpression& _node)
+					{
+						_found = _found || this->inlined_callee(_node) != nullptr;
+					});
+				return _found;
+			};
+
+			/**
+			 * @brief Expands a call, appending the callee's statements to a body.
+			 * @return The value the call evaluates to.
+			*/
+			GLSLExpression::Parameter expand(GLSLExpression::FunctionCall& _call, const GLSLFunction& _callee,
+				std::vector<GLSLStatement>& _out)
+			{
+				auto& _context = *this->context;
+				const auto _body = _callee.body();
+
+				// Variables written by the callee, substituting an argument for them would be visible
+				auto _written = std::set<GLSLVariableID>();
+				for_each_statement(_body, [&_written](const GLSLStatement& _statement)
+					{
+						if (_statement.has_dest())
+						{
+							_written.insert(_statement.dest);
+						};
+					});
+
+				auto _with = std::map<GLSLVariableID, GLSLExpression::Parameter>();
+				const auto _params = _callee.params();
+				HUBRIS_ASSERT(_params.size() == _call.params.size());
+				for (size_t n = 0; n != _params.size(); ++n)
+				{
+					const auto _paramID = _params[n];
+					const auto _paramType = _context.type(_paramID);
+					auto& _arg = _call.params[n];
+					const auto _argType = _arg.type(_context);
+
+					const auto _direct = _argType == _paramType && !_written.contains(_paramID) &&
+						(_arg.is_literal() || (_arg.is_variable() && !_written.contains(_arg.id())));
+					if (_direct)
+					{
+						_with.insert_or_assign(_paramID, std::move(_arg));
+						continue;
+					};
+
+					// Evaluate the argument once into a local standing in for the parameter
+					const auto _local = _context.new_variable(_paramType)->id();
+					auto _declare = GLSLStatement(GLSLStatementType::declaration);
+					_declare.dest = _local;
+					_declare.expr = (_argType == _paramType) ?
+						GLSLExpression(GLSLExpression::Identity(std::move(_arg))) :
+						GLSLExpression(GLSLExpression::Cast(_paramType, std::move(_arg)));
+					_out.push_back(std::move(_declare));
+					_with.insert_or_assign(_paramID, GLSLExpression::Parameter(_local));
+				};
+
+				for (auto& _statement : _body.first(_body.size() - 1))
+				{
+					auto _copy = _statement.clone();
+
+					// Loops come before their bodies, their induction variable is mapped before its uses
+					for_each_statement(std::span(&_copy, 1), [&](GLSLStatement& v)
+						{
+							if (v.type == GLSLStatementType::declaration || v.type == GLSLStatementType::for_loop)
+							{
+								const auto _local = _context.new_variable(_context.type(v.dest))->id();
+								_with.insert_or_assign(v.dest, GLSLExpression::Parameter(_local));
+							};
+							if (const auto it = _with.find(v.dest); it != _with.end())
+							{
+								v.dest = it->second.id();
+							};
+							substitute_variables(v.expr, _with);
+						});
+					_out.push_back(std::move(_copy));
+				};
+
+				auto _result = _body.back().expr.clone();
+				substitute_variables(_result, _with);
+
+				++this->calls;
+				return to_parameter(std::move(_result));
+			};
+
+			/**
+			 * @brief Inlines the calls within a parameter, innermost first.
+			*/
+			void inline_param(GLSLExpression::Parameter& _param, std::vector<GLSLStatement>& _out)
+			{
+				if (!_param.is_expression())
+				{
+					return;
+				};
+
+				auto& _expr = _param.expr();
+				for_each_param(_expr, [this, &_out](GLSLExpression::Parameter& _child)
+					{
+						this->inline_param(_child, _out);
+					});
+
+				if (const auto _callee = this->inlined_callee(_expr))
+				{
+					auto _value = this->expand(_expr.get<GLSLExpression::FunctionCall>(), *_callee, _out);
+					_param = std::move(_value);
+				};
+			};
+
+			/**
+			 * @brief Inlines the calls within a statement list, loop bodies and branch arms included.
+			*/
+			std::vector<GLSLStatement> inline_statements(std::span<GLSLStatement> _statements)
+			{
+				auto _body = std::vector<GLSLStatement>();
+				_body.reserve(_statements.size());
+
+				for (auto& _statement : _statements)
+				{
+					if (_statement.type == GLSLStatementType::for_loop)
+					{
+						// The bound is evaluated every iteration, functions called there are never inlined
+						_statement.body = this->inline_statements(_statement.body);
+						_body.push_back(std::move(_statement));
+						continue;
+					};
+					if (_statement.type == GLSLStatementType::if_else)
+					{
+						// The condition is evaluated once, ahead of the arms, like any other statement
+						_statement.body = this->inline_statements(_statement.body);
+						_statement.else_body = this->inline_statements(_statement.else_body);
+					};
+					if (!this->has_inlined_call(_statement.expr))
+					{
+						_body.push_back(std::move(_statement));
+						continue;
+					};
+
+					// Clone the expression first, pooled nodes may be shared with other statements
+					auto _copy = GLSLStatement(_statement.type);
+					_copy.dest = _statement.dest;
+					_copy.expr = _statement.expr.clone();
+					_copy.body = std::move(_statement.body);
+					_copy.else_body = std::move(_statement.else_body);
+					for_each_param(_copy.expr, [this, &_body](GLSLExpression::Parameter& _param)
+						{
+							this->inline_param(_param, _body);
+						});
+					if (const auto _callee = this->inlined_callee(_copy.expr))
+					{
+						auto _value = this->expand(_copy.expr.get<GLSLExpression::FunctionCall>(), *_callee, _body);
+						_copy.expr = to_expression(std::move(_value));
+					};
+					_body.push_back(std::move(_copy));
+				};
+
+				return _body;
+			};
+
+			void inline_into(GLSLFunction& _function)
+			{
+				if (!this->inlined.empty())
+				{
+					_function.set_body(this->inline_statements(_function.body()));
+				};
+			};
+		};
+	};
+
+	GLSLInlineReport inline_functions(GLSLContext& _context, GLSLParams& _params, const GLSLInlineOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		const auto _graph = build_call_graph(_params);
+		auto _inliner = Inliner{ &_context };
+		auto _report = GLSLInlineReport();
+
+		// Callees always come before their callers
+		for (auto& _function : _params.functions)
+		{
+			_inliner.inline_into(_function);
+
+			const auto& _node = *_graph.find(_function.id());
+			auto& _decision = _report.decisions.emplace_back();
+			_decision.function = _function.id();
+			_decision.name = std::string(_function.name());
+			_decision.size = statement_size(_function.body());
+			_decision.call_sites = _node.call_sites;
+
+			if (_node.call_sites == 0)
+			{
+				_decision.reason = GLSLInlineReason::unused;
+			}
+			else if (!is_inlinable(_function))
+			{
+				_decision.reason = GLSLInlineReason::not_inlinable;
+			}
+			else if (_node.called_from_globals)
+			{
+				_decision.reason = GLSLInlineReason::called_from_globals;
+			}
+			else if (_node.called_from_loop_bound)
+			{
+				_decision.reason = GLSLInlineReason::called_from_loop_bound;
+			}
+			else if (_node.called_from_select)
+			{
+				_decision.reason = GLSLInlineReason::called_from_select;
+			}
+			else if (!is_order_safe(_context, _params, _function))
+			{
+				_decision.reason = GLSLInlineReason::order_dependent;
+			}
+			else if (_decision.size <= _options.max_size)
+			{
+				_decision.reason = GLSLInlineReason::small;
+				_decision.inlined = true;
+			}
+			else if (_options.inline_single_call && _node.call_sites == 1)
+			{
+				_decision.reason = GLSLInlineReason::single_call;
+				_decision.inlined = true;
+			}
+			else
+			{
+				_decision.reason = GLSLInlineReason::too_large;
+			};
+
+			if (_decision.inlined)
+			{
+				_inliner.inlined.insert_or_assign(_function.id(), &_function);
+			};
+		};
+		_inliner.inline_into(_params.main_fn);
+		_report.calls_inlined = _inliner.calls;
+
+		// Nothing calls the inlined functions anymore
+		for (auto& _function : _params.functions)
+		{
+			if (!_inliner.inlined.contains(_function.id()))
+			{
+				continue;
+			};
+
+			for (auto _param : _function.params())
+			{
+				_context.erase(_param);
+			};
+			for_each_statement(_function.body(), [&_context](const GLSLStatement& _statement)
+				{
+					if (_statement.type == GLSLStatementType::declaration || _statement.type == GLSLStatementType::for_loop)
+					{
+						_context.erase(_statement.dest);
+					};
+				});
+			_context.erase(_function.id());
+			++_report.functions_removed;
+		};
+		std::erase_if(_params.functions, [&_inliner](const GLSLFunction& _function)
+			{
+				return _inliner.inlined.contains(_function.id());
+			});
+
+		return _report;
+	};
+
+	void GLSLInlineReport::write(std::ostream& _ostr) const
+	{
+		_ostr << std::format("{:<24}{:>8}{:>8}  {}\n", "function", "size", "calls", "decision");
+		for (auto& _decision : this->decisions)
+		{
+			_ostr << std::format("{:<24}{:>8}{:>8}  {} ({})\n", _decision.name, _decision.size, _decision.call_sites,
+				(_decision.inlined) ? "inlined" : "kept", inline_reason_name(_decision.reason));
+		};
+		_ostr << std::format("{} calls inlined, {} functions removed\n", this->calls_inlined, this->functions_removed);
+	};
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Calls between the user defined functions of a shader.
+	*/
+	struct GLSLCallGraph
+	{
+	public:
+
+		struct Node
+		{
+			// Null for main
+			GLSLFunctionID function{};
+
+			// User functions called, in order of their first call, without duplicates
+			std::vector<GLSLFunctionID> callees{};
+
+			// Calls made to this function from main, other functions, globals, loop bounds and select operands
+			size_t call_sites = 0;
+			bool called_from_globals = false;
+			bool called_from_loop_bound = false;
+			bool called_from_select = false;
+		};
+
+		/**
+		 * @brief One node per user function in definition order, followed by main.
+		*/
+		std::vector<Node> nodes{};
+
+		/**
+		 * @brief Gets the node for a function.
+		 * @param _function Function ID, null for main.
+		 * @return Node, or null if not a user function.
+		*/
+		const Node* find(GLSLFunctionID _function) const;
+
+		const Node& main() const { return this->nodes.back(); };
+	};
+
+	/**
+	 * @brief Builds the call graph of a shader's user functions, builtins are not included.
+	 * @param _params Shader parameters.
+	 * @return Call graph.
+	*/
+	GLSLCallGraph build_call_graph(const GLSLParams& _params);
+
+
+
+	/**
+	 * @brief Why a function was or was not inlined.
+	*/
+	enum class GLSLInlineReason : uint8_t
+	{
+		// Inlined, within the size budget
+		small = 0,
+		// Inlined, called from a single place so nothing is duplicated
+		single_call,
+		// Kept, larger than the size budget and called more than once
+		too_large,
+		// Kept, not a single trailing return (ie. void functions)
+		not_inlinable,
+		// Kept, global initializers cannot hold the inlined statements
+		called_from_globals,
+		// Kept, loop bounds are evaluated every iteration and cannot hold them either
+		called_from_loop_bound,
+		// Kept, only the chosen operand of a select is evaluated, statements ahead of it always run
+		called_from_select,
+		// Kept, another part of a calling statement touches what it reads or writes
+		order_dependent,
+		// Kept, never called
+		unused,
+	};
+
+	constexpr std::string_view inline_reason_name(GLSLInlineReason _reason)
+	{
+		constexpr std::string_view _names[] =
+		{
+			"small", "single call", "too large", "not inlinable", "called from globals", "called from loop bound",
+			"called from select", "order dependent", "unused"
+		};
+		return _names[static_cast<size_t>(_reason)];
+	};
+
+	/**
+	 * @brief Heuristic used to decide which functions are inlined.
+	*/
+	struct GLSLInlineOptions
+	{
+		/**
+		 * @brief Largest function inlined at every call, counted in statements plus expression nodes.
+		*/
+		size_t max_size = 12;
+
+		/**
+		 * @brief Also inline functions of any size that are called from a single place.
+		*/
+		bool inline_single_call = true;
+	};
+
+	struct GLSLInlineDecision
+	{
+		GLSLFunctionID function{};
+		std::string name{};
+
+		// Size after inlining into the function, see GLSLInlineOptions::max_size
+		size_t size = 0;
+		size_t call_sites = 0;
+
+		bool inlined = false;
+		GLSLInlineReason reason = GLSLInlineReason::unused;
+	};
+
+	/**
+	 * @brief Decisions made by inline_functions().
+	*/
+	struct GLSLInlineReport
+	{
+		/**
+		 * @brief One decision per user function, in definition order.
+		*/
+		std::vector<GLSLInlineDecision> decisions{};
+
+		size_t calls_inlined = 0;
+		size_t functions_removed = 0;
+
+		/**
+		 * @brief Writes one line per function with its size, call sites and decision.
+		*/
+		void write(std::ostream& _ostr) const;
+	};
+
+	/**
+	 * @brief Inlines small and single call user functions into their callers.
+	 *
+	 * Functions are visited callees first, so a function's size is measured after its own
+	 * calls were inlined. Arguments that are variables or literals of the parameter's type
+	 * are substituted directly, anything else is evaluated once into a new local ahead of
+	 * the calling statement, followed by the callee's statements with fresh locals. The call
+	 * is replaced by the returned expression. Inlined functions are removed from the shader.
+	 *
+	 * Functions called within the operands of a select are never inlined, their statements
+	 * would run whichever operand is chosen. Neither are functions whose statements would
+	 * move ahead of something else in a calling statement that touches what they read or
+	 * write, ie. "f() + h()" where h() writes a global f() returns.
+	 *
+	 * Auto types must already be deduced.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @param _options Inlining heuristic.
+	 * @return Decisions made for every user function.
+	*/
+	GLSLInlineReport inline_functions(GLSLContext& _context, GLSLParams& _params, const GLSLInlineOptions& _options = {});
+};
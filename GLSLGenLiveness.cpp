@@ -0,0 +1,483 @@
+#include "GLSLGenLiveness.hpp"
+
+#include <map>
+#include <set>
+#include <span>
+#include <format>
+#include <utility>
+#include <charconv>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		using VariableSet = std::set<GLSLVariableID>;
+
+		/**
+		 * @brief Variables a statement touches, nested bodies included.
+		*/
+		struct Access
+		{
+			VariableSet reads{};
+			VariableSet writes{};
+
+			// Calls a user function, which may touch anything
+			bool calls = false;
+
+			bool touches(GLSLVariableID _id) const
+			{
+				return this->reads.contains(_id) || this->writes.contains(_id);
+			};
+		};
+
+		void add_reads(const GLSLContext& _context, const GLSLExpression& _expr, Access& _access)
+		{
+			for_each_expression(_expr, [&](const GLSLExpression& _node)
+				{
+					if (_node.type() == GLSLExpressionType::function_call)
+					{
+						const auto _function = _context.find(_node.get<GLSLExpression::FunctionCall>().function);
+						_access.calls = _access.calls || !_function || !_function->builtin();
+					};
+					for_each_param(_node, [&_access](const GLSLExpression::Parameter& _param)
+						{
+							if (_param.is_variable())
+							{
+								_access.reads.insert(_param.id());
+							};
+						});
+				});
+		};
+
+		Access find_access(const GLSLContext& _context, const GLSLStatement& _statement)
+		{
+			auto _access = Access{};
+			const auto _visit = [&](const GLSLStatement& v)
+			{
+				add_reads(_context, v.expr, _access);
+				if (v.has_dest())
+				{
+					_access.writes.insert(v.dest);
+				};
+			};
+			_visit(_statement);
+			for_each_statement(_statement.body, _visit);
+			for_each_statement(_statement.else_body, _visit);
+			return _access;
+		};
+
+		/**
+		 * @brief Checks if a variable has the name given to unnamed variables, "_var" followed by its ID.
+		*/
+		bool is_unnamed(const GLSLVariable& _var)
+		{
+			const auto _name = std::string_view(_var.name());
+			if (!_name.starts_with("_var"))
+			{
+				return false;
+			};
+			auto _id = decltype(_var.id().get()){};
+			const auto _digits = _name.substr(4);
+			const auto r = std::from_chars(_digits.data(), _digits.data() + _digits.size(), _id);
+			return r.ec == std::errc() && r.ptr == _digits.data() + _digits.size() && _id == _var.id().get();
+		};
+
+		struct LiveRanges
+		{
+			const GLSLContext* context;
+
+			// Locals of the function being visited, the only variables liveness tracks
+			VariableSet locals{};
+
+			// Temporaries of the function being visited, see reuse_temporaries()
+			VariableSet temporaries{};
+
+			GLSLLiveRangeFunction* report = nullptr;
+
+			void find_locals(const GLSLFunction& _function)
+			{
+				this->locals.clear();
+				this->temporaries.clear();
+				this->locals.insert(_function.params().begin(), _function.params().end());
+
+				auto _declarations = std::map<GLSLVariableID, size_t>();
+				for_each_statement(_function.body(), [&](const GLSLStatement& _statement)
+					{
+						if (_statement.type == GLSLStatementType::declaration)
+						{
+							++_declarations[_statement.dest];
+						}
+						else if (_statement.type == GLSLStatementType::for_loop)
+						{
+							_declarations[_statement.dest] += 2;
+						};
+					});
+				for (auto& [_id, _count] : _declarations)
+				{
+					this->locals.insert(_id);
+					const auto _var = this->context->find(_id);
+					const auto _param = std::ranges::find(_function.params(), _id) != _function.params().end();
+					if (_count == 1 && _var && !_param && is_unnamed(*_var))
+					{
+						this->temporaries.insert(_id);
+					};
+				};
+			};
+
+			void add_local_reads(const GLSLExpression& _expr, VariableSet& _live) const
+			{
+				auto _access = Access{};
+				add_reads(*this->context, _expr, _access);
+				for (auto _id : _access.reads)
+				{
+					if (this->locals.contains(_id))
+					{
+						_live.insert(_id);
+					};
+				};
+			};
+
+			/**
+			 * @brief Gets the locals live ahead of a loop's test, read by the loop or after it.
+			*/
+			VariableSet loop_live(const GLSLStatement& _loop, const VariableSet& _after) const
+			{
+				auto _live = _after;
+				_live.insert(_loop.dest);
+				this->add_local_reads(_loop.expr, _live);
+
+				// Conservatively live through every iteration, except what the body declares
+				auto _declared = VariableSet();
+				for_each_statement(_loop.body, [&](const GLSLStatement& _statement)
+					{
+						this->add_local_reads(_statement.expr, _live);
+						if (_statement.type == GLSLStatementType::declaration || _statement.type == GLSLStatementType::for_loop)
+						{
+							_declared.insert(_statement.dest);
+						};
+					});
+				for (auto _id : _declared)
+				{
+					_live.erase(_id);
+				};
+				return _live;
+			};
+
+			/**
+			 * @brief Gets the locals live ahead of a statement.
+			 * @param _after Locals live after it.
+			 * @param _peak Raised to the most locals live at once within the statement.
+			*/
+			VariableSet live_before(const GLSLStatement& _statement, const VariableSet& _after, size_t& _peak) const
+			{
+				auto _live = VariableSet();
+				switch (_statement.type)
+				{
+				case GLSLStatementType::declaration:
+				case GLSLStatementType::assignment:
+				{
+					_live = _after;
+					_live.erase(_statement.dest);
+					this->add_local_reads(_statement.expr, _live);
+
+					// The result is held alongside the operands it is computed from
+					auto _held = _live;
+					_held.insert(_after.begin(), _after.end());
+					_peak = std::max(_peak, _held.size());
+				};
+				break;
+
+				case GLSLStatementType::return_value:
+					this->add_local_reads(_statement.expr, _live);
+					_peak = std::max(_peak, _live.size());
+					break;
+
+				case GLSLStatementType::for_loop:
+				{
+					const auto _loop = this->loop_live(_statement, _after);
+					this->live_in(_statement.body, _loop, _peak);
+					_live = _loop;
+					_live.erase(_statement.dest);
+					_peak = std::max(_peak, _loop.size());
+				};
+				break;
+
+				case GLSLStatementType::if_else:
+				{
+					_live = this->live_in(_statement.body, _after, _peak);
+					const auto _else = this->live_in(_statement.else_body, _after, _peak);
+					_live.insert(_else.begin(), _else.end());
+					this->add_local_reads(_statement.expr, _live);
+					_peak = std::max({ _peak, _live.size(), _after.size() });
+				};
+				break;
+
+				default:
+					break;
+				};
+				return _live;
+			};
+
+			/**
+			 * @brief Gets the locals live ahead of a statement list.
+			 * @param _points If given, receives the locals live ahead of each statement, then those live after the list.
+			*/
+			VariableSet live_in(std::span<const GLSLStatement> _statements, const VariableSet& _out, size_t& _peak,
+				std::vector<VariableSet>* _points = nullptr) const
+			{
+				auto _live = _out;
+				if (_points)
+				{
+					_points->assign(_statements.size() + 1, VariableSet());
+					_points->back() = _out;
+				};
+				for (size_t n = _statements.size(); n != 0; --n)
+				{
+					_live = this->live_before(_statements[n - 1], _live, _peak);
+					if (_points)
+					{
+						(*_points)[n - 1] = _live;
+					};
+				};
+				return _live;
+			};
+
+			/**
+			 * @brief Moves temporaries' declarations down to their first use when no other range grows.
+			*/
+			void sink_declarations(std::span<GLSLStatement> _statements, const VariableSet& _out)
+			{
+				auto& _context = *this->context;
+				auto _points = std::vector<VariableSet>();
+				size_t _peak = 0;
+				this->live_in(_statements, _out, _peak, &_points);
+
+				for (size_t i = _statements.size(); i != 0; --i)
+				{
+					const auto& _declaration = _statements[i - 1];
+					if (_declaration.type != GLSLStatementType::declaration || !this->temporaries.contains(_declaration.dest))
+					{
+						continue;
+					};
+					const auto _access = find_access(_context, _declaration);
+					if (_access.calls)
+					{
+						continue;
+					};
+
+					// Stops at the first use, or anything it depends on
+					auto j = i;
+					for (; j != _statements.size(); ++j)
+					{
+						const auto& _next = _statements[j];
+						const auto _nextAccess = find_access(_context, _next);
+						if (_next.type == GLSLStatementType::return_value || _nextAccess.calls ||
+							_nextAccess.touches(_declaration.dest) ||
+							std::ranges::any_of(_access.reads, [&](GLSLVariableID v) { return _nextAccess.writes.contains(v); }))
+						{
+							break;
+						};
+					};
+
+					// Unused, or already in place
+					if (j == i || j == _statements.size())
+					{
+						continue;
+					};
+					const auto _extends = std::ranges::any_of(_access.reads, [&](GLSLVariableID v)
+						{
+							return this->locals.contains(v) && !_points[j].contains(v);
+						});
+					if (_extends)
+					{
+						continue;
+					};
+
+					std::rotate(_statements.begin() + (i - 1), _statements.begin() + i, _statements.begin() + j);
+					++this->report->statements_moved;
+					this->live_in(_statements, _out, _peak, &_points);
+				};
+			};
+
+			/**
+			 * @brief Shares locals between the temporaries declared in a list whose ranges do not overlap.
+			*/
+			void share_temporaries(std::span<GLSLStatement> _statements, const VariableSet& _out)
+			{
+				auto& _context = *this->context;
+				auto _points = std::vector<VariableSet>();
+				size_t _peak = 0;
+				this->live_in(_statements, _out, _peak, &_points);
+
+				// Last statement touching each temporary declared here, or ahead of which it is live.
+				// Const temporaries are left out, a shared declaration becomes an assignment.
+				auto _ends = std::map<GLSLVariableID, size_t>();
+				for (size_t n = 0; n != _statements.size(); ++n)
+				{
+					const auto& _statement = _statements[n];
+					if (_statement.type == GLSLStatementType::declaration && this->temporaries.contains(_statement.dest) &&
+						!_context.find(_statement.dest)->is_const())
+					{
+						_ends.insert_or_assign(_statement.dest, n);
+					};
+					const auto _access = find_access(_context, _statement);
+					for (auto& [_id, _end] : _ends)
+					{
+						if (_points[n].contains(_id) || _access.touches(_id))
+						{
+							_end = n;
+						};
+					};
+				};
+
+				// Linear scan, a temporary is free once past the last statement touching it
+				using Key = std::pair<GLSLType, GLSLPrecision>;
+				auto _free = std::map<Key, std::vector<GLSLVariableID>>();
+				auto _active = std::vector<std::pair<size_t, GLSLVariableID>>();
+				auto _with = std::map<GLSLVariableID, GLSLExpression::Parameter>();
+				auto _first = _statements.size();
+
+				const auto _key = [&_context](GLSLVariableID _id)
+				{
+					return Key(_context.type(_id), _context.find(_id)->precision());
+				};
+				for (size_t n = 0; n != _statements.size(); ++n)
+				{
+					// A temporary last read by this statement may receive its result
+					std::erase_if(_active, [&](const std::pair<size_t, GLSLVariableID>& v)
+						{
+							if (v.first > n)
+							{
+								return false;
+							};
+							_free[_key(v.second)].push_back(v.second);
+							return true;
+						});
+
+					auto& _statement = _statements[n];
+					if (_statement.type != GLSLStatementType::declaration || !_ends.contains(_statement.dest))
+					{
+						continue;
+					};
+					const auto _id = _statement.dest;
+					auto& _pool = _free[_key(_id)];
+					if (_pool.empty())
+					{
+						_active.push_back({ _ends.at(_id), _id });
+						continue;
+					};
+
+					const auto _shared = _pool.back();
+					_pool.pop_back();
+					_with.insert_or_assign(_id, GLSLExpression::Parameter(_shared));
+					_active.push_back({ _ends.at(_id), _shared });
+					_statement.type = GLSLStatementType::assignment;
+					_first = std::min(_first, n);
+					++this->report->temporaries_reused;
+				};
+				if (_with.empty())
+				{
+					return;
+				};
+
+				const auto _rename = [&](GLSLStatement& _statement)
+				{
+					if (_statement.has_dest())
+					{
+						if (const auto it = _with.find(_statement.dest); it != _with.end())
+						{
+							_statement.dest = it->second.id();
+						};
+					};
+					auto _access = Access{};
+					add_reads(_context, _statement.expr, _access);
+					if (std::ranges::any_of(_access.reads, [&_with](GLSLVariableID v) { return _with.contains(v); }))
+					{
+						// Clone first, pooled nodes may be shared with other statements
+						_statement.expr = _statement.expr.clone();
+						substitute_variables(_statement.expr, _with);
+					};
+				};
+				for_each_statement(_statements.subspan(_first), _rename);
+			};
+
+			/**
+			 * @brief Shortens ranges and shares temporaries in a list, then within its loops and branches.
+			*/
+			void visit(std::span<GLSLStatement> _statements, const VariableSet& _out)
+			{
+				this->sink_declarations(_statements, _out);
+				this->share_temporaries(_statements, _out);
+
+				auto _points = std::vector<VariableSet>();
+				size_t _peak = 0;
+				this->live_in(_statements, _out, _peak, &_points);
+				for (size_t n = 0; n != _statements.size(); ++n)
+				{
+					auto& _statement = _statements[n];
+					if (_statement.type == GLSLStatementType::for_loop)
+					{
+						this->visit(_statement.body, this->loop_live(_statement, _points[n + 1]));
+					}
+					else if (_statement.type == GLSLStatementType::if_else)
+					{
+						this->visit(_statement.body, _points[n + 1]);
+						this->visit(_statement.else_body, _points[n + 1]);
+					};
+				};
+			};
+
+			size_t peak(const GLSLFunction& _function)
+			{
+				this->find_locals(_function);
+				size_t _peak = 0;
+				const auto _in = this->live_in(_function.body(), {}, _peak);
+
+				// Parameters are live on entry even if never read
+				_peak = std::max(_peak, _function.params().size());
+				return std::max(_peak, _in.size());
+			};
+		};
+	};
+
+	void GLSLLiveRangeReport::write(std::ostream& _ostr) const
+	{
+		_ostr << std::format("{:<24}{:>8}{:>8}{:>8}{:>8}\n", "function", "before", "after", "reused", "moved");
+		for (auto& _function : this->functions)
+		{
+			_ostr << std::format("{:<24}{:>8}{:>8}{:>8}{:>8}\n", _function.name, _function.peak_before,
+				_function.peak_after, _function.temporaries_reused, _function.statements_moved);
+		};
+	};
+
+	size_t peak_live_locals(const GLSLContext& _context, const GLSLFunction& _function)
+	{
+		auto _ranges = LiveRanges{ &_context };
+		return _ranges.peak(_function);
+	};
+
+	GLSLLiveRangeReport reuse_temporaries(GLSLContext& _context, GLSLParams& _params)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		auto _report = GLSLLiveRangeReport{};
+		auto _ranges = LiveRanges{ &_context };
+		const auto _visit = [&](GLSLFunction& _function)
+		{
+			auto& _entry = _report.functions.emplace_back();
+			_entry.name = _function.name();
+			_entry.peak_before = _ranges.peak(_function);
+
+			_ranges.report = &_entry;
+			_ranges.visit(_function.body(), {});
+			_entry.peak_after = _ranges.peak(_function);
+		};
+		for (auto& _function : _params.functions)
+		{
+			_visit(_function);
+		};
+		_visit(_params.main_fn);
+		return _report;
+	};
+};
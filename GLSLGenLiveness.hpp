@@ -0,0 +1,84 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+namespace glsl
+{
+	/**
+	 * @brief What reuse_temporaries() did to one function.
+	*/
+	struct GLSLLiveRangeFunction
+	{
+		std::string name{};
+
+		// Most locals live at once, before and after the pass
+		size_t peak_before = 0;
+		size_t peak_after = 0;
+
+		// Temporaries folded into an earlier one, their declarations became assignments
+		size_t temporaries_reused = 0;
+
+		// Declarations moved closer to their first use
+		size_t statements_moved = 0;
+	};
+
+	/**
+	 * @brief Summary of reuse_temporaries(), peak register pressure before and after.
+	*/
+	struct GLSLLiveRangeReport
+	{
+		/**
+		 * @brief One entry per function, user functions in order then main.
+		*/
+		std::vector<GLSLLiveRangeFunction> functions{};
+
+		/**
+		 * @brief Writes one line per function with its peaks and what changed.
+		*/
+		void write(std::ostream& _ostr) const;
+	};
+
+	/**
+	 * @brief Finds the peak number of locals live at once in a function.
+	 *
+	 * A local is live from where it is written to where it is last read. Parameters, loop
+	 * variables and declared locals count, inputs, outputs, uniforms and globals do not.
+	 * Locals read within a loop are live throughout it.
+	 *
+	 * @param _context Shader context.
+	 * @param _function Function to measure.
+	*/
+	size_t peak_live_locals(const GLSLContext& _context, const GLSLFunction& _function);
+
+	/**
+	 * @brief Shortens the live ranges of temporaries and shares locals between them.
+	 *
+	 * Temporaries are the unnamed locals (named "_varN") declared once, ie. those
+	 * GLSLFunctionBuilder and the other passes make for intermediate values.
+	 *
+	 * Each statement list is handled on its own, loop and branch bodies included:
+	 *	- A temporary's declaration is moved down to just before its first use, as long as
+	 *	  it only moves past statements independent from it and every local it reads is
+	 *	  still live there, so no other range grows. Statements calling user functions are
+	 *	  never crossed.
+	 *	- A temporary declared once an earlier one of the same type and precision is dead,
+	 *	  or dies reading into it, takes that temporary's place. Its declaration becomes an
+	 *	  assignment, so only temporaries declared in the same list are shared.
+	 *
+	 * Temporaries left unused stay in the context. Globals are not visited.
+	 *
+	 * Auto types must already be deduced.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @return Peak live locals of each function, before and after.
+	*/
+	GLSLLiveRangeReport reuse_temporaries(GLSLContext& _context, GLSLParams& _params);
+};
@@ -0,0 +1,429 @@
+#include "GLSLGenModule.hpp"
+#include "GLSLGenSerialize.hpp"
+
+#include <set>
+#include <iterator>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief Finds the global statement declaring a variable.
+		 * @return Pointer to the statement, or null if the variable is not a global.
+		*/
+		const GLSLStatement* find_global(const GLSLParams& _params, GLSLVariableID _id)
+		{
+			for (auto& v : _params.globals)
+			{
+				if (v.type == GLSLStatementType::declaration && v.dest == _id)
+				{
+					return &v;
+				};
+			};
+			return nullptr;
+		};
+
+		/**
+		 * @brief Calls a function for every variable and function referenced by an expression tree.
+		*/
+		template <typename VarFnT, typename FunctionFnT>
+		void for_each_reference(const GLSLExpression& _expr, VarFnT&& _varFn, FunctionFnT&& _functionFn)
+		{
+			for_each_expression(_expr, [&](const GLSLExpression& _node)
+				{
+					if (_node.type() == GLSLExpressionType::function_call)
+					{
+						_functionFn(_node.get<GLSLExpressionType::function_call>().function);
+					};
+					for_each_param(_node, [&](const GLSLExpression::Parameter& _param)
+						{
+							if (_param.is_variable())
+							{
+								_varFn(_param.id());
+							};
+						});
+				});
+		};
+
+		/**
+		 * @brief Rewrites every variable and function ID within an expression tree.
+		*/
+		template <typename VarFnT, typename FunctionFnT>
+		void remap_references(GLSLExpression& _expr, VarFnT&& _varFn, FunctionFnT&& _functionFn)
+		{
+			for_each_expression(_expr, [&](GLSLExpression& _node)
+				{
+					if (_node.type() == GLSLExpressionType::function_call)
+					{
+						auto& _call = _node.get<GLSLExpressionType::function_call>();
+						_call.function = _functionFn(_call.function);
+					};
+					for_each_param(_node, [&](GLSLExpression::Parameter& _param)
+						{
+							if (_param.is_variable())
+							{
+								_param = GLSLExpression::Parameter(_varFn(_param.id()));
+							};
+						});
+				});
+		};
+
+		/**
+		 * @brief Checks if a variable is part of a module's public interface.
+		*/
+		bool is_exported_variable(const GLSLModule& _module, const GLSLVariable& _var)
+		{
+			return _var.uniform() || find_global(_module.params, _var.id()) != nullptr;
+		};
+	};
+
+
+
+	bool GLSLModule::resolve()
+	{
+		if (!deduce_auto(this->context, this->params) || !this->params.check())
+		{
+			return false;
+		};
+
+		// Modules cannot declare their own stage inputs or outputs.
+		if (!this->context.inputs().empty() || !this->context.outputs().empty())
+		{
+			return false;
+		};
+
+		for (auto& v : this->context.functions())
+		{
+			if (!this->params.find_function(v.id()))
+			{
+				return false;
+			};
+		};
+
+		return true;
+	};
+
+	std::vector<std::byte> GLSLModule::serialize() const
+	{
+		return serialize_ir(this->context, this->params);
+	};
+
+	bool GLSLModule::load(std::span<const std::byte> _data)
+	{
+		const auto _ir = GLSLBinaryIR(_data);
+		return deserialize_ir(_ir, this->context, this->params);
+	};
+
+	bool load_module(GLSLFileCache& _cache, const std::filesystem::path& _path, GLSLModule& _module)
+	{
+		const auto _file = _cache.get(_path);
+		if (!_file || !_module.load(_file->bytes()))
+		{
+			return false;
+		};
+
+		if (_module.name.empty())
+		{
+			_module.name = _path.stem().string();
+		};
+		return true;
+	};
+
+
+
+	GLSLVariableID GLSLModuleImport::id(std::string_view _name) const
+	{
+		const auto _id = this->module->context.id(std::string(_name));
+		const auto it = this->variables.find(_id);
+		return (it != this->variables.end()) ? it->second : GLSLVariableID();
+	};
+
+	GLSLFunctionID GLSLModuleImport::function_id(std::string_view _name) const
+	{
+		const auto _id = this->module->context.function_id(std::string(_name));
+		const auto it = this->functions.find(_id);
+		return (it != this->functions.end()) ? it->second : GLSLFunctionID();
+	};
+
+
+
+	std::optional<GLSLModuleImport> import_module(const GLSLModule& _module, GLSLContext& _context)
+	{
+		const auto& _from = _module.context;
+
+		// Check everything up front so a failed import leaves the context untouched.
+		for (auto& v : _from.variables())
+		{
+			if (v.builtin())
+			{
+				if (!_context.contains(v.name()))
+				{
+					return std::nullopt;
+				};
+			}
+			else if (is_exported_variable(_module, v) && _context.contains(v.name()))
+			{
+				return std::nullopt;
+			};
+		};
+		for (auto& v : _from.functions(true))
+		{
+			if (!_context.contains_function(v.name()))
+			{
+				return std::nullopt;
+			};
+		};
+		for (auto& v : _from.functions(false))
+		{
+			if (_context.contains_function(v.name()))
+			{
+				return std::nullopt;
+			};
+		};
+
+		auto _import = GLSLModuleImport{};
+		_import.module = &_module;
+
+		for (auto& v : _from.variables())
+		{
+			if (v.builtin())
+			{
+				_import.variables.insert({ v.id(), _context.id(std::string(v.name())) });
+			}
+			else if (is_exported_variable(_module, v))
+			{
+				auto _var = _context.new_variable(std::string(v.name()), v.type());
+				_var->set_uniform(v.uniform()).set_const(v.is_const()).set_precision(v.precision());
+				_import.variables.insert({ v.id(), _var->id() });
+			};
+		};
+
+		for (auto& v : _from.functions(true))
+		{
+			_import.functions.insert({ v.id(), _context.function_id(std::string(v.name())) });
+		};
+		for (auto& v : _from.functions(false))
+		{
+			auto _decl = _context.new_function(std::string(v.name()));
+			for (auto& _overload : v.overloads())
+			{
+				_decl->add_overload(_overload.return_type, std::span<const GLSLFunctionParameter>(_overload.params))
+					.set_cost(_overload.cost);
+			};
+			_import.functions.insert({ v.id(), _decl->id() });
+		};
+
+		return _import;
+	};
+
+	GLSLModuleLinkStats link_module(const GLSLModuleImport& _import, GLSLContext& _context, GLSLParams& _params)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::link);
+		const auto& _module = *_import.module;
+		const auto& _from = _module.context;
+
+		// Shader side ID back to the module side ID.
+		auto _importedVariables = std::map<GLSLVariableID, GLSLVariableID>{};
+		for (auto& [_moduleID, _shaderID] : _import.variables)
+		{
+			_importedVariables.insert({ _shaderID, _moduleID });
+		};
+		auto _importedFunctions = std::map<GLSLFunctionID, GLSLFunctionID>{};
+		for (auto& [_moduleID, _shaderID] : _import.functions)
+		{
+			_importedFunctions.insert({ _shaderID, _moduleID });
+		};
+
+		// Walk everything reachable from the shader, then through the module itself.
+		auto _reachedVariables = std::set<GLSLVariableID>{};
+		auto _reachedFunctions = std::set<GLSLFunctionID>{};
+		auto _worklist = std::vector<const GLSLExpression*>{};
+
+		const auto _reachVariable = [&](GLSLVariableID _id)
+		{
+			const auto _var = _from.find(_id);
+			if (!_var || _var->builtin() || !_reachedVariables.insert(_id).second)
+			{
+				return;
+			};
+			if (const auto _global = find_global(_module.params, _id); _global)
+			{
+				_worklist.push_back(&_global->expr);
+			};
+		};
+		const auto _reachFunction = [&](GLSLFunctionID _id)
+		{
+			const auto _fn = _module.params.find_function(_id);
+			if (!_fn || !_reachedFunctions.insert(_id).second)
+			{
+				return;
+			};
+			for_each_statement(_fn->body(), [&_worklist](const GLSLStatement& v)
+				{
+					_worklist.push_back(&v.expr);
+				});
+		};
+
+		const auto _shaderRoot = [&](const GLSLExpression& _expr)
+		{
+			for_each_reference(_expr,
+				[&](GLSLVariableID _id)
+				{
+					if (const auto it = _importedVariables.find(_id); it != _importedVariables.end())
+					{
+						_reachVariable(it->second);
+					};
+				},
+				[&](GLSLFunctionID _id)
+				{
+					if (const auto it = _importedFunctions.find(_id); it != _importedFunctions.end())
+					{
+						_reachFunction(it->second);
+					};
+				});
+		};
+
+		for (auto& v : _params.globals)
+		{
+			_shaderRoot(v.expr);
+		};
+		const auto _shaderBody = [&_shaderRoot](std::span<const GLSLStatement> _body)
+		{
+			for_each_statement(_body, [&_shaderRoot](const GLSLStatement& v)
+				{
+					_shaderRoot(v.expr);
+				});
+		};
+		for (auto& _fn : _params.functions)
+		{
+			_shaderBody(_fn.body());
+		};
+		_shaderBody(_params.main_fn.body());
+
+		while (!_worklist.empty())
+		{
+			const auto _expr = _worklist.back();
+			_worklist.pop_back();
+			for_each_reference(*_expr, _reachVariable, _reachFunction);
+		};
+
+		// Module locals and parameters get fresh variables in the shader.
+		auto _locals = std::map<GLSLVariableID, GLSLVariableID>{};
+		const auto _mapVariable = [&](GLSLVariableID _id) -> GLSLVariableID
+		{
+			if (const auto it = _import.variables.find(_id); it != _import.variables.end())
+			{
+				return it->second;
+			};
+			if (const auto it = _locals.find(_id); it != _locals.end())
+			{
+				return it->second;
+			};
+
+			const auto& _var = *_from.find(_id);
+
+			// Auto named variables are renamed to keep the shader's own "_varN" names unique.
+			const auto _autoNamed = _var.name().starts_with("_var");
+			auto _newVar = (_autoNamed || _context.contains(_var.name())) ?
+				_context.new_variable(_var.type()) :
+				_context.new_variable(std::string(_var.name()), _var.type());
+			_newVar->set_const(_var.is_const()).set_precision(_var.precision());
+
+			_locals.insert({ _id, _newVar->id() });
+			return _newVar->id();
+		};
+		const auto _mapFunction = [&](GLSLFunctionID _id) -> GLSLFunctionID
+		{
+			return _import.functions.at(_id);
+		};
+
+		const auto _copyStatement = [&](const GLSLStatement& _statement)
+		{
+			auto _out = _statement.clone();
+			for_each_statement(std::span(&_out, 1), [&](GLSLStatement& v)
+				{
+					if (v.has_dest())
+					{
+						v.dest = _mapVariable(v.dest);
+					};
+					remap_references(v.expr, _mapVariable, _mapFunction);
+				});
+			return _out;
+		};
+
+		// Copy in module order, which already has callees before callers.
+		auto _globals = std::vector<GLSLStatement>{};
+		for (auto& v : _module.params.globals)
+		{
+			if (_reachedVariables.contains(v.dest))
+			{
+				_globals.push_back(_copyStatement(v));
+			};
+		};
+
+		auto _functions = std::vector<GLSLFunction>{};
+		for (auto& _fn : _module.params.functions)
+		{
+			if (!_reachedFunctions.contains(_fn.id()))
+			{
+				continue;
+			};
+
+			auto& _out = _functions.emplace_back(std::string(_fn.name()));
+			_out.set_id(_mapFunction(_fn.id())).set_return_type(_fn.return_type());
+			for (auto& v : _fn.params())
+			{
+				_out.add_param(_mapVariable(v));
+			};
+			for (auto& v : _fn.body())
+			{
+				_out.append(_copyStatement(v));
+			};
+		};
+
+		_params.globals.insert(_params.globals.begin(),
+			std::make_move_iterator(_globals.begin()), std::make_move_iterator(_globals.end()));
+		_params.functions.insert(_params.functions.begin(),
+			std::make_move_iterator(_functions.begin()), std::make_move_iterator(_functions.end()));
+
+		// Drop whatever the import declared but the shader never reached.
+		auto _stats = GLSLModuleLinkStats{};
+		for (auto& [_moduleID, _shaderID] : _import.variables)
+		{
+			if (_from.find(_moduleID)->builtin())
+			{
+				continue;
+			};
+
+			if (_reachedVariables.contains(_moduleID))
+			{
+				++_stats.variables_linked;
+			}
+			else
+			{
+				_context.erase(_shaderID);
+				++_stats.variables_removed;
+			};
+		};
+		for (auto& [_moduleID, _shaderID] : _import.functions)
+		{
+			if (_from.find(_moduleID)->builtin())
+			{
+				continue;
+			};
+
+			if (_reachedFunctions.contains(_moduleID))
+			{
+				++_stats.functions_linked;
+			}
+			else
+			{
+				_context.erase(_shaderID);
+				++_stats.functions_removed;
+			};
+		};
+
+		return _stats;
+	};
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenFile.hpp"
+
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Reusable set of function definitions, constants and uniforms.
+	 *
+	 * A module is built like a shader, using params.functions for its functions and
+	 * params.globals for its constants, and its main function is ignored. It is resolved
+	 * once and then imported into any number of shaders.
+	*/
+	struct GLSLModule
+	{
+	public:
+
+		std::string name{};
+
+		GLSLContext context{};
+		GLSLParams params;
+
+		/**
+		 * @brief Deduces auto types and checks that every declared function has a definition.
+		 * @return True if the module can be linked, false otherwise.
+		*/
+		bool resolve();
+
+		/**
+		 * @brief Serializes the module into the binary IR format.
+		 * @return Binary IR buffer.
+		*/
+		std::vector<std::byte> serialize() const;
+
+		/**
+		 * @brief Loads a serialized module, the module must be empty.
+		 * @param _data Binary IR buffer.
+		 * @return True on success, false if the buffer failed validation.
+		*/
+		bool load(std::span<const std::byte> _data);
+
+		GLSLModule() :
+			params(this->context)
+		{};
+
+		GLSLModule(const GLSLModule& other) = delete;
+		GLSLModule& operator=(const GLSLModule& other) = delete;
+	};
+
+	/**
+	 * @brief Loads a serialized module through a file cache.
+	 * @param _cache Memory mapped file cache.
+	 * @param _path Path to the serialized module.
+	 * @param _module Module to load into, must be empty.
+	 * @return True on success, false otherwise.
+	*/
+	bool load_module(GLSLFileCache& _cache, const std::filesystem::path& _path, GLSLModule& _module);
+
+
+
+	/**
+	 * @brief Declarations a module added to a shader's context, used to reference and later link it.
+	*/
+	struct GLSLModuleImport
+	{
+	public:
+
+		const GLSLModule* module = nullptr;
+
+		/**
+		 * @brief Module symbol ID to shader symbol ID.
+		*/
+		std::map<GLSLVariableID, GLSLVariableID> variables{};
+		std::map<GLSLFunctionID, GLSLFunctionID> functions{};
+
+		/**
+		 * @brief Gets the shader side ID of a module variable.
+		 * @param _name Variable name within the module.
+		 * @return Variable ID, null if not imported.
+		*/
+		GLSLVariableID id(std::string_view _name) const;
+
+		/**
+		 * @brief Gets the shader side ID of a module function.
+		 * @param _name Function name within the module.
+		 * @return Function ID, null if not imported.
+		*/
+		GLSLFunctionID function_id(std::string_view _name) const;
+	};
+
+	/**
+	 * @brief Summary of what a link step kept and removed.
+	*/
+	struct GLSLModuleLinkStats
+	{
+		size_t functions_linked = 0;
+		size_t functions_removed = 0;
+		size_t variables_linked = 0;
+		size_t variables_removed = 0;
+	};
+
+	/**
+	 * @brief Declares a module's functions, uniforms and constants in a shader's context.
+	 *
+	 * Only declarations are added, nothing is copied into the shader until link_module().
+	 * Builtins used by the module are matched by name and must already exist in the context.
+	 *
+	 * @param _module Resolved module.
+	 * @param _context Shader context.
+	 * @return Import mapping, or nullopt if a name collides or a builtin is missing.
+	*/
+	std::optional<GLSLModuleImport> import_module(const GLSLModule& _module, GLSLContext& _context);
+
+	/**
+	 * @brief Links the parts of an imported module that the shader actually reaches.
+	 *
+	 * Reachability starts from the shader's globals and functions and follows calls through
+	 * the module's function bodies. Reached definitions are copied in front of the shader's
+	 * own globals and functions, everything else the import declared is removed again.
+	 *
+	 * @param _import Import returned by import_module() for this context.
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @return Link statistics.
+	*/
+	GLSLModuleLinkStats link_module(const GLSLModuleImport& _import, GLSLContext& _context, GLSLParams& _params);
+};
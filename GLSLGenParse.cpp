@@ -0,0 +1,1340 @@
+#include "GLSLGenParse.hpp"
+#include "GLSLGenFile.hpp"
+
+#include <chrono>
+#include <vector>
+#include <charconv>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+
+namespace glsl
+{
+	namespace
+	{
+		// Deepest expression nesting accepted, each level recurses through parse_expression()
+		constexpr size_t MAX_EXPRESSION_DEPTH = 256;
+
+		enum class TokenKind
+		{
+			end = 0,
+			identifier,
+			number,
+			punct,
+			directive,
+			invalid,
+		};
+
+		struct Token
+		{
+			TokenKind kind = TokenKind::end;
+
+			// View into the source text.
+			std::string_view text{};
+
+			// Byte offset of the token within the source.
+			size_t offset = 0;
+
+			bool is(std::string_view _text) const
+			{
+				return (this->kind == TokenKind::punct || this->kind == TokenKind::identifier) &&
+					this->text == _text;
+			};
+		};
+
+		constexpr bool is_ident_start(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+		};
+		constexpr bool is_digit(char c)
+		{
+			return c >= '0' && c <= '9';
+		};
+		constexpr bool is_ident_char(char c)
+		{
+			return is_ident_start(c) || is_digit(c);
+		};
+
+		/**
+		 * @brief Produces tokens on demand, never allocates.
+		*/
+		struct Lexer
+		{
+			std::string_view src;
+			size_t pos = 0;
+
+			void skip_space_and_comments()
+			{
+				while (this->pos < this->src.size())
+				{
+					const auto c = this->src[this->pos];
+					if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+					{
+						++this->pos;
+					}
+					else if (c == '/' && this->pos + 1 < this->src.size() && this->src[this->pos + 1] == '/')
+					{
+						const auto _end = this->src.find('\n', this->pos);
+						this->pos = (_end == std::string_view::npos) ? this->src.size() : _end;
+					}
+					else if (c == '/' && this->pos + 1 < this->src.size() && this->src[this->pos + 1] == '*')
+					{
+						const auto _end = this->src.find("*/", this->pos + 2);
+						this->pos = (_end == std::string_view::npos) ? this->src.size() : _end + 2;
+					}
+					else
+					{
+						break;
+					};
+				};
+			};
+
+			Token next()
+			{
+				this->skip_space_and_comments();
+
+				auto _token = Token{};
+				_token.offset = this->pos;
+				if (this->pos >= this->src.size())
+				{
+					return _token;
+				};
+
+				const auto _begin = this->pos;
+				const auto c = this->src[this->pos];
+
+				if (is_ident_start(c))
+				{
+					_token.kind = TokenKind::identifier;
+					while (this->pos < this->src.size() && is_ident_char(this->src[this->pos])) { ++this->pos; };
+				}
+				else if (is_digit(c) || (c == '.' && this->pos + 1 < this->src.size() && is_digit(this->src[this->pos + 1])))
+				{
+					_token.kind = TokenKind::number;
+					while (this->pos < this->src.size())
+					{
+						const auto d = this->src[this->pos];
+						if (is_digit(d) || d == '.' || d == 'f' || d == 'F' || d == 'l' || d == 'L')
+						{
+							++this->pos;
+						}
+						else if ((d == 'e' || d == 'E'))
+						{
+							++this->pos;
+							if (this->pos < this->src.size() && (this->src[this->pos] == '+' || this->src[this->pos] == '-'))
+							{
+								++this->pos;
+							};
+						}
+						else
+						{
+							break;
+						};
+					};
+				}
+				else if (c == '#')
+				{
+					_token.kind = TokenKind::directive;
+					const auto _end = this->src.find('\n', this->pos);
+					this->pos = (_end == std::string_view::npos) ? this->src.size() : _end;
+				}
+				else if ((c == '=' || c == '!' || c == '<' || c == '>') && this->pos + 1 < this->src.size() && this->src[this->pos + 1] == '=')
+				{
+					_token.kind = TokenKind::punct;
+					this->pos += 2;
+				}
+				else if (std::string_view("(){};,.=+-*/<>?:").find(c) != std::string_view::npos)
+				{
+					_token.kind = TokenKind::punct;
+					++this->pos;
+				}
+				else
+				{
+					_token.kind = TokenKind::invalid;
+					++this->pos;
+				};
+
+				_token.text = this->src.substr(_begin, this->pos - _begin);
+				return _token;
+			};
+		};
+
+		/**
+		 * @brief Maps a swizzle character to its component index.
+		 * @return Component index, or 255 if not a swizzle character.
+		*/
+		constexpr uint8_t swizzle_index(char c)
+		{
+			switch (c)
+			{
+			case 'x': case 'r': case 's':
+				return 0;
+			case 'y': case 'g': case 't':
+				return 1;
+			case 'z': case 'b': case 'p':
+				return 2;
+			case 'w': case 'a': case 'q':
+				return 3;
+			default:
+				return 255;
+			};
+		};
+
+		/**
+		 * @brief Checks if a name is a GLSL type the IR has no equivalent for, ie. mat3 or ivec2.
+		*/
+		constexpr bool is_unsupported_type_name(std::string_view _name)
+		{
+			// Matrices other than mat4, optionally double and with columns x rows
+			auto _matrix = _name;
+			if (_matrix.starts_with('d'))
+			{
+				_matrix.remove_prefix(1);
+			};
+			const auto _dimension = [](char c) { return c >= '2' && c <= '4'; };
+			if (_matrix.starts_with("mat") && _matrix.size() >= 4 && _dimension(_matrix[3]))
+			{
+				const auto _square = _matrix.size() == 4;
+				const auto _sized = _matrix.size() == 6 && _matrix[4] == 'x' && _dimension(_matrix[5]);
+				return (_square || _sized) && _name != "mat4";
+			};
+
+			// Integer, unsigned and bool vectors
+			if (_name.size() == 5 && _name.substr(1, 3) == "vec" && std::string_view("iub").find(_name[0]) != std::string_view::npos)
+			{
+				return _dimension(_name[4]);
+			};
+
+			constexpr std::string_view _others[] =
+			{
+				"uint", "sampler1D", "sampler3D", "samplerCube", "sampler2DShadow", "isampler2D", "usampler2D",
+			};
+			return std::ranges::find(_others, _name) != std::end(_others);
+		};
+
+
+
+		/**
+		 * @brief Gets the value of an int, float or double literal.
+		 * @return The value, or nullopt for other literals.
+		*/
+		std::optional<double> literal_scalar(const GLSLLiteral& _literal)
+		{
+			switch (_literal.type())
+			{
+			case GLSLType::glsl_int:
+				return (double)_literal.vec1<int>();
+			case GLSLType::glsl_float:
+				return (double)_literal.vec1<float>();
+			case GLSLType::glsl_double:
+				return _literal.vec1<double>();
+			default:
+				return std::nullopt;
+			};
+		};
+
+		/**
+		 * @brief Single pass recursive descent parser that builds the IR as it goes.
+		*/
+		struct Parser
+		{
+		public:
+
+			bool parse()
+			{
+				this->advance();
+				while (this->tok_.kind != TokenKind::end)
+				{
+					if (this->tok_.kind == TokenKind::directive)
+					{
+						if (!this->parse_directive()) { return false; };
+					}
+					else if (this->parse_type() != GLSLType::glsl_error)
+					{
+						if (!this->parse_function()) { return false; };
+					}
+					else if (this->tok_.kind == TokenKind::identifier && is_unsupported_type_name(this->tok_.text))
+					{
+						return this->fail_type("expected a type name");
+					}
+					else
+					{
+						if (!this->parse_global()) { return false; };
+					};
+				};
+				return true;
+			};
+
+			const std::string& error() const { return this->error_; };
+			size_t error_offset() const { return this->error_offset_; };
+
+			Parser(std::string_view _source, GLSLContext& _context, GLSLParams& _params) :
+				lexer_{ _source }, context_(&_context), params_(&_params)
+			{
+				// Index the existing symbols so lookups during the parse are O(1)
+				for (auto& v : _context.variables())
+				{
+					this->variables_.insert_or_assign(v.name(), v.id());
+				};
+				for (auto& v : _context.functions(true))
+				{
+					this->functions_.insert_or_assign(v.name(), v.id());
+				};
+				for (auto& v : _context.functions(false))
+				{
+					this->functions_.insert_or_assign(v.name(), v.id());
+				};
+			};
+
+		private:
+
+			using Parameter = GLSLExpression::Parameter;
+
+			void advance()
+			{
+				this->tok_ = this->lexer_.next();
+			};
+
+			bool fail(std::string_view _what)
+			{
+				if (this->error_.empty())
+				{
+					this->error_ = std::string(_what);
+					if (!this->tok_.text.empty())
+					{
+						this->error_ += " near '";
+						this->error_ += this->tok_.text;
+						this->error_ += '\'';
+					};
+					this->error_offset_ = this->tok_.offset;
+				};
+				return false;
+			};
+
+			bool expect(std::string_view _text)
+			{
+				if (!this->tok_.is(_text))
+				{
+					auto _msg = std::string("expected '");
+					_msg += _text;
+					_msg += '\'';
+					return this->fail(_msg);
+				};
+				this->advance();
+				return true;
+			};
+
+			/**
+			 * @brief Fails where a type name was expected, saying so if it names a type outside the subset.
+			*/
+			bool fail_type(std::string_view _what)
+			{
+				if (this->tok_.kind == TokenKind::identifier && is_unsupported_type_name(this->tok_.text))
+				{
+					return this->fail("unsupported type, only bool, int, float, double, vecN, dvecN, mat4 and sampler2D(Array) are supported");
+				};
+				return this->fail(_what);
+			};
+
+			bool take(std::string_view _text)
+			{
+				if (this->tok_.is(_text))
+				{
+					this->advance();
+					return true;
+				};
+				return false;
+			};
+
+			GLSLType parse_type()
+			{
+				if (this->tok_.kind != TokenKind::identifier)
+				{
+					return GLSLType::glsl_error;
+				};
+				return glsl_type_from_name(this->tok_.text);
+			};
+
+			GLSLVariable* declare_variable(std::string_view _name, GLSLType _type)
+			{
+				if (this->variables_.contains(_name))
+				{
+					this->fail("redeclared variable");
+					return nullptr;
+				};
+				auto _var = this->context_->new_variable(std::string(_name), _type);
+				this->variables_.insert_or_assign(_name, _var->id());
+				if (this->function_)
+				{
+					this->locals_.push_back(_name);
+				};
+				return _var;
+			};
+
+			/**
+			 * @brief Converts a value to a type, implicitly as GLSL would.
+			 * @return False if the value is not implicitly convertible to the type.
+			*/
+			bool make_converted(Parameter _param, GLSLType _type, GLSLExpression& _out)
+			{
+				const auto _paramType = _param.type(*this->context_);
+				if (_paramType == _type)
+				{
+					_out = GLSLExpression::Identity(std::move(_param));
+				}
+				else if (is_implicitly_convertible_to(_paramType, _type))
+				{
+					_out = GLSLExpression::Cast(_type, std::move(_param));
+				}
+				else
+				{
+					return false;
+				};
+				return true;
+			};
+
+
+
+			bool parse_directive()
+			{
+				constexpr auto _versionDirective = std::string_view("#version");
+
+				auto _text = this->tok_.text;
+				if (_text.substr(0, _versionDirective.size()) != _versionDirective)
+				{
+					return this->fail("unsupported preprocessor directive");
+				};
+				_text.remove_prefix(_versionDirective.size());
+				while (!_text.empty() && (_text.front() == ' ' || _text.front() == '\t')) { _text.remove_prefix(1); };
+
+				int _version = 0;
+				const auto r = std::from_chars(_text.data(), _text.data() + _text.size(), _version);
+				if (r.ec != std::errc())
+				{
+					return this->fail("invalid version directive");
+				};
+				this->params_->version = _version;
+
+				_text.remove_prefix(r.ptr - _text.data());
+				while (!_text.empty() && (_text.front() == ' ' || _text.front() == '\t')) { _text.remove_prefix(1); };
+				while (!_text.empty() && (_text.back() == ' ' || _text.back() == '\t' || _text.back() == '\r')) { _text.remove_suffix(1); };
+				if (_text == "es")
+				{
+					this->params_->profile = GLSLProfile::es;
+				}
+				else if (_text.empty() || _text == "core")
+				{
+					this->params_->profile = GLSLProfile::core;
+				}
+				else
+				{
+					return this->fail("unsupported profile");
+				};
+
+				this->advance();
+				return true;
+			};
+
+			/**
+			 * @brief Takes a precision qualifier if there is one.
+			*/
+			GLSLPrecision take_precision()
+			{
+				for (auto _precision : { GLSLPrecision::lowp, GLSLPrecision::mediump, GLSLPrecision::highp })
+				{
+					if (this->take(glsl_precision_name(_precision)))
+					{
+						return _precision;
+					};
+				};
+				return GLSLPrecision::none;
+			};
+
+			// precision <qualifier> <type>;
+			bool parse_default_precision()
+			{
+				const auto _precision = this->take_precision();
+				if (_precision == GLSLPrecision::none)
+				{
+					return this->fail("expected a precision qualifier");
+				};
+
+				// Sampler precisions are accepted but not kept
+				const auto _type = this->parse_type();
+				if (_type == GLSLType::glsl_float)
+				{
+					this->params_->float_precision = _precision;
+				}
+				else if (_type == GLSLType::glsl_int)
+				{
+					this->params_->int_precision = _precision;
+				}
+				else if (!is_sampler(_type))
+				{
+					return this->fail("expected float, int or a sampler type");
+				};
+				this->advance();
+
+				return this->expect(";");
+			};
+
+			bool parse_global()
+			{
+				auto _inout = GLSLInOut::local;
+				bool _uniform = false;
+
+				if (this->take("precision"))
+				{
+					return this->parse_default_precision();
+				};
+
+				if (this->take("in"))
+				{
+					_inout = GLSLInOut::in;
+				}
+				else if (this->take("out"))
+				{
+					_inout = GLSLInOut::out;
+				}
+				else if (this->take("uniform"))
+				{
+					_uniform = true;
+				}
+				else
+				{
+					return this->fail("expected in, out, uniform or a function");
+				};
+
+				const auto _precision = this->take_precision();
+				const auto _type = this->parse_type();
+				if (_type == GLSLType::glsl_error || _type == GLSLType::glsl_void)
+				{
+					return this->fail_type("expected a type name");
+				};
+				this->advance();
+
+				if (this->tok_.kind != TokenKind::identifier)
+				{
+					return this->fail("expected a variable name");
+				};
+				auto _var = this->declare_variable(this->tok_.text, _type);
+				if (!_var)
+				{
+					return false;
+				};
+				_var->set_inout(_inout).set_precision(_precision);
+				if (_uniform)
+				{
+					_var->set_uniform();
+				};
+				this->advance();
+
+				return this->expect(";");
+			};
+
+			bool parse_function()
+			{
+				const auto _returnType = this->parse_type();
+				this->advance();
+				if (this->tok_.kind != TokenKind::identifier)
+				{
+					return this->fail("expected a function name");
+				};
+				const auto _name = this->tok_.text;
+				this->advance();
+
+				if (!this->expect("("))
+				{
+					return false;
+				};
+				if (_name == "main")
+				{
+					if (_returnType != GLSLType::glsl_void)
+					{
+						return this->fail("main must return void");
+					};
+					if (!this->expect(")"))
+					{
+						return false;
+					};
+					this->params_->main_fn.set_name(std::string(_name));
+					this->function_ = &this->params_->main_fn;
+				}
+				else if (!this->parse_function_params(_name, _returnType))
+				{
+					return false;
+				};
+
+				if (!this->expect("{"))
+				{
+					return false;
+				};
+				while (!this->tok_.is("}"))
+				{
+					if (this->tok_.kind == TokenKind::end)
+					{
+						return this->fail("unexpected end of file in function body");
+					};
+					if (!this->parse_statement())
+					{
+						return false;
+					};
+				};
+				this->advance();
+
+				// The emitter writes "};" after function bodies
+				this->take(";");
+
+				// Parameters and locals go out of scope, the function itself becomes callable
+				for (auto& v : this->locals_)
+				{
+					this->variables_.erase(v);
+				};
+				this->locals_.clear();
+				if (this->function_ != &this->params_->main_fn)
+				{
+					this->functions_.insert_or_assign(_name, this->function_->id());
+				};
+				this->function_ = nullptr;
+				return true;
+			};
+
+			/**
+			 * @brief Parses a parameter list up to and including ')' and defines the function.
+			*/
+			bool parse_function_params(std::string_view _name, GLSLType _returnType)
+			{
+				if (this->functions_.contains(_name))
+				{
+					return this->fail("redefined function");
+				};
+
+				auto _params = std::vector<std::pair<std::string_view, GLSLType>>();
+				auto _precisions = std::vector<GLSLPrecision>();
+				if (!this->tok_.is(")"))
+				{
+					do
+					{
+						_precisions.push_back(this->take_precision());
+						const auto _type = this->parse_type();
+						if (_type == GLSLType::glsl_error || _type == GLSLType::glsl_void)
+						{
+							return this->fail_type("expected a type name");
+						};
+						this->advance();
+
+						if (this->tok_.kind != TokenKind::identifier)
+						{
+							return this->fail("expected a parameter name");
+						};
+						const auto _paramName = this->tok_.text;
+						if (this->variables_.contains(_paramName) ||
+							std::ranges::find(_params, _paramName, &std::pair<std::string_view, GLSLType>::first) != _params.end())
+						{
+							return this->fail("redeclared variable");
+						};
+						_params.emplace_back(_paramName, _type);
+						this->advance();
+					}
+					while (this->take(","));
+				};
+				if (!this->expect(")"))
+				{
+					return false;
+				};
+
+				auto& _function = this->params_->define_function(std::string(_name), _returnType, _params);
+				for (size_t n = 0; n != _params.size(); ++n)
+				{
+					const auto _param = _function.params()[n];
+					this->context_->find(_param)->set_precision(_precisions[n]);
+					this->variables_.insert_or_assign(_params[n].first, _param);
+					this->locals_.push_back(_params[n].first);
+				};
+				this->function_ = &_function;
+				return true;
+			};
+
+			bool parse_return()
+			{
+				const auto _returnType = this->function_->return_type();
+				if (_returnType == GLSLType::glsl_void)
+				{
+					return this->fail("void function returns a value");
+				};
+
+				auto _param = Parameter();
+				if (!this->parse_expression(_param))
+				{
+					return false;
+				};
+
+				auto _statement = GLSLStatement(GLSLStatementType::return_value);
+				if (!this->make_converted(std::move(_param), _returnType, _statement.expr))
+				{
+					return this->fail("cannot return expression as the function's return type");
+				};
+				if (!this->expect(";"))
+				{
+					return false;
+				};
+
+				this->function_->append(std::move(_statement));
+				return true;
+			};
+
+			bool parse_statement()
+			{
+				if (this->tok_.kind != TokenKind::identifier)
+				{
+					return this->fail("expected a statement");
+				};
+				if (this->take("return"))
+				{
+					return this->parse_return();
+				};
+
+				auto _statement = GLSLStatement(GLSLStatementType::assignment);
+				GLSLType _destType = GLSLType::glsl_error;
+
+				const auto _precision = this->take_precision();
+				const auto _declType = this->parse_type();
+				if (_declType == GLSLType::glsl_error && (_precision != GLSLPrecision::none || is_unsupported_type_name(this->tok_.text)))
+				{
+					return this->fail_type("expected a type name");
+				};
+				if (_declType != GLSLType::glsl_error)
+				{
+					// <type> <name> = <expr>;
+					this->advance();
+					if (this->tok_.kind != TokenKind::identifier)
+					{
+						return this->fail("expected a variable name");
+					};
+					auto _var = this->declare_variable(this->tok_.text, _declType);
+					if (!_var)
+					{
+						return false;
+					};
+					_var->set_precision(_precision);
+					_statement = GLSLStatement(GLSLStatementType::declaration);
+					_statement.dest = _var->id();
+					_destType = _declType;
+				}
+				else
+				{
+					// <name> = <expr>;
+					const auto it = this->variables_.find(this->tok_.text);
+					if (it == this->variables_.end())
+					{
+						return this->fail("unknown variable");
+					};
+					const auto _var = this->context_->find(it->second);
+					if (!_var->can_write())
+					{
+						return this->fail("variable is not writable");
+					};
+					_statement.dest = _var->id();
+					_destType = _var->type();
+				};
+				this->advance();
+
+				if (this->tok_.is("."))
+				{
+					return this->fail("swizzled assignment targets are not supported, assign the whole vector");
+				};
+				if (!this->expect("="))
+				{
+					return false;
+				};
+
+				auto _param = Parameter();
+				if (!this->parse_expression(_param))
+				{
+					return false;
+				};
+
+				if (!this->make_converted(std::move(_param), _destType, _statement.expr))
+				{
+					return this->fail("cannot assign expression to a variable of a different type");
+				};
+
+				if (!this->expect(";"))
+				{
+					return false;
+				};
+
+				this->function_->append(std::move(_statement));
+				return true;
+			};
+
+
+
+			bool parse_expression(Parameter& _out)
+			{
+				if (this->depth_ == MAX_EXPRESSION_DEPTH)
+				{
+					return this->fail("expression is nested too deeply");
+				};
+				++this->depth_;
+				const auto _ok = this->parse_conditional(_out);
+				--this->depth_;
+				return _ok;
+			};
+
+			bool make_binary_op(GLSLBinaryOperator _op, Parameter& _lhs, Parameter _rhs)
+			{
+				const auto _lhsType = _lhs.type(*this->context_);
+				const auto _rhsType = _rhs.type(*this->context_);
+				if (!invocable(_op, _lhsType, _rhsType))
+				{
+					return this->fail("operator is not invocable with the given types");
+				};
+				_lhs = GLSLExpression::make_unique(GLSLExpression::BinaryOp(_op, std::move(_lhs), std::move(_rhs)));
+				return true;
+			};
+
+			bool parse_conditional(Parameter& _out)
+			{
+				if (!this->parse_equality(_out))
+				{
+					return false;
+				};
+				if (!this->tok_.is("?"))
+				{
+					return true;
+				};
+				if (_out.type(*this->context_) != GLSLType::glsl_bool)
+				{
+					return this->fail("select condition must be a bool");
+				};
+				this->advance();
+
+				// Right associative, "a ? b : c ? d : e" selects between b and "c ? d : e"
+				auto _ifTrue = Parameter();
+				auto _ifFalse = Parameter();
+				if (!this->parse_expression(_ifTrue) || !this->expect(":") || !this->parse_expression(_ifFalse))
+				{
+					return false;
+				};
+				if (_ifTrue.type(*this->context_) != _ifFalse.type(*this->context_))
+				{
+					return this->fail("select operands must have the same type");
+				};
+				_out = GLSLExpression::make_unique(GLSLExpression::Select(std::move(_out), std::move(_ifTrue), std::move(_ifFalse)));
+				return true;
+			};
+			bool parse_equality(Parameter& _out)
+			{
+				if (!this->parse_relational(_out))
+				{
+					return false;
+				};
+				while (this->tok_.is("==") || this->tok_.is("!="))
+				{
+					const auto _op = this->tok_.is("==") ? GLSLBinaryOperator::eq : GLSLBinaryOperator::neq;
+					this->advance();
+
+					auto _rhs = Parameter();
+					if (!this->parse_relational(_rhs) || !this->make_binary_op(_op, _out, std::move(_rhs)))
+					{
+						return false;
+					};
+				};
+				return true;
+			};
+			bool parse_relational(Parameter& _out)
+			{
+				if (!this->parse_additive(_out))
+				{
+					return false;
+				};
+				while (this->tok_.is("<") || this->tok_.is("<=") || this->tok_.is(">") || this->tok_.is(">="))
+				{
+					const auto _op =
+						this->tok_.is("<") ? GLSLBinaryOperator::lt :
+						this->tok_.is("<=") ? GLSLBinaryOperator::le :
+						this->tok_.is(">") ? GLSLBinaryOperator::gt : GLSLBinaryOperator::ge;
+					this->advance();
+
+					auto _rhs = Parameter();
+					if (!this->parse_additive(_rhs) || !this->make_binary_op(_op, _out, std::move(_rhs)))
+					{
+						return false;
+					};
+				};
+				return true;
+			};
+			bool parse_additive(Parameter& _out)
+			{
+				if (!this->parse_multiplicative(_out))
+				{
+					return false;
+				};
+				while (this->tok_.is("+") || this->tok_.is("-"))
+				{
+					const auto _op = this->tok_.is("+") ? GLSLBinaryOperator::add : GLSLBinaryOperator::sub;
+					this->advance();
+
+					auto _rhs = Parameter();
+					if (!this->parse_multiplicative(_rhs) || !this->make_binary_op(_op, _out, std::move(_rhs)))
+					{
+						return false;
+					};
+				};
+				return true;
+			};
+			bool parse_multiplicative(Parameter& _out)
+			{
+				if (!this->parse_unary(_out))
+				{
+					return false;
+				};
+				while (this->tok_.is("*") || this->tok_.is("/"))
+				{
+					const auto _op = this->tok_.is("*") ? GLSLBinaryOperator::mult : GLSLBinaryOperator::div;
+					this->advance();
+
+					auto _rhs = Parameter();
+					if (!this->parse_unary(_rhs) || !this->make_binary_op(_op, _out, std::move(_rhs)))
+					{
+						return false;
+					};
+				};
+				return true;
+			};
+			bool parse_unary(Parameter& _out)
+			{
+				if (this->tok_.is("-") || this->tok_.is("+"))
+				{
+					// Literals take the sign, the IR has no unary minus so anything else becomes 0 - x
+					const bool _negate = this->tok_.is("-");
+					this->advance();
+					if (this->tok_.kind == TokenKind::number)
+					{
+						return this->parse_number(_out, _negate) && this->parse_postfix(_out);
+					};
+					if (this->depth_ == MAX_EXPRESSION_DEPTH)
+					{
+						return this->fail("expression is nested too deeply");
+					};
+					++this->depth_;
+					const auto _ok = this->parse_unary(_out);
+					--this->depth_;
+					return _ok && (!_negate || this->make_negated(_out));
+				};
+				return this->parse_primary(_out) && this->parse_postfix(_out);
+			};
+
+			/**
+			 * @brief Negates a value as 0 - x, with a zero of its component type.
+			*/
+			bool make_negated(Parameter& _out)
+			{
+				const auto _type = _out.type(*this->context_);
+				const auto _component = (is_matrix(_type)) ? GLSLType::glsl_float : (is_vector(_type)) ? element_type(_type) : _type;
+
+				auto _zero = Parameter();
+				switch (_component)
+				{
+				case GLSLType::glsl_int:
+					_zero = GLSLLiteral(0);
+					break;
+				case GLSLType::glsl_float:
+					_zero = GLSLLiteral(0.0f);
+					break;
+				case GLSLType::glsl_double:
+					_zero = GLSLLiteral(0.0);
+					break;
+				default:
+					return this->fail("unary minus is only valid on numbers");
+				};
+				if (!this->make_binary_op(GLSLBinaryOperator::sub, _zero, std::move(_out)))
+				{
+					return false;
+				};
+				_out = std::move(_zero);
+				return true;
+			};
+
+			bool parse_postfix(Parameter& _out)
+			{
+				while (this->take("."))
+				{
+					if (this->tok_.kind != TokenKind::identifier || this->tok_.text.size() > 4)
+					{
+						return this->fail("expected a swizzle");
+					};
+
+					auto _indexes = std::array<uint8_t, 4>{ 255, 255, 255, 255 };
+					for (size_t n = 0; n != this->tok_.text.size(); ++n)
+					{
+						_indexes[n] = swizzle_index(this->tok_.text[n]);
+						if (_indexes[n] == 255)
+						{
+							return this->fail("invalid swizzle");
+						};
+					};
+
+					const auto _type = _out.type(*this->context_);
+					if (is_vector(_type))
+					{
+						for (auto& _index : _indexes)
+						{
+							if (_index != 255 && _index >= vec_size(_type))
+							{
+								return this->fail("swizzle index out of range");
+							};
+						};
+					}
+					else if (!is_matrix(_type) || this->tok_.text.size() != 1)
+					{
+						return this->fail("swizzle is only valid on vectors");
+					};
+					this->advance();
+
+					const auto& s = _indexes;
+					_out = GLSLExpression::make_unique(GLSLExpression::Swizzle(std::move(_out), s[0], s[1], s[2], s[3]));
+				};
+				return true;
+			};
+
+			bool parse_number(Parameter& _out, bool _negate)
+			{
+				auto _text = this->tok_.text;
+				bool _isFloat = _text.find_first_of(".eE") != std::string_view::npos;
+				bool _isDouble = false;
+
+				if (_text.ends_with("lf") || _text.ends_with("LF"))
+				{
+					_isDouble = true;
+					_text.remove_suffix(2);
+				}
+				else if (_text.ends_with('f') || _text.ends_with('F'))
+				{
+					_isFloat = true;
+					_text.remove_suffix(1);
+				};
+
+				const auto _first = _text.data();
+				const auto _last = _text.data() + _text.size();
+				if (_isDouble)
+				{
+					double v = 0.0;
+					if (std::from_chars(_first, _last, v).ptr != _last) { return this->fail("invalid number"); };
+					_out = GLSLLiteral(_negate ? -v : v);
+				}
+				else if (_isFloat)
+				{
+					float v = 0.0f;
+					if (std::from_chars(_first, _last, v).ptr != _last) { return this->fail("invalid number"); };
+					_out = GLSLLiteral(_negate ? -v : v);
+				}
+				else
+				{
+					int v = 0;
+					if (std::from_chars(_first, _last, v).ptr != _last) { return this->fail("invalid number"); };
+					_out = GLSLLiteral(_negate ? -v : v);
+				};
+
+				this->advance();
+				return true;
+			};
+
+			bool parse_arguments(std::vector<Parameter>& _args)
+			{
+				if (!this->expect("("))
+				{
+					return false;
+				};
+				if (this->take(")"))
+				{
+					return true;
+				};
+				while (true)
+				{
+					auto _arg = Parameter();
+					if (!this->parse_expression(_arg))
+					{
+						return false;
+					};
+					_args.push_back(std::move(_arg));
+
+					if (this->take(")"))
+					{
+						return true;
+					};
+					if (!this->expect(","))
+					{
+						return false;
+					};
+				};
+			};
+
+			bool parse_call(Parameter& _out, GLSLFunctionID _function)
+			{
+				// Functions are declared before their body is parsed, so only recursion gets here
+				if (this->function_ && !this->params_->may_call(*this->function_, _function))
+				{
+					return this->fail("recursive function call");
+				};
+
+				auto _args = std::vector<Parameter>();
+				if (!this->parse_arguments(_args))
+				{
+					return false;
+				};
+
+				auto _types = std::vector<GLSLType>();
+				for (auto& v : _args)
+				{
+					_types.push_back(v.type(*this->context_));
+				};
+
+				// Arguments must convert implicitly, find_best_overload() may return an overload
+				// rated as no match, resolve_params() would then abort
+				const auto _overload = this->context_->find(_function)->find_best_overload(_types);
+				if (!_overload || _overload->params.size() != _types.size())
+				{
+					return this->fail("no matching overload for function call");
+				};
+				for (size_t n = 0; n != _types.size(); ++n)
+				{
+					using Convertability = GLSLFunctionParameter::Convertability;
+					if (_overload->params[n].convertability_from(_types[n]) < Convertability::implicit)
+					{
+						return this->fail("no matching overload for function call");
+					};
+				};
+
+				auto _call = GLSLExpression::FunctionCall(_function);
+				for (auto& v : _args)
+				{
+					_call.add_param(std::move(v));
+				};
+				_call.resolve_params(*this->context_);
+				if (_call.result_type(*this->context_) == GLSLType::glsl_error)
+				{
+					return this->fail("no matching overload for function call");
+				};
+				_out = GLSLExpression::make_unique(std::move(_call));
+				return true;
+			};
+
+			/**
+			 * @brief Maps a constructor back to the IR, only the forms the emitter produces are accepted.
+			*/
+			bool parse_constructor(Parameter& _out, GLSLType _type)
+			{
+				auto _args = std::vector<Parameter>();
+				if (!this->parse_arguments(_args))
+				{
+					return false;
+				};
+
+				// vecN(<literal>, ...) is a vector literal
+				const bool _allLiterals = !_args.empty() && std::ranges::all_of(_args, [](const Parameter& v) { return v.is_literal(); });
+				if (_allLiterals && is_vector(_type) && _args.size() == vec_size(_type))
+				{
+					const bool _double = is_type_in_category(_type, GLSLGenType::gen_double);
+					auto _floats = std::array<float, 4>{};
+					auto _doubles = std::array<double, 4>{};
+					for (size_t n = 0; n != _args.size(); ++n)
+					{
+						const auto& _literal = _args[n].literal();
+						switch (_literal.type())
+						{
+						case GLSLType::glsl_int:
+							_floats[n] = (float)_literal.vec1<int>();
+							_doubles[n] = (double)_literal.vec1<int>();
+							break;
+						case GLSLType::glsl_float:
+							_floats[n] = _literal.vec1<float>();
+							_doubles[n] = (double)_literal.vec1<float>();
+							break;
+						case GLSLType::glsl_double:
+							_floats[n] = (float)_literal.vec1<double>();
+							_doubles[n] = _literal.vec1<double>();
+							break;
+						default:
+							return this->fail("invalid vector literal component");
+						};
+					};
+					_out = _double ? GLSLLiteral(_type, _doubles) : GLSLLiteral(_type, _floats);
+					return true;
+				};
+
+				// <type>(<param>) is a plain cast
+				if (_args.size() == 1)
+				{
+					const auto _argType = _args.front().type(*this->context_);
+					if (_argType == _type)
+					{
+						_out = std::move(_args.front());
+					}
+					else if (!is_castable_to(_argType, _type))
+					{
+						return this->fail("invalid cast");
+					}
+					else
+					{
+						_out = GLSLExpression::make_unique(GLSLExpression::Cast(_type, std::move(_args.front())));
+					};
+					return true;
+				};
+
+				// vecN(<vec>, 0.0, .., 1.0) is an up cast of a smaller vector, the emitter writes
+				// the vector as <vec>.xy..
+				if (is_vector(_type))
+				{
+					auto* _what = &_args.front();
+					if (_what->is_expression() && _what->expr().type() == GLSLExpressionType::swizzle)
+					{
+						auto& _swizzle = _what->expr().get<GLSLExpression::Swizzle>();
+						const auto _size = vec_size(_swizzle.what.type(*this->context_));
+						bool _identity = is_vector(_swizzle.what.type(*this->context_));
+						for (size_t n = 0; _identity && n != 4; ++n)
+						{
+							_identity = _swizzle.swizzle_[n] == ((n < _size) ? (uint8_t)n : (uint8_t)255);
+						};
+						if (_identity)
+						{
+							_what = &_swizzle.what;
+						};
+					};
+
+					const auto _fromType = _what->type(*this->context_);
+					const auto _fromSize = vec_size(_fromType);
+					bool _matches = is_vector(_fromType) && _fromSize < vec_size(_type) &&
+						_args.size() == 1 + vec_size(_type) - _fromSize;
+					for (size_t n = 1; _matches && n != _args.size(); ++n)
+					{
+						const auto _component = _fromSize + n - 1;
+						const auto _expected = (_component == 3) ? 1.0 : 0.0;
+						_matches = _args[n].is_literal() && literal_scalar(_args[n].literal()) == _expected;
+					};
+
+					if (_matches)
+					{
+						auto _from = std::move(*_what);
+						_out = GLSLExpression::make_unique(GLSLExpression::Cast(_type, std::move(_from)));
+						return true;
+					};
+				};
+
+				return this->fail("unsupported constructor form, only literals, casts and a vector padded with 0.0 "
+					"and a 1.0 w are supported");
+			};
+
+			bool parse_primary(Parameter& _out)
+			{
+				if (this->tok_.kind == TokenKind::number)
+				{
+					return this->parse_number(_out, false);
+				};
+
+				if (this->take("("))
+				{
+					return this->parse_expression(_out) && this->expect(")");
+				};
+
+				if (this->tok_.kind != TokenKind::identifier)
+				{
+					return this->fail("expected an expression");
+				};
+
+				if (this->tok_.text == "true" || this->tok_.text == "false")
+				{
+					_out = GLSLLiteral(this->tok_.text == "true");
+					this->advance();
+					return true;
+				};
+
+				const auto _name = this->tok_.text;
+
+				if (const auto _type = glsl_type_from_name(_name); _type != GLSLType::glsl_error)
+				{
+					this->advance();
+					return this->parse_constructor(_out, _type);
+				};
+
+				if (const auto it = this->functions_.find(_name); it != this->functions_.end())
+				{
+					this->advance();
+					return this->parse_call(_out, it->second);
+				};
+
+				if (const auto it = this->variables_.find(_name); it != this->variables_.end())
+				{
+					this->advance();
+					_out = it->second;
+					return true;
+				};
+
+				return this->fail_type("unknown identifier");
+			};
+
+			Lexer lexer_;
+			Token tok_{};
+
+			GLSLContext* context_;
+			GLSLParams* params_;
+
+			std::unordered_map<std::string_view, GLSLVariableID> variables_{};
+			std::unordered_map<std::string_view, GLSLFunctionID> functions_{};
+
+			// Function whose body is being parsed and the names it declared, null between functions
+			GLSLFunction* function_ = nullptr;
+			std::vector<std::string_view> locals_{};
+
+			std::string error_{};
+			size_t error_offset_ = 0;
+
+			// Expressions being parsed within each other
+			size_t depth_ = 0;
+		};
+	};
+
+
+
+	GLSLParseResult parse_glsl(std::string_view _source, GLSLContext& _context, GLSLParams& _params)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::parse);
+		const auto _start = std::chrono::steady_clock::now();
+
+		auto _parser = Parser(_source, _context, _params);
+		const auto _good = _parser.parse();
+
+		const auto _end = std::chrono::steady_clock::now();
+
+		auto _result = GLSLParseResult();
+		_result.good = _good;
+		_result.bytes = _source.size();
+		_result.seconds = std::chrono::duration<double>(_end - _start).count();
+
+		if (!_good)
+		{
+			_result.error = _parser.error();
+
+			// Only pay for line counting when reporting an error
+			const auto _before = _source.substr(0, _parser.error_offset());
+			_result.line = 1 + (size_t)std::ranges::count(_before, '\n');
+			const auto _lineStart = _before.rfind('\n');
+			_result.column = 1 + ((_lineStart == std::string_view::npos) ? _before.size() : _before.size() - _lineStart - 1);
+		};
+
+		return _result;
+	};
+
+	GLSLParseResult parse_glsl_file(const std::filesystem::path& _path, GLSLContext& _context, GLSLParams& _params)
+	{
+		const auto _file = GLSLMappedFile(_path);
+		if (!_file)
+		{
+			auto _result = GLSLParseResult();
+			_result.error = "failed to open file";
+			return _result;
+		};
+		return parse_glsl(_file.text(), _context, _params);
+	};
+};
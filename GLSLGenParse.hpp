@@ -0,0 +1,84 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <string>
+#include <filesystem>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Outcome of parsing a GLSL source.
+	*/
+	struct GLSLParseResult
+	{
+		bool good = false;
+
+		/**
+		 * @brief Description of the first error, empty on success.
+		*/
+		std::string error{};
+
+		/**
+		 * @brief 1-based position of the first error.
+		*/
+		size_t line = 0;
+		size_t column = 0;
+
+		/**
+		 * @brief Number of source bytes consumed and how long it took.
+		*/
+		size_t bytes = 0;
+		double seconds = 0.0;
+
+		/**
+		 * @brief Parsing throughput.
+		 * @return Throughput in MB/s, 0 if no time was measured.
+		*/
+		double megabytes_per_second() const
+		{
+			return (this->seconds > 0.0) ? ((double)this->bytes / (1024.0 * 1024.0)) / this->seconds : 0.0;
+		};
+
+		explicit operator bool() const noexcept { return this->good; };
+	};
+
+	/**
+	 * @brief Parses GLSL source into a context and shader parameters.
+	 *
+	 * Handles the subset of GLSL the IR can represent: the version directive, default precision
+	 * statements, in/out/uniform declarations and functions made of declarations, assignments
+	 * and returns, main among them. Declarations and parameters may carry a precision
+	 * qualifier. Functions are callable once defined. Expressions may
+	 * use literals, calls, binary operators, matrix times vector products, unary minus, selects,
+	 * swizzles, casts and constructors padding a smaller vector with 0.0 and a 1.0 w, ie.
+	 * vec4(p, 1.0). The IR has no unary minus, -x is parsed as 0 - x.
+	 *
+	 * Outside the subset, and reported as an error: types other than bool, int, float, double,
+	 * vecN, dvecN, mat4 and the sampler2D types (ie. mat3, ivec2, uint), constructors combining
+	 * other values (ie. vec4(p, 0.5) or vec2(a, b) from non-literals), assignments to swizzles
+	 * such as c.xy = v, compound assignments and increments, logical operators, control flow,
+	 * arrays, structs and preprocessor directives other than #version.
+	 *
+	 * Builtin variables and functions referenced by the source must already be present in
+	 * the context. Tokens are views into the source, it is never copied.
+	 *
+	 * @param _source GLSL source text.
+	 * @param _context Context to add the declared symbols to.
+	 * @param _params Parameters to write the version and functions into.
+	 * @return Parse result, check "good" before using the context.
+	*/
+	GLSLParseResult parse_glsl(std::string_view _source, GLSLContext& _context, GLSLParams& _params);
+
+	/**
+	 * @brief Memory maps a file and parses it with parse_glsl().
+	 * @param _path Path to the GLSL source file.
+	 * @param _context Context to add the declared symbols to.
+	 * @param _params Parameters to write the version and functions into.
+	 * @return Parse result, check "good" before using the context.
+	*/
+	GLSLParseResult parse_glsl_file(const std::filesystem::path& _path, GLSLContext& _context, GLSLParams& _params);
+};
@@ -0,0 +1,143 @@
+#include "GLSLGenPerf.hpp"
+
+#ifdef __linux__
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <linux/perf_event.h>
+#endif
+
+namespace glsl
+{
+#ifdef __linux__
+	namespace
+	{
+		struct PerfEventConfig
+		{
+			GLSLPerfEvent event;
+			uint32_t type;
+			uint64_t config;
+		};
+
+		constexpr auto perf_hardware_events_v = std::array
+		{
+			PerfEventConfig{ GLSLPerfEvent::cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			PerfEventConfig{ GLSLPerfEvent::instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			PerfEventConfig{ GLSLPerfEvent::cache_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			PerfEventConfig{ GLSLPerfEvent::branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		};
+		constexpr auto perf_software_events_v = std::array
+		{
+			PerfEventConfig{ GLSLPerfEvent::task_clock_ns, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+			PerfEventConfig{ GLSLPerfEvent::page_faults, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+		};
+
+		int open_perf_event(const PerfEventConfig& _config, int _group)
+		{
+			auto _attr = perf_event_attr{};
+			_attr.size = sizeof(perf_event_attr);
+			_attr.type = _config.type;
+			_attr.config = _config.config;
+			_attr.disabled = (_group == -1) ? 1 : 0;
+			_attr.exclude_kernel = 1;
+			_attr.exclude_hv = 1;
+			_attr.read_format = PERF_FORMAT_GROUP;
+
+			// This thread, any CPU
+			return static_cast<int>(syscall(SYS_perf_event_open, &_attr, 0, -1, _group, 0));
+		};
+	};
+
+	bool GLSLPerfCounters::open()
+	{
+		this->close();
+
+		const auto _add = [this](const PerfEventConfig& _config) -> bool
+		{
+			const auto _fd = open_perf_event(_config, this->group_);
+			if (_fd == -1)
+			{
+				return false;
+			};
+			if (this->group_ == -1)
+			{
+				this->group_ = _fd;
+			};
+			this->fds_[this->count_] = _fd;
+			this->index_[static_cast<size_t>(_config.event)] = static_cast<int>(this->count_);
+			++this->count_;
+			return true;
+		};
+
+		// The first event to open leads the group, so try a hardware event first.
+		for (auto& v : perf_hardware_events_v)
+		{
+			if (_add(v))
+			{
+				this->hardware_ = true;
+			};
+		};
+		for (auto& v : perf_software_events_v)
+		{
+			_add(v);
+		};
+
+		if (this->group_ == -1)
+		{
+			return false;
+		};
+
+		ioctl(this->group_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(this->group_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		return true;
+	};
+
+	void GLSLPerfCounters::close() noexcept
+	{
+		for (size_t n = 0; n != this->count_; ++n)
+		{
+			::close(this->fds_[n]);
+		};
+		this->fds_.fill(-1);
+		this->index_.fill(-1);
+		this->group_ = -1;
+		this->hardware_ = false;
+		this->count_ = 0;
+	};
+
+	bool GLSLPerfCounters::read(GLSLPerfSample& _out) const noexcept
+	{
+		if (this->group_ == -1)
+		{
+			return false;
+		};
+
+		// { nr, values[nr] }
+		auto _buffer = std::array<uint64_t, glsl_perf_event_count_v + 1>{};
+		const auto _bytes = ::read(this->group_, _buffer.data(), (this->count_ + 1) * sizeof(uint64_t));
+		if (_bytes < static_cast<ssize_t>((this->count_ + 1) * sizeof(uint64_t)))
+		{
+			return false;
+		};
+
+		for (size_t n = 0; n != glsl_perf_event_count_v; ++n)
+		{
+			const auto _index = this->index_[n];
+			_out[n] = (_index != -1) ? _buffer[static_cast<size_t>(_index) + 1] : 0;
+		};
+		return true;
+	};
+#else
+	bool GLSLPerfCounters::open()
+	{
+		return false;
+	};
+	void GLSLPerfCounters::close() noexcept
+	{
+	};
+	bool GLSLPerfCounters::read(GLSLPerfSample& _out) const noexcept
+	{
+		return false;
+	};
+#endif
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+/** @file */
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Performance counters sampled around generation phases.
+	*/
+	enum class GLSLPerfEvent : uint8_t
+	{
+		// Hardware counters
+		cycles = 0,
+		instructions,
+		cache_misses,
+		branch_misses,
+
+		// Software counters, used as the fallback when hardware counters are unavailable
+		task_clock_ns,
+		page_faults,
+	};
+	constexpr size_t glsl_perf_event_count_v = 6;
+
+	constexpr std::string_view perf_event_name(GLSLPerfEvent _event)
+	{
+		constexpr auto _names = std::array<std::string_view, glsl_perf_event_count_v>
+		{
+			"cycles", "instructions", "cache_misses", "branch_misses", "task_clock_ns", "page_faults"
+		};
+		return _names[static_cast<size_t>(_event)];
+	};
+
+	/**
+	 * @brief Values of every event at one point in time, unavailable events read as 0.
+	*/
+	using GLSLPerfSample = std::array<uint64_t, glsl_perf_event_count_v>;
+
+	/**
+	 * @brief Counts hardware and software events for the calling thread using perf_event_open.
+	 *
+	 * Only implemented on Linux, open() fails everywhere else. Counting is limited to user space
+	 * so it works with the default perf_event_paranoid setting. Counters are opened as a single
+	 * group so all events are read at once.
+	*/
+	struct GLSLPerfCounters
+	{
+	public:
+
+		/**
+		 * @brief Opens the counters for the calling thread.
+		 *
+		 * Hardware counters are tried first, if they cannot be opened (virtual machines,
+		 * containers) only the software counters are used.
+		 *
+		 * @return True if at least one counter could be opened, false otherwise.
+		*/
+		bool open();
+
+		/**
+		 * @brief Closes every counter, does nothing if none are open.
+		*/
+		void close() noexcept;
+
+		bool good() const noexcept { return this->group_ != -1; };
+		explicit operator bool() const noexcept { return this->good(); };
+
+		/**
+		 * @brief Checks if the hardware counters were opened.
+		*/
+		bool hardware() const noexcept { return this->hardware_; };
+
+		/**
+		 * @brief Checks if a particular event is being counted.
+		*/
+		bool available(GLSLPerfEvent _event) const noexcept
+		{
+			return this->index_[static_cast<size_t>(_event)] != -1;
+		};
+
+		/**
+		 * @brief Reads the current value of every counter.
+		 * @param _out Sample to write to.
+		 * @return True on success, false otherwise.
+		*/
+		bool read(GLSLPerfSample& _out) const noexcept;
+
+		GLSLPerfCounters() = default;
+		~GLSLPerfCounters()
+		{
+			this->close();
+		};
+
+		GLSLPerfCounters(const GLSLPerfCounters&) = delete;
+		GLSLPerfCounters& operator=(const GLSLPerfCounters&) = delete;
+
+	private:
+		int group_ = -1;
+		bool hardware_ = false;
+		size_t count_ = 0;
+
+		// File descriptors in group read order
+		std::array<int, glsl_perf_event_count_v> fds_{ -1, -1, -1, -1, -1, -1 };
+
+		// Position of each event in the group read, -1 if unavailable
+		std::array<int, glsl_perf_event_count_v> index_{ -1, -1, -1, -1, -1, -1 };
+	};
+};
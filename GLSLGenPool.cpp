@@ -0,0 +1,56 @@
+#include "GLSLGenPool.hpp"
+
+namespace glsl
+{
+	void GLSLExpressionPool::intern_children(GLSLExpression& _expr)
+	{
+		for_each_param(_expr, [this](GLSLExpression::Parameter& _param)
+			{
+				if (!_param.is_expression() || this->contains(&_param.expr()))
+				{
+					return;
+				};
+
+				// Nodes shared with something else must be left intact
+				auto& _child = _param.expr();
+				_param = this->intern(_child.shared() ? _child.clone() : std::move(_child));
+			});
+	};
+
+	GLSLExpressionPool::UniqueExpression GLSLExpressionPool::intern(GLSLExpression&& _expr)
+	{
+		this->intern_children(_expr);
+
+		// Children are pooled, so their hashes are cached and equal children are the same node.
+		const auto _hash = hash_expression_node(_expr, [this](const GLSLExpression& _child)
+			{
+				return this->hashes_.find(&_child)->second;
+			});
+
+		const auto [_begin, _end] = this->nodes_.equal_range(_hash);
+		for (auto it = _begin; it != _end; ++it)
+		{
+			if (*it->second == _expr)
+			{
+				++this->hits_;
+				return share(it->second);
+			};
+		};
+
+		const auto _node = GLSLExpression::make_unique(std::move(_expr)).release();
+		this->hashes_.insert({ _node, _hash });
+		this->nodes_.insert({ _hash, _node });
+		return share(_node);
+	};
+
+	void GLSLExpressionPool::clear()
+	{
+		for (auto& [_hash, _node] : this->nodes_)
+		{
+			GLSLExpressionDeleter{}(_node);
+		};
+		this->nodes_.clear();
+		this->hashes_.clear();
+		this->hits_ = 0;
+	};
+};
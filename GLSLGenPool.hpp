@@ -0,0 +1,97 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <unordered_map>
+
+namespace glsl
+{
+	/**
+	 * @brief Hash-consing factory for expressions.
+	 *
+	 * Interning an expression returns the pool's node for it: if a structurally equal
+	 * expression was interned before, the existing node is shared instead of allocating a new
+	 * one, so trees built through a pool form a DAG. Children are interned first, which means
+	 * two expressions from the same pool are structurally equal exactly when they are the
+	 * same node.
+	 *
+	 * Returned handles are ordinary UniqueExpressions and can be placed in any Parameter.
+	 * Shared nodes are reference counted and stay alive while any handle to them exists, even
+	 * after the pool is destroyed. They must not be modified, clone() an expression to get a
+	 * private copy before changing it (ie. before resolve_params()).
+	*/
+	struct GLSLExpressionPool
+	{
+	public:
+
+		using UniqueExpression = GLSLExpression::UniqueExpression;
+
+		/**
+		 * @brief Gets the shared node for an expression, adding it if not yet present.
+		 * @param _expr Expression to intern, its children are interned as well.
+		 * @return Handle to the shared node.
+		*/
+		UniqueExpression intern(GLSLExpression&& _expr);
+
+		template <typename T> requires std::constructible_from<GLSLExpression, T&&>
+		UniqueExpression make(T&& _expr)
+		{
+			return this->intern(GLSLExpression(std::forward<T>(_expr)));
+		};
+
+		/**
+		 * @brief Checks if a node belongs to this pool.
+		*/
+		bool contains(const GLSLExpression* _expr) const
+		{
+			return this->hashes_.contains(_expr);
+		};
+
+		/**
+		 * @brief Number of distinct nodes held by the pool.
+		*/
+		size_t size() const noexcept { return this->hashes_.size(); };
+
+		/**
+		 * @brief Number of intern requests answered with an existing node.
+		*/
+		size_t hits() const noexcept { return this->hits_; };
+
+		/**
+		 * @brief Releases the pool's references, nodes still in use stay alive.
+		*/
+		void clear();
+
+		GLSLExpressionPool() = default;
+		~GLSLExpressionPool()
+		{
+			this->clear();
+		};
+
+		GLSLExpressionPool(const GLSLExpressionPool&) = delete;
+		GLSLExpressionPool& operator=(const GLSLExpressionPool&) = delete;
+
+	private:
+
+		/**
+		 * @brief Adds a reference to a node and returns a handle owning it.
+		*/
+		static UniqueExpression share(GLSLExpression* _expr)
+		{
+			++_expr->refs_;
+			return UniqueExpression(_expr);
+		};
+
+		void intern_children(GLSLExpression& _expr);
+
+		// Node hash by address, also the set of nodes owned by the pool
+		std::unordered_map<const GLSLExpression*, size_t> hashes_{};
+
+		// Nodes by hash
+		std::unordered_multimap<size_t, GLSLExpression*> nodes_{};
+
+		size_t hits_ = 0;
+	};
+};
@@ -0,0 +1,612 @@
+#include "GLSLGenPrecision.hpp"
+
+#include <cmath>
+#include <array>
+#include <format>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		using Parameter = GLSLExpression::Parameter;
+
+		constexpr auto infinity_v = std::numeric_limits<double>::infinity();
+
+		// Rounds a variable's bounds may keep growing before they are dropped
+		constexpr size_t widen_after_v = 4;
+
+		/**
+		 * @brief Bounds on a value and the precision it was computed at, empty if never written.
+		*/
+		struct Value
+		{
+			double min = infinity_v;
+			double max = -infinity_v;
+			GLSLPrecision precision = GLSLPrecision::lowp;
+
+			bool empty() const { return this->min > this->max; };
+
+			static Value from(const GLSLValueRange& _range)
+			{
+				return Value{ _range.min, _range.max, _range.precision };
+			};
+			static Value unbounded(GLSLPrecision _precision)
+			{
+				return Value{ -infinity_v, infinity_v, _precision };
+			};
+		};
+
+		Value join(const Value& a, const Value& b)
+		{
+			return Value{ std::min(a.min, b.min), std::max(a.max, b.max), std::max(a.precision, b.precision) };
+		};
+
+		bool is_int(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_int;
+		};
+
+		/**
+		 * @brief Checks if precision qualifiers apply to a type, floats and ints of any size.
+		*/
+		bool has_precision(GLSLType _type)
+		{
+			return is_int(_type) || is_matrix(_type) || is_type_in_category(_type, GLSLGenType::gen_float);
+		};
+
+		/**
+		 * @brief Gets the lowest precision whose range holds the values, GLSL ES's minimum ranges.
+		*/
+		GLSLPrecision range_precision(const Value& _value, bool _int)
+		{
+			if (_value.empty())
+			{
+				return GLSLPrecision::lowp;
+			};
+			const auto _within = [&_value](double _bound)
+			{
+				return _value.min > -_bound && _value.max < _bound;
+			};
+			if (_within((_int) ? 256.0 : 2.0))
+			{
+				return GLSLPrecision::lowp;
+			};
+			if (_within((_int) ? 32768.0 : 16384.0))
+			{
+				return GLSLPrecision::mediump;
+			};
+			return GLSLPrecision::highp;
+		};
+
+		// Multiplies interval bounds, zero times an unbounded side stays zero
+		double multiply_bounds(double a, double b)
+		{
+			return (a == 0.0 || b == 0.0) ? 0.0 : a * b;
+		};
+
+		Value multiply(const Value& a, const Value& b)
+		{
+			const auto _products = std::array
+			{
+				multiply_bounds(a.min, b.min), multiply_bounds(a.min, b.max),
+				multiply_bounds(a.max, b.min), multiply_bounds(a.max, b.max),
+			};
+			const auto [_min, _max] = std::ranges::minmax(_products);
+			return Value{ _min, _max, std::max(a.precision, b.precision) };
+		};
+
+		Value scale(Value _value, double _count)
+		{
+			_value.min = multiply_bounds(_value.min, _count);
+			_value.max = multiply_bounds(_value.max, _count);
+			return _value;
+		};
+
+		struct RangeAnalysis
+		{
+			const GLSLContext* context;
+			const GLSLParams* params;
+			const GLSLPrecisionOptions* options;
+
+			// Joined over every write, sources start out with their range
+			std::map<GLSLVariableID, Value> values{};
+
+			// Raised when an expression reading the variable needs more than its operands have
+			std::map<GLSLVariableID, GLSLPrecision> demands{};
+
+			// What each user function returns
+			std::map<GLSLFunctionID, Value> returns{};
+
+			// Set whenever a value or demand changes during a round
+			bool changed = false;
+
+			// Widening drops growing bounds instead of joining them
+			bool widen = false;
+
+			Value value(GLSLVariableID _id) const
+			{
+				const auto it = this->values.find(_id);
+				return (it != this->values.end()) ? it->second : Value{};
+			};
+
+			/**
+			 * @brief Checks if the analysis may change a variable, builtins and bools keep what they are.
+			*/
+			bool is_inferred(const GLSLVariable& _var) const
+			{
+				return !_var.builtin() && has_precision(_var.type());
+			};
+
+			void write(GLSLVariableID _id, const Value& _value)
+			{
+				auto& _old = this->values[_id];
+				auto _new = join(_old, _value);
+				if (this->widen && !_old.empty())
+				{
+					_new.min = (_new.min < _old.min) ? -infinity_v : _new.min;
+					_new.max = (_new.max > _old.max) ? infinity_v : _new.max;
+				};
+				if (_new.min != _old.min || _new.max != _old.max || _new.precision != _old.precision)
+				{
+					_old = _new;
+					this->changed = true;
+				};
+			};
+
+			/**
+			 * @brief Raises the variables an expression reads directly, or those read by its operands
+			 *	if it reads none. Raising one operand is enough to raise the whole operation.
+			 * @return True if any variable was found to raise.
+			*/
+			bool demand(const GLSLExpression& _expr, GLSLPrecision _precision)
+			{
+				bool _found = false;
+				for_each_param(_expr, [this, _precision, &_found](const Parameter& _param)
+					{
+						if (!_param.is_variable())
+						{
+							return;
+						};
+						// Uniforms are pinned, raising them in one stage only would break linking
+						const auto _var = this->context->find(_param.id());
+						if (!_var || !this->is_inferred(*_var) || _var->uniform())
+						{
+							return;
+						};
+						_found = true;
+						auto& _demand = this->demands[_param.id()];
+						if (_demand < _precision)
+						{
+							_demand = _precision;
+							this->changed = true;
+						};
+					});
+				if (!_found)
+				{
+					for_each_param(_expr, [this, _precision, &_found](const Parameter& _param)
+						{
+							if (_param.is_expression())
+							{
+								_found = this->demand(_param.expr(), _precision) || _found;
+							};
+						});
+				};
+				return _found;
+			};
+
+			Value eval(const Parameter& _param)
+			{
+				if (_param.is_variable())
+				{
+					return this->value(_param.id());
+				}
+				else if (_param.is_literal())
+				{
+					// Literals take the precision of what they are used with
+					const auto& _literal = _param.literal();
+					auto _out = Value{};
+					const auto _count = std::max<size_t>(vec_size(_literal.type()), 1);
+					for (size_t n = 0; n != _count; ++n)
+					{
+						double v = 0.0;
+						switch (_literal.type())
+						{
+						case GLSLType::glsl_bool:
+							v = _literal.arr<bool>()[n];
+							break;
+						case GLSLType::glsl_int:
+							v = _literal.arr<int>()[n];
+							break;
+						case GLSLType::glsl_double:
+						case GLSLType::glsl_dvec2:
+						case GLSLType::glsl_dvec3:
+						case GLSLType::glsl_dvec4:
+							v = _literal.arr<double>()[n];
+							break;
+						default:
+							v = _literal.arr<float>()[n];
+							break;
+						};
+						_out.min = std::min(_out.min, v);
+						_out.max = std::max(_out.max, v);
+					};
+					return _out;
+				}
+				else
+				{
+					return this->eval(_param.expr());
+				};
+			};
+
+			/**
+			 * @brief Gets the values an expression may produce, demanding more precision from the
+			 *	variables it reads if its result needs more than its operands have.
+			*/
+			Value eval(const GLSLExpression& _expr)
+			{
+				auto _operands = GLSLPrecision::lowp;
+				auto _out = this->eval_node(_expr, _operands);
+				if (_out.empty())
+				{
+					return _out;
+				};
+
+				const auto _type = _expr.result_type(*this->context);
+				if (has_precision(_type))
+				{
+					const auto _needed = range_precision(_out, is_int(_type));
+					if (_needed > _operands && this->takes_operand_precision(_expr))
+					{
+						this->demand(_expr, _needed);
+					};
+					_out.precision = std::max(_out.precision, _needed);
+				};
+				return _out;
+			};
+
+			/**
+			 * @brief Checks if an expression is computed at the precision of its operands, user
+			 *	functions return their return type's and texture() its sampler's.
+			*/
+			bool takes_operand_precision(const GLSLExpression& _expr) const
+			{
+				if (_expr.type() != GLSLExpressionType::function_call)
+				{
+					return true;
+				};
+				const auto _function = this->context->find(_expr.get<GLSLExpression::FunctionCall>().function);
+				return _function && _function->builtin() && _function->name() != "texture";
+			};
+
+			Value eval_node(const GLSLExpression& _expr, GLSLPrecision& _operands)
+			{
+				auto& _context = *this->context;
+				auto _args = std::vector<Value>();
+				for_each_param(_expr, [this, &_args, &_operands](const Parameter& _param)
+					{
+						_args.push_back(this->eval(_param));
+						if (!_param.is_literal())
+						{
+							_operands = std::max(_operands, _args.back().precision);
+						};
+					});
+				if (std::ranges::any_of(_args, &Value::empty))
+				{
+					return Value{};
+				};
+
+				switch (_expr.type())
+				{
+				case GLSLExpressionType::identity:
+					[[fallthrough]];
+				case GLSLExpressionType::swizzle:
+					return _args[0];
+
+				case GLSLExpressionType::cast:
+				{
+					// Bools convert to 0 or 1
+					const auto& _cast = _expr.get<GLSLExpression::Cast>();
+					if (_cast.param.type(_context) == GLSLType::glsl_bool || _cast.to_type() == GLSLType::glsl_bool)
+					{
+						return Value{ 0.0, 1.0, _args[0].precision };
+					};
+					return _args[0];
+				};
+
+				case GLSLExpressionType::select:
+					return join(_args[1], _args[2]);
+
+				case GLSLExpressionType::binary_op:
+				{
+					const auto& _op = _expr.get<GLSLExpression::BinaryOp>();
+					const auto& a = _args[0];
+					const auto& b = _args[1];
+					const auto _precision = std::max(a.precision, b.precision);
+					switch (_op.op)
+					{
+					case GLSLBinaryOperator::add:
+						return Value{ a.min + b.min, a.max + b.max, _precision };
+					case GLSLBinaryOperator::sub:
+						return Value{ a.min - b.max, a.max - b.min, _precision };
+					case GLSLBinaryOperator::mult:
+					{
+						// Matrix products sum 4 products per component
+						const auto _lhs = _op.lhs.type(_context);
+						const auto _rhs = _op.rhs.type(_context);
+						const auto _product = multiply(a, b);
+						return (!is_scalar(_lhs) && !is_scalar(_rhs) && (is_matrix(_lhs) || is_matrix(_rhs))) ?
+							scale(_product, 4.0) : _product;
+					};
+					case GLSLBinaryOperator::div:
+					{
+						if (b.min <= 0.0 && b.max >= 0.0)
+						{
+							return Value::unbounded(_precision);
+						};
+						const auto _quotients = std::array{ a.min / b.min, a.min / b.max, a.max / b.min, a.max / b.max };
+						const auto [_min, _max] = std::ranges::minmax(_quotients);
+						return Value{ _min, _max, _precision };
+					};
+					default:
+						// Comparisons
+						return Value{ 0.0, 1.0, GLSLPrecision::lowp };
+					};
+				};
+
+				case GLSLExpressionType::function_call:
+					return this->eval_call(_expr.get<GLSLExpression::FunctionCall>(), _args);
+
+				default:
+					abort();
+					return Value{};
+				};
+			};
+
+			Value eval_call(const GLSLExpression::FunctionCall& _call, std::span<const Value> _args)
+			{
+				auto& _context = *this->context;
+				const auto _function = _context.find(_call.function);
+				if (!_function)
+				{
+					return Value::unbounded(GLSLPrecision::highp);
+				};
+				if (!_function->builtin())
+				{
+					const auto it = this->returns.find(_call.function);
+					return (it != this->returns.end()) ? it->second : Value{};
+				};
+
+				auto _precision = GLSLPrecision::lowp;
+				for (auto& v : _args)
+				{
+					_precision = std::max(_precision, v.precision);
+				};
+
+				const auto _name = _function->name();
+				if (_name == "sin" || _name == "cos")
+				{
+					return Value{ -1.0, 1.0, _precision };
+				}
+				else if (_name == "abs")
+				{
+					return Value{ 0.0, std::max(std::abs(_args[0].min), std::abs(_args[0].max)), _precision };
+				}
+				else if (_name == "dot")
+				{
+					const auto _count = double(vec_size(_call.params[0].type(_context)));
+					return scale(multiply(_args[0], _args[1]), _count);
+				}
+				else if (_name == "pow" && _args[0].min >= 0.0)
+				{
+					// A base within [0, 1] stays within it for positive exponents
+					const auto _bounded = _args[0].max <= 1.0 && _args[1].min > 0.0;
+					return Value{ 0.0, (_bounded) ? 1.0 : infinity_v, _precision };
+				}
+				else if (_name == "texture")
+				{
+					// The result has the sampler's precision, not the coordinates'
+					return Value::from(this->options->texture_range);
+				};
+				return Value::unbounded(_precision);
+			};
+
+			void visit(std::span<const GLSLStatement> _statements, GLSLFunctionID _function)
+			{
+				for (auto& _statement : _statements)
+				{
+					const auto _value = this->eval(_statement.expr);
+					switch (_statement.type)
+					{
+					case GLSLStatementType::declaration:
+						[[fallthrough]];
+					case GLSLStatementType::assignment:
+						this->write(_statement.dest, _value);
+						break;
+
+					case GLSLStatementType::for_loop:
+					{
+						// The induction variable runs from begin up to the bound
+						const auto _begin = double(_statement.loop.begin);
+						auto _index = Value{ std::min(_begin, _value.min), std::max(_begin, _value.max), _value.precision };
+						if (_value.empty())
+						{
+							_index = Value{ _begin, _begin, GLSLPrecision::lowp };
+						};
+						this->write(_statement.dest, _index);
+					};
+					break;
+
+					case GLSLStatementType::return_value:
+					{
+						auto& _old = this->returns[_function];
+						const auto _new = join(_old, _value);
+						if (_new.min != _old.min || _new.max != _old.max || _new.precision != _old.precision)
+						{
+							_old = (this->widen && !_old.empty()) ?
+								Value{ (_new.min < _old.min) ? -infinity_v : _new.min, (_new.max > _old.max) ? infinity_v : _new.max, _new.precision } :
+								_new;
+							this->changed = true;
+						};
+					};
+					break;
+
+					default:
+						break;
+					};
+
+					this->visit(_statement.body, _function);
+					this->visit(_statement.else_body, _function);
+				};
+			};
+
+			void run()
+			{
+				// Sources keep the range they are given, function parameters are unknown
+				for (auto& _var : this->context->variables())
+				{
+					if (_var.builtin() || _var.inout() == GLSLInOut::in || _var.uniform())
+					{
+						const auto it = this->options->sources.find(_var.id());
+						auto _value = (it != this->options->sources.end() && !_var.builtin()) ?
+							Value::from(it->second) : Value::unbounded(GLSLPrecision::highp);
+						if (_var.uniform())
+						{
+							_value.precision = GLSLPrecision::highp;
+						};
+						this->values.insert_or_assign(_var.id(), _value);
+					};
+				};
+				for (auto& _function : this->params->functions)
+				{
+					for (auto _param : _function.params())
+					{
+						this->values.insert_or_assign(_param, Value::unbounded(GLSLPrecision::highp));
+					};
+				};
+
+				// Functions come before their callers
+				this->changed = true;
+				for (size_t _round = 0; this->changed; ++_round)
+				{
+					this->changed = false;
+					this->widen = _round >= widen_after_v;
+					this->visit(this->params->globals, GLSLFunctionID());
+					for (auto& _function : this->params->functions)
+					{
+						this->visit(_function.body(), _function.id());
+					};
+					this->visit(this->params->main_fn.body(), GLSLFunctionID());
+				};
+			};
+
+			/**
+			 * @brief Gets the lowest precision a variable may be declared with.
+			*/
+			GLSLPrecision precision(const GLSLVariable& _var) const
+			{
+				if (_var.uniform())
+				{
+					return GLSLPrecision::highp;
+				};
+				const auto _value = this->value(_var.id());
+				auto _precision = std::max(_value.precision, range_precision(_value, is_int(_var.type())));
+				if (const auto it = this->demands.find(_var.id()); it != this->demands.end())
+				{
+					_precision = std::max(_precision, it->second);
+				};
+				return _precision;
+			};
+		};
+
+		/**
+		 * @brief Picks the most common precision, ties going to the higher one.
+		*/
+		GLSLPrecision most_common(const std::array<size_t, 4>& _counts)
+		{
+			auto _best = GLSLPrecision::highp;
+			for (auto _precision : { GLSLPrecision::mediump, GLSLPrecision::lowp })
+			{
+				if (_counts[size_t(_precision)] > _counts[size_t(_best)])
+				{
+					_best = _precision;
+				};
+			};
+			return _best;
+		};
+	};
+
+	void GLSLPrecisionReport::write(std::ostream& _ostr) const
+	{
+		_ostr << std::format("default float {}, int {}\n", glsl_precision_name(this->float_precision),
+			glsl_precision_name(this->int_precision));
+		_ostr << std::format("{:<24}{:>12}{:>12}  {}\n", "variable", "min", "max", "precision");
+		for (auto& _decision : this->decisions)
+		{
+			_ostr << std::format("{:<24}{:>12}{:>12}  {}\n", _decision.name, _decision.min, _decision.max,
+				glsl_precision_name(_decision.precision));
+		};
+	};
+
+	GLSLPrecisionReport infer_precision(GLSLContext& _context, GLSLParams& _params, const GLSLPrecisionOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		auto _analysis = RangeAnalysis{ &_context, &_params, &_options };
+		_analysis.run();
+
+		auto _report = GLSLPrecisionReport{};
+		auto _floats = std::array<size_t, 4>{};
+		auto _ints = std::array<size_t, 4>{};
+		for (auto& _var : _context.variables())
+		{
+			if (!_analysis.is_inferred(_var))
+			{
+				continue;
+			};
+
+			auto _decision = GLSLPrecisionDecision{};
+			_decision.variable = _var.id();
+			_decision.name = std::string(_var.name());
+			_decision.precision = _analysis.precision(_var);
+
+			const auto _value = _analysis.value(_var.id());
+			if (!_value.empty())
+			{
+				_decision.min = _value.min;
+				_decision.max = _value.max;
+			};
+
+			if (!_var.uniform())
+			{
+				++((is_int(_var.type())) ? _ints : _floats)[size_t(_decision.precision)];
+			};
+			_report.decisions.push_back(std::move(_decision));
+		};
+
+		// Returned values take the default precision of the function's return type
+		_report.float_precision = most_common(_floats);
+		_report.int_precision = most_common(_ints);
+		for (auto& _function : _params.functions)
+		{
+			const auto it = _analysis.returns.find(_function.id());
+			if (it == _analysis.returns.end() || !has_precision(_function.return_type()))
+			{
+				continue;
+			};
+			const auto _int = is_int(_function.return_type());
+			auto& _default = (_int) ? _report.int_precision : _report.float_precision;
+			_default = std::max({ _default, it->second.precision, range_precision(it->second, _int) });
+		};
+
+		_params.float_precision = _report.float_precision;
+		_params.int_precision = _report.int_precision;
+		for (auto& _decision : _report.decisions)
+		{
+			auto& _var = *_context.find(_decision.variable);
+			const auto _default = (is_int(_var.type())) ? _report.int_precision : _report.float_precision;
+			_var.set_precision((_decision.precision == _default && !_var.uniform()) ? GLSLPrecision::none : _decision.precision);
+		};
+		return _report;
+	};
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <map>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+namespace glsl
+{
+	/**
+	 * @brief Bounds on the values a variable holds and the precision they need whatever their range.
+	*/
+	struct GLSLValueRange
+	{
+		// Bounds on every component
+		double min = -std::numeric_limits<double>::infinity();
+		double max = std::numeric_limits<double>::infinity();
+
+		// Least precision the values need, ie. texture coordinates must tell texels apart
+		GLSLPrecision precision = GLSLPrecision::lowp;
+
+		// Color channels within [0, 1], 8 bits are enough
+		static constexpr GLSLValueRange color() { return { 0.0, 1.0, GLSLPrecision::lowp }; };
+
+		// Texture coordinates within [0, 1], mediump tells apart the texels of textures up to 1024 wide
+		static constexpr GLSLValueRange uv() { return { 0.0, 1.0, GLSLPrecision::mediump }; };
+
+		// Components of normalized vectors, ie. normals and directions
+		static constexpr GLSLValueRange normalized() { return { -1.0, 1.0, GLSLPrecision::mediump }; };
+
+		// Integer indices into an array of the given size
+		static constexpr GLSLValueRange index(size_t _count) { return { 0.0, double(_count) - 1.0, GLSLPrecision::lowp }; };
+
+		// Nothing known, always highp
+		static constexpr GLSLValueRange unknown()
+		{
+			return { -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), GLSLPrecision::highp };
+		};
+	};
+
+	/**
+	 * @brief What infer_precision() knows about the values coming into a shader.
+	*/
+	struct GLSLPrecisionOptions
+	{
+		/**
+		 * @brief Values held by inputs and uniforms, anything not listed is GLSLValueRange::unknown().
+		*/
+		std::map<GLSLVariableID, GLSLValueRange> sources{};
+
+		/**
+		 * @brief Values returned by texture(). Colors by default, texture() returns the sampler's
+		 *	precision which is lowp by default in GLSL ES fragment shaders. Use unknown() for
+		 *	float textures.
+		*/
+		GLSLValueRange texture_range = GLSLValueRange::color();
+	};
+
+	struct GLSLPrecisionDecision
+	{
+		GLSLVariableID variable{};
+		std::string name{};
+
+		// Bounds found for every component, infinite if unbounded
+		double min = 0.0;
+		double max = 0.0;
+
+		// Lowest precision holding the variable's values and computing the expressions reading it
+		GLSLPrecision precision = GLSLPrecision::highp;
+	};
+
+	/**
+	 * @brief Precisions chosen by infer_precision().
+	*/
+	struct GLSLPrecisionReport
+	{
+		/**
+		 * @brief One decision per float or int variable that is not a builtin, in ID order.
+		*/
+		std::vector<GLSLPrecisionDecision> decisions{};
+
+		// Default precisions declared for the shader
+		GLSLPrecision float_precision = GLSLPrecision::highp;
+		GLSLPrecision int_precision = GLSLPrecision::highp;
+
+		/**
+		 * @brief Writes the default precisions, then one line per variable with its bounds and precision.
+		*/
+		void write(std::ostream& _ostr) const;
+	};
+
+	/**
+	 * @brief Infers the lowest safe GLSL ES precision of every variable from the ranges of its values.
+	 *
+	 * Value ranges flow from the sources (inputs and uniforms as described by the options,
+	 * literals, builtin functions with bounded results and texture reads) through every
+	 * expression with interval arithmetic. Each write widens its variable's range, writes
+	 * within loops and branches included, until nothing changes. Bounds still growing after
+	 * a few rounds are dropped.
+	 *
+	 * A variable needs the precision whose range holds its values, and at least the precision
+	 * of everything it was computed from. GLSL ES computes an operation at the precision of
+	 * its operands, so when an operation's result needs more than its operands have, the
+	 * variables it reads directly are raised too.
+	 *
+	 * The default float and int precisions become the most common ones among the shader's
+	 * variables, raised if needed to hold what user functions return. Variables on the
+	 * default precision are left unqualified. Uniforms are always declared highp whatever
+	 * their range, as GLSL ES requires them to match across stages and each stage is inferred
+	 * on its own. Builtins and bools are not changed.
+	 *
+	 * Switch the shader to GLSL ES ("params.profile = GLSLProfile::es", version 300) for the
+	 * qualifiers and default precision statements to be meaningful. Auto types must already
+	 * be deduced.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters, gets the default precisions.
+	 * @param _options Source value ranges.
+	 * @return Precision of every variable.
+	*/
+	GLSLPrecisionReport infer_precision(GLSLContext& _context, GLSLParams& _params, const GLSLPrecisionOptions& _options = {});
+};
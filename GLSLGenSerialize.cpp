@@ -0,0 +1,1063 @@
+#include "GLSLGenSerialize.hpp"
+
+#include <ostream>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+namespace glsl
+{
+	namespace
+	{
+		constexpr size_t SECTION_ALIGNMENT = 8;
+
+		// Deepest expression tree and statement nesting accepted, the loader rebuilds both recursively
+		constexpr uint32_t MAX_EXPRESSION_DEPTH = 256;
+		constexpr uint32_t MAX_STATEMENT_DEPTH = 64;
+
+		constexpr size_t align_up(size_t _value, size_t _alignment)
+		{
+			return (_value + _alignment - 1) / _alignment * _alignment;
+		};
+
+		bool is_valid_type(int32_t _type)
+		{
+			return _type >= jc::to_underlying(GLSLType::glsl_auto) &&
+				_type <= jc::to_underlying(GLSLType::glsl_sampler_2D_array);
+		};
+
+		GLSLBinaryLiteralKind literal_kind(GLSLType _type)
+		{
+			switch (_type)
+			{
+			case GLSLType::glsl_bool:
+				return GLSLBinaryLiteralKind::boolean;
+			case GLSLType::glsl_int:
+				return GLSLBinaryLiteralKind::integer;
+			case GLSLType::glsl_float:
+				[[fallthrough]];
+			case GLSLType::glsl_vec2:
+				[[fallthrough]];
+			case GLSLType::glsl_vec3:
+				[[fallthrough]];
+			case GLSLType::glsl_vec4:
+				[[fallthrough]];
+			case GLSLType::glsl_mat4:
+				return GLSLBinaryLiteralKind::floating;
+			case GLSLType::glsl_double:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec2:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec3:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec4:
+				return GLSLBinaryLiteralKind::double_floating;
+			default:
+				return GLSLBinaryLiteralKind::none;
+			};
+		};
+
+		template <typename T>
+		void store_literal_data(std::array<std::byte, 32>& _data, const GLSLLiteral& _literal)
+		{
+			const auto& _arr = _literal.arr<T>();
+			static_assert(sizeof(_arr) <= sizeof(_data));
+			std::memcpy(_data.data(), _arr.data(), sizeof(_arr));
+		};
+
+		template <typename T>
+		GLSLLiteral load_literal_data(GLSLType _type, const std::array<std::byte, 32>& _data)
+		{
+			auto _arr = std::array<T, 4>{};
+			std::memcpy(_arr.data(), _data.data(), sizeof(_arr));
+			return GLSLLiteral(_type, _arr);
+		};
+
+
+
+		/**
+		 * @brief Accumulates the record arrays while walking the IR.
+		*/
+		struct IRWriter
+		{
+			std::vector<char> strings{};
+			std::vector<GLSLBinaryVariable> variables{};
+			std::vector<GLSLBinaryFunction> functions{};
+			std::vector<GLSLBinaryOverload> overloads{};
+			std::vector<GLSLBinaryFunctionParam> function_params{};
+			std::vector<GLSLBinaryLiteral> literals{};
+			std::vector<GLSLBinaryParam> params{};
+			std::vector<GLSLBinaryExpression> expressions{};
+			std::vector<GLSLBinaryStatement> statements{};
+			std::vector<GLSLBinaryStatement> globals{};
+			std::vector<GLSLBinaryBody> bodies{};
+			std::vector<uint32_t> body_params{};
+
+			GLSLBinaryString add_string(std::string_view _str)
+			{
+				const auto _offset = (uint32_t)this->strings.size();
+				this->strings.insert(this->strings.end(), _str.begin(), _str.end());
+				return GLSLBinaryString{ _offset, (uint32_t)_str.size() };
+			};
+
+			uint32_t add_literal(const GLSLLiteral& _literal)
+			{
+				auto _record = GLSLBinaryLiteral{};
+				_record.type = jc::to_underlying(_literal.type());
+				_record.kind = _literal.has_value() ? literal_kind(_literal.type()) : GLSLBinaryLiteralKind::none;
+
+				switch (_record.kind)
+				{
+				case GLSLBinaryLiteralKind::boolean:
+					store_literal_data<bool>(_record.data, _literal);
+					break;
+				case GLSLBinaryLiteralKind::integer:
+					store_literal_data<int>(_record.data, _literal);
+					break;
+				case GLSLBinaryLiteralKind::floating:
+					store_literal_data<float>(_record.data, _literal);
+					break;
+				case GLSLBinaryLiteralKind::double_floating:
+					store_literal_data<double>(_record.data, _literal);
+					break;
+				default:
+					break;
+				};
+
+				this->literals.push_back(_record);
+				return (uint32_t)(this->literals.size() - 1);
+			};
+
+			GLSLBinaryParam add_param(const GLSLExpression::Parameter& _param)
+			{
+				if (_param.is_expression())
+				{
+					return GLSLBinaryParam{ GLSLBinaryParamKind::expression, this->add_expression(_param.expr()) };
+				}
+				else if (_param.is_literal())
+				{
+					return GLSLBinaryParam{ GLSLBinaryParamKind::literal, this->add_literal(_param.literal()) };
+				}
+				else
+				{
+					return GLSLBinaryParam{ GLSLBinaryParamKind::variable, _param.id().get() };
+				};
+			};
+
+			/**
+			 * @brief Writes an expression tree, children are written before their parent.
+			 * @return Index of the written node.
+			*/
+			uint32_t add_expression(const GLSLExpression& _expr)
+			{
+				auto _record = GLSLBinaryExpression{};
+				_record.type = (uint8_t)_expr.type();
+				_record.swizzle = { 255, 255, 255, 255 };
+
+				// Children must be written first, collect the params locally so they stay contiguous.
+				auto _params = std::vector<GLSLBinaryParam>{};
+
+				switch (_expr.type())
+				{
+				case GLSLExpressionType::identity:
+					_params.push_back(this->add_param(_expr.get<GLSLExpression::Identity>().param));
+					break;
+				case GLSLExpressionType::cast:
+				{
+					const auto& _cast = _expr.get<GLSLExpression::Cast>();
+					_record.cast_type = jc::to_underlying(_cast.to_type());
+					_params.push_back(this->add_param(_cast.param));
+				};
+				break;
+				case GLSLExpressionType::function_call:
+				{
+					const auto& _call = _expr.get<GLSLExpression::FunctionCall>();
+					_record.function = _call.function.get();
+					for (auto& _param : _call.params)
+					{
+						_params.push_back(this->add_param(_param));
+					};
+				};
+				break;
+				case GLSLExpressionType::binary_op:
+				{
+					const auto& _op = _expr.get<GLSLExpression::BinaryOp>();
+					_record.op = (uint8_t)_op.op;
+					_params.push_back(this->add_param(_op.lhs));
+					_params.push_back(this->add_param(_op.rhs));
+				};
+				break;
+				case GLSLExpressionType::swizzle:
+				{
+					const auto& _swizzle = _expr.get<GLSLExpression::Swizzle>();
+					_record.swizzle = _swizzle.swizzle_;
+					_params.push_back(this->add_param(_swizzle.what));
+				};
+				break;
+				case GLSLExpressionType::select:
+				{
+					const auto& _select = _expr.get<GLSLExpression::Select>();
+					_params.push_back(this->add_param(_select.condition));
+					_params.push_back(this->add_param(_select.if_true));
+					_params.push_back(this->add_param(_select.if_false));
+				};
+				break;
+				default:
+					abort();
+					break;
+				};
+
+				_record.first_param = (uint32_t)this->params.size();
+				_record.param_count = (uint32_t)_params.size();
+				this->params.insert(this->params.end(), _params.begin(), _params.end());
+
+				this->expressions.push_back(_record);
+				return (uint32_t)(this->expressions.size() - 1);
+			};
+
+			void add_statements(std::vector<GLSLBinaryStatement>& _out, std::span<const GLSLStatement> _statements)
+			{
+				for (auto& _statement : _statements)
+				{
+					auto _record = GLSLBinaryStatement{};
+					_record.type = jc::to_underlying(_statement.type);
+					_record.dest = _statement.dest.get();
+					_record.expr = this->add_expression(_statement.expr);
+
+					const auto _index = _out.size();
+					_out.push_back(_record);
+					if (_statement.type == GLSLStatementType::for_loop || _statement.type == GLSLStatementType::if_else)
+					{
+						this->add_statements(_out, _statement.body);
+						const auto _else = _out.size();
+						this->add_statements(_out, _statement.else_body);
+
+						auto& _nested = _out[_index];
+						_nested.loop_begin = _statement.loop.begin;
+						_nested.loop_step = _statement.loop.step;
+						_nested.loop_size = (uint32_t)(_out.size() - _index - 1);
+						_nested.else_size = (uint32_t)(_out.size() - _else);
+					};
+				};
+			};
+
+			void add_body(const GLSLFunction& _function)
+			{
+				auto _record = GLSLBinaryBody{};
+				_record.function = _function.id().get();
+				_record.name = this->add_string(_function.name());
+				_record.return_type = jc::to_underlying(_function.return_type());
+
+				_record.first_param = (uint32_t)this->body_params.size();
+				_record.param_count = (uint32_t)_function.params().size();
+				for (auto& v : _function.params())
+				{
+					this->body_params.push_back(v.get());
+				};
+
+				_record.first_statement = (uint32_t)this->statements.size();
+				this->add_statements(this->statements, _function.body());
+				_record.statement_count = (uint32_t)(this->statements.size() - _record.first_statement);
+
+				this->bodies.push_back(_record);
+			};
+
+			void add_variable(const GLSLVariable& _var)
+			{
+				auto _record = GLSLBinaryVariable{};
+				_record.id = _var.id().get();
+				_record.name = this->add_string(_var.name());
+				_record.type = jc::to_underlying(_var.type());
+				_record.inout = (uint8_t)_var.inout();
+				_record.builtin = _var.builtin();
+				_record.uniform = _var.uniform();
+				_record.is_const = _var.is_const();
+				_record.precision = (uint8_t)_var.precision();
+				this->variables.push_back(_record);
+			};
+
+			void add_function(const GLSLFunctionDecl& _decl)
+			{
+				auto _record = GLSLBinaryFunction{};
+				_record.id = _decl.id().get();
+				_record.name = this->add_string(_decl.name());
+				_record.builtin = _decl.builtin();
+				_record.first_overload = (uint32_t)this->overloads.size();
+				_record.overload_count = (uint32_t)_decl.overloads().size();
+
+				for (auto& _overload : _decl.overloads())
+				{
+					auto _overloadRecord = GLSLBinaryOverload{};
+					_overloadRecord.return_type = jc::to_underlying(_overload.return_type);
+					_overloadRecord.first_param = (uint32_t)this->function_params.size();
+					_overloadRecord.param_count = (uint32_t)_overload.params.size();
+					_overloadRecord.cost_alu = _overload.cost.alu;
+					_overloadRecord.cost_transcendental = _overload.cost.transcendental;
+					_overloadRecord.cost_texture = _overload.cost.texture;
+					_overloadRecord.cost_per_component = _overload.cost.per_component;
+
+					for (auto& _param : _overload.params)
+					{
+						if (_param.is_generic())
+						{
+							this->function_params.push_back({ 1, jc::to_underlying(_param.get_generic()) });
+						}
+						else
+						{
+							this->function_params.push_back({ 0, jc::to_underlying(_param.get_type()) });
+						};
+					};
+
+					this->overloads.push_back(_overloadRecord);
+				};
+
+				this->functions.push_back(_record);
+			};
+		};
+
+		template <typename T>
+		GLSLBinarySection place_section(size_t& _offset, const std::vector<T>& _records)
+		{
+			_offset = align_up(_offset, SECTION_ALIGNMENT);
+			const auto _section = GLSLBinarySection{ (uint32_t)_offset, (uint32_t)_records.size() };
+			_offset += _records.size() * sizeof(T);
+			return _section;
+		};
+
+		template <typename T>
+		void copy_section(std::vector<std::byte>& _out, GLSLBinarySection _section, const std::vector<T>& _records)
+		{
+			if (!_records.empty())
+			{
+				std::memcpy(_out.data() + _section.offset, _records.data(), _records.size() * sizeof(T));
+			};
+		};
+
+
+
+		template <typename T>
+		bool check_section(const GLSLBinaryHeader& _header, GLSLBinarySection _section)
+		{
+			static_assert(alignof(T) <= SECTION_ALIGNMENT);
+			if (_section.offset % SECTION_ALIGNMENT != 0 || _section.offset < _header.header_size)
+			{
+				return false;
+			};
+			const auto _end = (uint64_t)_section.offset + (uint64_t)_section.count * sizeof(T);
+			return _end <= _header.file_size;
+		};
+
+		bool check_string(const GLSLBinaryHeader& _header, GLSLBinaryString _str)
+		{
+			return (uint64_t)_str.offset + _str.size <= _header.strings.count;
+		};
+
+		bool check_variable_id(std::span<const GLSLBinaryVariable> _variables, uint32_t _id)
+		{
+			const auto it = std::ranges::lower_bound(_variables, _id, {}, &GLSLBinaryVariable::id);
+			return it != _variables.end() && it->id == _id;
+		};
+		bool check_function_id(std::span<const GLSLBinaryFunction> _functions, uint32_t _id)
+		{
+			const auto it = std::ranges::lower_bound(_functions, _id, {}, &GLSLBinaryFunction::id);
+			return it != _functions.end() && it->id == _id;
+		};
+
+		template <typename T>
+		bool is_strictly_sorted_by_id(std::span<const T> _records)
+		{
+			for (size_t n = 0; n != _records.size(); ++n)
+			{
+				if (_records[n].id == 0 || (n != 0 && _records[n - 1].id >= _records[n].id))
+				{
+					return false;
+				};
+			};
+			return true;
+		};
+
+
+
+		/**
+		 * @brief Rebuilds live expressions from a validated buffer.
+		*/
+		struct IRReader
+		{
+			const GLSLBinaryIR& ir;
+
+			GLSLExpression::Parameter make_param(const GLSLBinaryParam& _param) const
+			{
+				switch (_param.kind)
+				{
+				case GLSLBinaryParamKind::variable:
+					return GLSLVariableID(_param.value);
+				case GLSLBinaryParamKind::expression:
+					return GLSLExpression::make_unique(this->make_expression(_param.value));
+				case GLSLBinaryParamKind::literal:
+					return this->make_literal(this->ir.literals()[_param.value]);
+				default:
+					abort();
+					return {};
+				};
+			};
+
+			GLSLLiteral make_literal(const GLSLBinaryLiteral& _literal) const
+			{
+				const auto _type = GLSLType(_literal.type);
+				switch (_literal.kind)
+				{
+				case GLSLBinaryLiteralKind::boolean:
+					return load_literal_data<bool>(_type, _literal.data);
+				case GLSLBinaryLiteralKind::integer:
+					return load_literal_data<int>(_type, _literal.data);
+				case GLSLBinaryLiteralKind::floating:
+					return load_literal_data<float>(_type, _literal.data);
+				case GLSLBinaryLiteralKind::double_floating:
+					return load_literal_data<double>(_type, _literal.data);
+				default:
+					return GLSLLiteral();
+				};
+			};
+
+			GLSLExpression make_expression(uint32_t _index) const
+			{
+				const auto& _record = this->ir.expressions()[_index];
+				const auto _params = this->ir.params().subspan(_record.first_param, _record.param_count);
+
+				switch (GLSLExpressionType(_record.type))
+				{
+				case GLSLExpressionType::identity:
+					return GLSLExpression::Identity(this->make_param(_params[0]));
+				case GLSLExpressionType::cast:
+					return GLSLExpression::Cast(GLSLType(_record.cast_type), this->make_param(_params[0]));
+				case GLSLExpressionType::function_call:
+				{
+					auto _call = GLSLExpression::FunctionCall(GLSLFunctionID(_record.function));
+					for (auto& _param : _params)
+					{
+						_call.add_param(this->make_param(_param));
+					};
+					return _call;
+				};
+				case GLSLExpressionType::binary_op:
+					return GLSLExpression::BinaryOp(GLSLBinaryOperator(_record.op),
+						this->make_param(_params[0]), this->make_param(_params[1]));
+				case GLSLExpressionType::swizzle:
+				{
+					const auto& s = _record.swizzle;
+					return GLSLExpression::Swizzle(this->make_param(_params[0]), s[0], s[1], s[2], s[3]);
+				};
+				case GLSLExpressionType::select:
+					return GLSLExpression::Select(this->make_param(_params[0]),
+						this->make_param(_params[1]), this->make_param(_params[2]));
+				default:
+					abort();
+					return {};
+				};
+			};
+
+			/**
+			 * @brief Rebuilds a validated statement range, loops and branches take their bodies from the records following them.
+			*/
+			std::vector<GLSLStatement> make_statements(std::span<const GLSLBinaryStatement> _records) const
+			{
+				auto _out = std::vector<GLSLStatement>();
+				for (size_t n = 0; n != _records.size(); ++n)
+				{
+					const auto& _record = _records[n];
+					auto& _statement = _out.emplace_back(GLSLStatementType(_record.type));
+					_statement.dest = GLSLVariableID(_record.dest);
+					_statement.expr = this->make_expression(_record.expr);
+
+					if (_statement.type == GLSLStatementType::for_loop || _statement.type == GLSLStatementType::if_else)
+					{
+						const auto _thenSize = _record.loop_size - _record.else_size;
+						_statement.loop.begin = _record.loop_begin;
+						_statement.loop.step = _record.loop_step;
+						_statement.body = this->make_statements(_records.subspan(n + 1, _thenSize));
+						_statement.else_body = this->make_statements(_records.subspan(n + 1 + _thenSize, _record.else_size));
+						n += _record.loop_size;
+					};
+				};
+				return _out;
+			};
+
+			GLSLFunction make_function(const GLSLBinaryBody& _record) const
+			{
+				auto _function = GLSLFunction(std::string(this->ir.str(_record.name)));
+				_function.set_id(GLSLFunctionID(_record.function))
+					.set_return_type(GLSLType(_record.return_type));
+
+				for (auto& v : this->ir.body_params().subspan(_record.first_param, _record.param_count))
+				{
+					_function.add_param(GLSLVariableID(v));
+				};
+				_function.set_body(this->make_statements(this->ir.statements().subspan(_record.first_statement, _record.statement_count)));
+				return _function;
+			};
+		};
+
+		/**
+		 * @brief Type checks restored statements, so a loaded shader can be emitted without asserting.
+		 * @param _returnType Return type of the function holding the statements, void for main and the globals.
+		*/
+		bool check_statement_types(const GLSLContext& _context, std::span<const GLSLStatement> _statements, GLSLType _returnType)
+		{
+			for (auto& v : _statements)
+			{
+				const auto _type = checked_result_type(_context, v.expr);
+				if (_type == GLSLType::glsl_error || _type == GLSLType::glsl_void)
+				{
+					return false;
+				};
+
+				// Reads undeduced variables, deduce_auto() checks it once they are known
+				if (_type != GLSLType::glsl_auto)
+				{
+					bool _good = true;
+					switch (v.type)
+					{
+					case GLSLStatementType::declaration:
+						[[fallthrough]];
+					case GLSLStatementType::assignment:
+					{
+						const auto _destType = _context.type(v.dest);
+						_good = _destType == GLSLType::glsl_auto || is_implicitly_convertible_to(_type, _destType);
+					};
+					break;
+					case GLSLStatementType::return_value:
+						_good = _returnType != GLSLType::glsl_void && is_implicitly_convertible_to(_type, _returnType);
+						break;
+					case GLSLStatementType::for_loop:
+						_good = _type == GLSLType::glsl_int && _context.type(v.dest) == GLSLType::glsl_int;
+						break;
+					case GLSLStatementType::if_else:
+						_good = _type == GLSLType::glsl_bool;
+						break;
+					default:
+						_good = false;
+						break;
+					};
+					if (!_good)
+					{
+						return false;
+					};
+				};
+
+				if (!check_statement_types(_context, v.body, _returnType) ||
+					!check_statement_types(_context, v.else_body, _returnType))
+				{
+					return false;
+				};
+			};
+			return true;
+		};
+	};
+
+
+
+	bool GLSLBinaryIR::validate() const
+	{
+		// Header
+		if (this->data_.size() < sizeof(GLSLBinaryHeader) ||
+			reinterpret_cast<uintptr_t>(this->data_.data()) % SECTION_ALIGNMENT != 0)
+		{
+			return false;
+		};
+
+		const auto& _header = this->header();
+		if (_header.magic != glsl_binary_magic_v ||
+			_header.version_major != glsl_binary_version_major_v ||
+			_header.endian_tag != glsl_binary_endian_tag_v ||
+			_header.header_size != sizeof(GLSLBinaryHeader) ||
+			_header.file_size != this->data_.size() ||
+			_header.glsl_profile > jc::to_underlying(GLSLProfile::es) ||
+			_header.float_precision > jc::to_underlying(GLSLPrecision::highp) ||
+			_header.int_precision > jc::to_underlying(GLSLPrecision::highp))
+		{
+			return false;
+		};
+
+		// Section bounds
+		if (!check_section<char>(_header, _header.strings) ||
+			!check_section<GLSLBinaryVariable>(_header, _header.variables) ||
+			!check_section<GLSLBinaryFunction>(_header, _header.functions) ||
+			!check_section<GLSLBinaryOverload>(_header, _header.overloads) ||
+			!check_section<GLSLBinaryFunctionParam>(_header, _header.function_params) ||
+			!check_section<GLSLBinaryLiteral>(_header, _header.literals) ||
+			!check_section<GLSLBinaryParam>(_header, _header.params) ||
+			!check_section<GLSLBinaryExpression>(_header, _header.expressions) ||
+			!check_section<GLSLBinaryStatement>(_header, _header.statements) ||
+			!check_section<GLSLBinaryStatement>(_header, _header.globals) ||
+			!check_section<GLSLBinaryBody>(_header, _header.bodies) ||
+			!check_section<uint32_t>(_header, _header.body_params))
+		{
+			return false;
+		};
+
+		// Symbols
+		const auto _variables = this->variables();
+		if (!is_strictly_sorted_by_id(_variables))
+		{
+			return false;
+		};
+		for (auto& v : _variables)
+		{
+			if (!check_string(_header, v.name) || !is_valid_type(v.type) ||
+				v.inout > jc::to_underlying(GLSLInOut::out) ||
+				v.precision > jc::to_underlying(GLSLPrecision::highp))
+			{
+				return false;
+			};
+		};
+
+		const auto _functions = this->functions();
+		if (!is_strictly_sorted_by_id(_functions))
+		{
+			return false;
+		};
+		for (auto& v : _functions)
+		{
+			if (!check_string(_header, v.name) ||
+				(uint64_t)v.first_overload + v.overload_count > _header.overloads.count)
+			{
+				return false;
+			};
+		};
+		for (auto& v : this->overloads())
+		{
+			if (!is_valid_type(v.return_type) ||
+				(uint64_t)v.first_param + v.param_count > _header.function_params.count)
+			{
+				return false;
+			};
+		};
+		for (auto& v : this->function_params())
+		{
+			if (v.generic)
+			{
+				if (v.value != jc::to_underlying(GLSLGenType::gen_float) &&
+					v.value != jc::to_underlying(GLSLGenType::gen_double))
+				{
+					return false;
+				};
+			}
+			else if (!is_valid_type(v.value))
+			{
+				return false;
+			};
+		};
+		for (auto& v : this->literals())
+		{
+			// Empty literals load without their type
+			if (!is_valid_type(v.type) ||
+				(v.kind != GLSLBinaryLiteralKind::none && v.kind != literal_kind(GLSLType(v.type))))
+			{
+				return false;
+			};
+		};
+
+		// Expressions, params may only reference nodes that come before their owner and each
+		// node has exactly one owner, either a param or a statement, so every node is a tree
+		const auto _params = this->params();
+		const auto _expressions = this->expressions();
+		auto _uses = std::vector<uint32_t>(_expressions.size());
+		auto _depths = std::vector<uint32_t>(_expressions.size());
+		for (uint32_t n = 0; n != _expressions.size(); ++n)
+		{
+			const auto& _expr = _expressions[n];
+			if ((uint64_t)_expr.first_param + _expr.param_count > _params.size())
+			{
+				return false;
+			};
+
+			uint32_t _expectedParams = 1;
+			switch (GLSLExpressionType(_expr.type))
+			{
+			case GLSLExpressionType::identity:
+				break;
+			case GLSLExpressionType::cast:
+				if (!is_valid_type(_expr.cast_type) || _expr.cast_type == jc::to_underlying(GLSLType::glsl_auto))
+				{
+					return false;
+				};
+				break;
+			case GLSLExpressionType::function_call:
+				if (!check_function_id(_functions, _expr.function))
+				{
+					return false;
+				};
+				_expectedParams = _expr.param_count;
+				break;
+			case GLSLExpressionType::binary_op:
+				if (_expr.op > jc::to_underlying(GLSLBinaryOperator::greater_equal))
+				{
+					return false;
+				};
+				_expectedParams = 2;
+				break;
+			case GLSLExpressionType::swizzle:
+			{
+				// At least one index, no gaps before the 255 terminator
+				bool _ended = false;
+				for (auto& s : _expr.swizzle)
+				{
+					if (s == 255)
+					{
+						_ended = true;
+					}
+					else if (_ended || s > 3)
+					{
+						return false;
+					};
+				};
+				if (_expr.swizzle.front() == 255)
+				{
+					return false;
+				};
+			};
+			break;
+			case GLSLExpressionType::select:
+				_expectedParams = 3;
+				break;
+			default:
+				return false;
+			};
+
+			if (_expr.param_count != _expectedParams)
+			{
+				return false;
+			};
+
+			uint32_t _depth = 1;
+			for (auto& _param : _params.subspan(_expr.first_param, _expr.param_count))
+			{
+				switch (_param.kind)
+				{
+				case GLSLBinaryParamKind::variable:
+					if (!check_variable_id(_variables, _param.value)) { return false; };
+					break;
+				case GLSLBinaryParamKind::expression:
+					if (_param.value >= n || ++_uses[_param.value] != 1) { return false; };
+					_depth = std::max(_depth, _depths[_param.value] + 1);
+					break;
+				case GLSLBinaryParamKind::literal:
+					if (_param.value >= _header.literals.count) { return false; };
+					break;
+				default:
+					return false;
+				};
+			};
+			if (_depth > MAX_EXPRESSION_DEPTH)
+			{
+				return false;
+			};
+			_depths[n] = _depth;
+		};
+
+		// Statements, returns have no destination
+		const auto _checkStatement = [&](const GLSLBinaryStatement& v) -> bool
+		{
+			if (v.expr >= _expressions.size() || ++_uses[v.expr] != 1)
+			{
+				return false;
+			};
+			const auto _nested = GLSLStatementType(v.type) == GLSLStatementType::for_loop ||
+				GLSLStatementType(v.type) == GLSLStatementType::if_else;
+			if ((!_nested && v.loop_size != 0) ||
+				(GLSLStatementType(v.type) != GLSLStatementType::if_else && v.else_size != 0))
+			{
+				return false;
+			};
+			switch (GLSLStatementType(v.type))
+			{
+			case GLSLStatementType::declaration:
+				[[fallthrough]];
+			case GLSLStatementType::assignment:
+				return check_variable_id(_variables, v.dest);
+			case GLSLStatementType::return_value:
+				return true;
+			case GLSLStatementType::for_loop:
+				return v.loop_step != 0 && check_variable_id(_variables, v.dest);
+			case GLSLStatementType::if_else:
+				return v.else_size <= v.loop_size;
+			default:
+				return false;
+			};
+		};
+		if (!std::ranges::all_of(this->statements(), _checkStatement) ||
+			!std::ranges::all_of(this->globals(), _checkStatement) ||
+			!std::ranges::all_of(_uses, [](uint32_t v) { return v == 1; }))
+		{
+			return false;
+		};
+
+		// Loop bodies and branch arms must lie within the range holding their statement and
+		// never return, as GLSLFunctionBuilder guarantees for the passes relying on it
+		const auto _checkLoops = [](const auto& _self, std::span<const GLSLBinaryStatement> _range, uint32_t _depth) -> bool
+		{
+			if (_depth > MAX_STATEMENT_DEPTH)
+			{
+				return false;
+			};
+			for (size_t n = 0; n != _range.size(); ++n)
+			{
+				if (_depth != 1 && GLSLStatementType(_range[n].type) == GLSLStatementType::return_value)
+				{
+					return false;
+				};
+				const auto _size = _range[n].loop_size;
+				if (_size > _range.size() - n - 1)
+				{
+					return false;
+				};
+				const auto _thenSize = _size - _range[n].else_size;
+				if (!_self(_self, _range.subspan(n + 1, _thenSize), _depth + 1) ||
+					!_self(_self, _range.subspan(n + 1 + _thenSize, _range[n].else_size), _depth + 1))
+				{
+					return false;
+				};
+				n += _size;
+			};
+			return true;
+		};
+		if (!_checkLoops(_checkLoops, this->globals(), 1))
+		{
+			return false;
+		};
+
+		// Function bodies, the first one is main
+		const auto _bodies = this->bodies();
+		if (_bodies.empty() || _bodies.front().function != 0)
+		{
+			return false;
+		};
+		for (size_t n = 0; n != _bodies.size(); ++n)
+		{
+			const auto& v = _bodies[n];
+			if (!check_string(_header, v.name) || !is_valid_type(v.return_type) ||
+				(n != 0 && !check_function_id(_functions, v.function)) ||
+				(uint64_t)v.first_param + v.param_count > _header.body_params.count ||
+				(uint64_t)v.first_statement + v.statement_count > _header.statements.count ||
+				!_checkLoops(_checkLoops, this->statements().subspan(v.first_statement, v.statement_count), 1))
+			{
+				return false;
+			};
+			for (auto& _param : this->body_params().subspan(v.first_param, v.param_count))
+			{
+				if (!check_variable_id(_variables, _param))
+				{
+					return false;
+				};
+			};
+		};
+
+		// Calls, a function may only call builtins and functions whose body comes before its
+		// own, see GLSLParams::may_call(). Main is stored first but may call any of them.
+		auto _bodyOf = std::unordered_map<uint32_t, size_t>{};
+		for (size_t n = 1; n != _bodies.size(); ++n)
+		{
+			if (!_bodyOf.try_emplace(_bodies[n].function, n).second)
+			{
+				return false;
+			};
+		};
+		const auto _mayCall = [&](size_t _caller, uint32_t _callee) -> bool
+		{
+			const auto it = std::ranges::lower_bound(_functions, _callee, {}, &GLSLBinaryFunction::id);
+			if (it->builtin != 0)
+			{
+				return true;
+			};
+			const auto _body = _bodyOf.find(_callee);
+			return _body != _bodyOf.end() && (_caller == 0 || _body->second < _caller);
+		};
+		auto _pending = std::vector<uint32_t>{};
+		for (size_t n = 0; n != _bodies.size(); ++n)
+		{
+			for (auto& _statement : this->statements().subspan(_bodies[n].first_statement, _bodies[n].statement_count))
+			{
+				_pending.push_back(_statement.expr);
+				while (!_pending.empty())
+				{
+					const auto& _expr = _expressions[_pending.back()];
+					_pending.pop_back();
+					if (GLSLExpressionType(_expr.type) == GLSLExpressionType::function_call && !_mayCall(n, _expr.function))
+					{
+						return false;
+					};
+					for (auto& _param : _params.subspan(_expr.first_param, _expr.param_count))
+					{
+						if (_param.kind == GLSLBinaryParamKind::expression)
+						{
+							_pending.push_back(_param.value);
+						};
+					};
+				};
+			};
+		};
+
+		return true;
+	};
+
+
+
+	std::vector<std::byte> serialize_ir(const GLSLContext& _context, const GLSLParams& _params)
+	{
+		auto _writer = IRWriter();
+
+		// Variables are stored in ID order by the context
+		for (auto& v : _context.variables())
+		{
+			_writer.add_variable(v);
+		};
+
+		// Functions are split by builtin-ness in the context, merge them back into ID order
+		auto _functions = std::vector<const GLSLFunctionDecl*>{};
+		for (auto& v : _context.functions(true)) { _functions.push_back(&v); };
+		for (auto& v : _context.functions(false)) { _functions.push_back(&v); };
+		std::ranges::sort(_functions, {}, [](const GLSLFunctionDecl* v) { return v->id(); });
+		for (auto& v : _functions)
+		{
+			_writer.add_function(*v);
+		};
+
+		_writer.add_statements(_writer.globals, _params.globals);
+		_writer.add_body(_params.main_fn);
+		for (auto& v : _params.functions)
+		{
+			_writer.add_body(v);
+		};
+
+		auto _header = GLSLBinaryHeader{};
+		_header.magic = glsl_binary_magic_v;
+		_header.version_major = glsl_binary_version_major_v;
+		_header.version_minor = glsl_binary_version_minor_v;
+		_header.endian_tag = glsl_binary_endian_tag_v;
+		_header.header_size = sizeof(GLSLBinaryHeader);
+		_header.glsl_version = _params.version;
+		_header.glsl_profile = (uint8_t)_params.profile;
+		_header.float_precision = (uint8_t)_params.float_precision;
+		_header.int_precision = (uint8_t)_params.int_precision;
+
+		// Lay out the sections
+		size_t _offset = sizeof(GLSLBinaryHeader);
+		_header.strings = place_section(_offset, _writer.strings);
+		_header.variables = place_section(_offset, _writer.variables);
+		_header.functions = place_section(_offset, _writer.functions);
+		_header.overloads = place_section(_offset, _writer.overloads);
+		_header.function_params = place_section(_offset, _writer.function_params);
+		_header.literals = place_section(_offset, _writer.literals);
+		_header.params = place_section(_offset, _writer.params);
+		_header.expressions = place_section(_offset, _writer.expressions);
+		_header.statements = place_section(_offset, _writer.statements);
+		_header.globals = place_section(_offset, _writer.globals);
+		_header.bodies = place_section(_offset, _writer.bodies);
+		_header.body_params = place_section(_offset, _writer.body_params);
+		_offset = align_up(_offset, SECTION_ALIGNMENT);
+		_header.file_size = (uint32_t)_offset;
+
+		auto _out = std::vector<std::byte>(_offset, std::byte{ 0 });
+		std::memcpy(_out.data(), &_header, sizeof(_header));
+		copy_section(_out, _header.strings, _writer.strings);
+		copy_section(_out, _header.variables, _writer.variables);
+		copy_section(_out, _header.functions, _writer.functions);
+		copy_section(_out, _header.overloads, _writer.overloads);
+		copy_section(_out, _header.function_params, _writer.function_params);
+		copy_section(_out, _header.literals, _writer.literals);
+		copy_section(_out, _header.params, _writer.params);
+		copy_section(_out, _header.expressions, _writer.expressions);
+		copy_section(_out, _header.statements, _writer.statements);
+		copy_section(_out, _header.globals, _writer.globals);
+		copy_section(_out, _header.bodies, _writer.bodies);
+		copy_section(_out, _header.body_params, _writer.body_params);
+		return _out;
+	};
+
+	bool write_ir(std::ostream& _ostr, const GLSLContext& _context, const GLSLParams& _params)
+	{
+		const auto _data = serialize_ir(_context, _params);
+		_ostr.write(reinterpret_cast<const char*>(_data.data()), _data.size());
+		return _ostr.good();
+	};
+
+	bool deserialize_ir(const GLSLBinaryIR& _ir, GLSLContext& _context, GLSLParams& _params)
+	{
+		if (!_ir.validate())
+		{
+			return false;
+		};
+
+		// Restored aside and only handed over once every statement type checks
+		auto _restored = GLSLContext();
+		for (auto& v : _ir.variables())
+		{
+			auto _var = GLSLVariable(GLSLVariableID(v.id), std::string(_ir.str(v.name)), GLSLType(v.type));
+			_var.set_inout(GLSLInOut(v.inout))
+				.set_builtin(v.builtin != 0)
+				.set_uniform(v.uniform != 0)
+				.set_const(v.is_const != 0)
+				.set_precision(GLSLPrecision(v.precision));
+			_restored.restore_variable(std::move(_var));
+		};
+
+		const auto _overloads = _ir.overloads();
+		const auto _functionParams = _ir.function_params();
+		for (auto& v : _ir.functions())
+		{
+			auto _decl = GLSLFunctionDecl(GLSLFunctionID(v.id), std::string(_ir.str(v.name)));
+			_decl.set_builtin(v.builtin != 0);
+
+			for (auto& _overload : _overloads.subspan(v.first_overload, v.overload_count))
+			{
+				auto _params = std::vector<GLSLFunctionParameter>{};
+				for (auto& _param : _functionParams.subspan(_overload.first_param, _overload.param_count))
+				{
+					if (_param.generic)
+					{
+						_params.push_back(GLSLFunctionParameter(GLSLGenType(_param.value)));
+					}
+					else
+					{
+						_params.push_back(GLSLFunctionParameter(GLSLType(_param.value)));
+					};
+				};
+				_decl.add_overload(GLSLType(_overload.return_type), std::span<const GLSLFunctionParameter>(_params))
+					.set_cost({ _overload.cost_alu, _overload.cost_transcendental, _overload.cost_texture, _overload.cost_per_component != 0 });
+			};
+
+			_restored.restore_function(std::move(_decl));
+		};
+
+		const auto _reader = IRReader{ _ir };
+		auto _globals = _reader.make_statements(_ir.globals());
+
+		const auto _bodies = _ir.bodies();
+		auto _main = _reader.make_function(_bodies.front());
+		auto _functions = std::vector<GLSLFunction>{};
+		for (auto& v : _bodies.subspan(1))
+		{
+			_functions.push_back(_reader.make_function(v));
+		};
+
+		if (!check_statement_types(_restored, _globals, GLSLType::glsl_void) ||
+			!check_statement_types(_restored, _main.body(), GLSLType::glsl_void) ||
+			!std::ranges::all_of(_functions, [&_restored](const GLSLFunction& v)
+				{
+					return check_statement_types(_restored, v.body(), v.return_type());
+				}))
+		{
+			return false;
+		};
+
+		_context = std::move(_restored);
+		_params.version = _ir.glsl_version();
+		_params.profile = GLSLProfile(_ir.header().glsl_profile);
+		_params.float_precision = GLSLPrecision(_ir.header().float_precision);
+		_params.int_precision = GLSLPrecision(_ir.header().int_precision);
+		_params.globals = std::move(_globals);
+		_params.main_fn = std::move(_main);
+		_params.functions = std::move(_functions);
+		return true;
+	};
+};
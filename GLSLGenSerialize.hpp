@@ -0,0 +1,309 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+namespace glsl
+{
+	/*
+		Binary IR layout
+
+		The file is a single header followed by flat arrays of fixed size records. Every
+		reference inside the file is either a byte offset from the start of the file or an
+		index into one of the record arrays, so a buffer can be mmap-ed anywhere and read
+		in place. Sections are 8 byte aligned.
+
+		Expression nodes are written children first, a node may only reference nodes with
+		a lower index. This keeps the trees acyclic and lets the loader build them bottom up.
+
+		Loop bodies and branch arms are written right after their statement, which records
+		how many of the following statements belong to it. A branch's else arm comes last.
+	*/
+
+	/**
+	 * @brief Magic bytes at the start of every binary IR file.
+	*/
+	constexpr std::array<char, 8> glsl_binary_magic_v{ 'G', 'L', 'S', 'L', 'I', 'R', '\0', '\0' };
+
+	/**
+	 * @brief Format version, files with a different major version are rejected.
+	*/
+	constexpr uint16_t glsl_binary_version_major_v = 6;
+	constexpr uint16_t glsl_binary_version_minor_v = 0;
+
+	/**
+	 * @brief Written in native byte order, used to reject files from the other endianness.
+	*/
+	constexpr uint16_t glsl_binary_endian_tag_v = 0x0102;
+
+	struct GLSLBinaryString
+	{
+		// Byte offset of the first character within the strings section.
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	struct GLSLBinarySection
+	{
+		// Byte offset from the start of the file.
+		uint32_t offset;
+		// Number of records in the section.
+		uint32_t count;
+	};
+
+	struct GLSLBinaryHeader
+	{
+		std::array<char, 8> magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		uint16_t endian_tag;
+		uint16_t header_size;
+		uint32_t file_size;
+
+		// GLSL "#version" value.
+		int32_t glsl_version;
+
+		// GLSLProfile, then the GLSL ES default GLSLPrecision for floats and ints.
+		uint8_t glsl_profile;
+		uint8_t float_precision;
+		uint8_t int_precision;
+		uint8_t reserved;
+
+		GLSLBinarySection strings;
+		GLSLBinarySection variables;
+		GLSLBinarySection functions;
+		GLSLBinarySection overloads;
+		GLSLBinarySection function_params;
+		GLSLBinarySection literals;
+		GLSLBinarySection params;
+		GLSLBinarySection expressions;
+		GLSLBinarySection statements;
+		GLSLBinarySection globals;
+		GLSLBinarySection bodies;
+		GLSLBinarySection body_params;
+	};
+
+	struct GLSLBinaryVariable
+	{
+		uint32_t id;
+		GLSLBinaryString name;
+		int32_t type;
+		uint8_t inout;
+		uint8_t builtin;
+		uint8_t uniform;
+		uint8_t is_const;
+		uint8_t precision;
+		uint8_t reserved[3];
+	};
+
+	struct GLSLBinaryFunction
+	{
+		uint32_t id;
+		GLSLBinaryString name;
+		uint32_t first_overload;
+		uint32_t overload_count;
+		uint32_t builtin;
+	};
+
+	struct GLSLBinaryOverload
+	{
+		int32_t return_type;
+		uint32_t first_param;
+		uint32_t param_count;
+
+		// GLSLFunctionCost
+		uint32_t cost_alu;
+		uint32_t cost_transcendental;
+		uint32_t cost_texture;
+		uint32_t cost_per_component;
+	};
+
+	struct GLSLBinaryFunctionParam
+	{
+		// Non-zero if "value" is a GLSLGenType instead of a GLSLType.
+		uint32_t generic;
+		int32_t value;
+	};
+
+	enum class GLSLBinaryLiteralKind : uint32_t
+	{
+		none = 0,
+		boolean,
+		integer,
+		floating,
+		double_floating,
+	};
+
+	struct GLSLBinaryLiteral
+	{
+		int32_t type;
+		GLSLBinaryLiteralKind kind;
+		// Raw component storage, interpreted according to "kind".
+		std::array<std::byte, 32> data;
+	};
+
+	enum class GLSLBinaryParamKind : uint32_t
+	{
+		variable = 0,
+		expression,
+		literal,
+	};
+
+	struct GLSLBinaryParam
+	{
+		GLSLBinaryParamKind kind;
+		// Variable ID, expression node index or literal index depending on "kind".
+		uint32_t value;
+	};
+
+	struct GLSLBinaryExpression
+	{
+		// GLSLExpressionType
+		uint8_t type;
+		// GLSLBinaryOperator for binary ops.
+		uint8_t op;
+		std::array<uint8_t, 4> swizzle;
+		uint16_t reserved;
+		// Cast target type.
+		int32_t cast_type;
+		// Called function ID.
+		uint32_t function;
+		uint32_t first_param;
+		uint32_t param_count;
+	};
+
+	struct GLSLBinaryStatement
+	{
+		uint32_t type;
+		uint32_t dest;
+		// Index of the root expression node.
+		uint32_t expr;
+
+		// Loop header, only used by loops.
+		int32_t loop_begin;
+		int32_t loop_step;
+		// Number of statements following a loop or branch that make up its body, nested bodies included.
+		uint32_t loop_size;
+		// Number of those statements, at the end, forming a branch's else arm.
+		uint32_t else_size;
+	};
+
+	/**
+	 * @brief A function definition, the first body is always main.
+	*/
+	struct GLSLBinaryBody
+	{
+		// Declaration ID, 0 for main.
+		uint32_t function;
+		GLSLBinaryString name;
+		int32_t return_type;
+		// Range within the body params section, each entry is a variable ID.
+		uint32_t first_param;
+		uint32_t param_count;
+		// Range within the statements section.
+		uint32_t first_statement;
+		uint32_t statement_count;
+	};
+
+	/**
+	 * @brief Read-only view over a binary IR buffer.
+	 *
+	 * Records are read in place, nothing is copied. The buffer must outlive the view and
+	 * validate() must return true before any of the accessors are used.
+	*/
+	struct GLSLBinaryIR
+	{
+	public:
+
+		/**
+		 * @brief Checks the header, section bounds and every cross reference in the buffer.
+		 *
+		 * Expressions must form trees, each node used by exactly one param or statement, and
+		 * trees and nested statements are limited in depth so loading stays bounded. Functions
+		 * may only call builtins and functions whose body is stored before their own.
+		 *
+		 * @return True if the buffer can be safely read, false otherwise.
+		*/
+		bool validate() const;
+
+		const GLSLBinaryHeader& header() const
+		{
+			return *reinterpret_cast<const GLSLBinaryHeader*>(this->data_.data());
+		};
+
+		int glsl_version() const { return this->header().glsl_version; };
+
+		std::string_view str(GLSLBinaryString _str) const
+		{
+			const auto _strings = this->header().strings;
+			return std::string_view(reinterpret_cast<const char*>(this->data_.data()) + _strings.offset + _str.offset, _str.size);
+		};
+
+		std::span<const GLSLBinaryVariable> variables() const { return this->section<GLSLBinaryVariable>(this->header().variables); };
+		std::span<const GLSLBinaryFunction> functions() const { return this->section<GLSLBinaryFunction>(this->header().functions); };
+		std::span<const GLSLBinaryOverload> overloads() const { return this->section<GLSLBinaryOverload>(this->header().overloads); };
+		std::span<const GLSLBinaryFunctionParam> function_params() const { return this->section<GLSLBinaryFunctionParam>(this->header().function_params); };
+		std::span<const GLSLBinaryLiteral> literals() const { return this->section<GLSLBinaryLiteral>(this->header().literals); };
+		std::span<const GLSLBinaryParam> params() const { return this->section<GLSLBinaryParam>(this->header().params); };
+		std::span<const GLSLBinaryExpression> expressions() const { return this->section<GLSLBinaryExpression>(this->header().expressions); };
+		std::span<const GLSLBinaryStatement> statements() const { return this->section<GLSLBinaryStatement>(this->header().statements); };
+		std::span<const GLSLBinaryStatement> globals() const { return this->section<GLSLBinaryStatement>(this->header().globals); };
+		std::span<const GLSLBinaryBody> bodies() const { return this->section<GLSLBinaryBody>(this->header().bodies); };
+		std::span<const uint32_t> body_params() const { return this->section<uint32_t>(this->header().body_params); };
+
+		std::span<const std::byte> data() const { return this->data_; };
+
+		explicit GLSLBinaryIR(std::span<const std::byte> _data) :
+			data_(_data)
+		{};
+
+	private:
+
+		template <typename T>
+		std::span<const T> section(GLSLBinarySection _section) const
+		{
+			return std::span<const T>(reinterpret_cast<const T*>(this->data_.data() + _section.offset), _section.count);
+		};
+
+		std::span<const std::byte> data_;
+	};
+
+	/**
+	 * @brief Serializes a context and its shader parameters into the binary IR format.
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters, globals and every function body are written.
+	 * @return Binary IR buffer.
+	*/
+	std::vector<std::byte> serialize_ir(const GLSLContext& _context, const GLSLParams& _params);
+
+	/**
+	 * @brief Writes a context and its shader parameters as binary IR.
+	 * @param _ostr Output stream, should be opened in binary mode.
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	 * @return True if the stream is still good after writing, false otherwise.
+	*/
+	bool write_ir(std::ostream& _ostr, const GLSLContext& _context, const GLSLParams& _params);
+
+	/**
+	 * @brief Rebuilds a context and shader parameters from binary IR.
+	 *
+	 * The buffer is validated and every statement type checked before anything is added to
+	 * the context, so loaded IR can be emitted without asserting.
+	 *
+	 * @param _ir Binary IR view.
+	 * @param _context Context to restore the symbols into, replaced on success so it should be empty.
+	 * @param _params Parameters to restore the globals and functions into.
+	 * @return True on success, false if the buffer failed validation or holds ill-typed statements.
+	*/
+	bool deserialize_ir(const GLSLBinaryIR& _ir, GLSLContext& _context, GLSLParams& _params);
+};
@@ -0,0 +1,696 @@
+#include "GLSLGenSimplify.hpp"
+
+#include <cmath>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+
+namespace glsl
+{
+	namespace
+	{
+		using Parameter = GLSLExpression::Parameter;
+
+		/**
+		 * @brief Gets the type of a scalar, vector or matrix's components.
+		*/
+		GLSLType component_type(GLSLType _type)
+		{
+			if (is_matrix(_type))
+			{
+				return GLSLType::glsl_float;
+			};
+			return (is_vector(_type)) ? element_type(_type) : _type;
+		};
+
+		bool is_int(GLSLType _type)
+		{
+			return component_type(_type) == GLSLType::glsl_int;
+		};
+
+		/**
+		 * @brief Checks a predicate against every component of a numeric scalar or vector literal.
+		 * @param _fn Invoked with each component converted to a double, which keeps float values and signs.
+		 * @return True if every component passed, false if one did not or the literal is not numeric.
+		*/
+		template <typename FnT>
+		bool all_components(const GLSLLiteral& _literal, FnT&& _fn)
+		{
+			const auto _type = _literal.type();
+			if (!is_scalar(_type) && !is_vector(_type))
+			{
+				return false;
+			};
+
+			const auto _check = [&_fn, _count = vec_size(_type)](const auto& _parts)
+			{
+				return std::all_of(_parts.begin(), _parts.begin() + _count, [&_fn](auto v) { return _fn(double(v)); });
+			};
+			switch (component_type(_type))
+			{
+			case GLSLType::glsl_int:
+				return _check(_literal.arr<int>());
+			case GLSLType::glsl_float:
+				return _check(_literal.arr<float>());
+			case GLSLType::glsl_double:
+				return _check(_literal.arr<double>());
+			default:
+				return false;
+			};
+		};
+
+		/**
+		 * @brief Checks if a parameter is a literal with every component equal to a value, either zero matches 0.
+		*/
+		bool is_value(const Parameter& _param, double _value)
+		{
+			return _param.is_literal() && all_components(_param.literal(), [_value](double v) { return v == _value; });
+		};
+
+		/**
+		 * @brief Checks if a parameter is a literal zero, every component of the given sign.
+		*/
+		bool is_zero(const Parameter& _param, bool _negative)
+		{
+			return _param.is_literal() && all_components(_param.literal(), [_negative](double v)
+				{
+					return v == 0.0 && std::signbit(v) == _negative;
+				});
+		};
+
+		/**
+		 * @brief Builds a literal of the same type, each component mapped through a function.
+		 * @param _fn Invoked with each component, returns its new value of the same type.
+		*/
+		template <typename FnT>
+		GLSLLiteral map_components(const GLSLLiteral& _literal, FnT&& _fn)
+		{
+			const auto _map = [&_literal, &_fn](auto _parts)
+			{
+				for (size_t n = 0; n != vec_size(_literal.type()); ++n)
+				{
+					_parts[n] = _fn(_parts[n]);
+				};
+				return GLSLLiteral(_literal.type(), _parts);
+			};
+			switch (component_type(_literal.type()))
+			{
+			case GLSLType::glsl_int:
+				return _map(_literal.arr<int>());
+			case GLSLType::glsl_float:
+				return _map(_literal.arr<float>());
+			case GLSLType::glsl_double:
+				return _map(_literal.arr<double>());
+			default:
+				abort();
+				return GLSLLiteral();
+			};
+		};
+
+		/**
+		 * @brief Checks if a parameter calls a user function, which may write globals or outputs.
+		*/
+		bool calls_user_functions(const GLSLContext& _context, const Parameter& _param)
+		{
+			return _param.is_expression() && glsl::calls_user_functions(_context, _param.expr());
+		};
+
+		GLSLExpression::BinaryOp* as_binary(Parameter& _param, GLSLBinaryOperator _op)
+		{
+			if (!_param.is_expression() || _param.expr().type() != GLSLExpressionType::binary_op)
+			{
+				return nullptr;
+			};
+			auto& _binary = _param.expr().get<GLSLExpression::BinaryOp>();
+			return (_binary.op == _op) ? &_binary : nullptr;
+		};
+
+		/**
+		 * @brief Gets y if a parameter is the negation "0 - y", the IR has no unary minus.
+		*/
+		Parameter* negated(Parameter& _param)
+		{
+			const auto _op = as_binary(_param, GLSLBinaryOperator::sub);
+			return (_op && is_value(_op->lhs, 0.0)) ? &_op->rhs : nullptr;
+		};
+
+		/**
+		 * @brief Takes an operand out of a child node, copied if the child is shared.
+		*/
+		Parameter take(const Parameter& _child, Parameter& _operand)
+		{
+			return (_child.expr().shared()) ? _operand.clone() : std::move(_operand);
+		};
+
+		/**
+		 * @brief Replaces a node with one of its own operands, or with anything else.
+		*/
+		void replace(Parameter& _node, Parameter&& _with)
+		{
+			auto _value = std::move(_with);
+			_node = std::move(_value);
+		};
+
+		void replace(Parameter& _node, GLSLExpression::BinaryOp&& _with)
+		{
+			replace(_node, Parameter(GLSLExpression::make_unique(std::move(_with))));
+		};
+
+
+
+		// x * 1 and 1 * x, exact
+		bool mult_one(const GLSLContext& _context, Parameter& _node, bool)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::mult);
+			if (!_op)
+			{
+				return false;
+			};
+
+			// Dropping the 1 must not change the result type, ie. float * vec3(1.0)
+			const auto _type = _node.type(_context);
+			if (is_value(_op->rhs, 1.0) && _op->lhs.type(_context) == _type)
+			{
+				replace(_node, std::move(_op->lhs));
+				return true;
+			};
+			if (is_value(_op->lhs, 1.0) && _op->rhs.type(_context) == _type)
+			{
+				replace(_node, std::move(_op->rhs));
+				return true;
+			};
+			return false;
+		};
+
+		// x + 0 and 0 + x, exact for ints and -0.0, x + 0.0 turns a -0.0 into 0.0
+		bool add_zero(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::add);
+			if (!_op)
+			{
+				return false;
+			};
+
+			const auto _type = _node.type(_context);
+			const auto _dropped = [_relaxed, _int = is_int(_type)](const Parameter& v)
+			{
+				return is_zero(v, true) || (is_zero(v, false) && (_int || _relaxed));
+			};
+			if (_dropped(_op->rhs) && _op->lhs.type(_context) == _type)
+			{
+				replace(_node, std::move(_op->lhs));
+				return true;
+			};
+			if (_dropped(_op->lhs) && _op->rhs.type(_context) == _type)
+			{
+				replace(_node, std::move(_op->rhs));
+				return true;
+			};
+			return false;
+		};
+
+		// x - 0, exact for ints and 0.0, x - -0.0 turns a -0.0 into 0.0
+		bool sub_zero(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::sub);
+			if (!_op || _op->lhs.type(_context) != _node.type(_context))
+			{
+				return false;
+			};
+			if (is_zero(_op->rhs, false) || (is_zero(_op->rhs, true) && _relaxed))
+			{
+				replace(_node, std::move(_op->lhs));
+				return true;
+			};
+			return false;
+		};
+
+		// x / 1, exact
+		bool div_one(const GLSLContext& _context, Parameter& _node, bool)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::div);
+			if (!_op || !is_value(_op->rhs, 1.0) || _op->lhs.type(_context) != _node.type(_context))
+			{
+				return false;
+			};
+			replace(_node, std::move(_op->lhs));
+			return true;
+		};
+
+		// x * 0 and 0 * x, ints only as inf * 0.0 and NaN * 0.0 are NaN
+		bool mult_zero(const GLSLContext& _context, Parameter& _node, bool)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::mult);
+			if (!_op || _node.type(_context) != GLSLType::glsl_int)
+			{
+				return false;
+			};
+			if ((is_value(_op->lhs, 0.0) && !calls_user_functions(_context, _op->rhs)) ||
+				(is_value(_op->rhs, 0.0) && !calls_user_functions(_context, _op->lhs)))
+			{
+				replace(_node, Parameter(GLSLLiteral(0)));
+				return true;
+			};
+			return false;
+		};
+
+		/**
+		 * x / c into x * (1 / c) for float and double constants. Exact if c is a power of two with
+		 * a normal reciprocal, otherwise rounded twice, still within GLSL's 2.5 ULP for division.
+		*/
+		bool div_constant(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::div);
+			if (!_op || !_op->rhs.is_literal() || is_int(_node.type(_context)))
+			{
+				return false;
+			};
+
+			const auto& _divisor = _op->rhs.literal();
+			const auto _float = component_type(_divisor.type()) == GLSLType::glsl_float;
+			const auto _invertible = all_components(_divisor, [_float, _relaxed](double v)
+				{
+					const auto _reciprocal = (_float) ? double(1.0f / float(v)) : 1.0 / v;
+					if (!std::isfinite(v) || v == 0.0 || !std::isnormal(_reciprocal))
+					{
+						return false;
+					};
+					int _exponent = 0;
+					return _relaxed || std::abs(std::frexp(v, &_exponent)) == 0.5;
+				});
+			if (!_invertible)
+			{
+				return false;
+			};
+
+			_op->rhs = map_components(_divisor, [](auto v) { return decltype(v)(1) / v; });
+			_op->op = GLSLBinaryOperator::mult;
+			return true;
+		};
+
+		bool is_builtin_call(const GLSLContext& _context, const Parameter& _param, std::string_view _name, size_t _params)
+		{
+			if (!_param.is_expression() || _param.expr().type() != GLSLExpressionType::function_call)
+			{
+				return false;
+			};
+			const auto& _call = _param.expr().get<GLSLExpression::FunctionCall>();
+			const auto _function = _context.find(_call.function);
+			return _function && _function->builtin() && _function->name() == _name && _call.params.size() == _params;
+		};
+
+		/**
+		 * pow(x, 2.0) into x * x and pow(x, 1.0) into x. Both are at least as precise as pow(),
+		 * which is also undefined for x < 0, though not computed the same way.
+		 * Only variables and literals are squared, an expression would be evaluated twice.
+		*/
+		bool pow_constant(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			if (!_relaxed || !is_builtin_call(_context, _node, "pow", 2))
+			{
+				return false;
+			};
+
+			auto& _params = _node.expr().get<GLSLExpression::FunctionCall>().params;
+			if (is_value(_params[1], 1.0) && _params[0].type(_context) == _node.type(_context))
+			{
+				replace(_node, std::move(_params[0]));
+				return true;
+			};
+			if (is_value(_params[1], 2.0) && !_params[0].is_expression())
+			{
+				auto _base = std::move(_params[0]);
+				auto _copy = _base.clone();
+				replace(_node, GLSLExpression::BinaryOp(GLSLBinaryOperator::mult, std::move(_base), std::move(_copy)));
+				return true;
+			};
+			return false;
+		};
+
+		// 0 - c into -c, exact unless c has a zero component as 0.0 - 0.0 is 0.0
+		bool negate_literal(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::sub);
+			if (!_op || !is_value(_op->lhs, 0.0) || !_op->rhs.is_literal() || _op->rhs.type(_context) != _node.type(_context))
+			{
+				return false;
+			};
+
+			const auto& _literal = _op->rhs.literal();
+			if (!_relaxed && !is_int(_literal.type()) && !all_components(_literal, [](double v) { return v != 0.0; }))
+			{
+				return false;
+			};
+
+			// Ints wrap like the subtraction would instead of overflowing
+			auto _negated = map_components(_literal, [](auto v)
+				{
+					if constexpr (std::is_same_v<decltype(v), int>)
+					{
+						return int(0u - unsigned(v));
+					}
+					else
+					{
+						return -v;
+					};
+				});
+			replace(_node, Parameter(std::move(_negated)));
+			return true;
+		};
+
+		/**
+		 * Negations cancelling out or turning into the opposite operation. These move where a zero's
+		 * sign comes from, exact for ints only.
+		 *	0 - (0 - x) into x
+		 *	a - (0 - b) into a + b
+		 *	a + (0 - b) and (0 - b) + a into a - b
+		 *	(0 - a) * (0 - b) into a * b, same for division
+		 *	(0 - a) * c into a * -c for a negative literal c, same for division and c * (0 - a)
+		*/
+		bool fold_negation(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			if (!_node.is_expression() || _node.expr().type() != GLSLExpressionType::binary_op ||
+				!(_relaxed || is_int(_node.type(_context))))
+			{
+				return false;
+			};
+
+			const auto _type = _node.type(_context);
+			auto& _op = _node.expr().get<GLSLExpression::BinaryOp>();
+
+			// Unwrapping "0 - y" must not change its type, ie. vec3(0.0) - 1.0
+			const auto _unwrap = [&_context](Parameter& v) -> Parameter*
+			{
+				const auto _inner = negated(v);
+				return (_inner && _inner->type(_context) == v.type(_context)) ? _inner : nullptr;
+			};
+			const auto _negativeLiteral = [](const Parameter& v)
+			{
+				return v.is_literal() && !is_int(v.literal().type()) &&
+					all_components(v.literal(), [](double c) { return c < 0.0; });
+			};
+
+			switch (_op.op)
+			{
+			case GLSLBinaryOperator::sub:
+				if (const auto _inner = _unwrap(_op.rhs))
+				{
+					if (is_value(_op.lhs, 0.0) && _inner->type(_context) == _type)
+					{
+						replace(_node, take(_op.rhs, *_inner));
+						return true;
+					};
+					_op.rhs = take(_op.rhs, *_inner);
+					_op.op = GLSLBinaryOperator::add;
+					return true;
+				};
+				return false;
+
+			case GLSLBinaryOperator::add:
+				if (const auto _inner = _unwrap(_op.rhs))
+				{
+					_op.rhs = take(_op.rhs, *_inner);
+					_op.op = GLSLBinaryOperator::sub;
+					return true;
+				};
+				if (const auto _inner = _unwrap(_op.lhs))
+				{
+					auto _lhs = std::move(_op.rhs);
+					_op.rhs = take(_op.lhs, *_inner);
+					_op.lhs = std::move(_lhs);
+					_op.op = GLSLBinaryOperator::sub;
+					return true;
+				};
+				return false;
+
+			case GLSLBinaryOperator::mult:
+				[[fallthrough]];
+			case GLSLBinaryOperator::div:
+			{
+				const auto _lhs = _unwrap(_op.lhs);
+				const auto _rhs = _unwrap(_op.rhs);
+				if (_lhs && _rhs)
+				{
+					auto _a = take(_op.lhs, *_lhs);
+					auto _b = take(_op.rhs, *_rhs);
+					_op.lhs = std::move(_a);
+					_op.rhs = std::move(_b);
+					return true;
+				};
+
+				const auto _negate = [](const Parameter& v)
+				{
+					return Parameter(map_components(v.literal(), [](auto c) { return -c; }));
+				};
+				if (_lhs && _negativeLiteral(_op.rhs))
+				{
+					auto _a = take(_op.lhs, *_lhs);
+					_op.lhs = std::move(_a);
+					_op.rhs = _negate(_op.rhs);
+					return true;
+				};
+				if (_rhs && _negativeLiteral(_op.lhs))
+				{
+					auto _b = take(_op.rhs, *_rhs);
+					_op.rhs = std::move(_b);
+					_op.lhs = _negate(_op.lhs);
+					return true;
+				};
+				return false;
+			};
+
+			default:
+				return false;
+			};
+		};
+
+		/**
+		 * @brief Multiplies two scalar literals of the same type, ints wrap.
+		*/
+		GLSLLiteral multiply_literals(const GLSLLiteral& lhs, const GLSLLiteral& rhs)
+		{
+			switch (lhs.type())
+			{
+			case GLSLType::glsl_int:
+				return GLSLLiteral(int(unsigned(lhs.vec1<int>()) * unsigned(rhs.vec1<int>())));
+			case GLSLType::glsl_float:
+				return GLSLLiteral(lhs.vec1<float>() * rhs.vec1<float>());
+			case GLSLType::glsl_double:
+				return GLSLLiteral(lhs.vec1<double>() * rhs.vec1<double>());
+			default:
+				abort();
+				return GLSLLiteral();
+			};
+		};
+
+		/**
+		 * @brief Builds lhs * rhs for scalars of the same type, folding literal factors, ie. 2 * (3 * a) into 6 * a.
+		*/
+		Parameter multiply_scalars(Parameter&& lhs, Parameter&& rhs)
+		{
+			if (rhs.is_literal())
+			{
+				std::swap(lhs, rhs);
+			};
+			if (lhs.is_literal() && rhs.is_literal())
+			{
+				return multiply_literals(lhs.literal(), rhs.literal());
+			};
+
+			if (const auto _op = as_binary(rhs, GLSLBinaryOperator::mult); _op && lhs.is_literal())
+			{
+				auto _constant = &_op->lhs;
+				auto _other = &_op->rhs;
+				if (!_constant->is_literal())
+				{
+					std::swap(_constant, _other);
+				};
+				if (_constant->is_literal())
+				{
+					auto _folded = Parameter(multiply_literals(lhs.literal(), _constant->literal()));
+					return GLSLExpression::make_unique(GLSLExpression::BinaryOp(GLSLBinaryOperator::mult,
+						std::move(_folded), take(rhs, *_other)));
+				};
+			};
+			return GLSLExpression::make_unique(GLSLExpression::BinaryOp(GLSLBinaryOperator::mult, std::move(lhs), std::move(rhs)));
+		};
+
+		/**
+		 * s * (t * v) into (s * t) * v for scalars s, t and a vector or matrix v, in any operand
+		 * order, so each chain multiplies v once. Literal factors are multiplied together.
+		 * Reassociates, exact for ints only.
+		*/
+		bool scalar_factors(const GLSLContext& _context, Parameter& _node, bool _relaxed)
+		{
+			const auto _op = as_binary(_node, GLSLBinaryOperator::mult);
+			const auto _type = _node.type(_context);
+			if (!_op || is_scalar(_type) || !(_relaxed || is_int(_type)))
+			{
+				return false;
+			};
+
+			// The outer scalar on one side, the inner scalar times v on the other
+			const auto _component = component_type(_type);
+			const auto _scalar = [&_context, _component](const Parameter& v)
+			{
+				return v.type(_context) == _component;
+			};
+			auto _outer = &_op->lhs;
+			auto _child = &_op->rhs;
+			auto _inner = as_binary(*_child, GLSLBinaryOperator::mult);
+			if (!_scalar(*_outer) || !_inner)
+			{
+				std::swap(_outer, _child);
+				_inner = as_binary(*_child, GLSLBinaryOperator::mult);
+			};
+			if (!_scalar(*_outer) || !_inner)
+			{
+				return false;
+			};
+
+			auto _factor = &_inner->lhs;
+			auto _what = &_inner->rhs;
+			if (!_scalar(*_factor))
+			{
+				std::swap(_factor, _what);
+			};
+			if (!_scalar(*_factor) || _what->type(_context) != _type)
+			{
+				return false;
+			};
+
+			auto _scale = multiply_scalars(std::move(*_outer), take(*_child, *_factor));
+			auto _vector = take(*_child, *_what);
+			replace(_node, GLSLExpression::BinaryOp(GLSLBinaryOperator::mult, std::move(_scale), std::move(_vector)));
+			return true;
+		};
+
+		// Identities first, they make the later patterns simpler
+		constexpr GLSLSimplifyRule default_rules_v[] =
+		{
+			{ "mult_one", &mult_one },
+			{ "add_zero", &add_zero },
+			{ "sub_zero", &sub_zero },
+			{ "div_one", &div_one },
+			{ "mult_zero", &mult_zero },
+			{ "negate_literal", &negate_literal },
+			{ "fold_negation", &fold_negation },
+			{ "div_constant", &div_constant },
+			{ "pow_constant", &pow_constant },
+			{ "scalar_factors", &scalar_factors },
+		};
+
+
+
+		struct Simplifier
+		{
+			const GLSLContext* context;
+			const GLSLSimplifyOptions* options;
+			GLSLSimplifyStats stats{};
+
+			/**
+			 * @brief Simplifies an expression parameter's children, then the parameter itself.
+			 * @return True if anything was rewritten.
+			*/
+			bool simplify(Parameter& _param)
+			{
+				if (!_param.is_expression())
+				{
+					return false;
+				};
+				if (_param.expr().shared())
+				{
+					auto _copy = _param.clone();
+					if (!this->simplify(_copy))
+					{
+						return false;
+					};
+					_param = std::move(_copy);
+					return true;
+				};
+
+				bool _changed = this->simplify_children(_param.expr());
+				for (size_t n = 0; n != this->options->max_rewrites_per_node && _param.is_expression(); ++n)
+				{
+					const auto _rule = std::ranges::find_if(this->options->rules, [this, &_param](const GLSLSimplifyRule& v)
+						{
+							return v.apply(*this->context, _param, this->options->relaxed);
+						});
+					if (_rule == this->options->rules.end())
+					{
+						break;
+					};
+					++this->stats.rewrites[_rule->name];
+					_changed = true;
+
+					// Rules may build new nodes below this one
+					if (_param.is_expression())
+					{
+						this->simplify_children(_param.expr());
+					};
+				};
+				return _changed;
+			};
+
+			bool simplify_children(GLSLExpression& _expr)
+			{
+				bool _changed = false;
+				for_each_param(_expr, [this, &_changed](Parameter& v)
+					{
+						_changed = this->simplify(v) || _changed;
+					});
+				return _changed;
+			};
+
+			/**
+			 * @brief Simplifies a statement's expression, which may end up as a plain identity.
+			*/
+			void simplify(GLSLExpression& _expr)
+			{
+				if (_expr.type() == GLSLExpressionType::identity)
+				{
+					this->simplify_children(_expr);
+					return;
+				};
+
+				auto _root = Parameter(GLSLExpression::make_unique(std::move(_expr)));
+				this->simplify(_root);
+				if (_root.is_expression())
+				{
+					_expr = std::move(_root.expr());
+				}
+				else
+				{
+					_expr = GLSLExpression(GLSLExpression::Identity(std::move(_root)));
+				};
+			};
+
+			void simplify(std::span<GLSLStatement> _statements)
+			{
+				for_each_statement(_statements, [this](GLSLStatement& v)
+					{
+						this->simplify(v.expr);
+					});
+			};
+		};
+	};
+
+	std::span<const GLSLSimplifyRule> simplify_rules()
+	{
+		return default_rules_v;
+	};
+
+	GLSLSimplifyStats simplify_expressions(GLSLContext& _context, GLSLParams& _params, const GLSLSimplifyOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		auto _simplifier = Simplifier{ &_context, &_options };
+		_simplifier.simplify(_params.globals);
+		for (auto& _function : _params.functions)
+		{
+			_simplifier.simplify(_function.body());
+		};
+		_simplifier.simplify(_params.main_fn.body());
+		return _simplifier.stats;
+	};
+};
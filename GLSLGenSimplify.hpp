@@ -0,0 +1,102 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <map>
+#include <span>
+#include <cstddef>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief A rewrite applied by simplify_expressions().
+	*/
+	struct GLSLSimplifyRule
+	{
+		// Short name, used to count the rule's rewrites in GLSLSimplifyStats
+		std::string_view name;
+
+		/**
+		 * @brief Rewrites an expression node in place.
+		 * @param _context Shader context.
+		 * @param _node Expression parameter to rewrite, never shared, its children are already simplified.
+		 * @param _relaxed Set if the rewrite may change how the result is rounded, or the sign of a zero
+		 *	result, as long as it stays within GLSL's precision requirements. Unset, only rewrites giving
+		 *	the same result for every input are allowed.
+		 * @return True if the node was rewritten.
+		*/
+		bool(*apply)(const GLSLContext& _context, GLSLExpression::Parameter& _node, bool _relaxed);
+	};
+
+	/**
+	 * @brief Gets the rules simplify_expressions() applies by default, in the order they are tried.
+	 *
+	 * Identities (x * 1, x + 0, x - 0, x / 1, x * 0 on ints), division by a constant turned
+	 * into a multiplication, pow(x, 2.0) into x * x, negation folding and merging the scalar
+	 * factors of a scalar times vector chain.
+	*/
+	std::span<const GLSLSimplifyRule> simplify_rules();
+
+	/**
+	 * @brief Rules and precision guarantees used by simplify_expressions().
+	*/
+	struct GLSLSimplifyOptions
+	{
+		/**
+		 * @brief Rules tried on each node, the first one matching is applied.
+		*/
+		std::span<const GLSLSimplifyRule> rules = simplify_rules();
+
+		/**
+		 * @brief Allow rewrites that may round differently within GLSL's precision requirements,
+		 *	see GLSLSimplifyRule::apply. GLSL lets compilers reassociate and turn divisions into
+		 *	reciprocal multiplications of the same precision unless results are declared precise.
+		*/
+		bool relaxed = true;
+
+		/**
+		 * @brief Most rewrites applied to a single node, guards against rules undoing each other.
+		*/
+		size_t max_rewrites_per_node = 16;
+	};
+
+	/**
+	 * @brief Summary of what simplify_expressions() rewrote.
+	*/
+	struct GLSLSimplifyStats
+	{
+		// Rewrites per rule name
+		std::map<std::string_view, size_t> rewrites{};
+
+		size_t total() const
+		{
+			size_t _total = 0;
+			for (auto& [_name, _count] : this->rewrites)
+			{
+				_total += _count;
+			};
+			return _total;
+		};
+	};
+
+	/**
+	 * @brief Applies algebraic simplification and strength reduction rules to every expression.
+	 *
+	 * Expression trees are visited bottom up, each node rewritten until no rule matches. Rules
+	 * only drop an operand if it calls no user functions, and only duplicate variables and
+	 * literals, never whole expressions.
+	 *
+	 * Shared nodes (see GLSLExpressionPool) are simplified on a copy, kept only if it changed.
+	 *
+	 * Auto types must already be deduced.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @param _options Rules and precision guarantees.
+	 * @return Rewrite statistics.
+	*/
+	GLSLSimplifyStats simplify_expressions(GLSLContext& _context, GLSLParams& _params, const GLSLSimplifyOptions& _options = {});
+};
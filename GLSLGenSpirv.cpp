@@ -0,0 +1,1798 @@
+#include "GLSLGenSpirv.hpp"
+
+#include <map>
+#include <set>
+#include <bit>
+#include <array>
+#include <string>
+#include <format>
+#include <algorithm>
+#include <string_view>
+#include <initializer_list>
+
+namespace glsl
+{
+	namespace
+	{
+		constexpr uint32_t spirv_magic_v = 0x07230203;
+
+		// SPIR-V 1.0
+		constexpr uint32_t spirv_version_v = 0x00010000;
+
+		/**
+		 * @brief SPIR-V enumerants, named as in the specification.
+		*/
+		namespace spv
+		{
+			enum Op : uint16_t
+			{
+				OpName = 5,
+				OpMemberName = 6,
+				OpExtInstImport = 11,
+				OpExtInst = 12,
+				OpMemoryModel = 14,
+				OpEntryPoint = 15,
+				OpExecutionMode = 16,
+				OpCapability = 17,
+				OpTypeVoid = 19,
+				OpTypeBool = 20,
+				OpTypeInt = 21,
+				OpTypeFloat = 22,
+				OpTypeVector = 23,
+				OpTypeMatrix = 24,
+				OpTypeImage = 25,
+				OpTypeSampledImage = 27,
+				OpTypeStruct = 30,
+				OpTypePointer = 32,
+				OpTypeFunction = 33,
+				OpConstantTrue = 41,
+				OpConstantFalse = 42,
+				OpConstant = 43,
+				OpConstantComposite = 44,
+				OpFunction = 54,
+				OpFunctionParameter = 55,
+				OpFunctionEnd = 56,
+				OpFunctionCall = 57,
+				OpVariable = 59,
+				OpLoad = 61,
+				OpStore = 62,
+				OpAccessChain = 65,
+				OpDecorate = 71,
+				OpMemberDecorate = 72,
+				OpVectorShuffle = 79,
+				OpCompositeConstruct = 80,
+				OpCompositeExtract = 81,
+				OpImageSampleImplicitLod = 87,
+				OpImageSampleExplicitLod = 88,
+				OpConvertFToS = 110,
+				OpConvertSToF = 111,
+				OpFConvert = 115,
+				OpIAdd = 128,
+				OpFAdd = 129,
+				OpISub = 130,
+				OpFSub = 131,
+				OpIMul = 132,
+				OpFMul = 133,
+				OpSDiv = 135,
+				OpFDiv = 136,
+				OpVectorTimesScalar = 142,
+				OpMatrixTimesScalar = 143,
+				OpVectorTimesMatrix = 144,
+				OpMatrixTimesVector = 145,
+				OpMatrixTimesMatrix = 146,
+				OpDot = 148,
+				OpAny = 154,
+				OpAll = 155,
+				OpLogicalEqual = 164,
+				OpLogicalNotEqual = 165,
+				OpLogicalOr = 166,
+				OpLogicalAnd = 167,
+				OpSelect = 169,
+				OpIEqual = 170,
+				OpINotEqual = 171,
+				OpSGreaterThan = 173,
+				OpSGreaterThanEqual = 175,
+				OpSLessThan = 177,
+				OpSLessThanEqual = 179,
+				OpFOrdEqual = 180,
+				OpFUnordNotEqual = 183,
+				OpFOrdLessThan = 184,
+				OpFOrdGreaterThan = 186,
+				OpFOrdLessThanEqual = 188,
+				OpFOrdGreaterThanEqual = 190,
+				OpPhi = 245,
+				OpLoopMerge = 246,
+				OpSelectionMerge = 247,
+				OpLabel = 248,
+				OpBranch = 249,
+				OpBranchConditional = 250,
+				OpReturn = 253,
+				OpReturnValue = 254,
+				OpUnreachable = 255,
+			};
+
+			enum StorageClass : uint32_t
+			{
+				UniformConstant = 0,
+				Input = 1,
+				Uniform = 2,
+				Output = 3,
+				Private = 6,
+				Function = 7,
+			};
+
+			enum Decoration : uint32_t
+			{
+				Block = 2,
+				ColMajor = 5,
+				MatrixStride = 7,
+				BuiltIn = 11,
+				Flat = 14,
+				Location = 30,
+				Binding = 33,
+				DescriptorSet = 34,
+				Offset = 35,
+			};
+
+			enum BuiltInVariable : uint32_t
+			{
+				Position = 0,
+				FragCoord = 15,
+				PointCoord = 16,
+				FrontFacing = 17,
+				FragDepth = 22,
+				VertexIndex = 42,
+				InstanceIndex = 43,
+			};
+
+			// GLSL.std.450 extended instructions
+			enum GLSLstd450 : uint32_t
+			{
+				FAbs = 4,
+				SAbs = 5,
+				Sin = 13,
+				Cos = 14,
+				Tan = 15,
+				Pow = 26,
+			};
+
+			constexpr uint32_t CapabilityShader = 1;
+			constexpr uint32_t CapabilityFloat64 = 10;
+			constexpr uint32_t AddressingModelLogical = 0;
+			constexpr uint32_t MemoryModelGLSL450 = 1;
+			constexpr uint32_t ExecutionModelVertex = 0;
+			constexpr uint32_t ExecutionModelFragment = 4;
+			constexpr uint32_t ExecutionModeOriginUpperLeft = 7;
+			constexpr uint32_t ExecutionModeDepthReplacing = 12;
+			constexpr uint32_t Dim2D = 1;
+			constexpr uint32_t ImageOperandsLod = 0x2;
+		};
+
+		/**
+		 * @brief How the decoder reads an opcode's operands.
+		*/
+		struct OpInfo
+		{
+			uint16_t opcode;
+			std::string_view name;
+
+			// Has a result type, always the first operand
+			bool type;
+
+			// Has a result ID, following the result type if any
+			bool result;
+
+			// Remaining operands: 'i' for an ID, 'l' for a literal word, 's' for a string,
+			// a trailing '*' repeats the last one for every word left
+			std::string_view operands;
+		};
+
+		// Sorted by opcode
+		constexpr OpInfo op_infos_v[] =
+		{
+			{ spv::OpName, "OpName", false, false, "is" },
+			{ spv::OpMemberName, "OpMemberName", false, false, "ils" },
+			{ spv::OpExtInstImport, "OpExtInstImport", false, true, "s" },
+			{ spv::OpExtInst, "OpExtInst", true, true, "ili*" },
+			{ spv::OpMemoryModel, "OpMemoryModel", false, false, "ll" },
+			{ spv::OpEntryPoint, "OpEntryPoint", false, false, "lisi*" },
+			{ spv::OpExecutionMode, "OpExecutionMode", false, false, "il*" },
+			{ spv::OpCapability, "OpCapability", false, false, "l" },
+			{ spv::OpTypeVoid, "OpTypeVoid", false, true, "" },
+			{ spv::OpTypeBool, "OpTypeBool", false, true, "" },
+			{ spv::OpTypeInt, "OpTypeInt", false, true, "ll" },
+			{ spv::OpTypeFloat, "OpTypeFloat", false, true, "l" },
+			{ spv::OpTypeVector, "OpTypeVector", false, true, "il" },
+			{ spv::OpTypeMatrix, "OpTypeMatrix", false, true, "il" },
+			{ spv::OpTypeImage, "OpTypeImage", false, true, "il*" },
+			{ spv::OpTypeSampledImage, "OpTypeSampledImage", false, true, "i" },
+			{ spv::OpTypeStruct, "OpTypeStruct", false, true, "i*" },
+			{ spv::OpTypePointer, "OpTypePointer", false, true, "li" },
+			{ spv::OpTypeFunction, "OpTypeFunction", false, true, "i*" },
+			{ spv::OpConstantTrue, "OpConstantTrue", true, true, "" },
+			{ spv::OpConstantFalse, "OpConstantFalse", true, true, "" },
+			{ spv::OpConstant, "OpConstant", true, true, "l*" },
+			{ spv::OpConstantComposite, "OpConstantComposite", true, true, "i*" },
+			{ spv::OpFunction, "OpFunction", true, true, "li" },
+			{ spv::OpFunctionParameter, "OpFunctionParameter", true, true, "" },
+			{ spv::OpFunctionEnd, "OpFunctionEnd", false, false, "" },
+			{ spv::OpFunctionCall, "OpFunctionCall", true, true, "i*" },
+			{ spv::OpVariable, "OpVariable", true, true, "li" },
+			{ spv::OpLoad, "OpLoad", true, true, "il*" },
+			{ spv::OpStore, "OpStore", false, false, "iil*" },
+			{ spv::OpAccessChain, "OpAccessChain", true, true, "i*" },
+			{ spv::OpDecorate, "OpDecorate", false, false, "il*" },
+			{ spv::OpMemberDecorate, "OpMemberDecorate", false, false, "ill*" },
+			{ spv::OpVectorShuffle, "OpVectorShuffle", true, true, "iil*" },
+			{ spv::OpCompositeConstruct, "OpCompositeConstruct", true, true, "i*" },
+			{ spv::OpCompositeExtract, "OpCompositeExtract", true, true, "il*" },
+			{ spv::OpImageSampleImplicitLod, "OpImageSampleImplicitLod", true, true, "iili*" },
+			{ spv::OpImageSampleExplicitLod, "OpImageSampleExplicitLod", true, true, "iili*" },
+			{ spv::OpConvertFToS, "OpConvertFToS", true, true, "i" },
+			{ spv::OpConvertSToF, "OpConvertSToF", true, true, "i" },
+			{ spv::OpFConvert, "OpFConvert", true, true, "i" },
+			{ spv::OpIAdd, "OpIAdd", true, true, "ii" },
+			{ spv::OpFAdd, "OpFAdd", true, true, "ii" },
+			{ spv::OpISub, "OpISub", true, true, "ii" },
+			{ spv::OpFSub, "OpFSub", true, true, "ii" },
+			{ spv::OpIMul, "OpIMul", true, true, "ii" },
+			{ spv::OpFMul, "OpFMul", true, true, "ii" },
+			{ spv::OpSDiv, "OpSDiv", true, true, "ii" },
+			{ spv::OpFDiv, "OpFDiv", true, true, "ii" },
+			{ spv::OpVectorTimesScalar, "OpVectorTimesScalar", true, true, "ii" },
+			{ spv::OpMatrixTimesScalar, "OpMatrixTimesScalar", true, true, "ii" },
+			{ spv::OpVectorTimesMatrix, "OpVectorTimesMatrix", true, true, "ii" },
+			{ spv::OpMatrixTimesVector, "OpMatrixTimesVector", true, true, "ii" },
+			{ spv::OpMatrixTimesMatrix, "OpMatrixTimesMatrix", true, true, "ii" },
+			{ spv::OpDot, "OpDot", true, true, "ii" },
+			{ spv::OpAny, "OpAny", true, true, "i" },
+			{ spv::OpAll, "OpAll", true, true, "i" },
+			{ spv::OpLogicalEqual, "OpLogicalEqual", true, true, "ii" },
+			{ spv::OpLogicalNotEqual, "OpLogicalNotEqual", true, true, "ii" },
+			{ spv::OpLogicalOr, "OpLogicalOr", true, true, "ii" },
+			{ spv::OpLogicalAnd, "OpLogicalAnd", true, true, "ii" },
+			{ spv::OpSelect, "OpSelect", true, true, "iii" },
+			{ spv::OpIEqual, "OpIEqual", true, true, "ii" },
+			{ spv::OpINotEqual, "OpINotEqual", true, true, "ii" },
+			{ spv::OpSGreaterThan, "OpSGreaterThan", true, true, "ii" },
+			{ spv::OpSGreaterThanEqual, "OpSGreaterThanEqual", true, true, "ii" },
+			{ spv::OpSLessThan, "OpSLessThan", true, true, "ii" },
+			{ spv::OpSLessThanEqual, "OpSLessThanEqual", true, true, "ii" },
+			{ spv::OpFOrdEqual, "OpFOrdEqual", true, true, "ii" },
+			{ spv::OpFUnordNotEqual, "OpFUnordNotEqual", true, true, "ii" },
+			{ spv::OpFOrdLessThan, "OpFOrdLessThan", true, true, "ii" },
+			{ spv::OpFOrdGreaterThan, "OpFOrdGreaterThan", true, true, "ii" },
+			{ spv::OpFOrdLessThanEqual, "OpFOrdLessThanEqual", true, true, "ii" },
+			{ spv::OpFOrdGreaterThanEqual, "OpFOrdGreaterThanEqual", true, true, "ii" },
+			{ spv::OpPhi, "OpPhi", true, true, "i*" },
+			{ spv::OpLoopMerge, "OpLoopMerge", false, false, "iil*" },
+			{ spv::OpSelectionMerge, "OpSelectionMerge", false, false, "il" },
+			{ spv::OpLabel, "OpLabel", false, true, "" },
+			{ spv::OpBranch, "OpBranch", false, false, "i" },
+			{ spv::OpBranchConditional, "OpBranchConditional", false, false, "iiil*" },
+			{ spv::OpReturn, "OpReturn", false, false, "" },
+			{ spv::OpReturnValue, "OpReturnValue", false, false, "i" },
+			{ spv::OpUnreachable, "OpUnreachable", false, false, "" },
+		};
+
+		const OpInfo* find_op_info(uint16_t _opcode)
+		{
+			const auto it = std::ranges::lower_bound(op_infos_v, _opcode, {}, &OpInfo::opcode);
+			return (it != std::ranges::end(op_infos_v) && it->opcode == _opcode) ? &*it : nullptr;
+		};
+
+		enum class OperandKind : uint8_t
+		{
+			id,
+			literal,
+			string,
+		};
+
+		/**
+		 * @brief Walks the operands following an instruction's result type and ID.
+		 * @param _fn Called with the kind, the index of the first word and the number of words.
+		 * @return False if a string runs past the instruction.
+		*/
+		template <typename FnT>
+		bool for_each_operand(const OpInfo& _info, const GLSLSpirvInstruction& _instruction, FnT&& _fn)
+		{
+			auto& _words = _instruction.operands;
+			size_t n = size_t(_info.type) + size_t(_info.result);
+			size_t _pattern = 0;
+			while (n < _words.size() && _pattern != _info.operands.size())
+			{
+				auto _kind = _info.operands[_pattern];
+				const auto _repeat = _pattern + 1 < _info.operands.size() && _info.operands[_pattern + 1] == '*';
+				if (!_repeat)
+				{
+					++_pattern;
+				};
+
+				if (_kind == 's')
+				{
+					// Null terminated and padded with zeroes to a whole word
+					size_t _count = 0;
+					bool _terminated = false;
+					while (!_terminated && n + _count < _words.size())
+					{
+						const auto w = _words[n + _count];
+						_terminated = (w & 0xFF) == 0 || (w & 0xFF00) == 0 || (w & 0xFF0000) == 0 || (w & 0xFF000000) == 0;
+						++_count;
+					};
+					if (!_terminated)
+					{
+						return false;
+					};
+					_fn(OperandKind::string, n, _count);
+					n += _count;
+				}
+				else
+				{
+					_fn((_kind == 'i') ? OperandKind::id : OperandKind::literal, n, size_t(1));
+					++n;
+				};
+			};
+
+			// Operands past the pattern are literals
+			if (n < _words.size())
+			{
+				_fn(OperandKind::literal, n, _words.size() - n);
+			};
+			return true;
+		};
+
+		std::string decode_string(std::span<const uint32_t> _words)
+		{
+			auto _out = std::string();
+			for (auto w : _words)
+			{
+				for (size_t b = 0; b != 4; ++b)
+				{
+					const auto c = char((w >> (b * 8)) & 0xFF);
+					if (c == '\0')
+					{
+						return _out;
+					};
+					_out.push_back(c);
+				};
+			};
+			return _out;
+		};
+
+		void append_string(std::vector<uint32_t>& _words, std::string_view _string)
+		{
+			// Always at least one zero byte, padded to a whole word
+			for (size_t n = 0; n <= _string.size(); n += 4)
+			{
+				uint32_t w = 0;
+				for (size_t b = 0; b != 4 && n + b < _string.size(); ++b)
+				{
+					w |= uint32_t(uint8_t(_string[n + b])) << (b * 8);
+				};
+				_words.push_back(w);
+			};
+		};
+
+		void emit(std::vector<uint32_t>& _out, uint16_t _opcode, std::span<const uint32_t> _operands)
+		{
+			_out.push_back((uint32_t(_operands.size() + 1) << 16) | _opcode);
+			_out.insert(_out.end(), _operands.begin(), _operands.end());
+		};
+		void emit(std::vector<uint32_t>& _out, uint16_t _opcode, std::initializer_list<uint32_t> _operands)
+		{
+			emit(_out, _opcode, std::span<const uint32_t>(_operands.begin(), _operands.size()));
+		};
+
+		bool is_int(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_int;
+		};
+		// is_scalar() leaves out bool
+		bool is_single(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_bool || is_scalar(_type);
+		};
+		bool is_float_scalar(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_float || _type == GLSLType::glsl_double;
+		};
+
+		GLSLType vector_type(GLSLType _element, size_t _count)
+		{
+			constexpr GLSLType _floats[] = { GLSLType::glsl_float, GLSLType::glsl_vec2, GLSLType::glsl_vec3, GLSLType::glsl_vec4 };
+			constexpr GLSLType _doubles[] = { GLSLType::glsl_double, GLSLType::glsl_dvec2, GLSLType::glsl_dvec3, GLSLType::glsl_dvec4 };
+			if (_count == 0 || _count > 4)
+			{
+				return GLSLType::glsl_error;
+			};
+			if (_element == GLSLType::glsl_float)
+			{
+				return _floats[_count - 1];
+			}
+			else if (_element == GLSLType::glsl_double)
+			{
+				return _doubles[_count - 1];
+			};
+			return GLSLType::glsl_error;
+		};
+
+		/**
+		 * @brief Gets the std140 alignment and size of a uniform block member.
+		*/
+		std::pair<uint32_t, uint32_t> std140_layout(GLSLType _type)
+		{
+			switch (_type)
+			{
+			case GLSLType::glsl_vec2:
+				return { 8, 8 };
+			case GLSLType::glsl_vec3:
+				return { 16, 12 };
+			case GLSLType::glsl_vec4:
+				return { 16, 16 };
+			case GLSLType::glsl_double:
+				return { 8, 8 };
+			case GLSLType::glsl_dvec2:
+				return { 16, 16 };
+			case GLSLType::glsl_dvec3:
+				return { 32, 24 };
+			case GLSLType::glsl_dvec4:
+				return { 32, 32 };
+			case GLSLType::glsl_mat4:
+				return { 16, 64 };
+			default:
+				return { 4, 4 };
+			};
+		};
+
+		struct Value
+		{
+			uint32_t id = 0;
+			GLSLType type = GLSLType::glsl_error;
+		};
+
+		struct SpirvWriter
+		{
+			const GLSLContext* context;
+			const GLSLParams* params;
+			GLSLShaderStage stage;
+			const GLSLSpirvOptions* options;
+
+			// Cleared by anything that cannot be lowered, the module is still finished but discarded
+			bool ok = true;
+
+			uint32_t next_id = 1;
+			uint32_t glsl_std = 0;
+			bool float64 = false;
+			bool depth_replacing = false;
+
+			// Module sections, see assemble() for their order
+			std::vector<uint32_t> names{};
+			std::vector<uint32_t> decorations{};
+			std::vector<uint32_t> globals{};
+			std::vector<uint32_t> functions{};
+
+			std::map<GLSLType, uint32_t> types{};
+			std::map<uint32_t, uint32_t> bool_vectors{};
+			std::map<std::pair<uint32_t, uint32_t>, uint32_t> pointers{};
+			std::map<std::vector<uint32_t>, uint32_t> function_types{};
+
+			// Keyed by opcode, type and value words
+			std::map<std::vector<uint32_t>, uint32_t> constants{};
+
+			struct Variable
+			{
+				uint32_t pointer = 0;
+				uint32_t storage = 0;
+				GLSLType type{};
+
+				// Member of the uniform block, or npos
+				uint32_t member = npos;
+			};
+			static constexpr uint32_t npos = ~uint32_t(0);
+
+			std::map<GLSLVariableID, Variable> variables{};
+			std::map<GLSLFunctionID, uint32_t> function_ids{};
+			std::vector<uint32_t> interface{};
+			uint32_t uniform_block = 0;
+
+			// Function being written, its variables must come first in its entry block
+			std::vector<uint32_t> locals{};
+			std::vector<uint32_t> code{};
+			GLSLType return_type{};
+			bool terminated = false;
+
+			// Label of the block being written, the parent block of an OpPhi
+			uint32_t block = 0;
+
+			uint32_t new_id()
+			{
+				return this->next_id++;
+			};
+
+			Value fail()
+			{
+				this->ok = false;
+				return Value{ this->new_id(), GLSLType::glsl_error };
+			};
+
+			void name(uint32_t _id, std::string_view _name)
+			{
+				auto _operands = std::vector<uint32_t>{ _id };
+				append_string(_operands, _name);
+				emit(this->names, spv::OpName, _operands);
+			};
+
+			uint32_t type_id(GLSLType _type)
+			{
+				if (const auto it = this->types.find(_type); it != this->types.end())
+				{
+					return it->second;
+				};
+
+				uint32_t _id = 0;
+				switch (_type)
+				{
+				case GLSLType::glsl_void:
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeVoid, { _id });
+					break;
+				case GLSLType::glsl_bool:
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeBool, { _id });
+					break;
+				case GLSLType::glsl_int:
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeInt, { _id, 32, 1 });
+					break;
+				case GLSLType::glsl_float:
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeFloat, { _id, 32 });
+					break;
+				case GLSLType::glsl_double:
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeFloat, { _id, 64 });
+					this->float64 = true;
+					break;
+				case GLSLType::glsl_vec2:
+				case GLSLType::glsl_vec3:
+				case GLSLType::glsl_vec4:
+				case GLSLType::glsl_dvec2:
+				case GLSLType::glsl_dvec3:
+				case GLSLType::glsl_dvec4:
+				{
+					const auto _component = this->type_id(element_type(_type));
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeVector, { _id, _component, uint32_t(vec_size(_type)) });
+				};
+				break;
+				case GLSLType::glsl_mat4:
+				{
+					const auto _column = this->type_id(GLSLType::glsl_vec4);
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeMatrix, { _id, _column, 4 });
+				};
+				break;
+				case GLSLType::glsl_sampler_2D:
+				case GLSLType::glsl_sampler_2D_array:
+				{
+					const auto _sampled = this->type_id(GLSLType::glsl_float);
+					const auto _image = this->new_id();
+					const uint32_t _arrayed = (_type == GLSLType::glsl_sampler_2D_array) ? 1 : 0;
+					emit(this->globals, spv::OpTypeImage, { _image, _sampled, spv::Dim2D, 0, _arrayed, 0, 1, 0 });
+					_id = this->new_id();
+					emit(this->globals, spv::OpTypeSampledImage, { _id, _image });
+				};
+				break;
+				default:
+					return this->fail().id;
+				};
+
+				this->types.insert_or_assign(_type, _id);
+				return _id;
+			};
+
+			uint32_t bool_vector_id(uint32_t _count)
+			{
+				if (const auto it = this->bool_vectors.find(_count); it != this->bool_vectors.end())
+				{
+					return it->second;
+				};
+				const auto _component = this->type_id(GLSLType::glsl_bool);
+				const auto _id = this->new_id();
+				emit(this->globals, spv::OpTypeVector, { _id, _component, _count });
+				this->bool_vectors.insert_or_assign(_count, _id);
+				return _id;
+			};
+
+			uint32_t pointer_id(uint32_t _storage, uint32_t _type)
+			{
+				const auto _key = std::pair(_storage, _type);
+				if (const auto it = this->pointers.find(_key); it != this->pointers.end())
+				{
+					return it->second;
+				};
+				const auto _id = this->new_id();
+				emit(this->globals, spv::OpTypePointer, { _id, _storage, _type });
+				this->pointers.insert_or_assign(_key, _id);
+				return _id;
+			};
+
+			uint32_t function_type_id(GLSLType _return, std::span<const GLSLVariableID> _params)
+			{
+				auto _key = std::vector<uint32_t>{ this->type_id(_return) };
+				for (auto _param : _params)
+				{
+					_key.push_back(this->type_id(this->context->type(_param)));
+				};
+				if (const auto it = this->function_types.find(_key); it != this->function_types.end())
+				{
+					return it->second;
+				};
+
+				const auto _id = this->new_id();
+				auto _operands = _key;
+				_operands.insert(_operands.begin(), _id);
+				emit(this->globals, spv::OpTypeFunction, _operands);
+				this->function_types.insert_or_assign(_key, _id);
+				return _id;
+			};
+
+			uint32_t constant(uint16_t _opcode, uint32_t _type, std::span<const uint32_t> _value)
+			{
+				auto _key = std::vector<uint32_t>{ _opcode, _type };
+				_key.insert(_key.end(), _value.begin(), _value.end());
+				if (const auto it = this->constants.find(_key); it != this->constants.end())
+				{
+					return it->second;
+				};
+
+				const auto _id = this->new_id();
+				auto _operands = std::vector<uint32_t>{ _type, _id };
+				_operands.insert(_operands.end(), _value.begin(), _value.end());
+				emit(this->globals, _opcode, _operands);
+				this->constants.insert_or_assign(std::move(_key), _id);
+				return _id;
+			};
+
+			Value constant_bool(bool _value)
+			{
+				const auto _type = this->type_id(GLSLType::glsl_bool);
+				return { this->constant((_value) ? spv::OpConstantTrue : spv::OpConstantFalse, _type, {}), GLSLType::glsl_bool };
+			};
+			Value constant_int(int32_t _value)
+			{
+				const uint32_t _words[] = { std::bit_cast<uint32_t>(_value) };
+				return { this->constant(spv::OpConstant, this->type_id(GLSLType::glsl_int), _words), GLSLType::glsl_int };
+			};
+			Value constant_float(GLSLType _type, double _value)
+			{
+				if (_type == GLSLType::glsl_double)
+				{
+					const auto _bits = std::bit_cast<uint64_t>(_value);
+					const uint32_t _words[] = { uint32_t(_bits), uint32_t(_bits >> 32) };
+					return { this->constant(spv::OpConstant, this->type_id(_type), _words), _type };
+				};
+				const uint32_t _words[] = { std::bit_cast<uint32_t>(float(_value)) };
+				return { this->constant(spv::OpConstant, this->type_id(GLSLType::glsl_float), _words), GLSLType::glsl_float };
+			};
+
+			/**
+			 * @brief Gets a scalar constant of a type from a number, ie. 1 or 0.
+			*/
+			Value constant_of(GLSLType _type, int _value)
+			{
+				switch (_type)
+				{
+				case GLSLType::glsl_bool:
+					return this->constant_bool(_value != 0);
+				case GLSLType::glsl_int:
+					return this->constant_int(_value);
+				default:
+					return this->constant_float(_type, double(_value));
+				};
+			};
+
+			Value literal(const GLSLLiteral& _literal)
+			{
+				const auto _type = _literal.type();
+				const auto _count = vec_size(_type);
+				const auto _element = (is_vector(_type)) ? element_type(_type) : _type;
+
+				auto _components = std::array<uint32_t, 4>{};
+				for (size_t n = 0; n != _count; ++n)
+				{
+					switch (_element)
+					{
+					case GLSLType::glsl_bool:
+						_components[n] = this->constant_bool(_literal.arr<bool>()[n]).id;
+						break;
+					case GLSLType::glsl_int:
+						_components[n] = this->constant_int(_literal.arr<int>()[n]).id;
+						break;
+					case GLSLType::glsl_float:
+						_components[n] = this->constant_float(_element, _literal.arr<float>()[n]).id;
+						break;
+					case GLSLType::glsl_double:
+						_components[n] = this->constant_float(_element, _literal.arr<double>()[n]).id;
+						break;
+					default:
+						return this->fail();
+					};
+				};
+				if (!is_vector(_type))
+				{
+					return { _components[0], _type };
+				};
+				return { this->constant(spv::OpConstantComposite, this->type_id(_type), std::span(_components.data(), _count)), _type };
+			};
+
+			/**
+			 * @brief Writes an instruction with a result type and ID.
+			*/
+			Value op(uint16_t _opcode, GLSLType _type, std::initializer_list<uint32_t> _operands)
+			{
+				return this->op_id(_opcode, _type, this->type_id(_type), _operands);
+			};
+			Value op_id(uint16_t _opcode, GLSLType _type, uint32_t _typeID, std::span<const uint32_t> _operands)
+			{
+				const auto _id = this->new_id();
+				auto _words = std::vector<uint32_t>{ _typeID, _id };
+				_words.insert(_words.end(), _operands.begin(), _operands.end());
+				emit(this->code, _opcode, _words);
+				return { _id, _type };
+			};
+			Value op_id(uint16_t _opcode, GLSLType _type, uint32_t _typeID, std::initializer_list<uint32_t> _operands)
+			{
+				return this->op_id(_opcode, _type, _typeID, std::span<const uint32_t>(_operands.begin(), _operands.size()));
+			};
+
+			Value splat(Value _scalar, GLSLType _vector)
+			{
+				const auto _component = this->convert(_scalar, element_type(_vector));
+				auto _parts = std::vector<uint32_t>(vec_size(_vector), _component.id);
+				return this->op_id(spv::OpCompositeConstruct, _vector, this->type_id(_vector), _parts);
+			};
+
+			Value convert(Value _value, GLSLType _to)
+			{
+				const auto _from = _value.type;
+				if (_from == _to || !this->ok)
+				{
+					return { _value.id, _to };
+				};
+
+				if (is_single(_from) && is_single(_to))
+				{
+					if (_from == GLSLType::glsl_bool)
+					{
+						return this->op(spv::OpSelect, _to, { _value.id, this->constant_of(_to, 1).id, this->constant_of(_to, 0).id });
+					}
+					else if (_to == GLSLType::glsl_bool)
+					{
+						return this->op((is_int(_from)) ? spv::OpINotEqual : spv::OpFUnordNotEqual, _to,
+							{ _value.id, this->constant_of(_from, 0).id });
+					}
+					else if (is_int(_from))
+					{
+						return this->op(spv::OpConvertSToF, _to, { _value.id });
+					}
+					else if (is_int(_to))
+					{
+						return this->op(spv::OpConvertFToS, _to, { _value.id });
+					};
+					return this->op(spv::OpFConvert, _to, { _value.id });
+				}
+				else if (is_single(_from) && is_vector(_to))
+				{
+					return this->splat(_value, _to);
+				}
+				else if (is_vector(_from) && is_single(_to))
+				{
+					const auto _first = this->op(spv::OpCompositeExtract, element_type(_from), { _value.id, 0 });
+					return this->convert(_first, _to);
+				}
+				else if (is_vector(_from) && is_vector(_to))
+				{
+					if (vec_size(_from) > vec_size(_to))
+					{
+						// Drops the trailing components
+						auto _operands = std::vector<uint32_t>{ _value.id, _value.id };
+						for (uint32_t n = 0; n != vec_size(_to); ++n)
+						{
+							_operands.push_back(n);
+						};
+						const auto _shorter = vector_type(element_type(_from), vec_size(_to));
+						_value = this->op_id(spv::OpVectorShuffle, _shorter, this->type_id(_shorter), _operands);
+						return this->convert(_value, _to);
+					}
+					else if (vec_size(_from) == vec_size(_to))
+					{
+						return this->op(spv::OpFConvert, _to, { _value.id });
+					}
+					else
+					{
+						// Pads like the emitter, 0 for y and z and 1 for w
+						const auto _element = element_type(_to);
+						_value = this->convert(_value, vector_type(_element, vec_size(_from)));
+						auto _parts = std::vector<uint32_t>{ _value.id };
+						for (size_t n = vec_size(_from); n != vec_size(_to); ++n)
+						{
+							_parts.push_back(this->constant_of(_element, (n == 3) ? 1 : 0).id);
+						};
+						return this->op_id(spv::OpCompositeConstruct, _to, this->type_id(_to), _parts);
+					};
+				};
+				return this->fail();
+			};
+
+			Value load(GLSLVariableID _id)
+			{
+				const auto it = this->variables.find(_id);
+				if (it == this->variables.end())
+				{
+					return this->fail();
+				};
+
+				auto& _var = it->second;
+				if (_var.member == npos)
+				{
+					return this->op(spv::OpLoad, _var.type, { _var.pointer });
+				};
+
+				// Uniform block members, bools are stored as ints
+				const auto _stored = (_var.type == GLSLType::glsl_bool) ? GLSLType::glsl_int : _var.type;
+				const auto _pointer = this->op_id(spv::OpAccessChain, _stored, this->pointer_id(spv::Uniform, this->type_id(_stored)),
+					{ _var.pointer, this->constant_int(int32_t(_var.member)).id });
+				const auto _value = this->op(spv::OpLoad, _stored, { _pointer.id });
+				return this->convert(_value, _var.type);
+			};
+
+			void store(GLSLVariableID _id, Value _value)
+			{
+				const auto it = this->variables.find(_id);
+				if (it == this->variables.end() || it->second.member != npos)
+				{
+					this->fail();
+					return;
+				};
+				_value = this->convert(_value, it->second.type);
+				emit(this->code, spv::OpStore, { it->second.pointer, _value.id });
+			};
+
+			Value eval(const GLSLExpression::Parameter& _param)
+			{
+				if (_param.is_variable())
+				{
+					return this->load(_param.id());
+				}
+				else if (_param.is_literal())
+				{
+					return this->literal(_param.literal());
+				};
+				return this->eval(_param.expr());
+			};
+
+			Value eval(const GLSLExpression& _expr)
+			{
+				switch (_expr.type())
+				{
+				case GLSLExpressionType::identity:
+					return this->eval(_expr.get<GLSLExpression::Identity>().param);
+
+				case GLSLExpressionType::cast:
+				{
+					auto& _cast = _expr.get<GLSLExpression::Cast>();
+					return this->convert(this->eval(_cast.param), _cast.to_type());
+				};
+
+				case GLSLExpressionType::swizzle:
+					return this->eval_swizzle(_expr.get<GLSLExpression::Swizzle>());
+
+				case GLSLExpressionType::select:
+					return this->eval_select(_expr.get<GLSLExpression::Select>());
+
+				case GLSLExpressionType::binary_op:
+					return this->eval_binary(_expr.get<GLSLExpression::BinaryOp>());
+
+				case GLSLExpressionType::function_call:
+					return this->eval_call(_expr.get<GLSLExpression::FunctionCall>(), _expr.result_type(*this->context));
+
+				default:
+					return this->fail();
+				};
+			};
+
+			Value eval_swizzle(const GLSLExpression::Swizzle& _swizzle)
+			{
+				const auto _value = this->eval(_swizzle.what);
+				if (!this->ok)
+				{
+					return this->fail();
+				};
+				const auto _count = size_t(std::ranges::find(_swizzle.swizzle_, 255) - _swizzle.swizzle_.begin());
+				if (_count == 1 && (is_vector(_value.type) || is_matrix(_value.type)))
+				{
+					return this->op(spv::OpCompositeExtract, element_type(_value.type), { _value.id, _swizzle.swizzle_[0] });
+				}
+				else if (_count > 1 && is_vector(_value.type))
+				{
+					auto _operands = std::vector<uint32_t>{ _value.id, _value.id };
+					for (size_t n = 0; n != _count; ++n)
+					{
+						_operands.push_back(_swizzle.swizzle_[n]);
+					};
+					const auto _type = vector_type(element_type(_value.type), _count);
+					return this->op_id(spv::OpVectorShuffle, _type, this->type_id(_type), _operands);
+				};
+				return this->fail();
+			};
+
+			/**
+			 * @brief Evaluates a select, OpSelect evaluates both operands so it is only used if neither
+			 *	calls a user function.
+			*/
+			Value eval_select(const GLSLExpression::Select& _select)
+			{
+				const auto _calls = [this](const GLSLExpression::Parameter& _param)
+				{
+					return _param.is_expression() && calls_user_functions(*this->context, _param.expr());
+				};
+				if (_calls(_select.if_true) || _calls(_select.if_false))
+				{
+					return this->eval_select_branch(_select);
+				};
+
+				const auto _condition = this->convert(this->eval(_select.condition), GLSLType::glsl_bool);
+				const auto _true = this->eval(_select.if_true);
+				const auto _false = this->convert(this->eval(_select.if_false), _true.type);
+				const auto _type = _true.type;
+				if (!this->ok)
+				{
+					return this->fail();
+				};
+
+				// SPIR-V 1.0 selects vectors with a vector of bools, and no composites
+				if (is_vector(_type))
+				{
+					const auto _size = uint32_t(vec_size(_type));
+					const auto _parts = std::vector<uint32_t>(_size, _condition.id);
+					const auto _mask = this->op_id(spv::OpCompositeConstruct, GLSLType::glsl_bool, this->bool_vector_id(_size), _parts);
+					return this->op(spv::OpSelect, _type, { _mask.id, _true.id, _false.id });
+				}
+				else if (is_matrix(_type))
+				{
+					const auto _column = element_type(_type);
+					const auto _size = uint32_t(vec_size(_column));
+					const auto _parts = std::vector<uint32_t>(_size, _condition.id);
+					const auto _mask = this->op_id(spv::OpCompositeConstruct, GLSLType::glsl_bool, this->bool_vector_id(_size), _parts);
+					auto _columns = std::vector<uint32_t>();
+					for (uint32_t n = 0; n != 4; ++n)
+					{
+						const auto a = this->op(spv::OpCompositeExtract, _column, { _true.id, n });
+						const auto b = this->op(spv::OpCompositeExtract, _column, { _false.id, n });
+						_columns.push_back(this->op(spv::OpSelect, _column, { _mask.id, a.id, b.id }).id);
+					};
+					return this->op_id(spv::OpCompositeConstruct, _type, this->type_id(_type), _columns);
+				};
+				return this->op(spv::OpSelect, _type, { _condition.id, _true.id, _false.id });
+			};
+
+			/**
+			 * @brief Writes a select as a structured branch, only the chosen operand is evaluated.
+			*/
+			Value eval_select_branch(const GLSLExpression::Select& _select)
+			{
+				const auto _condition = this->convert(this->eval(_select.condition), GLSLType::glsl_bool);
+				const auto _then = this->new_id();
+				const auto _else = this->new_id();
+				const auto _merge = this->new_id();
+
+				emit(this->code, spv::OpSelectionMerge, { _merge, 0 });
+				emit(this->code, spv::OpBranchConditional, { _condition.id, _then, _else });
+
+				// Operands may hold selects of their own, the phi takes the blocks they end in
+				this->label(_then);
+				const auto _true = this->eval(_select.if_true);
+				const auto _trueBlock = this->block;
+				this->branch(_merge);
+
+				this->label(_else);
+				const auto _false = this->convert(this->eval(_select.if_false), _true.type);
+				const auto _falseBlock = this->block;
+				this->branch(_merge);
+
+				this->label(_merge);
+				if (!this->ok)
+				{
+					return this->fail();
+				};
+				return this->op(spv::OpPhi, _true.type, { _true.id, _trueBlock, _false.id, _falseBlock });
+			};
+
+			/**
+			 * @brief Gets the opcode of an arithmetic operator on scalars or vectors.
+			*/
+			uint16_t arithmetic_op(GLSLBinaryOperator _op, bool _int)
+			{
+				switch (_op)
+				{
+				case GLSLBinaryOperator::add:
+					return (_int) ? spv::OpIAdd : spv::OpFAdd;
+				case GLSLBinaryOperator::sub:
+					return (_int) ? spv::OpISub : spv::OpFSub;
+				case GLSLBinaryOperator::mult:
+					return (_int) ? spv::OpIMul : spv::OpFMul;
+				default:
+					return (_int) ? spv::OpSDiv : spv::OpFDiv;
+				};
+			};
+
+			/**
+			 * @brief Gets the opcode comparing two scalars or vectors component-wise.
+			*/
+			uint16_t compare_op(GLSLBinaryOperator _op, GLSLType _element)
+			{
+				const auto _int = is_int(_element);
+				switch (_op)
+				{
+				case GLSLBinaryOperator::eq:
+					return (_element == GLSLType::glsl_bool) ? spv::OpLogicalEqual : (_int) ? spv::OpIEqual : spv::OpFOrdEqual;
+				case GLSLBinaryOperator::neq:
+					return (_element == GLSLType::glsl_bool) ? spv::OpLogicalNotEqual : (_int) ? spv::OpINotEqual : spv::OpFUnordNotEqual;
+				case GLSLBinaryOperator::lt:
+					return (_int) ? spv::OpSLessThan : spv::OpFOrdLessThan;
+				case GLSLBinaryOperator::le:
+					return (_int) ? spv::OpSLessThanEqual : spv::OpFOrdLessThanEqual;
+				case GLSLBinaryOperator::gt:
+					return (_int) ? spv::OpSGreaterThan : spv::OpFOrdGreaterThan;
+				default:
+					return (_int) ? spv::OpSGreaterThanEqual : spv::OpFOrdGreaterThanEqual;
+				};
+			};
+
+			Value compare(GLSLBinaryOperator _op, Value _lhs, Value _rhs)
+			{
+				const auto _type = _lhs.type;
+				_rhs = this->convert(_rhs, _type);
+				if (is_single(_type))
+				{
+					return this->op(this->compare_op(_op, _type), GLSLType::glsl_bool, { _lhs.id, _rhs.id });
+				};
+
+				// Vectors and matrices are equal if every component is
+				const auto _any = _op == GLSLBinaryOperator::neq;
+				const auto _vector = [&](Value a, Value b)
+				{
+					const auto _size = uint32_t(vec_size(a.type));
+					const auto _mask = this->op_id(this->compare_op(_op, element_type(a.type)), GLSLType::glsl_bool,
+						this->bool_vector_id(_size), { a.id, b.id });
+					return this->op((_any) ? spv::OpAny : spv::OpAll, GLSLType::glsl_bool, { _mask.id });
+				};
+				if (is_vector(_type))
+				{
+					return _vector(_lhs, _rhs);
+				}
+				else if (is_matrix(_type))
+				{
+					auto _out = Value{};
+					for (uint32_t n = 0; n != 4; ++n)
+					{
+						const auto a = this->op(spv::OpCompositeExtract, element_type(_type), { _lhs.id, n });
+						const auto b = this->op(spv::OpCompositeExtract, element_type(_type), { _rhs.id, n });
+						const auto _column = _vector(a, b);
+						_out = (n == 0) ? _column :
+							this->op((_any) ? spv::OpLogicalOr : spv::OpLogicalAnd, GLSLType::glsl_bool, { _out.id, _column.id });
+					};
+					return _out;
+				};
+				return this->fail();
+			};
+
+			Value eval_binary(const GLSLExpression::BinaryOp& _binary)
+			{
+				auto _lhs = this->eval(_binary.lhs);
+				auto _rhs = this->eval(_binary.rhs);
+				const auto _op = _binary.op;
+				if (!this->ok)
+				{
+					return this->fail();
+				};
+				switch (_op)
+				{
+				case GLSLBinaryOperator::add:
+				case GLSLBinaryOperator::sub:
+				case GLSLBinaryOperator::mult:
+				case GLSLBinaryOperator::div:
+					break;
+				default:
+					return this->compare(_op, _lhs, _rhs);
+				};
+
+				if (is_matrix(_lhs.type) || is_matrix(_rhs.type))
+				{
+					return this->matrix_arithmetic(_op, _lhs, _rhs);
+				};
+
+				if (is_vector(_lhs.type) || is_vector(_rhs.type))
+				{
+					const auto _type = (is_vector(_lhs.type)) ? _lhs.type : _rhs.type;
+					const auto _element = element_type(_type);
+					if (_op == GLSLBinaryOperator::mult && is_single(_lhs.type) != is_single(_rhs.type))
+					{
+						const auto _vector = (is_single(_lhs.type)) ? _rhs : _lhs;
+						const auto _scalar = this->convert((is_single(_lhs.type)) ? _lhs : _rhs, _element);
+						return this->op(spv::OpVectorTimesScalar, _type, { _vector.id, _scalar.id });
+					};
+					_lhs = this->convert(_lhs, _type);
+					_rhs = this->convert(_rhs, _type);
+					return this->op(this->arithmetic_op(_op, false), _type, { _lhs.id, _rhs.id });
+				};
+
+				if (_lhs.type == GLSLType::glsl_bool || _rhs.type == GLSLType::glsl_bool)
+				{
+					return this->fail();
+				};
+				const auto _type = _lhs.type;
+				_rhs = this->convert(_rhs, _type);
+				return this->op(this->arithmetic_op(_op, is_int(_type)), _type, { _lhs.id, _rhs.id });
+			};
+
+			/**
+			 * @brief Lowers arithmetic with a matrix operand, column by column where SPIR-V has no instruction.
+			*/
+			Value matrix_arithmetic(GLSLBinaryOperator _op, Value _lhs, Value _rhs)
+			{
+				const auto _type = (is_matrix(_lhs.type)) ? _lhs.type : _rhs.type;
+				const auto _column = element_type(_type);
+
+				if (_op == GLSLBinaryOperator::mult)
+				{
+					if (_lhs.type == _rhs.type)
+					{
+						return this->op(spv::OpMatrixTimesMatrix, _type, { _lhs.id, _rhs.id });
+					};
+					if (is_vector(_lhs.type))
+					{
+						return this->op(spv::OpVectorTimesMatrix, _lhs.type, { _lhs.id, _rhs.id });
+					};
+					if (is_vector(_rhs.type))
+					{
+						return this->op(spv::OpMatrixTimesVector, _rhs.type, { _lhs.id, _rhs.id });
+					};
+					const auto _matrix = (is_matrix(_lhs.type)) ? _lhs : _rhs;
+					const auto _scalar = this->convert((is_matrix(_lhs.type)) ? _rhs : _lhs, element_type(_column));
+					return this->op(spv::OpMatrixTimesScalar, _type, { _matrix.id, _scalar.id });
+				};
+
+				// Scalars apply to every column
+				const auto _columnOf = [&](Value v, uint32_t n)
+				{
+					if (is_matrix(v.type))
+					{
+						return this->op(spv::OpCompositeExtract, _column, { v.id, n });
+					};
+					return this->convert(v, _column);
+				};
+				auto _columns = std::vector<uint32_t>();
+				for (uint32_t n = 0; n != 4; ++n)
+				{
+					const auto a = _columnOf(_lhs, n);
+					const auto b = _columnOf(_rhs, n);
+					_columns.push_back(this->op(this->arithmetic_op(_op, false), _column, { a.id, b.id }).id);
+				};
+				return this->op_id(spv::OpCompositeConstruct, _type, this->type_id(_type), _columns);
+			};
+
+			Value eval_call(const GLSLExpression::FunctionCall& _call, GLSLType _type)
+			{
+				const auto _decl = this->context->find(_call.function);
+				if (!_decl || _type == GLSLType::glsl_error)
+				{
+					return this->fail();
+				};
+
+				auto _args = std::vector<Value>();
+				for (auto& _param : _call.params)
+				{
+					_args.push_back(this->eval(_param));
+				};
+				if (!this->ok)
+				{
+					return this->fail();
+				};
+
+				if (!_decl->builtin())
+				{
+					const auto _function = this->params->find_function(_call.function);
+					const auto it = this->function_ids.find(_call.function);
+					if (!_function || it == this->function_ids.end() || _function->params().size() != _args.size())
+					{
+						return this->fail();
+					};
+					auto _operands = std::vector<uint32_t>{ it->second };
+					size_t n = 0;
+					for (auto _param : _function->params())
+					{
+						_operands.push_back(this->convert(_args[n++], this->context->type(_param)).id);
+					};
+					return this->op_id(spv::OpFunctionCall, _type, this->type_id(_type), _operands);
+				};
+
+				const auto _name = _decl->name();
+				if (_name == "texture" && _args.size() == 2)
+				{
+					const auto _coord = this->convert(_args[1],
+						(_args[0].type == GLSLType::glsl_sampler_2D_array) ? GLSLType::glsl_vec3 : GLSLType::glsl_vec2);
+
+					// Implicit derivatives only exist in fragment shaders
+					if (this->stage == GLSLShaderStage::fragment)
+					{
+						return this->op(spv::OpImageSampleImplicitLod, _type, { _args[0].id, _coord.id });
+					};
+					const auto _lod = this->constant_float(GLSLType::glsl_float, 0.0);
+					return this->op(spv::OpImageSampleExplicitLod, _type, { _args[0].id, _coord.id, spv::ImageOperandsLod, _lod.id });
+				}
+				else if (_name == "dot" && _args.size() == 2)
+				{
+					const auto _rhs = this->convert(_args[1], _args[0].type);
+					const auto _opcode = (is_vector(_args[0].type)) ? spv::OpDot : spv::OpFMul;
+					return this->op(_opcode, _type, { _args[0].id, _rhs.id });
+				};
+
+				// GLSL.std.450, arguments take the result's type
+				constexpr std::pair<std::string_view, uint32_t> _instructions[] =
+				{
+					{ "sin", spv::Sin }, { "cos", spv::Cos }, { "tan", spv::Tan }, { "abs", spv::FAbs }, { "pow", spv::Pow },
+				};
+				const auto it = std::ranges::find(_instructions, _name, &std::pair<std::string_view, uint32_t>::first);
+				if (it == std::ranges::end(_instructions))
+				{
+					return this->fail();
+				};
+				const auto _instruction = (it->second == spv::FAbs && is_int(_type)) ? uint32_t(spv::SAbs) : it->second;
+				auto _operands = std::vector<uint32_t>{ this->glsl_std, _instruction };
+				for (auto& _arg : _args)
+				{
+					_operands.push_back(this->convert(_arg, _type).id);
+				};
+				return this->op_id(spv::OpExtInst, _type, this->type_id(_type), _operands);
+			};
+
+			void label(uint32_t _id)
+			{
+				emit(this->code, spv::OpLabel, { _id });
+				this->terminated = false;
+				this->block = _id;
+			};
+			void branch(uint32_t _target)
+			{
+				emit(this->code, spv::OpBranch, { _target });
+				this->terminated = true;
+			};
+
+			void write_statements(std::span<const GLSLStatement> _statements)
+			{
+				for (auto& _statement : _statements)
+				{
+					// Anything after a return is unreachable, but still needs a block
+					if (this->terminated)
+					{
+						this->label(this->new_id());
+					};
+
+					switch (_statement.type)
+					{
+					case GLSLStatementType::declaration:
+						[[fallthrough]];
+					case GLSLStatementType::assignment:
+						this->store(_statement.dest, this->eval(_statement.expr));
+						break;
+
+					case GLSLStatementType::return_value:
+						if (this->return_type == GLSLType::glsl_void)
+						{
+							emit(this->code, spv::OpReturn, {});
+						}
+						else
+						{
+							const auto _value = this->convert(this->eval(_statement.expr), this->return_type);
+							emit(this->code, spv::OpReturnValue, { _value.id });
+						};
+						this->terminated = true;
+						break;
+
+					case GLSLStatementType::for_loop:
+						this->write_loop(_statement);
+						break;
+
+					case GLSLStatementType::if_else:
+						this->write_branch(_statement);
+						break;
+
+					default:
+						this->fail();
+						break;
+					};
+				};
+			};
+
+			/**
+			 * @brief Writes a for loop as a structured loop, the condition gets its own block after the header.
+			*/
+			void write_loop(const GLSLStatement& _loop)
+			{
+				const auto _index = this->context->type(_loop.dest);
+				this->store(_loop.dest, this->constant_int(_loop.loop.begin));
+
+				const auto _header = this->new_id();
+				const auto _condition = this->new_id();
+				const auto _body = this->new_id();
+				const auto _continue = this->new_id();
+				const auto _merge = this->new_id();
+
+				this->branch(_header);
+				this->label(_header);
+				emit(this->code, spv::OpLoopMerge, { _merge, _continue, 0 });
+				this->branch(_condition);
+
+				this->label(_condition);
+				const auto _value = this->load(_loop.dest);
+				const auto _bound = this->convert(this->eval(_loop.expr), _index);
+				const auto _test = this->op((_loop.loop.step > 0) ? spv::OpSLessThan : spv::OpSGreaterThan, GLSLType::glsl_bool,
+					{ _value.id, _bound.id });
+				emit(this->code, spv::OpBranchConditional, { _test.id, _body, _merge });
+
+				this->label(_body);
+				this->write_statements(_loop.body);
+				this->branch(_continue);
+
+				this->label(_continue);
+				const auto _current = this->load(_loop.dest);
+				const auto _next = this->op(spv::OpIAdd, _index, { _current.id, this->constant_int(_loop.loop.step).id });
+				this->store(_loop.dest, _next);
+				this->branch(_header);
+
+				this->label(_merge);
+			};
+
+			void write_branch(const GLSLStatement& _branch)
+			{
+				const auto _condition = this->convert(this->eval(_branch.expr), GLSLType::glsl_bool);
+				const auto _then = this->new_id();
+				const auto _merge = this->new_id();
+				const auto _else = (_branch.else_body.empty()) ? _merge : this->new_id();
+
+				emit(this->code, spv::OpSelectionMerge, { _merge, 0 });
+				emit(this->code, spv::OpBranchConditional, { _condition.id, _then, _else });
+
+				this->label(_then);
+				this->write_statements(_branch.body);
+				this->branch(_merge);
+
+				if (!_branch.else_body.empty())
+				{
+					this->label(_else);
+					this->write_statements(_branch.else_body);
+					this->branch(_merge);
+				};
+				this->label(_merge);
+			};
+
+			/**
+			 * @brief Declares a variable in memory.
+			*/
+			uint32_t declare(std::vector<uint32_t>& _out, GLSLVariableID _id, uint32_t _storage)
+			{
+				const auto _type = this->context->type(_id);
+				const auto _pointer = this->new_id();
+				emit(_out, spv::OpVariable, { this->pointer_id(_storage, this->type_id(_type)), _pointer, _storage });
+				this->variables.insert_or_assign(_id, Variable{ _pointer, _storage, _type });
+				this->name(_pointer, this->context->name(_id));
+				return _pointer;
+			};
+
+			void write_function(const GLSLFunction& _function, std::span<const GLSLStatement> _prologue)
+			{
+				this->return_type = _function.return_type();
+				this->locals.clear();
+				this->code.clear();
+
+				const auto _id = this->function_ids.at(_function.id());
+				auto _head = std::vector<uint32_t>();
+				emit(_head, spv::OpFunction, { this->type_id(this->return_type), _id, 0,
+					this->function_type_id(this->return_type, _function.params()) });
+
+				// Parameters are values, copied into variables as GLSL lets functions write them
+				auto _params = std::vector<std::pair<GLSLVariableID, uint32_t>>();
+				for (auto _param : _function.params())
+				{
+					const auto _value = this->new_id();
+					emit(_head, spv::OpFunctionParameter, { this->type_id(this->context->type(_param)), _value });
+					_params.push_back({ _param, _value });
+				};
+				this->block = this->new_id();
+				emit(_head, spv::OpLabel, { this->block });
+				this->terminated = false;
+
+				for (auto& [_param, _value] : _params)
+				{
+					this->declare(this->locals, _param, spv::Function);
+					this->store(_param, Value{ _value, this->context->type(_param) });
+				};
+				for_each_statement(_function.body(), [this](const GLSLStatement& _statement)
+					{
+						if (_statement.type == GLSLStatementType::declaration || _statement.type == GLSLStatementType::for_loop)
+						{
+							this->declare(this->locals, _statement.dest, spv::Function);
+						};
+					});
+
+				this->write_statements(_prologue);
+				this->write_statements(_function.body());
+				if (!this->terminated)
+				{
+					emit(this->code, (this->return_type == GLSLType::glsl_void) ? spv::OpReturn : spv::OpUnreachable, {});
+				};
+				emit(this->code, spv::OpFunctionEnd, {});
+
+				this->functions.insert(this->functions.end(), _head.begin(), _head.end());
+				this->functions.insert(this->functions.end(), this->locals.begin(), this->locals.end());
+				this->functions.insert(this->functions.end(), this->code.begin(), this->code.end());
+			};
+
+			/**
+			 * @brief Declares the inputs, outputs and uniforms, builtins only if the shader uses them.
+			*/
+			void declare_interface()
+			{
+				auto _used = std::set<GLSLVariableID>();
+				const auto _use = [&_used](const GLSLStatement& _statement)
+				{
+					if (_statement.has_dest())
+					{
+						_used.insert(_statement.dest);
+					};
+					for_each_expression(_statement.expr, [&_used](const GLSLExpression& _node)
+						{
+							for_each_param(_node, [&_used](const GLSLExpression::Parameter& _param)
+								{
+									if (_param.is_variable())
+									{
+										_used.insert(_param.id());
+									};
+								});
+						});
+				};
+				for_each_statement(this->params->globals, _use);
+				for (auto& _function : this->params->functions)
+				{
+					for_each_statement(_function.body(), _use);
+				};
+				for_each_statement(this->params->main_fn.body(), _use);
+
+				constexpr std::pair<std::string_view, uint32_t> _builtins[] =
+				{
+					{ "gl_Position", spv::Position }, { "gl_VertexID", spv::VertexIndex }, { "gl_InstanceID", spv::InstanceIndex },
+					{ "gl_FragCoord", spv::FragCoord }, { "gl_FrontFacing", spv::FrontFacing }, { "gl_PointCoord", spv::PointCoord },
+					{ "gl_FragDepth", spv::FragDepth },
+				};
+
+				uint32_t _inputs = 0;
+				uint32_t _outputs = 0;
+				uint32_t _samplers = 0;
+				auto _members = std::vector<const GLSLVariable*>();
+				for (auto& _var : this->context->variables())
+				{
+					if (_var.uniform())
+					{
+						if (!is_sampler(_var.type()))
+						{
+							_members.push_back(&_var);
+							continue;
+						};
+						const auto _pointer = this->declare(this->globals, _var.id(), spv::UniformConstant);
+						emit(this->decorations, spv::OpDecorate, { _pointer, spv::DescriptorSet, this->options->descriptor_set });
+						emit(this->decorations, spv::OpDecorate, { _pointer, spv::Binding, this->options->first_sampler_binding + _samplers++ });
+						continue;
+					};
+					if (_var.inout() == GLSLInOut::local || (_var.builtin() && !_used.contains(_var.id())))
+					{
+						continue;
+					};
+
+					const auto _input = _var.inout() == GLSLInOut::in;
+					const auto _pointer = this->declare(this->globals, _var.id(), (_input) ? spv::Input : spv::Output);
+					this->interface.push_back(_pointer);
+					if (_var.builtin())
+					{
+						const auto it = std::ranges::find(_builtins, _var.name(), &std::pair<std::string_view, uint32_t>::first);
+						if (it == std::ranges::end(_builtins))
+						{
+							this->fail();
+							continue;
+						};
+						emit(this->decorations, spv::OpDecorate, { _pointer, spv::BuiltIn, it->second });
+						this->depth_replacing = this->depth_replacing || it->second == spv::FragDepth;
+						continue;
+					};
+
+					emit(this->decorations, spv::OpDecorate, { _pointer, spv::Location, (_input) ? _inputs++ : _outputs++ });
+					if (_input && this->stage == GLSLShaderStage::fragment && !is_float_scalar(_var.type()) && !is_vector(_var.type()))
+					{
+						// Integer inputs are never interpolated
+						emit(this->decorations, spv::OpDecorate, { _pointer, spv::Flat });
+					};
+				};
+
+				if (!_members.empty())
+				{
+					this->declare_uniform_block(_members);
+				};
+			};
+
+			void declare_uniform_block(std::span<const GLSLVariable* const> _members)
+			{
+				auto _operands = std::vector<uint32_t>{ 0 };
+				for (auto _var : _members)
+				{
+					const auto _stored = (_var->type() == GLSLType::glsl_bool) ? GLSLType::glsl_int : _var->type();
+					_operands.push_back(this->type_id(_stored));
+				};
+				const auto _struct = this->new_id();
+				_operands.front() = _struct;
+				emit(this->globals, spv::OpTypeStruct, _operands);
+				emit(this->decorations, spv::OpDecorate, { _struct, spv::Block });
+				this->name(_struct, "Uniforms");
+
+				uint32_t _offset = 0;
+				for (uint32_t n = 0; n != _members.size(); ++n)
+				{
+					auto& _var = *_members[n];
+					const auto [_align, _size] = std140_layout(_var.type());
+					_offset = (_offset + _align - 1) / _align * _align;
+					emit(this->decorations, spv::OpMemberDecorate, { _struct, n, spv::Offset, _offset });
+					if (is_matrix(_var.type()))
+					{
+						emit(this->decorations, spv::OpMemberDecorate, { _struct, n, spv::ColMajor });
+						emit(this->decorations, spv::OpMemberDecorate, { _struct, n, spv::MatrixStride, 16 });
+					};
+					_offset += _size;
+
+					auto _name = std::vector<uint32_t>{ _struct, n };
+					append_string(_name, _var.name());
+					emit(this->names, spv::OpMemberName, _name);
+				};
+
+				this->uniform_block = this->new_id();
+				emit(this->globals, spv::OpVariable, { this->pointer_id(spv::Uniform, _struct), this->uniform_block, spv::Uniform });
+				emit(this->decorations, spv::OpDecorate, { this->uniform_block, spv::DescriptorSet, this->options->descriptor_set });
+				emit(this->decorations, spv::OpDecorate, { this->uniform_block, spv::Binding, this->options->uniform_block_binding });
+				for (uint32_t n = 0; n != _members.size(); ++n)
+				{
+					this->variables.insert_or_assign(_members[n]->id(), Variable{ this->uniform_block, spv::Uniform, _members[n]->type(), n });
+				};
+			};
+
+			std::vector<uint32_t> run()
+			{
+				this->glsl_std = this->new_id();
+				this->declare_interface();
+
+				// Globals live in Private storage, main initializes them before anything else
+				for (auto& _statement : this->params->globals)
+				{
+					if (_statement.has_dest() && !this->variables.contains(_statement.dest))
+					{
+						this->declare(this->globals, _statement.dest, spv::Private);
+					};
+				};
+
+				for (auto& _function : this->params->functions)
+				{
+					this->function_ids.insert_or_assign(_function.id(), this->new_id());
+				};
+				const auto _main = this->new_id();
+				this->function_ids.insert_or_assign(this->params->main_fn.id(), _main);
+				for (auto& _function : this->params->functions)
+				{
+					this->name(this->function_ids.at(_function.id()), _function.name());
+				};
+				this->name(_main, "main");
+
+				for (auto& _function : this->params->functions)
+				{
+					this->write_function(_function, {});
+				};
+				this->write_function(this->params->main_fn, this->params->globals);
+
+				return this->assemble(_main);
+			};
+
+			std::vector<uint32_t> assemble(uint32_t _main)
+			{
+				auto _words = std::vector<uint32_t>{ spirv_magic_v, spirv_version_v, 0, this->next_id, 0 };
+				emit(_words, spv::OpCapability, { spv::CapabilityShader });
+				if (this->float64)
+				{
+					emit(_words, spv::OpCapability, { spv::CapabilityFloat64 });
+				};
+
+				auto _import = std::vector<uint32_t>{ this->glsl_std };
+				append_string(_import, "GLSL.std.450");
+				emit(_words, spv::OpExtInstImport, _import);
+				emit(_words, spv::OpMemoryModel, { spv::AddressingModelLogical, spv::MemoryModelGLSL450 });
+
+				const auto _fragment = this->stage == GLSLShaderStage::fragment;
+				auto _entry = std::vector<uint32_t>{ (_fragment) ? spv::ExecutionModelFragment : spv::ExecutionModelVertex, _main };
+				append_string(_entry, "main");
+				_entry.insert(_entry.end(), this->interface.begin(), this->interface.end());
+				emit(_words, spv::OpEntryPoint, _entry);
+				if (_fragment)
+				{
+					emit(_words, spv::OpExecutionMode, { _main, spv::ExecutionModeOriginUpperLeft });
+					if (this->depth_replacing)
+					{
+						emit(_words, spv::OpExecutionMode, { _main, spv::ExecutionModeDepthReplacing });
+					};
+				};
+
+				for (auto _section : { &this->names, &this->decorations, &this->globals, &this->functions })
+				{
+					_words.insert(_words.end(), _section->begin(), _section->end());
+				};
+				return _words;
+			};
+		};
+	};
+
+	bool generate_spirv(const GLSLContext& _context, const GLSLParams& _params, GLSLShaderStage _stage,
+		std::vector<uint32_t>& _words, const GLSLSpirvOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::emit);
+		const auto _site = GLSLScopedAllocSite(GLSLAllocSite::emit);
+
+		auto _writer = SpirvWriter{ &_context, &_params, _stage, &_options };
+		auto _module = _writer.run();
+		if (!_writer.ok)
+		{
+			return false;
+		};
+		count_stat(GLSLCounter::bytes_emitted, _module.size() * sizeof(uint32_t));
+		_words = std::move(_module);
+		return true;
+	};
+
+	bool decode_spirv(std::span<const uint32_t> _words, GLSLSpirvModule& _module)
+	{
+		if (_words.size() < 5 || _words[0] != spirv_magic_v || _words[4] != 0)
+		{
+			return false;
+		};
+		_module = GLSLSpirvModule{};
+		_module.version = _words[1];
+		_module.generator = _words[2];
+		_module.bound = _words[3];
+
+		for (size_t n = 5; n != _words.size();)
+		{
+			const auto _count = size_t(_words[n] >> 16);
+			if (_count == 0 || _count > _words.size() - n)
+			{
+				return false;
+			};
+			auto& _instruction = _module.instructions.emplace_back();
+			_instruction.opcode = uint16_t(_words[n] & 0xFFFF);
+			_instruction.operands.assign(_words.begin() + n + 1, _words.begin() + n + _count);
+			n += _count;
+		};
+
+		// Results are defined once, every ID operand somewhere in the module
+		auto _defined = std::set<uint32_t>();
+		for (auto& _instruction : _module.instructions)
+		{
+			const auto _info = find_op_info(_instruction.opcode);
+			if (!_info || !_info->result)
+			{
+				continue;
+			};
+			const auto _at = size_t(_info->type);
+			if (_instruction.operands.size() <= _at)
+			{
+				return false;
+			};
+			const auto _id = _instruction.operands[_at];
+			if (_id == 0 || _id >= _module.bound || !_defined.insert(_id).second)
+			{
+				return false;
+			};
+		};
+		for (auto& _instruction : _module.instructions)
+		{
+			const auto _info = find_op_info(_instruction.opcode);
+			if (!_info)
+			{
+				continue;
+			};
+			bool _ok = !_info->type || (!_instruction.operands.empty() && _defined.contains(_instruction.operands[0]));
+			_ok = _ok && for_each_operand(*_info, _instruction, [&](OperandKind _kind, size_t _first, size_t)
+				{
+					if (_kind == OperandKind::id && !_defined.contains(_instruction.operands[_first]))
+					{
+						_ok = false;
+					};
+				});
+			if (!_ok)
+			{
+				return false;
+			};
+		};
+		return true;
+	};
+
+	std::vector<uint32_t> encode_spirv(const GLSLSpirvModule& _module)
+	{
+		auto _words = std::vector<uint32_t>{ spirv_magic_v, _module.version, _module.generator, _module.bound, 0 };
+		for (auto& _instruction : _module.instructions)
+		{
+			emit(_words, _instruction.opcode, _instruction.operands);
+		};
+		return _words;
+	};
+
+	void write_spirv_text(std::ostream& _ostr, const GLSLSpirvModule& _module)
+	{
+		_ostr << std::format("; SPIR-V {}.{}\n; Generator {}\n; Bound {}\n", (_module.version >> 16) & 0xFF,
+			(_module.version >> 8) & 0xFF, _module.generator, _module.bound);
+
+		for (auto& _instruction : _module.instructions)
+		{
+			auto& _words = _instruction.operands;
+			const auto _info = find_op_info(_instruction.opcode);
+			if (!_info)
+			{
+				_ostr << "Op<" << _instruction.opcode << '>';
+				for (auto w : _words)
+				{
+					_ostr << ' ' << w;
+				};
+				_ostr << '\n';
+				continue;
+			};
+
+			const auto _at = size_t(_info->type);
+			if (_info->result && _words.size() > _at)
+			{
+				_ostr << '%' << _words[_at] << " = ";
+			};
+			_ostr << _info->name;
+			if (_info->type && !_words.empty())
+			{
+				_ostr << " %" << _words[0];
+			};
+
+			const auto _complete = for_each_operand(*_info, _instruction, [&](OperandKind _kind, size_t _first, size_t _count)
+				{
+					switch (_kind)
+					{
+					case OperandKind::id:
+						_ostr << " %" << _words[_first];
+						break;
+					case OperandKind::string:
+						_ostr << " \"" << decode_string(std::span(_words).subspan(_first, _count)) << '"';
+						break;
+					default:
+						for (size_t n = 0; n != _count; ++n)
+						{
+							_ostr << ' ' << _words[_first + n];
+						};
+						break;
+					};
+				});
+			if (!_complete)
+			{
+				_ostr << " <unterminated string>";
+			};
+			_ostr << '\n';
+		};
+	};
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+namespace glsl
+{
+	/**
+	 * @brief Descriptor bindings used by generate_spirv().
+	*/
+	struct GLSLSpirvOptions
+	{
+		// Descriptor set holding every uniform
+		uint32_t descriptor_set = 0;
+
+		// Binding of the block holding the uniforms that are not samplers
+		uint32_t uniform_block_binding = 0;
+
+		// Binding of the first sampler, the others follow in declaration order
+		uint32_t first_sampler_binding = 1;
+	};
+
+	/**
+	 * @brief Lowers a shader straight to a SPIR-V 1.0 module for Vulkan.
+	 *
+	 * The module uses the Shader capability, the logical addressing model and the GLSL450
+	 * memory model. Builtin functions other than dot() and texture() are called through
+	 * the GLSL.std.450 extended instructions.
+	 *
+	 * Interface and resource layout:
+	 *	- Inputs and outputs get locations in declaration order. Outputs of the vertex shader
+	 *	  match the inputs of the fragment shader by location, not by name, so both must
+	 *	  declare them in the same order.
+	 *	- Builtins get BuiltIn decorations and are only declared if used. gl_VertexID and
+	 *	  gl_InstanceID become VertexIndex and InstanceIndex, which include the base vertex and
+	 *	  instance unlike in OpenGL.
+	 *	- Uniforms other than samplers are members of one std140 uniform block, bools being
+	 *	  stored as ints. Samplers are combined image samplers.
+	 *
+	 * Every variable lives in memory (locals in Function storage, globals in Private storage
+	 * initialized at the start of main) and is loaded and stored where the IR reads and
+	 * writes it. Drivers promote these to registers.
+	 *
+	 * Selects become OpSelect unless an operand calls a user function, those are written as
+	 * a structured branch joined by an OpPhi so only the chosen operand runs.
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters, must be resolved with auto types deduced.
+	 * @param _stage Stage of the shader.
+	 * @param _words Receives the module's words.
+	 * @param _options Descriptor bindings.
+	 * @return True on success, false if the shader uses something with no SPIR-V lowering
+	 *	(ie. matrix swizzles).
+	*/
+	bool generate_spirv(const GLSLContext& _context, const GLSLParams& _params, GLSLShaderStage _stage,
+		std::vector<uint32_t>& _words, const GLSLSpirvOptions& _options = {});
+
+	/**
+	 * @brief A decoded SPIR-V instruction.
+	*/
+	struct GLSLSpirvInstruction
+	{
+		uint16_t opcode = 0;
+
+		// Every word after the first, result type and result ID included
+		std::vector<uint32_t> operands{};
+	};
+
+	/**
+	 * @brief A decoded SPIR-V module.
+	*/
+	struct GLSLSpirvModule
+	{
+		uint32_t version = 0;
+		uint32_t generator = 0;
+
+		// Every ID is below the bound
+		uint32_t bound = 0;
+
+		std::vector<GLSLSpirvInstruction> instructions{};
+	};
+
+	/**
+	 * @brief Decodes and checks a SPIR-V module.
+	 *
+	 * Checks the header, that every instruction fits within the words and that IDs are
+	 * below the bound. For the opcodes generate_spirv() writes it also checks that result
+	 * IDs are defined once and that every ID operand is defined somewhere in the module.
+	 *
+	 * Encoding the decoded module with encode_spirv() gives back the same words.
+	 *
+	 * @param _words Module words, in the host's byte order.
+	 * @param _module Receives the decoded module.
+	 * @return True if the module is well formed, false otherwise.
+	*/
+	bool decode_spirv(std::span<const uint32_t> _words, GLSLSpirvModule& _module);
+
+	/**
+	 * @brief Encodes a module back into words.
+	*/
+	std::vector<uint32_t> encode_spirv(const GLSLSpirvModule& _module);
+
+	/**
+	 * @brief Writes a module as text, one instruction per line.
+	 *
+	 *	%12 = OpFAdd %7 %10 %11
+	 *
+	 * IDs are written as "%N", strings quoted and other literals as numbers. Opcodes
+	 * generate_spirv() does not write are shown as "Op<N>" followed by their raw words.
+	*/
+	void write_spirv_text(std::ostream& _ostr, const GLSLSpirvModule& _module);
+};
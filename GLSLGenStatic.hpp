@@ -0,0 +1,680 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+
+/*
+	Compile-time shader front end.
+
+	Shaders whose contents are fully known at compile time can be written with the types in
+	glsl::cx and turned into GLSL source during constant evaluation:
+
+		constexpr auto fragment_source_v = glsl::cx::make_shader<[](glsl::cx::Shader& s)
+		{
+			using enum glsl::GLSLType;
+			const auto frag_uvs = s.input<glsl_vec3>("frag_uvs");
+			const auto color = s.output<glsl_vec4>("color");
+			const auto tex = s.uniform<glsl_sampler_2D_array>("test_texture");
+			s.assign(color, glsl::cx::texture(tex, frag_uvs));
+		}>();
+
+		std::string_view _source = fragment_source_v.view();
+
+	Every expression carries its GLSL type as a template parameter. Operators, builtin calls
+	and assignments are constrained with the same rules the runtime IR uses (invocable(),
+	is_implicitly_convertible_to() and the overloads from add_builtin_functions()), so a type
+	mismatch fails to compile instead of asserting at runtime. Narrowing needs an explicit
+	cast<>(), ie. s.assign(color, cx::cast<glsl_vec4>(v)) with v a vec3 writes vec4(v.xyz, 1.0).
+	The result is a constexpr character array, generating it costs nothing at runtime and
+	allocates nothing.
+
+	The output follows generate_glsl()'s layout, without the variable ID comments.
+*/
+
+namespace glsl
+{
+	namespace cx
+	{
+		/*
+			Constexpr mirrors of the runtime type rules.
+		*/
+
+		constexpr bool is_scalar_type(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_int || _type == GLSLType::glsl_float || _type == GLSLType::glsl_double;
+		};
+		constexpr bool is_vector_type(GLSLType _type)
+		{
+			switch (_type)
+			{
+			case GLSLType::glsl_vec2:
+				[[fallthrough]];
+			case GLSLType::glsl_vec3:
+				[[fallthrough]];
+			case GLSLType::glsl_vec4:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec2:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec3:
+				[[fallthrough]];
+			case GLSLType::glsl_dvec4:
+				return true;
+			default:
+				return false;
+			};
+		};
+		constexpr bool is_matrix_type(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_mat4;
+		};
+		constexpr bool is_float_category(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_float || _type == GLSLType::glsl_vec2 ||
+				_type == GLSLType::glsl_vec3 || _type == GLSLType::glsl_vec4;
+		};
+		constexpr bool is_double_category(GLSLType _type)
+		{
+			return _type == GLSLType::glsl_double || _type == GLSLType::glsl_dvec2 ||
+				_type == GLSLType::glsl_dvec3 || _type == GLSLType::glsl_dvec4;
+		};
+
+		/**
+		 * @brief Same rules as is_implicitly_convertible_to().
+		*/
+		constexpr bool is_implicitly_convertible(GLSLType _fromType, GLSLType _toType)
+		{
+			if (_fromType == _toType)
+			{
+				return true;
+			};
+			if (is_vector_type(_toType) != is_vector_type(_fromType) || vec_size(_toType) != vec_size(_fromType))
+			{
+				return false;
+			};
+
+			if (is_double_category(_toType))
+			{
+				return is_float_category(_fromType) || _fromType == GLSLType::glsl_int;
+			}
+			else if (is_float_category(_toType))
+			{
+				return _fromType == GLSLType::glsl_int;
+			}
+			else
+			{
+				return false;
+			};
+		};
+
+		/**
+		 * @brief Same rules as is_castable_to().
+		*/
+		constexpr bool is_castable(GLSLType _fromType, GLSLType _toType)
+		{
+			const auto _isValue = [](GLSLType _type)
+			{
+				return _type != GLSLType::glsl_void && _type != GLSLType::glsl_sampler_2D &&
+					_type != GLSLType::glsl_sampler_2D_array;
+			};
+			return _isValue(_fromType) && _isValue(_toType);
+		};
+
+		constexpr GLSLType element_type_of(GLSLType _type)
+		{
+			if (is_matrix_type(_type))
+			{
+				return GLSLType::glsl_vec4;
+			};
+			return is_double_category(_type) ? GLSLType::glsl_double : GLSLType::glsl_float;
+		};
+
+		/**
+		 * @brief Same rules as invocable(GLSLBinaryOperator, GLSLType, GLSLType).
+		*/
+		constexpr bool is_binary_invocable(GLSLBinaryOperator _op, GLSLType lhs, GLSLType rhs)
+		{
+			if (_op == GLSLBinaryOperator::eq || _op == GLSLBinaryOperator::neq)
+			{
+				return lhs == rhs;
+			};
+			if (_op >= GLSLBinaryOperator::lt)
+			{
+				return lhs == rhs && is_scalar_type(lhs);
+			};
+
+			if (_op == GLSLBinaryOperator::mult &&
+				((is_matrix_type(lhs) && rhs == element_type_of(lhs)) || (is_matrix_type(rhs) && lhs == element_type_of(rhs))))
+			{
+				return true;
+			}
+			else if (is_scalar_type(lhs) && (is_vector_type(rhs) || is_matrix_type(rhs)))
+			{
+				return true;
+			}
+			else if (is_scalar_type(rhs) && (is_vector_type(lhs) || is_matrix_type(lhs)))
+			{
+				return true;
+			}
+			else
+			{
+				return lhs == rhs;
+			};
+		};
+		constexpr GLSLType binary_result_type(GLSLBinaryOperator _op, GLSLType lhs, GLSLType rhs)
+		{
+			if (_op == GLSLBinaryOperator::eq || _op == GLSLBinaryOperator::neq || _op >= GLSLBinaryOperator::lt)
+			{
+				return GLSLType::glsl_bool;
+			};
+			if (_op == GLSLBinaryOperator::mult && is_matrix_type(lhs) != is_matrix_type(rhs) &&
+				(is_vector_type(lhs) || is_vector_type(rhs)))
+			{
+				return (is_vector_type(lhs)) ? lhs : rhs;
+			};
+			return (is_scalar_type(lhs) && (is_vector_type(rhs) || is_matrix_type(rhs))) ? rhs : lhs;
+		};
+
+		constexpr GLSLType vector_type_of(GLSLType _elementType, size_t _count)
+		{
+			if (_count == 1)
+			{
+				return _elementType;
+			};
+			const auto _base = (_elementType == GLSLType::glsl_double) ? GLSLType::glsl_dvec2 : GLSLType::glsl_vec2;
+			return static_cast<GLSLType>(static_cast<int>(_base) + static_cast<int>(_count) - 2);
+		};
+
+		namespace impl
+		{
+			/**
+			 * @brief Not constexpr, calling it during constant evaluation stops compilation with the message in the diagnostic.
+			*/
+			inline void compile_error(const char* _what)
+			{
+				HUBRIS_ABORT_M(_what);
+			};
+
+			constexpr void append_int(std::string& _out, int64_t _value)
+			{
+				if (_value < 0)
+				{
+					_out += '-';
+				};
+				auto _magnitude = (_value < 0) ? static_cast<uint64_t>(-(_value + 1)) + 1 : static_cast<uint64_t>(_value);
+
+				char _buffer[24]{};
+				size_t n = 0;
+				do
+				{
+					_buffer[n++] = static_cast<char>('0' + _magnitude % 10);
+					_magnitude /= 10;
+				} while (_magnitude != 0);
+				while (n != 0)
+				{
+					_out += _buffer[--n];
+				};
+			};
+
+			/**
+			 * @brief Writes a value with 6 decimals, like the runtime's "{:f}" format.
+			*/
+			constexpr void append_fixed(std::string& _out, double _value)
+			{
+				if (!(_value == _value) || _value > 9.2e12 || _value < -9.2e12)
+				{
+					compile_error("literal is not finite or too large for a compile-time shader");
+				};
+
+				const bool _negative = _value < 0.0;
+				const auto _scaled = static_cast<uint64_t>((_negative ? -_value : _value) * 1000000.0 + 0.5);
+				if (_negative)
+				{
+					_out += '-';
+				};
+				append_int(_out, static_cast<int64_t>(_scaled / 1000000));
+				_out += '.';
+
+				auto _fraction = _scaled % 1000000;
+				char _digits[6]{};
+				for (size_t n = 6; n != 0; --n)
+				{
+					_digits[n - 1] = static_cast<char>('0' + _fraction % 10);
+					_fraction /= 10;
+				};
+				_out.append(_digits, 6);
+			};
+		};
+
+
+
+		/**
+		 * @brief A typed GLSL expression, holds its source text.
+		 * @tparam TypeV GLSL type of the expression's result.
+		*/
+		template <GLSLType TypeV>
+		struct Expr
+		{
+		public:
+			static constexpr GLSLType type_v = TypeV;
+
+			std::string text{};
+
+			/**
+			 * @brief Swizzles a vector.
+			 * @tparam Ns Component indexes, 0 to 3.
+			*/
+			template <size_t... Ns> requires (is_vector_type(TypeV) && sizeof...(Ns) >= 1 && sizeof...(Ns) <= 4 &&
+				((Ns < vec_size(TypeV)) && ...))
+			constexpr auto swizzle() const
+			{
+				constexpr char _names[] = { 'x', 'y', 'z', 'w' };
+				auto _out = Expr<vector_type_of(element_type_of(TypeV), sizeof...(Ns))>{};
+				_out.text = this->text;
+				_out.text += '.';
+				((_out.text += _names[Ns]), ...);
+				return _out;
+			};
+
+			constexpr auto x() const { return this->swizzle<0>(); };
+			constexpr auto y() const { return this->swizzle<1>(); };
+			constexpr auto z() const { return this->swizzle<2>(); };
+			constexpr auto w() const { return this->swizzle<3>(); };
+			constexpr auto xy() const { return this->swizzle<0, 1>(); };
+			constexpr auto xyz() const { return this->swizzle<0, 1, 2>(); };
+
+			constexpr Expr() = default;
+			constexpr explicit Expr(std::string_view _text) :
+				text(_text)
+			{};
+		};
+
+		/**
+		 * @brief An assignable variable, outputs and locals.
+		*/
+		template <GLSLType TypeV>
+		struct Var : public Expr<TypeV>
+		{
+			using Expr<TypeV>::Expr;
+		};
+
+		template <typename T>
+		struct is_expr : std::false_type {};
+		template <GLSLType TypeV>
+		struct is_expr<Expr<TypeV>> : std::true_type {};
+		template <GLSLType TypeV>
+		struct is_expr<Var<TypeV>> : std::true_type {};
+
+		/**
+		 * @brief Converts a value into an expression, scalars become literals.
+		*/
+		template <GLSLType TypeV>
+		constexpr const Expr<TypeV>& to_expr(const Expr<TypeV>& _expr) { return _expr; };
+		constexpr Expr<GLSLType::glsl_int> to_expr(int _value)
+		{
+			auto _out = Expr<GLSLType::glsl_int>{};
+			impl::append_int(_out.text, _value);
+			return _out;
+		};
+		constexpr Expr<GLSLType::glsl_float> to_expr(float _value)
+		{
+			auto _out = Expr<GLSLType::glsl_float>{};
+			impl::append_fixed(_out.text, _value);
+			return _out;
+		};
+		constexpr Expr<GLSLType::glsl_double> to_expr(double _value)
+		{
+			auto _out = Expr<GLSLType::glsl_double>{};
+			impl::append_fixed(_out.text, _value);
+			return _out;
+		};
+		constexpr Expr<GLSLType::glsl_bool> to_expr(bool _value)
+		{
+			return Expr<GLSLType::glsl_bool>(_value ? "true" : "false");
+		};
+
+		template <typename T>
+		concept cx_operand = is_expr<std::remove_cvref_t<T>>::value || std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+		template <typename T>
+		constexpr GLSLType type_of_v = std::remove_cvref_t<decltype(to_expr(std::declval<T>()))>::type_v;
+
+		/**
+		 * @brief Vector literal, ie. vec3(1.0f, 2.0f, 3.0f).
+		*/
+		template <typename... Ts> requires (sizeof...(Ts) >= 2 && sizeof...(Ts) <= 4 && (std::is_arithmetic_v<Ts> && ...))
+		constexpr auto vec(Ts... _values)
+		{
+			auto _out = Expr<vector_type_of(GLSLType::glsl_float, sizeof...(Ts))>{};
+			_out.text = glsl_typename(decltype(_out)::type_v);
+			_out.text += '(';
+			bool _first = true;
+			((_out.text += (_first ? "" : ", "), impl::append_fixed(_out.text, static_cast<float>(_values)), _first = false), ...);
+			_out.text += ')';
+			return _out;
+		};
+
+		/**
+		 * @brief Explicit conversion, same output as the runtime's Cast expression.
+		 *
+		 * Scalars are converted with a constructor, vectors are truncated with a swizzle or
+		 * padded with 0 (and 1 for w).
+		*/
+		template <GLSLType ToV, GLSLType FromV> requires (is_castable(FromV, ToV) || (ToV == FromV && ToV != GLSLType::glsl_void))
+		constexpr Expr<ToV> cast(const Expr<FromV>& _expr)
+		{
+			if constexpr (ToV == FromV)
+			{
+				return Expr<ToV>(_expr.text);
+			}
+			else if constexpr (is_vector_type(FromV))
+			{
+				constexpr auto _toSize = vec_size(ToV);
+				constexpr auto _fromSize = vec_size(FromV);
+				constexpr auto _smaller = std::min(_toSize, _fromSize);
+				constexpr std::string_view _swizzle = "xyzw";
+
+				auto _out = Expr<ToV>{};
+				if constexpr (_toSize > _fromSize)
+				{
+					_out.text = glsl_typename(ToV);
+					_out.text += '(';
+				};
+				_out.text += _expr.text;
+				_out.text += '.';
+				_out.text += _swizzle.substr(0, _smaller);
+				if constexpr (_toSize > _fromSize)
+				{
+					for (size_t n = _smaller; n != _toSize; ++n)
+					{
+						_out.text += (n == 3) ? ", 1.0" : ", 0.0";
+					};
+					_out.text += ')';
+				};
+				return _out;
+			}
+			else
+			{
+				auto _out = Expr<ToV>(glsl_typename(ToV));
+				_out.text += '(';
+				_out.text += _expr.text;
+				_out.text += ')';
+				return _out;
+			};
+		};
+
+		/**
+		 * @brief Converts an expression for use where a type is expected, like assign() and resolve_params() do.
+		*/
+		template <GLSLType ToV, GLSLType FromV> requires (is_implicitly_convertible(FromV, ToV))
+		constexpr Expr<ToV> convert(const Expr<FromV>& _expr)
+		{
+			return cast<ToV>(_expr);
+		};
+
+		namespace impl
+		{
+			template <GLSLBinaryOperator OpV, GLSLType L, GLSLType R>
+			constexpr auto binary_op(const Expr<L>& lhs, const Expr<R>& rhs, std::string_view _op)
+			{
+				auto _out = Expr<binary_result_type(OpV, L, R)>{};
+				_out.text = '(';
+				_out.text += lhs.text;
+				_out.text += _op;
+				_out.text += rhs.text;
+				_out.text += ')';
+				return _out;
+			};
+		};
+
+#define GLSL_CX_BINARY_OP(op, name, str) \
+		template <cx_operand L, cx_operand R> requires ((is_expr<std::remove_cvref_t<L>>::value || is_expr<std::remove_cvref_t<R>>::value) && \
+			is_binary_invocable(GLSLBinaryOperator::name, type_of_v<L>, type_of_v<R>)) \
+		constexpr auto operator op(const L& lhs, const R& rhs) \
+		{ \
+			return impl::binary_op<GLSLBinaryOperator::name>(to_expr(lhs), to_expr(rhs), str); \
+		};
+		GLSL_CX_BINARY_OP(+, add, " + ")
+		GLSL_CX_BINARY_OP(-, sub, " - ")
+		GLSL_CX_BINARY_OP(*, mult, " * ")
+		GLSL_CX_BINARY_OP(/, div, " / ")
+		GLSL_CX_BINARY_OP(==, eq, " == ")
+		GLSL_CX_BINARY_OP(!=, neq, " != ")
+		GLSL_CX_BINARY_OP(<, lt, " < ")
+		GLSL_CX_BINARY_OP(<=, le, " <= ")
+		GLSL_CX_BINARY_OP(>, gt, " > ")
+		GLSL_CX_BINARY_OP(>=, ge, " >= ")
+#undef GLSL_CX_BINARY_OP
+
+		namespace impl
+		{
+			template <GLSLType ResultV, typename... Ts>
+			constexpr Expr<ResultV> call(std::string_view _name, const Ts&... _args)
+			{
+				auto _out = Expr<ResultV>(_name);
+				_out.text += '(';
+				bool _first = true;
+				((_out.text += (_first ? "" : ", "), _out.text += _args.text, _first = false), ...);
+				_out.text += ')';
+				return _out;
+			};
+		};
+
+		/*
+			Builtin functions, the overloads match add_builtin_functions().
+		*/
+
+#define GLSL_CX_FLOAT_FN(fn) \
+		template <cx_operand T> requires (is_implicitly_convertible(type_of_v<T>, GLSLType::glsl_float)) \
+		constexpr Expr<GLSLType::glsl_float> fn(const T& _value) \
+		{ \
+			return impl::call<GLSLType::glsl_float>(#fn, convert<GLSLType::glsl_float>(to_expr(_value))); \
+		};
+		GLSL_CX_FLOAT_FN(sin)
+		GLSL_CX_FLOAT_FN(cos)
+		GLSL_CX_FLOAT_FN(tan)
+		GLSL_CX_FLOAT_FN(abs)
+#undef GLSL_CX_FLOAT_FN
+
+		template <GLSLType L, GLSLType R> requires (L == R && (is_float_category(L) || is_double_category(L)))
+		constexpr auto dot(const Expr<L>& lhs, const Expr<R>& rhs)
+		{
+			return impl::call<is_double_category(L) ? GLSLType::glsl_double : GLSLType::glsl_float>("dot", lhs, rhs);
+		};
+
+		template <GLSLType SamplerV, GLSLType CoordV> requires (
+			(SamplerV == GLSLType::glsl_sampler_2D && is_implicitly_convertible(CoordV, GLSLType::glsl_vec2)) ||
+			(SamplerV == GLSLType::glsl_sampler_2D_array && is_implicitly_convertible(CoordV, GLSLType::glsl_vec3)))
+		constexpr Expr<GLSLType::glsl_vec4> texture(const Expr<SamplerV>& _sampler, const Expr<CoordV>& _coord)
+		{
+			constexpr auto _coordType = (SamplerV == GLSLType::glsl_sampler_2D) ? GLSLType::glsl_vec2 : GLSLType::glsl_vec3;
+			return impl::call<GLSLType::glsl_vec4>("texture", _sampler, convert<_coordType>(_coord));
+		};
+
+
+
+		/**
+		 * @brief Collects the declarations and statements of a compile-time shader.
+		*/
+		struct Shader
+		{
+		public:
+
+			int version = 330;
+
+			template <GLSLType TypeV>
+			constexpr Expr<TypeV> input(std::string_view _name)
+			{
+				this->declare_name(_name);
+				this->append_declaration(this->inputs_, "in ", TypeV, _name);
+				return Expr<TypeV>(_name);
+			};
+			template <GLSLType TypeV>
+			constexpr Var<TypeV> output(std::string_view _name)
+			{
+				this->declare_name(_name);
+				this->append_declaration(this->outputs_, "out ", TypeV, _name);
+				return Var<TypeV>(_name);
+			};
+			template <GLSLType TypeV>
+			constexpr Expr<TypeV> uniform(std::string_view _name)
+			{
+				this->declare_name(_name);
+				this->append_declaration(this->uniforms_, "uniform ", TypeV, _name);
+				return Expr<TypeV>(_name);
+			};
+
+			/**
+			 * @brief Names a builtin variable, builtins are not declared in the output.
+			*/
+			template <GLSLType TypeV>
+			constexpr Expr<TypeV> builtin_input(std::string_view _name)
+			{
+				return Expr<TypeV>(_name);
+			};
+			template <GLSLType TypeV>
+			constexpr Var<TypeV> builtin_output(std::string_view _name)
+			{
+				return Var<TypeV>(_name);
+			};
+
+			/**
+			 * @brief Declares a local variable in main.
+			 * @param _name Variable name.
+			 * @param _value Initial value, must be implicitly convertible to the variable's type.
+			 * @return The new variable.
+			*/
+			template <GLSLType TypeV, typename T> requires (cx_operand<T> && is_implicitly_convertible(type_of_v<T>, TypeV))
+			constexpr Var<TypeV> declare(std::string_view _name, const T& _value)
+			{
+				this->declare_name(_name);
+				this->body_ += '\t';
+				this->body_ += glsl_typename(TypeV);
+				this->body_ += ' ';
+				this->body_ += _name;
+				this->body_ += " = ";
+				this->body_ += convert<TypeV>(to_expr(_value)).text;
+				this->body_ += ";\n";
+				return Var<TypeV>(_name);
+			};
+
+			/**
+			 * @brief Declares a local variable of the value's type, named like the runtime's auto variables.
+			*/
+			template <typename T> requires (cx_operand<T>)
+			constexpr Var<type_of_v<T>> declare(const T& _value)
+			{
+				auto _name = std::string("_var");
+				impl::append_int(_name, static_cast<int64_t>(++this->temporaries_));
+				return this->declare<type_of_v<T>>(_name, _value);
+			};
+
+			/**
+			 * @brief Assigns a value to a variable, the value must be implicitly convertible to its type.
+			*/
+			template <GLSLType TypeV, typename T> requires (cx_operand<T> && is_implicitly_convertible(type_of_v<T>, TypeV))
+			constexpr void assign(const Var<TypeV>& _dest, const T& _value)
+			{
+				this->body_ += '\t';
+				this->body_ += _dest.text;
+				this->body_ += " = ";
+				this->body_ += convert<TypeV>(to_expr(_value)).text;
+				this->body_ += ";\n";
+			};
+
+			/**
+			 * @brief Assembles the GLSL source.
+			*/
+			constexpr std::string str() const
+			{
+				auto _out = std::string("#version ");
+				impl::append_int(_out, this->version);
+				_out += " core\n\n";
+				for (auto _section : { &this->inputs_, &this->outputs_ })
+				{
+					if (!_section->empty())
+					{
+						_out += *_section;
+						_out += '\n';
+					};
+				};
+				_out += this->uniforms_;
+				_out += "void main()\n{\n";
+				_out += this->body_;
+				_out += "};\n";
+				return _out;
+			};
+
+			constexpr Shader() = default;
+
+		private:
+
+			constexpr void declare_name(std::string_view _name)
+			{
+				if (std::ranges::find(this->names_, _name) != this->names_.end())
+				{
+					impl::compile_error("name declared twice in compile-time shader");
+				};
+				this->names_.push_back(std::string(_name));
+			};
+			constexpr void append_declaration(std::string& _section, std::string_view _qualifier, GLSLType _type,
+				std::string_view _name)
+			{
+				_section += _qualifier;
+				_section += glsl_typename(_type);
+				_section += ' ';
+				_section += _name;
+				_section += ";\n";
+			};
+
+			std::vector<std::string> names_{};
+			std::string inputs_{};
+			std::string outputs_{};
+			std::string uniforms_{};
+			std::string body_{};
+			size_t temporaries_ = 0;
+		};
+
+		/**
+		 * @brief GLSL source produced at compile time.
+		*/
+		template <size_t N>
+		struct StaticSource
+		{
+			std::array<char, N + 1> data{};
+
+			constexpr std::string_view view() const noexcept { return std::string_view(this->data.data(), N); };
+			constexpr const char* c_str() const noexcept { return this->data.data(); };
+			constexpr size_t size() const noexcept { return N; };
+		};
+
+		/**
+		 * @brief Runs a shader definition during constant evaluation and returns its GLSL source.
+		 * @tparam BuildFn Captureless callable taking a Shader&.
+		*/
+		template <auto BuildFn>
+		consteval auto make_shader()
+		{
+			constexpr auto _generate = []()
+			{
+				auto _shader = Shader();
+				BuildFn(_shader);
+				return _shader.str();
+			};
+
+			constexpr auto _size = _generate().size();
+			auto _out = StaticSource<_size>{};
+			const auto _source = _generate();
+			std::ranges::copy(_source, _out.data.begin());
+			return _out;
+		};
+	};
+};
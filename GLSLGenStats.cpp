@@ -0,0 +1,199 @@
+#include "GLSLGenStats.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <ostream>
+
+namespace glsl
+{
+	namespace impl
+	{
+		int64_t stats_now_ns() noexcept
+		{
+			using clock = std::chrono::steady_clock;
+			static const auto epoch_ = clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch_).count();
+		};
+		uint32_t stats_thread_id() noexcept
+		{
+			static std::atomic<uint32_t> next_{ 1 };
+			thread_local const uint32_t id_ = next_.fetch_add(1, std::memory_order_relaxed);
+			return id_;
+		};
+	};
+
+	void GLSLStats::add_phase(GLSLPhase _phase, int64_t _startNs, int64_t _durationNs, uint32_t _thread)
+	{
+		auto& _totals = this->phases_[static_cast<size_t>(_phase)];
+		++_totals.calls;
+		_totals.ns += _durationNs;
+
+		if (this->trace_)
+		{
+			this->events_.push_back(GLSLTraceEvent{ _phase, _thread, _startNs, _durationNs });
+		};
+	};
+
+	void GLSLStats::merge(const GLSLStats& _other)
+	{
+		for (size_t n = 0; n != glsl_phase_count_v; ++n)
+		{
+			this->phases_[n].calls += _other.phases_[n].calls;
+			this->phases_[n].ns += _other.phases_[n].ns;
+		};
+		for (size_t n = 0; n != glsl_counter_count_v; ++n)
+		{
+			this->counters_[n] += _other.counters_[n];
+		};
+		for (size_t n = 0; n != glsl_alloc_site_count_v; ++n)
+		{
+			this->allocs_[n].count += _other.allocs_[n].count;
+			this->allocs_[n].bytes += _other.allocs_[n].bytes;
+		};
+		this->peak_live_ = std::max(this->peak_live_, _other.peak_live_);
+		if (!this->perf_counters_)
+		{
+			this->perf_counters_ = _other.perf_counters_;
+		};
+		for (size_t n = 0; n != glsl_phase_count_v; ++n)
+		{
+			this->add_perf(static_cast<GLSLPhase>(n), GLSLPerfSample{}, _other.perf_[n]);
+		};
+		this->events_.insert(this->events_.end(), _other.events_.begin(), _other.events_.end());
+		this->shaders_ += _other.shaders_;
+	};
+
+	void GLSLStats::clear()
+	{
+		this->phases_ = {};
+		this->counters_ = {};
+		this->allocs_ = {};
+		this->live_ = 0;
+		this->peak_live_ = 0;
+		this->perf_ = {};
+		this->events_.clear();
+		this->shaders_ = 1;
+	};
+
+	void GLSLStats::write_chrome_trace(std::ostream& _ostr) const
+	{
+		_ostr << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+		// Complete events, timestamps are in microseconds
+		bool _first = true;
+		int64_t _end = 0;
+		for (auto& v : this->events_)
+		{
+			_ostr << (_first ? "" : ",\n")
+				<< std::format("{{\"name\":\"{}\",\"cat\":\"glsl\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:f},\"dur\":{:f}}}",
+					phase_name(v.phase), v.thread, (double)v.start_ns * 1e-3, (double)v.duration_ns * 1e-3);
+			_end = std::max(_end, v.start_ns + v.duration_ns);
+			_first = false;
+		};
+
+		// Final counter values
+		_ostr << (_first ? "" : ",\n") << std::format("{{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":{:f},\"args\":{{",
+			(double)_end * 1e-3);
+		for (size_t n = 0; n != glsl_counter_count_v; ++n)
+		{
+			const auto _counter = static_cast<GLSLCounter>(n);
+			_ostr << ((n != 0) ? "," : "") << std::format("\"{}\":{}", counter_name(_counter), this->counter(_counter));
+		};
+		_ostr << "}}\n]}\n";
+	};
+
+	void GLSLStats::write_summary(std::ostream& _ostr) const
+	{
+		_ostr << std::format("{:<22}{:>10}{:>14}{:>14}\n", "phase", "calls", "total ms", "ms/shader");
+		for (size_t n = 0; n != glsl_phase_count_v; ++n)
+		{
+			const auto _phase = static_cast<GLSLPhase>(n);
+			const auto& _totals = this->phase(_phase);
+			if (_totals.calls == 0)
+			{
+				continue;
+			};
+
+			const auto _ms = (double)_totals.ns * 1e-6;
+			_ostr << std::format("{:<22}{:>10}{:>14.3f}{:>14.3f}\n", phase_name(_phase), _totals.calls,
+				_ms, _ms / (double)this->shaders_);
+		};
+
+		_ostr << std::format("{:<22}{:>10}{:>14}\n", "counter", "", "per shader");
+		for (size_t n = 0; n != glsl_counter_count_v; ++n)
+		{
+			const auto _counter = static_cast<GLSLCounter>(n);
+			_ostr << std::format("{:<22}{:>10}{:>14}\n", counter_name(_counter), this->counter(_counter),
+				this->counter(_counter) / this->shaders_);
+		};
+
+		if (!allocation_hook_installed())
+		{
+			return;
+		};
+
+		_ostr << std::format("{:<22}{:>10}{:>14}{:>14}\n", "allocations", "count", "bytes", "count/shader");
+		for (size_t n = 0; n != glsl_alloc_site_count_v; ++n)
+		{
+			const auto _site = static_cast<GLSLAllocSite>(n);
+			const auto& _totals = this->allocations(_site);
+			_ostr << std::format("{:<22}{:>10}{:>14}{:>14}\n", alloc_site_name(_site), _totals.count, _totals.bytes,
+				_totals.count / this->shaders_);
+		};
+		const auto _total = this->allocations();
+		_ostr << std::format("{:<22}{:>10}{:>14}{:>14}\n", "total", _total.count, _total.bytes,
+			_total.count / this->shaders_);
+		_ostr << std::format("{:<22}{:>10}{:>14}\n", "peak live bytes", "", this->peak_live_bytes());
+	};
+	void GLSLStats::write_perf_summary(std::ostream& _ostr) const
+	{
+		const auto _perf = this->perf_counters_;
+		const auto _available = [_perf](GLSLPerfEvent _event)
+		{
+			return _perf && _perf->available(_event);
+		};
+
+		_ostr << std::format("{:<14}", "phase");
+		for (size_t n = 0; n != glsl_perf_event_count_v; ++n)
+		{
+			if (_available(static_cast<GLSLPerfEvent>(n)))
+			{
+				_ostr << std::format("{:>16}", perf_event_name(static_cast<GLSLPerfEvent>(n)));
+			};
+		};
+		const auto _ipc = _available(GLSLPerfEvent::cycles) && _available(GLSLPerfEvent::instructions);
+		if (_ipc)
+		{
+			_ostr << std::format("{:>8}", "ipc");
+		};
+		_ostr << '\n';
+
+		for (size_t p = 0; p != glsl_phase_count_v; ++p)
+		{
+			const auto _phase = static_cast<GLSLPhase>(p);
+			if (this->phase(_phase).calls == 0)
+			{
+				continue;
+			};
+
+			_ostr << std::format("{:<14}", phase_name(_phase));
+			for (size_t n = 0; n != glsl_perf_event_count_v; ++n)
+			{
+				const auto _event = static_cast<GLSLPerfEvent>(n);
+				if (_available(_event))
+				{
+					_ostr << std::format("{:>16}", this->perf(_phase, _event));
+				};
+			};
+			if (_ipc)
+			{
+				const auto _cycles = this->perf(_phase, GLSLPerfEvent::cycles);
+				const auto _instructions = this->perf(_phase, GLSLPerfEvent::instructions);
+				_ostr << std::format("{:>8.2f}", (_cycles != 0) ? (double)_instructions / (double)_cycles : 0.0);
+			};
+			_ostr << '\n';
+		};
+	};
+};
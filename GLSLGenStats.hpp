@@ -0,0 +1,443 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenPerf.hpp"
+
+#include <array>
+#include <iosfwd>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Set to 0 to compile out all instrumentation, timers and counters then become empty inline functions.
+*/
+#ifndef GLSL_GEN_STATS
+	#define GLSL_GEN_STATS 1
+#endif
+
+namespace glsl
+{
+	/**
+	 * @brief Stages of shader generation that are timed.
+	*/
+	enum class GLSLPhase : uint8_t
+	{
+		// Constructing the IR in user code
+		build = 0,
+		parse,
+		link,
+		deduce_auto,
+		check,
+		// Overload resolution, resolve_params()
+		resolve,
+		// IR to IR passes, ie. inlining
+		optimize,
+		emit,
+	};
+	constexpr size_t glsl_phase_count_v = 8;
+
+	constexpr std::string_view phase_name(GLSLPhase _phase)
+	{
+		constexpr auto _names = std::array<std::string_view, glsl_phase_count_v>
+		{
+			"build", "parse", "link", "deduce_auto", "check", "resolve", "optimize", "emit"
+		};
+		return _names[static_cast<size_t>(_phase)];
+	};
+
+	/**
+	 * @brief Events counted during generation.
+	*/
+	enum class GLSLCounter : uint8_t
+	{
+		// Expression nodes allocated
+		nodes = 0,
+		// Name lookups, id() and function_id()
+		lookups,
+		// Overloads rated by find_best_overload()
+		overload_evaluations,
+		// Bytes written by generate_glsl()
+		bytes_emitted,
+	};
+	constexpr size_t glsl_counter_count_v = 4;
+
+	constexpr std::string_view counter_name(GLSLCounter _counter)
+	{
+		constexpr auto _names = std::array<std::string_view, glsl_counter_count_v>
+		{
+			"nodes", "lookups", "overload_evaluations", "bytes_emitted"
+		};
+		return _names[static_cast<size_t>(_counter)];
+	};
+
+	/**
+	 * @brief Categories heap allocations are attributed to, see GLSLScopedAllocSite.
+	*/
+	enum class GLSLAllocSite : uint8_t
+	{
+		other = 0,
+		// Expression nodes
+		nodes,
+		// Variable and function declarations, their map nodes and names
+		symbols,
+		// Overload rating in find_best_overload()
+		overloads,
+		// Swizzle strings
+		strings,
+		// Anything allocated while writing output
+		emit,
+	};
+	constexpr size_t glsl_alloc_site_count_v = 6;
+
+	constexpr std::string_view alloc_site_name(GLSLAllocSite _site)
+	{
+		constexpr auto _names = std::array<std::string_view, glsl_alloc_site_count_v>
+		{
+			"other", "nodes", "symbols", "overloads", "strings", "emit"
+		};
+		return _names[static_cast<size_t>(_site)];
+	};
+
+	struct GLSLAllocTotals
+	{
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	/**
+	 * @brief Checks if the counting allocation hook is compiled in.
+	 *
+	 * The hook replaces the global operator new and delete, it is only built when
+	 * GLSL_GEN_ALLOC_HOOK is defined to 1. Without it, allocation stats stay empty.
+	*/
+	bool allocation_hook_installed() noexcept;
+
+	/**
+	 * @brief A single timed phase, used for trace output.
+	*/
+	struct GLSLTraceEvent
+	{
+		GLSLPhase phase;
+		uint32_t thread;
+
+		// Nanoseconds since the process' first timestamp
+		int64_t start_ns;
+		int64_t duration_ns;
+	};
+
+	/**
+	 * @brief Phase times and counters collected while a GLSLStatsScope is active.
+	 *
+	 * Phase times are inclusive, a resolve inside build counts towards both. Allocations are
+	 * only recorded if the allocation hook is installed, see allocation_hook_installed().
+	*/
+	struct GLSLStats
+	{
+	public:
+
+		struct PhaseTotals
+		{
+			uint64_t calls = 0;
+			int64_t ns = 0;
+		};
+
+		const PhaseTotals& phase(GLSLPhase _phase) const
+		{
+			return this->phases_[static_cast<size_t>(_phase)];
+		};
+		double seconds(GLSLPhase _phase) const
+		{
+			return (double)this->phase(_phase).ns * 1e-9;
+		};
+		uint64_t counter(GLSLCounter _counter) const
+		{
+			return this->counters_[static_cast<size_t>(_counter)];
+		};
+
+		const GLSLAllocTotals& allocations(GLSLAllocSite _site) const
+		{
+			return this->allocs_[static_cast<size_t>(_site)];
+		};
+
+		/**
+		 * @brief Gets the allocations over all sites.
+		*/
+		GLSLAllocTotals allocations() const noexcept
+		{
+			auto _out = GLSLAllocTotals{};
+			for (auto& v : this->allocs_)
+			{
+				_out.count += v.count;
+				_out.bytes += v.bytes;
+			};
+			return _out;
+		};
+
+		/**
+		 * @brief Highest number of bytes live at once from allocations made while collecting.
+		 *
+		 * For merged stats this is the highest peak of any single shader.
+		*/
+		uint64_t peak_live_bytes() const noexcept { return this->peak_live_; };
+
+		/**
+		 * @brief Gets the change in a performance counter over all calls of a phase.
+		*/
+		uint64_t perf(GLSLPhase _phase, GLSLPerfEvent _event) const
+		{
+			return this->perf_[static_cast<size_t>(_phase)][static_cast<size_t>(_event)];
+		};
+
+		/**
+		 * @brief Samples performance counters around every phase.
+		 *
+		 * The counters only count the thread that opened them, so they must be opened on the
+		 * thread collecting these stats.
+		 *
+		 * @param _counters Open counters, or null to stop sampling. Must outlive collection.
+		*/
+		GLSLStats& set_perf_counters(const GLSLPerfCounters* _counters) noexcept
+		{
+			this->perf_counters_ = _counters;
+			return *this;
+		};
+		const GLSLPerfCounters* perf_counters() const noexcept { return this->perf_counters_; };
+
+		/**
+		 * @brief Gets the recorded phase events, only filled if tracing is enabled.
+		*/
+		const std::vector<GLSLTraceEvent>& events() const noexcept { return this->events_; };
+
+		/**
+		 * @brief Enables recording individual phase events for write_chrome_trace().
+		*/
+		GLSLStats& set_trace(bool _trace = true) noexcept
+		{
+			this->trace_ = _trace;
+			return *this;
+		};
+		bool trace() const noexcept { return this->trace_; };
+
+		/**
+		 * @brief Number of shaders the stats cover, 1 unless stats have been merged.
+		*/
+		size_t shaders() const noexcept { return this->shaders_; };
+
+		void add_phase(GLSLPhase _phase, int64_t _startNs, int64_t _durationNs, uint32_t _thread);
+		void add_perf(GLSLPhase _phase, const GLSLPerfSample& _start, const GLSLPerfSample& _end) noexcept
+		{
+			auto& _totals = this->perf_[static_cast<size_t>(_phase)];
+			for (size_t n = 0; n != glsl_perf_event_count_v; ++n)
+			{
+				_totals[n] += _end[n] - _start[n];
+			};
+		};
+		void add_count(GLSLCounter _counter, uint64_t _count = 1) noexcept
+		{
+			this->counters_[static_cast<size_t>(_counter)] += _count;
+		};
+
+		void add_allocation(GLSLAllocSite _site, size_t _bytes) noexcept
+		{
+			auto& _totals = this->allocs_[static_cast<size_t>(_site)];
+			++_totals.count;
+			_totals.bytes += _bytes;
+
+			this->live_ += static_cast<int64_t>(_bytes);
+			if (this->live_ > static_cast<int64_t>(this->peak_live_))
+			{
+				this->peak_live_ = static_cast<uint64_t>(this->live_);
+			};
+		};
+		void add_deallocation(size_t _bytes) noexcept
+		{
+			this->live_ -= static_cast<int64_t>(_bytes);
+		};
+
+		/**
+		 * @brief Adds another set of stats to this one, used to aggregate a batch.
+		 * @param _other Stats to add.
+		*/
+		void merge(const GLSLStats& _other);
+
+		void clear();
+
+		/**
+		 * @brief Writes the recorded events as Chrome trace-event JSON (chrome://tracing, Perfetto).
+		 * @param _ostr Output stream.
+		*/
+		void write_chrome_trace(std::ostream& _ostr) const;
+
+		/**
+		 * @brief Writes a human readable table of phase times and counters.
+		 * @param _ostr Output stream.
+		*/
+		void write_summary(std::ostream& _ostr) const;
+
+		/**
+		 * @brief Writes a table of performance counter deltas per phase.
+		 * @param _ostr Output stream.
+		*/
+		void write_perf_summary(std::ostream& _ostr) const;
+
+		GLSLStats() = default;
+
+	private:
+		std::array<PhaseTotals, glsl_phase_count_v> phases_{};
+		std::array<uint64_t, glsl_counter_count_v> counters_{};
+		std::array<GLSLAllocTotals, glsl_alloc_site_count_v> allocs_{};
+		int64_t live_ = 0;
+		uint64_t peak_live_ = 0;
+		std::array<GLSLPerfSample, glsl_phase_count_v> perf_{};
+		const GLSLPerfCounters* perf_counters_ = nullptr;
+		std::vector<GLSLTraceEvent> events_{};
+		size_t shaders_ = 1;
+		bool trace_ = false;
+	};
+
+	namespace impl
+	{
+		inline thread_local GLSLStats* active_stats_ = nullptr;
+		inline thread_local GLSLAllocSite alloc_site_ = GLSLAllocSite::other;
+
+		int64_t stats_now_ns() noexcept;
+		uint32_t stats_thread_id() noexcept;
+	};
+
+	/**
+	 * @brief Gets the stats being collected on this thread.
+	 * @return Active stats, or null if none.
+	*/
+	inline GLSLStats* active_stats() noexcept
+	{
+#if GLSL_GEN_STATS
+		return impl::active_stats_;
+#else
+		return nullptr;
+#endif
+	};
+
+	/**
+	 * @brief Collects stats on the current thread for the lifetime of the scope, scopes may nest.
+	*/
+	struct GLSLStatsScope
+	{
+	public:
+		explicit GLSLStatsScope(GLSLStats& _stats) noexcept
+#if GLSL_GEN_STATS
+			: previous_(impl::active_stats_)
+		{
+			impl::active_stats_ = &_stats;
+		};
+		~GLSLStatsScope()
+		{
+			impl::active_stats_ = this->previous_;
+		};
+#else
+		{};
+#endif
+
+		GLSLStatsScope(const GLSLStatsScope&) = delete;
+		GLSLStatsScope& operator=(const GLSLStatsScope&) = delete;
+
+	private:
+#if GLSL_GEN_STATS
+		GLSLStats* previous_;
+#endif
+	};
+
+	/**
+	 * @brief Adds to a counter of the active stats, does nothing if none are active.
+	*/
+	inline void count_stat(GLSLCounter _counter, uint64_t _count = 1) noexcept
+	{
+#if GLSL_GEN_STATS
+		if (const auto _stats = impl::active_stats_; _stats) [[unlikely]]
+		{
+			_stats->add_count(_counter, _count);
+		};
+#endif
+	};
+
+	/**
+	 * @brief Times a phase for the lifetime of the scope, does nothing if no stats are active.
+	*/
+	struct GLSLScopedPhase
+	{
+	public:
+		explicit GLSLScopedPhase(GLSLPhase _phase) noexcept
+#if GLSL_GEN_STATS
+			: stats_(impl::active_stats_), phase_(_phase)
+		{
+			if (this->stats_) [[unlikely]]
+			{
+				if (const auto _perf = this->stats_->perf_counters(); _perf)
+				{
+					_perf->read(this->start_perf_);
+				};
+				this->start_ = impl::stats_now_ns();
+			};
+		};
+		~GLSLScopedPhase()
+		{
+			if (this->stats_) [[unlikely]]
+			{
+				const auto _end = impl::stats_now_ns();
+				if (const auto _perf = this->stats_->perf_counters(); _perf)
+				{
+					auto _endPerf = GLSLPerfSample{};
+					if (_perf->read(_endPerf))
+					{
+						this->stats_->add_perf(this->phase_, this->start_perf_, _endPerf);
+					};
+				};
+				this->stats_->add_phase(this->phase_, this->start_, _end - this->start_, impl::stats_thread_id());
+			};
+		};
+#else
+		{};
+#endif
+
+		GLSLScopedPhase(const GLSLScopedPhase&) = delete;
+		GLSLScopedPhase& operator=(const GLSLScopedPhase&) = delete;
+
+	private:
+#if GLSL_GEN_STATS
+		GLSLStats* stats_;
+		GLSLPhase phase_;
+		int64_t start_ = 0;
+		GLSLPerfSample start_perf_;
+#endif
+	};
+
+	/**
+	 * @brief Attributes allocations made on this thread to a site for the lifetime of the scope.
+	*/
+	struct GLSLScopedAllocSite
+	{
+	public:
+		explicit GLSLScopedAllocSite(GLSLAllocSite _site) noexcept
+#if GLSL_GEN_STATS
+			: previous_(impl::alloc_site_)
+		{
+			impl::alloc_site_ = _site;
+		};
+		~GLSLScopedAllocSite()
+		{
+			impl::alloc_site_ = this->previous_;
+		};
+#else
+		{};
+#endif
+
+		GLSLScopedAllocSite(const GLSLScopedAllocSite&) = delete;
+		GLSLScopedAllocSite& operator=(const GLSLScopedAllocSite&) = delete;
+
+	private:
+#if GLSL_GEN_STATS
+		GLSLAllocSite previous_;
+#endif
+	};
+};
@@ -0,0 +1,50 @@
+#include "GLSLGenStream.hpp"
+
+#include <algorithm>
+
+namespace glsl
+{
+	GLSLChunkedEmitter::StringAppendBuffer::int_type GLSLChunkedEmitter::StringAppendBuffer::overflow(int_type _ch)
+	{
+		if (!traits_type::eq_int_type(_ch, traits_type::eof()))
+		{
+			this->out_->push_back(traits_type::to_char_type(_ch));
+		};
+		return traits_type::not_eof(_ch);
+	};
+	std::streamsize GLSLChunkedEmitter::StringAppendBuffer::xsputn(const char* _data, std::streamsize _count)
+	{
+		this->out_->append(_data, static_cast<size_t>(_count));
+		return _count;
+	};
+
+	GLSLChunkedEmitter::GLSLChunkedEmitter(const GLSLContext& _context, const GLSLParams& _params, size_t _chunkSize) :
+		cursor_(_context, _params),
+		streambuf_(buffer_),
+		ostr_(&streambuf_),
+		chunk_size_(_chunkSize)
+	{
+		HUBRIS_ASSERT(_chunkSize != 0);
+
+		// A chunk plus room for the statement that overflows it
+		this->buffer_.reserve(_chunkSize + _chunkSize / 4 + 256);
+	};
+
+	std::string_view GLSLChunkedEmitter::next()
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::emit);
+		const auto _site = GLSLScopedAllocSite(GLSLAllocSite::emit);
+
+		// Drop the chunk handed out last time, only the tail of one statement is left to move.
+		this->buffer_.erase(0, this->consumed_);
+		this->consumed_ = 0;
+
+		while (this->buffer_.size() < this->chunk_size_ && this->cursor_.step(this->ostr_)) {};
+
+		const auto _size = std::min(this->chunk_size_, this->buffer_.size());
+		this->consumed_ = _size;
+		this->bytes_ += _size;
+		count_stat(GLSLCounter::bytes_emitted, _size);
+		return std::string_view(this->buffer_.data(), _size);
+	};
+};
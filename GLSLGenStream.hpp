@@ -0,0 +1,160 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <string>
+#include <cstddef>
+#include <ostream>
+#include <iterator>
+#include <concepts>
+#include <streambuf>
+#include <string_view>
+
+namespace glsl
+{
+	/**
+	 * @brief Pull-based GLSL writer, produces a shader's source in fixed size chunks.
+	 *
+	 * Source is generated only as chunks are requested, so the memory used is one chunk plus
+	 * the longest declaration, statement or loop / branch header no matter how large the shader
+	 * is, loop and branch bodies are written a statement at a time. Generation is
+	 * interleaved with whatever consumes the chunks (a file, a hash, a socket), and stopping
+	 * early skips the rest of the work.
+	 *
+	 * The output is identical to generate_glsl(). The context and params must not be modified
+	 * while the emitter is in use.
+	*/
+	struct GLSLChunkedEmitter
+	{
+	public:
+
+		static constexpr size_t default_chunk_size_v = 64 * 1024;
+
+		/**
+		 * @brief Generates the next chunk of source.
+		 * @return Chunk of chunk_size() bytes, the last one may be shorter. Empty once the whole
+		 *	source was produced. Stays valid until the next call.
+		*/
+		std::string_view next();
+
+		/**
+		 * @brief Checks if the whole source was produced.
+		*/
+		bool done() const noexcept
+		{
+			return this->cursor_.done() && this->buffer_.size() == this->consumed_;
+		};
+
+		size_t chunk_size() const noexcept { return this->chunk_size_; };
+
+		/**
+		 * @brief Bytes handed out so far.
+		*/
+		size_t bytes_emitted() const noexcept { return this->bytes_; };
+
+		/**
+		 * @brief Input iterator over the remaining chunks.
+		*/
+		struct iterator
+		{
+		public:
+			using value_type = std::string_view;
+			using difference_type = std::ptrdiff_t;
+
+			std::string_view operator*() const noexcept { return this->chunk_; };
+
+			iterator& operator++()
+			{
+				this->chunk_ = this->emitter_->next();
+				return *this;
+			};
+			void operator++(int) { ++*this; };
+
+			bool operator==(std::default_sentinel_t) const noexcept { return this->chunk_.empty(); };
+
+			iterator() = default;
+			explicit iterator(GLSLChunkedEmitter& _emitter) :
+				emitter_(&_emitter), chunk_(_emitter.next())
+			{};
+
+		private:
+			GLSLChunkedEmitter* emitter_ = nullptr;
+			std::string_view chunk_{};
+		};
+
+		iterator begin() { return iterator(*this); };
+		std::default_sentinel_t end() const noexcept { return std::default_sentinel; };
+
+		/**
+		 * @param _context Context holding the symbols.
+		 * @param _params Shader parameters.
+		 * @param _chunkSize Size of the chunks produced, must not be 0.
+		*/
+		GLSLChunkedEmitter(const GLSLContext& _context, const GLSLParams& _params, size_t _chunkSize = default_chunk_size_v);
+
+		// The stream points into the emitter
+		GLSLChunkedEmitter(const GLSLChunkedEmitter&) = delete;
+		GLSLChunkedEmitter& operator=(const GLSLChunkedEmitter&) = delete;
+
+	private:
+
+		/**
+		 * @brief Stream buffer appending to a string.
+		*/
+		struct StringAppendBuffer : public std::streambuf
+		{
+		public:
+			explicit StringAppendBuffer(std::string& _out) :
+				out_(&_out)
+			{};
+
+		protected:
+			int_type overflow(int_type _ch) override;
+			std::streamsize xsputn(const char* _data, std::streamsize _count) override;
+
+		private:
+			std::string* out_;
+		};
+
+		GLSLEmitCursor cursor_;
+		std::string buffer_{};
+		StringAppendBuffer streambuf_;
+		std::ostream ostr_;
+
+		size_t chunk_size_;
+
+		// Bytes at the start of the buffer handed out by the last call to next()
+		size_t consumed_ = 0;
+		size_t bytes_ = 0;
+	};
+
+	/**
+	 * @brief Generates a shader's source chunk by chunk, passing each one to a sink.
+	 *
+	 * For example, writing to a file without holding the whole source in memory:
+	 *
+	 *	stream_glsl(_context, _params, [&_file](std::string_view _chunk)
+	 *		{
+	 *			_file.write(_chunk.data(), _chunk.size());
+	 *		});
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	 * @param _sink Callable taking a std::string_view, called once per chunk.
+	 * @param _chunkSize Size of the chunks.
+	 * @return Total bytes produced.
+	*/
+	template <typename SinkT> requires std::invocable<SinkT&, std::string_view>
+	size_t stream_glsl(const GLSLContext& _context, const GLSLParams& _params, SinkT&& _sink,
+		size_t _chunkSize = GLSLChunkedEmitter::default_chunk_size_v)
+	{
+		auto _emitter = GLSLChunkedEmitter(_context, _params, _chunkSize);
+		for (auto _chunk : _emitter)
+		{
+			_sink(_chunk);
+		};
+		return _emitter.bytes_emitted();
+	};
+};
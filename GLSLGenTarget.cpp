@@ -0,0 +1,193 @@
+#include "GLSLGenTarget.hpp"
+
+#include <format>
+#include <thread>
+#include <sstream>
+#include <string_view>
+
+namespace glsl
+{
+	namespace
+	{
+		/**
+		 * @brief First versions with a builtin, 0 if a profile never has it.
+		*/
+		struct BuiltinVersion
+		{
+			std::string_view name;
+			int core;
+			int es;
+		};
+
+		// Builtins not listed are in every version
+		constexpr BuiltinVersion builtin_versions_v[] =
+		{
+			{ "gl_VertexID", 130, 300 },
+			{ "gl_InstanceID", 140, 300 },
+			{ "gl_PointCoord", 120, 100 },
+			{ "gl_FragDepth", 110, 300 },
+			{ "texture", 130, 300 },
+		};
+
+		// GLSL 4.00, never in GLSL ES
+		constexpr int doubles_version_v = 400;
+
+		// GLSL ES 1.00 declares inputs and outputs as attribute and varying and writes
+		// gl_FragColor, the emitter only writes the in/out syntax of GLSL ES 3.00
+		constexpr int es_min_version_v = 300;
+
+		std::string version_name(GLSLProfile _profile, int _version)
+		{
+			return std::format("GLSL{} {}.{:02}", (_profile == GLSLProfile::es) ? " ES" : "", _version / 100, _version % 100);
+		};
+
+		bool is_double(GLSLType _type)
+		{
+			return is_type_in_category(_type, GLSLGenType::gen_double);
+		};
+	};
+
+	GLSLShaderFeatures find_shader_features(const GLSLContext& _context, const GLSLParams& _params)
+	{
+		auto _features = GLSLShaderFeatures{};
+		const auto _useVariable = [&_context, &_features](GLSLVariableID _id)
+		{
+			const auto _var = _context.find(_id);
+			if (_var && _var->builtin())
+			{
+				_features.builtins.insert(std::string(_var->name()));
+			};
+		};
+		const auto _visit = [&](const GLSLStatement& _statement)
+		{
+			if (_statement.has_dest())
+			{
+				_useVariable(_statement.dest);
+			};
+			for_each_expression(_statement.expr, [&](const GLSLExpression& _node)
+				{
+					if (_node.type() == GLSLExpressionType::function_call)
+					{
+						const auto _function = _context.find(_node.get<GLSLExpression::FunctionCall>().function);
+						if (_function && _function->builtin())
+						{
+							_features.builtins.insert(std::string(_function->name()));
+						};
+					};
+					for_each_param(_node, [&](const GLSLExpression::Parameter& _param)
+						{
+							if (_param.is_variable())
+							{
+								_useVariable(_param.id());
+							}
+							else if (_param.is_literal() && is_double(_param.literal().type()))
+							{
+								_features.doubles = true;
+							};
+						});
+				});
+		};
+
+		for_each_statement(_params.globals, _visit);
+		for (auto& _function : _params.functions)
+		{
+			for_each_statement(_function.body(), _visit);
+			_features.doubles = _features.doubles || is_double(_function.return_type());
+		};
+		for_each_statement(_params.main_fn.body(), _visit);
+
+		for (auto& _var : _context.variables())
+		{
+			if (!_var.builtin() && is_double(_var.type()))
+			{
+				_features.doubles = true;
+			};
+		};
+		return _features;
+	};
+
+	std::vector<std::string> find_missing_features(const GLSLShaderFeatures& _features, const GLSLTarget& _target)
+	{
+		const auto _es = _target.profile == GLSLProfile::es;
+
+		auto _missing = std::vector<std::string>();
+		if (_es && _target.version < es_min_version_v)
+		{
+			_missing.push_back(std::format("{} is not supported, the oldest ES target is {}",
+				version_name(_target.profile, _target.version), version_name(_target.profile, es_min_version_v)));
+		};
+		for (auto& _builtin : builtin_versions_v)
+		{
+			if (!_features.builtins.contains(_builtin.name))
+			{
+				continue;
+			};
+			const auto _needed = (_es) ? _builtin.es : _builtin.core;
+			const auto _name = (_builtin.name.starts_with("gl_")) ? std::string(_builtin.name) : std::format("{}()", _builtin.name);
+			if (_needed == 0)
+			{
+				_missing.push_back(std::format("{} is not in {}", _name, version_name(_target.profile, _target.version)));
+			}
+			else if (_target.version < _needed)
+			{
+				_missing.push_back(std::format("{} needs {}", _name, version_name(_target.profile, _needed)));
+			};
+		};
+
+		if (_features.doubles)
+		{
+			if (_es)
+			{
+				_missing.push_back("double types are not in GLSL ES");
+			}
+			else if (_target.version < doubles_version_v)
+			{
+				_missing.push_back(std::format("double types need {}", version_name(_target.profile, doubles_version_v)));
+			};
+		};
+		return _missing;
+	};
+
+	std::vector<GLSLTargetOutput> generate_glsl_targets(const GLSLContext& _context, const GLSLParams& _params,
+		GLSLShaderStage _stage, std::span<const GLSLTarget> _targets)
+	{
+		auto _outputs = std::vector<GLSLTargetOutput>(_targets.size());
+		if (_targets.empty())
+		{
+			return _outputs;
+		};
+
+		// Shared by every target
+		const auto _features = find_shader_features(_context, _params);
+		const auto _cost = estimate_cost(_context, _params, _stage);
+
+		// Each target only writes its own output
+		const auto _emit = [&](size_t n)
+		{
+			auto& _output = _outputs[n];
+			_output.target = _targets[n];
+			_output.missing = find_missing_features(_features, _output.target);
+			_output.cost = _cost;
+			_output.over_budget = find_budget_overruns(_cost, _output.target.budget);
+			if (!_output.ok())
+			{
+				return;
+			};
+
+			auto _ostr = std::ostringstream();
+			generate_glsl(_context, _params, _output.target, _stage, _ostr);
+			_output.source = std::move(_ostr).str();
+		};
+
+		auto _workers = std::vector<std::jthread>();
+		_workers.reserve(_targets.size() - 1);
+		for (size_t n = 1; n != _targets.size(); ++n)
+		{
+			_workers.emplace_back(_emit, n);
+		};
+		_emit(0);
+		_workers.clear();
+
+		return _outputs;
+	};
+};
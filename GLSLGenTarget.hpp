@@ -0,0 +1,93 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenCost.hpp"
+
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace glsl
+{
+	/**
+	 * @brief Language features a shader uses that not every target has.
+	 *
+	 * Depends only on the IR, found once and checked against each target.
+	*/
+	struct GLSLShaderFeatures
+	{
+		/**
+		 * @brief Names of the builtin variables and functions the shader reads, writes or calls.
+		*/
+		std::set<std::string, std::less<>> builtins{};
+
+		// Double precision types, GLSL 4.00 and up, not in GLSL ES
+		bool doubles = false;
+	};
+
+	/**
+	 * @brief Finds the features a shader uses, builtins declared but never used are left out.
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	*/
+	GLSLShaderFeatures find_shader_features(const GLSLContext& _context, const GLSLParams& _params);
+
+	/**
+	 * @brief Lists the features a target lacks.
+	 *
+	 * GLSL ES targets before 3.00 are not supported and always have one entry.
+	 *
+	 * @param _features Features used by a shader.
+	 * @param _target Target to check.
+	 * @return One message per missing feature, ie. "texture() needs GLSL 1.30", empty if the target has them all.
+	*/
+	std::vector<std::string> find_missing_features(const GLSLShaderFeatures& _features, const GLSLTarget& _target);
+
+	/**
+	 * @brief A shader's source written for one target by generate_glsl_targets().
+	*/
+	struct GLSLTargetOutput
+	{
+		GLSLTarget target{};
+
+		// Source, empty if the target misses a feature or the shader is over its budget
+		std::string source{};
+
+		// Features used by the shader that the target lacks, see find_missing_features()
+		std::vector<std::string> missing{};
+
+		// Estimated cost of the shader, the same for every target
+		GLSLShaderCost cost{};
+
+		// Limits of the target's budget the shader exceeds, see find_budget_overruns()
+		std::vector<std::string> over_budget{};
+
+		bool ok() const noexcept { return this->missing.empty() && this->over_budget.empty(); };
+	};
+
+	/**
+	 * @brief Writes one shader's source for several targets at once.
+	 *
+	 * The IR is resolved and analysed once: auto types, overloads and precisions (see
+	 * infer_precision()) must already be done, and the features the shader uses are found
+	 * once for all targets, as is its cost (see estimate_cost()). A target missing a feature
+	 * or whose GLSLTarget::budget the cost exceeds gets no source. Each target is then
+	 * written on its own thread, the calling thread taking the first one. The context and
+	 * params are only read, they must not be modified until this returns.
+	 *
+	 * Stats active on the calling thread only count the first target.
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	 * @param _stage Stage of the shader.
+	 * @param _targets Targets to write, ie. GLSLTarget::gl33(), GLSLTarget::gl45() and GLSLTarget::es30().
+	 * @return One output per target, in the same order.
+	*/
+	std::vector<GLSLTargetOutput> generate_glsl_targets(const GLSLContext& _context, const GLSLParams& _params,
+		GLSLShaderStage _stage, std::span<const GLSLTarget> _targets);
+};
@@ -0,0 +1,165 @@
+#include "GLSLGenUnroll.hpp"
+
+#include <map>
+#include <algorithm>
+
+namespace glsl
+{
+	namespace
+	{
+		struct Unroller
+		{
+			GLSLContext* context;
+			const GLSLUnrollOptions* options;
+			GLSLUnrollStats stats{};
+
+			/**
+			 * @brief Appends a copy of a loop body with the induction variable replaced.
+			 * @param _fresh Give the body's declarations and loops new variables, needed for
+			 *	every copy sharing a scope with an earlier one.
+			*/
+			void append_copy(const GLSLStatement& _loop, GLSLExpression::Parameter _index, bool _fresh,
+				std::vector<GLSLStatement>& _out)
+			{
+				auto& _context = *this->context;
+				auto _with = std::map<GLSLVariableID, GLSLExpression::Parameter>();
+				_with.insert_or_assign(_loop.dest, std::move(_index));
+
+				for (auto& _statement : _loop.body)
+				{
+					auto _copy = _statement.clone();
+
+					// Loops come before their bodies, their induction variable is mapped before its uses
+					for_each_statement(std::span(&_copy, 1), [&](GLSLStatement& v)
+						{
+							if (_fresh && (v.type == GLSLStatementType::declaration || v.type == GLSLStatementType::for_loop))
+							{
+								const auto _local = _context.new_variable(_context.type(v.dest))->id();
+								_with.insert_or_assign(v.dest, GLSLExpression::Parameter(_local));
+							};
+							if (const auto it = _with.find(v.dest); it != _with.end() && it->second.is_variable())
+							{
+								v.dest = it->second.id();
+							};
+							substitute_variables(v.expr, _with);
+						});
+					_out.push_back(std::move(_copy));
+				};
+			};
+
+			/**
+			 * @brief Unrolls the loops within a statement list, innermost first.
+			*/
+			std::vector<GLSLStatement> unroll_statements(std::span<GLSLStatement> _statements)
+			{
+				auto _out = std::vector<GLSLStatement>();
+				_out.reserve(_statements.size());
+
+				for (auto& _statement : _statements)
+				{
+					if (_statement.type == GLSLStatementType::if_else)
+					{
+						_statement.body = this->unroll_statements(_statement.body);
+						_statement.else_body = this->unroll_statements(_statement.else_body);
+					};
+					if (_statement.type != GLSLStatementType::for_loop)
+					{
+						_out.push_back(std::move(_statement));
+						continue;
+					};
+					_statement.body = this->unroll_statements(_statement.body);
+					this->unroll(_statement, _out);
+				};
+
+				return _out;
+			};
+
+			/**
+			 * @brief Appends a loop to a statement list, unrolled as far as the budget allows.
+			*/
+			void unroll(GLSLStatement& _loop, std::vector<GLSLStatement>& _out)
+			{
+				const auto& _options = *this->options;
+
+				const auto _trips = loop_trip_count(_loop);
+				const auto _size = std::max<size_t>(statement_size(_loop.body), 1);
+				if (!_trips)
+				{
+					++this->stats.loops_kept;
+					_out.push_back(std::move(_loop));
+					return;
+				};
+
+				const auto _trip = size_t(*_trips);
+				const auto _begin = int64_t(_loop.loop.begin);
+				const auto _step = int64_t(_loop.loop.step);
+				const auto _value = [&](size_t _iteration)
+				{
+					return GLSLExpression::Parameter(GLSLLiteral(int(_begin + int64_t(_iteration) * _step)));
+				};
+
+				// Fully unrolled, the induction variable is left in the context as other loops may share it
+				if (_trip <= _options.max_size / _size)
+				{
+					for (size_t n = 0; n != _trip; ++n)
+					{
+						this->append_copy(_loop, _value(n), n != 0, _out);
+					};
+					++this->stats.loops_unrolled;
+					return;
+				};
+
+				const auto _factor = std::min({ _options.max_partial_factor, _options.max_size / _size, _trip });
+				if (_factor < 2)
+				{
+					++this->stats.loops_kept;
+					_out.push_back(std::move(_loop));
+					return;
+				};
+
+				// Whole groups of iterations stay in the loop, the rest are written out after it
+				const auto _main = _trip - _trip % _factor;
+				auto _body = std::vector<GLSLStatement>();
+				for (size_t k = 0; k != _factor; ++k)
+				{
+					auto _index = GLSLExpression::Parameter(_loop.dest);
+					if (k != 0)
+					{
+						_index = GLSLExpression::Parameter(GLSLExpression::make_unique(GLSLExpression(GLSLExpression::BinaryOp(
+							GLSLBinaryOperator::add, GLSLExpression::Parameter(_loop.dest),
+							GLSLExpression::Parameter(GLSLLiteral(int(int64_t(k) * _step)))))));
+					};
+					this->append_copy(_loop, std::move(_index), k != 0, _body);
+				};
+
+				auto _rolled = GLSLStatement(GLSLStatementType::for_loop);
+				_rolled.dest = _loop.dest;
+				_rolled.loop.begin = _loop.loop.begin;
+				_rolled.loop.step = int32_t(_step * int64_t(_factor));
+				_rolled.expr = GLSLExpression(GLSLExpression::Identity(_value(_main)));
+				_rolled.body = std::move(_body);
+
+				// Remainder copies share the enclosing scope with each other, each gets fresh variables
+				_out.push_back(std::move(_rolled));
+				for (size_t n = _main; n != _trip; ++n)
+				{
+					this->append_copy(_loop, _value(n), true, _out);
+				};
+				++this->stats.loops_partially_unrolled;
+			};
+		};
+	};
+
+	GLSLUnrollStats unroll_loops(GLSLContext& _context, GLSLParams& _params, const GLSLUnrollOptions& _options)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::optimize);
+
+		auto _unroller = Unroller{ &_context, &_options };
+		for (auto& _function : _params.functions)
+		{
+			_function.set_body(_unroller.unroll_statements(_function.body()));
+		};
+		_params.main_fn.set_body(_unroller.unroll_statements(_params.main_fn.body()));
+		return _unroller.stats;
+	};
+};
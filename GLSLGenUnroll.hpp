@@ -0,0 +1,61 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+
+#include <cstddef>
+
+namespace glsl
+{
+	/**
+	 * @brief Size budget used to decide how far loops are unrolled.
+	*/
+	struct GLSLUnrollOptions
+	{
+		/**
+		 * @brief Largest size a loop may grow to when unrolled, counted in statements plus
+		 *	expression nodes, see statement_size().
+		*/
+		size_t max_size = 64;
+
+		/**
+		 * @brief Most copies of the body a partially unrolled loop may hold, 1 disables partial unrolling.
+		*/
+		size_t max_partial_factor = 4;
+	};
+
+	/**
+	 * @brief Summary of what unroll_loops() did with each loop.
+	*/
+	struct GLSLUnrollStats
+	{
+		// Loops without any iterations are removed and counted here
+		size_t loops_unrolled = 0;
+		size_t loops_partially_unrolled = 0;
+		size_t loops_kept = 0;
+	};
+
+	/**
+	 * @brief Unrolls loops with a constant trip count.
+	 *
+	 * A loop's trip count is constant when its bound is an int literal and its body never
+	 * assigns the induction variable. Inner loops are visited first, so a loop's size is
+	 * measured after its own body was unrolled.
+	 *
+	 * Loops fitting the size budget once every iteration is written out are replaced by their
+	 * iterations, with the induction variable folded into an int literal in each. Otherwise
+	 * the loop is partially unrolled by the largest factor that fits, its body repeated with
+	 * the induction variable offset by each copy, and the iterations left over are written
+	 * out after it. Loops that fit neither stay rolled.
+	 *
+	 * Declarations within a repeated body get fresh variables for every copy but the first.
+	 * Globals are not visited, they cannot hold loops.
+	 *
+	 * @param _context Shader context.
+	 * @param _params Shader parameters.
+	 * @param _options Size budget.
+	 * @return Unrolling statistics.
+	*/
+	GLSLUnrollStats unroll_loops(GLSLContext& _context, GLSLParams& _params, const GLSLUnrollOptions& _options = {});
+};
@@ -2,6 +2,8 @@
 
 #include <ostream>
 #include <format>
+#include <cstring>
+#include <unordered_map>
 
 #include <jclib/algorithm.h>
 
@@ -164,7 +166,9 @@ namespace glsl
 		HUBRIS_ASSERT(_fromType != GLSLType::glsl_error);
 		HUBRIS_ASSERT(_toType != GLSLType::glsl_error);
 
-		if (_fromType != GLSLType::glsl_void && _toType != GLSLType::glsl_void)
+		// Samplers are opaque, there is no constructor taking or making one
+		if (_fromType != GLSLType::glsl_void && _toType != GLSLType::glsl_void &&
+			!is_sampler(_fromType) && !is_sampler(_toType))
 		{
 			return true;
 		}
@@ -306,6 +310,12 @@ namespace glsl
 
 	void GLSLExpressionDeleter::operator()(GLSLExpression* p) const
 	{
+		// Shared nodes are only destroyed by their last owner
+		if (p->refs_ != 0)
+		{
+			--p->refs_;
+			return;
+		};
 		delete p;
 	};
 
@@ -327,15 +337,83 @@ namespace glsl
 	};
 
 
-	bool GLSLExpression::Parameter::generate(std::ostream& _ostr, const GLSLContext& _context) const
+	/**
+	 * @brief Writes a literal as C++, float components get an "f" suffix to keep the math in single precision.
+	*/
+	inline bool generate_cpp_literal(std::ostream& _ostr, const GLSLLiteral& _literal)
+	{
+		switch (_literal.type())
+		{
+		case GLSLType::glsl_bool:
+			write(_ostr, "{}", _literal.vec1<bool>());
+			return true;
+		case GLSLType::glsl_int:
+			write(_ostr, "{}", _literal.vec1<int>());
+			return true;
+
+		case GLSLType::glsl_float:
+			write(_ostr, "{:f}f", _literal.vec1());
+			return true;
+		case GLSLType::glsl_vec2:
+		{
+			const auto [x, y] = _literal.vec2();
+			write(_ostr, "vec2({:f}f, {:f}f)", x, y);
+		};
+		return true;
+		case GLSLType::glsl_vec3:
+		{
+			const auto [x, y, z] = _literal.vec3();
+			write(_ostr, "vec3({:f}f, {:f}f, {:f}f)", x, y, z);
+		};
+		return true;
+		case GLSLType::glsl_vec4:
+		{
+			const auto [x, y, z, w] = _literal.vec4();
+			write(_ostr, "vec4({:f}f, {:f}f, {:f}f, {:f}f)", x, y, z, w);
+		};
+		return true;
+
+		case GLSLType::glsl_double:
+			write(_ostr, "{:f}", _literal.vec1<double>());
+			return true;
+		case GLSLType::glsl_dvec2:
+		{
+			const auto [x, y] = _literal.vec2<double>();
+			write(_ostr, "dvec2({:f}, {:f})", x, y);
+		};
+		return true;
+		case GLSLType::glsl_dvec3:
+		{
+			const auto [x, y, z] = _literal.vec3<double>();
+			write(_ostr, "dvec3({:f}, {:f}, {:f})", x, y, z);
+		};
+		return true;
+		case GLSLType::glsl_dvec4:
+		{
+			const auto [x, y, z, w] = _literal.vec4<double>();
+			write(_ostr, "dvec4({:f}, {:f}, {:f}, {:f})", x, y, z, w);
+		};
+		return true;
+
+		default:
+			return false;
+		};
+	};
+
+	bool GLSLExpression::Parameter::generate(std::ostream& _ostr, const GLSLContext& _context, GLSLLanguage _language) const
 	{
 		if (this->is_expression())
 		{
-			return generate_expression_string(_ostr, _context, this->expr());
+			return generate_expression_string(_ostr, _context, this->expr(), _language);
 		}
 		else if (this->is_literal())
 		{
 			auto& _literal = std::get<GLSLLiteral>(this->vt_);
+			if (_language == GLSLLanguage::cpp)
+			{
+				return generate_cpp_literal(_ostr, _literal);
+			};
+
 			switch (_literal.type())
 			{
 
@@ -348,7 +426,7 @@ namespace glsl
 
 			case GLSLType::glsl_int:
 			{
-				write(_ostr, "{:f}", _literal.vec1<int>());
+				write(_ostr, "{}", _literal.vec1<int>());
 			};
 			return true;
 
@@ -423,6 +501,8 @@ namespace glsl
 	
 	GLSLExpression::FunctionCall& GLSLExpression::FunctionCall::resolve_params(GLSLContext& _context) &
 	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::resolve);
+
 		// Determine best overload
 		auto& _function = *_context.find(this->function);
 		auto _paramTypes = this->resolve_parameters(_context);
@@ -449,6 +529,198 @@ namespace glsl
 	};
 
 
+	GLSLExpression::Parameter GLSLExpression::Parameter::clone() const
+	{
+		if (this->is_expression())
+		{
+			return GLSLExpression::make_unique(this->expr().clone());
+		}
+		else if (this->is_literal())
+		{
+			return this->literal();
+		}
+		else
+		{
+			return this->id();
+		};
+	};
+
+	GLSLExpression GLSLExpression::clone() const
+	{
+		switch (this->type())
+		{
+		case GLSLExpressionType::identity:
+			return Identity(this->get<Identity>().param.clone());
+		case GLSLExpressionType::cast:
+		{
+			const auto& _expr = this->get<Cast>();
+			return Cast(_expr.to_type(), _expr.param.clone());
+		};
+		case GLSLExpressionType::function_call:
+		{
+			const auto& _expr = this->get<FunctionCall>();
+			auto _out = FunctionCall(_expr.function);
+			for (auto& v : _expr.params)
+			{
+				_out.add_param(v.clone());
+			};
+			return _out;
+		};
+		case GLSLExpressionType::binary_op:
+		{
+			const auto& _expr = this->get<BinaryOp>();
+			return BinaryOp(_expr.op, _expr.lhs.clone(), _expr.rhs.clone());
+		};
+		case GLSLExpressionType::swizzle:
+		{
+			const auto& _expr = this->get<Swizzle>();
+			const auto& s = _expr.swizzle_;
+			return Swizzle(_expr.what.clone(), s[0], s[1], s[2], s[3]);
+		};
+		case GLSLExpressionType::select:
+		{
+			const auto& _expr = this->get<Select>();
+			return Select(_expr.condition.clone(), _expr.if_true.clone(), _expr.if_false.clone());
+		};
+		default:
+			abort();
+			return {};
+		};
+	};
+
+
+
+	bool GLSLLiteral::operator==(const GLSLLiteral& other) const noexcept
+	{
+		if (this->type_ != other.type_ || this->vt_.index() != other.vt_.index())
+		{
+			return false;
+		};
+
+		return std::visit([&other](auto& _value) -> bool
+			{
+				using value_type = std::remove_cvref_t<decltype(_value)>;
+				if constexpr (std::is_same_v<value_type, std::nullopt_t>)
+				{
+					return true;
+				}
+				else
+				{
+					const auto& _other = std::get<value_type>(other.vt_);
+					return std::memcmp(_value.data(), _other.data(), sizeof(value_type)) == 0;
+				};
+			}, this->vt_);
+	};
+	size_t GLSLLiteral::hash() const noexcept
+	{
+		auto _hash = hash_combine(static_cast<size_t>(this->type_), this->vt_.index());
+		std::visit([&_hash](auto& _value)
+			{
+				using value_type = std::remove_cvref_t<decltype(_value)>;
+				if constexpr (!std::is_same_v<value_type, std::nullopt_t>)
+				{
+					_hash = hash_combine(_hash, std::hash<std::string_view>{}(
+						std::string_view(reinterpret_cast<const char*>(_value.data()), sizeof(value_type))));
+				};
+			}, this->vt_);
+		return _hash;
+	};
+
+	bool GLSLExpression::Parameter::operator==(const Parameter& other) const
+	{
+		if (this->vt_.index() != other.vt_.index())
+		{
+			return false;
+		};
+
+		if (this->is_expression())
+		{
+			return this->expr() == other.expr();
+		}
+		else if (this->is_literal())
+		{
+			return this->literal() == other.literal();
+		}
+		else
+		{
+			return this->id() == other.id();
+		};
+	};
+	size_t GLSLExpression::Parameter::hash() const
+	{
+		if (this->is_expression())
+		{
+			return this->expr().hash();
+		}
+		else if (this->is_literal())
+		{
+			return this->literal().hash();
+		}
+		else
+		{
+			return ~static_cast<size_t>(this->id().get());
+		};
+	};
+
+	bool GLSLExpression::operator==(const GLSLExpression& other) const
+	{
+		if (this == &other)
+		{
+			return true;
+		};
+		if (this->type() != other.type())
+		{
+			return false;
+		};
+
+		switch (this->type())
+		{
+		case GLSLExpressionType::identity:
+			return this->get<Identity>().param == other.get<Identity>().param;
+		case GLSLExpressionType::cast:
+		{
+			const auto& l = this->get<Cast>();
+			const auto& r = other.get<Cast>();
+			return l.to_type() == r.to_type() && l.param == r.param;
+		};
+		case GLSLExpressionType::function_call:
+		{
+			const auto& l = this->get<FunctionCall>();
+			const auto& r = other.get<FunctionCall>();
+			return l.function == r.function && std::ranges::equal(l.params, r.params);
+		};
+		case GLSLExpressionType::binary_op:
+		{
+			const auto& l = this->get<BinaryOp>();
+			const auto& r = other.get<BinaryOp>();
+			return l.op == r.op && l.lhs == r.lhs && l.rhs == r.rhs;
+		};
+		case GLSLExpressionType::swizzle:
+		{
+			const auto& l = this->get<Swizzle>();
+			const auto& r = other.get<Swizzle>();
+			return l.swizzle_ == r.swizzle_ && l.what == r.what;
+		};
+		case GLSLExpressionType::select:
+		{
+			const auto& l = this->get<Select>();
+			const auto& r = other.get<Select>();
+			return l.condition == r.condition && l.if_true == r.if_true && l.if_false == r.if_false;
+		};
+		default:
+			abort();
+			return false;
+		};
+	};
+	size_t GLSLExpression::hash() const
+	{
+		return hash_expression_node(*this, [](const GLSLExpression& _child)
+			{
+				return _child.hash();
+			});
+	};
+
+
 	inline GLSLType binary_operator_result_type(GLSLBinaryOperator _op, GLSLType lhs, GLSLType rhs)
 	{
 		switch (_op)
@@ -460,7 +732,12 @@ namespace glsl
 		case GLSLBinaryOperator::div:
 			[[fallthrough]];
 		case GLSLBinaryOperator::add:
-			if (is_scalar(lhs) && (is_vector(rhs) || is_matrix(rhs)))
+			if (_op == GLSLBinaryOperator::mult && is_matrix(lhs) != is_matrix(rhs) && (is_vector(lhs) || is_vector(rhs)))
+			{
+				// Transforming a vector gives a vector
+				return (is_vector(lhs)) ? lhs : rhs;
+			}
+			else if (is_scalar(lhs) && (is_vector(rhs) || is_matrix(rhs)))
 			{
 				return rhs;
 			}
@@ -477,6 +754,14 @@ namespace glsl
 		case GLSLBinaryOperator::eq:
 			[[fallthrough]];
 		case GLSLBinaryOperator::neq:
+			[[fallthrough]];
+		case GLSLBinaryOperator::lt:
+			[[fallthrough]];
+		case GLSLBinaryOperator::le:
+			[[fallthrough]];
+		case GLSLBinaryOperator::gt:
+			[[fallthrough]];
+		case GLSLBinaryOperator::ge:
 			return GLSLType::glsl_bool;
 
 		default:
@@ -497,7 +782,13 @@ namespace glsl
 			[[fallthrough]];
 		case GLSLBinaryOperator::add:
 
-			if (is_scalar(lhs) && (is_vector(rhs) || is_matrix(rhs)))
+			// A matrix times a vector of its column type, on either side, is a linear transform
+			if (_operator == GLSLBinaryOperator::mult &&
+				((is_matrix(lhs) && rhs == element_type(lhs)) || (is_matrix(rhs) && lhs == element_type(rhs))))
+			{
+				return true;
+			}
+			else if (is_scalar(lhs) && (is_vector(rhs) || is_matrix(rhs)))
 			{
 				return true;
 			}
@@ -516,6 +807,16 @@ namespace glsl
 		case GLSLBinaryOperator::neq:
 			return lhs == rhs;
 
+		// Relational operators only compare scalar numbers
+		case GLSLBinaryOperator::lt:
+			[[fallthrough]];
+		case GLSLBinaryOperator::le:
+			[[fallthrough]];
+		case GLSLBinaryOperator::gt:
+			[[fallthrough]];
+		case GLSLBinaryOperator::ge:
+			return lhs == rhs && lhs != GLSLType::glsl_bool && is_scalar(lhs);
+
 		default:
 			abort();
 			return false;
@@ -538,6 +839,15 @@ namespace glsl
 			return GLSLType::glsl_error;
 		};
 	};
+	GLSLType GLSLExpression::Select::result_type(const GLSLContext& _context) const
+	{
+		const auto _type = this->if_true.type(_context);
+		if (this->condition.type(_context) != GLSLType::glsl_bool || _type != this->if_false.type(_context))
+		{
+			return GLSLType::glsl_error;
+		};
+		return _type;
+	};
 
 
 	inline GLSLType make_vector_type(GLSLType _type, uint8_t _count)
@@ -642,6 +952,7 @@ namespace glsl
 
 	inline std::string swizzle_str(std::span<const uint8_t> ns)
 	{
+		const auto _site = GLSLScopedAllocSite(GLSLAllocSite::strings);
 		auto s = std::string();
 		for (auto& n : ns) { s += swizzle_char(n); };
 		return s;
@@ -679,7 +990,7 @@ namespace glsl
 	};
 
 
-	bool generate_expression_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLExpression& _expr)
+	bool generate_expression_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLExpression& _expr, GLSLLanguage _language)
 	{
 		// Stringify expression
 		switch (_expr.type())
@@ -689,7 +1000,7 @@ namespace glsl
 			auto& _expression = _expr.get<GLSLExpressionType::identity>();
 			auto& _param = _expression.param;
 			
-			if (!_param.generate(_ostr, _context))
+			if (!_param.generate(_ostr, _context, _language))
 			{
 				return false;
 			};
@@ -703,6 +1014,15 @@ namespace glsl
 			const auto& _param = _expression.param;
 			const auto _fromType = _param.type(_context);
 
+			// C++ has no constructor forms for this, the prelude's cast() pads the same way.
+			if (_language == GLSLLanguage::cpp)
+			{
+				_ostr << "cast<" << _toType << ">(";
+				_param.generate(_ostr, _context, _language);
+				_ostr << ')';
+				break;
+			};
+
 			const auto _toTypeSize = vec_size(_toType);
 			const auto _fromTypeSize = vec_size(_fromType);
 
@@ -719,7 +1039,7 @@ namespace glsl
 				};
 
 				// Add param name
-				_param.generate(_ostr, _context);
+				_param.generate(_ostr, _context, _language);
 
 				auto _swizzle = sequential_swizzle_str(_smallerSize);
 				_ostr << '.' << _swizzle;
@@ -738,6 +1058,7 @@ namespace glsl
 							_ostr << ", 0.0";
 						};
 					};
+					_ostr << ')';
 				};
 			}
 			else
@@ -746,10 +1067,9 @@ namespace glsl
 				_ostr << _toType << '(';
 
 				// Add param name
-				_param.generate(_ostr, _context);
+				_param.generate(_ostr, _context, _language);
+				_ostr << ')';
 			};
-
-			_ostr << ')';
 		};
 		break;
 		case GLSLExpressionType::function_call:
@@ -767,7 +1087,7 @@ namespace glsl
 					_ostr << ", ";
 				};
 
-				v.generate(_ostr, _context);
+				v.generate(_ostr, _context, _language);
 				++n;
 			};
 
@@ -781,7 +1101,7 @@ namespace glsl
 			const auto& _rhsParam = _expression.rhs;
 
 			_ostr << '(';
-			_lhsParam.generate(_ostr, _context);
+			_lhsParam.generate(_ostr, _context, _language);
 			
 			using Op = GLSLBinaryOperator;
 			switch (_expression.op)
@@ -805,12 +1125,24 @@ namespace glsl
 			case Op::neq:
 				_ostr << " != ";
 				break;
+			case Op::lt:
+				_ostr << " < ";
+				break;
+			case Op::le:
+				_ostr << " <= ";
+				break;
+			case Op::gt:
+				_ostr << " > ";
+				break;
+			case Op::ge:
+				_ostr << " >= ";
+				break;
 
 			default:
 				abort();
 				break;
 			};
-			_rhsParam.generate(_ostr, _context);
+			_rhsParam.generate(_ostr, _context, _language);
 			_ostr << ')';
 		};
 		break;
@@ -841,11 +1173,38 @@ namespace glsl
 				};
 			};
 
+			if (_language == GLSLLanguage::cpp)
+			{
+				// swizzle<0, 1>(v)
+				_ostr << "swizzle<";
+				for (size_t n = 0; n != _swizzleIndexes.size(); ++n)
+				{
+					_ostr << ((n != 0) ? ", " : "") << (int)_swizzleIndexes[n];
+				};
+				_ostr << ">(";
+				_param.generate(_ostr, _context, _language);
+				_ostr << ')';
+				break;
+			};
+
 			const auto _swizzleStr = swizzle_str(_swizzleIndexes);
-			_param.generate(_ostr, _context);
+			_param.generate(_ostr, _context, _language);
 			_ostr << '.' << _swizzleStr;
 		};
 		break;
+		case GLSLExpressionType::select:
+		{
+			// (c ? a : b), the same in both languages
+			const auto& _expression = _expr.get<GLSLExpression::Select>();
+			_ostr << '(';
+			_expression.condition.generate(_ostr, _context, _language);
+			_ostr << " ? ";
+			_expression.if_true.generate(_ostr, _context, _language);
+			_ostr << " : ";
+			_expression.if_false.generate(_ostr, _context, _language);
+			_ostr << ')';
+		};
+		break;
 		default:
 			abort();
 			return false;
@@ -854,3 +1213,776 @@ namespace glsl
 		return true;
 	};
 };
+
+namespace glsl
+{
+	void add_builtin_vertex_shader_variables(GLSLContext& _context)
+	{
+		// Inputs
+		{
+			_context.new_variable("gl_VertexID", GLSLType::glsl_int)
+				->set_builtin()
+				.set_inout(GLSLInOut::in);
+		};
+		{
+			_context.new_variable("gl_InstanceID", GLSLType::glsl_int)
+				->set_builtin()
+				.set_inout(GLSLInOut::in);
+		};
+
+		// Outputs
+		{
+			_context.new_variable("gl_Position", GLSLType::glsl_vec4)
+				->set_builtin()
+				.set_inout(GLSLInOut::out);
+		};
+	};
+	void add_builtin_fragment_shader_variables(GLSLContext& _context)
+	{
+		// Inputs
+		(*_context.new_variable("gl_FragCoord", GLSLType::glsl_vec4))
+			.set_builtin()
+			.set_inout(GLSLInOut::in);
+		(*_context.new_variable("gl_FrontFacing", GLSLType::glsl_bool))
+			.set_builtin()
+			.set_inout(GLSLInOut::in);
+		(*_context.new_variable("gl_PointCoord", GLSLType::glsl_vec2))
+			.set_builtin()
+			.set_inout(GLSLInOut::in);
+
+		// Outputs
+		(*_context.new_variable("gl_FragDepth", GLSLType::glsl_float))
+			.set_builtin()
+			.set_inout(GLSLInOut::out);
+	};
+
+	void add_builtin_functions(GLSLContext& _context)
+	{
+		(*_context.new_function("sin", GLSLType::glsl_float))
+			.set_builtin()
+			.add_overload(GLSLType::glsl_float, GLSLType::glsl_float)
+			.set_cost({ .transcendental = 1 });
+		(*_context.new_function("cos", GLSLType::glsl_float))
+			.set_builtin()
+			.add_overload(GLSLType::glsl_float, GLSLType::glsl_float)
+			.set_cost({ .transcendental = 1 });
+		(*_context.new_function("tan", GLSLType::glsl_float))
+			.set_builtin()
+			// sin(x) * rcp(cos(x))
+			.add_overload(GLSLType::glsl_float, GLSLType::glsl_float)
+			.set_cost({ .alu = 1, .transcendental = 3 });
+
+		(*_context.new_function("abs", GLSLType::glsl_float))
+			.set_builtin()
+			.add_overload(GLSLType::glsl_float, GLSLType::glsl_float)
+			.set_cost({ .alu = 1 });
+
+		(*_context.new_function("pow", GLSLType::glsl_float))
+			.set_builtin()
+			// exp2(log2(x) * y)
+			.add_overload(GLSLType::glsl_float, { GLSLType::glsl_float, GLSLType::glsl_float })
+			.set_cost({ .alu = 1, .transcendental = 2 });
+
+		(*_context.new_function("dot"))
+			.set_builtin()
+			// One multiply-add per component
+			.add_overload(GLSLType::glsl_float, { GLSLGenType::gen_float, GLSLGenType::gen_float })
+			.set_cost({ .alu = 1 })
+			.add_overload(GLSLType::glsl_double, { GLSLGenType::gen_double, GLSLGenType::gen_double })
+			.set_cost({ .alu = 1 });
+
+		(*_context.new_function("texture"))
+			.set_builtin()
+			// texture 2D sampler
+			.add_overload(GLSLType::glsl_vec4, { GLSLType::glsl_sampler_2D, GLSLType::glsl_vec2 })
+			.set_cost({ .texture = 1, .per_component = false })
+			// texture 2D array Sampler
+			.add_overload(GLSLType::glsl_vec4, { GLSLType::glsl_sampler_2D_array, GLSLType::glsl_vec3 })
+			.set_cost({ .texture = 1, .per_component = false });
+
+	};
+
+
+	GLSLType checked_result_type(const GLSLContext& _context, const GLSLExpression& _expr)
+	{
+		auto _paramsType = GLSLType::glsl_void;
+		for_each_param(_expr, [&_context, &_paramsType](const GLSLExpression::Parameter& _param)
+			{
+				if (_paramsType == GLSLType::glsl_auto || _paramsType == GLSLType::glsl_error)
+				{
+					return;
+				};
+
+				const auto _type = (_param.is_expression()) ?
+					checked_result_type(_context, _param.expr()) :
+					_param.type(_context);
+				if (_type == GLSLType::glsl_auto || _type == GLSLType::glsl_error)
+				{
+					_paramsType = _type;
+				};
+			});
+		if (_paramsType == GLSLType::glsl_auto || _paramsType == GLSLType::glsl_error)
+		{
+			return _paramsType;
+		};
+
+		switch (_expr.type())
+		{
+		case GLSLExpressionType::identity:
+			return _expr.get<GLSLExpression::Identity>().result_type(_context);
+		case GLSLExpressionType::cast:
+		{
+			const auto& _cast = _expr.get<GLSLExpression::Cast>();
+			if (!is_castable_to(_cast.param.type(_context), _cast.to_type()))
+			{
+				return GLSLType::glsl_error;
+			};
+			return _cast.result_type(_context);
+		};
+		case GLSLExpressionType::function_call:
+			return _expr.get<GLSLExpression::FunctionCall>().result_type(_context);
+		case GLSLExpressionType::binary_op:
+			return _expr.get<GLSLExpression::BinaryOp>().result_type(_context);
+		case GLSLExpressionType::swizzle:
+		{
+			// Swizzle::result_type() asserts on anything the emitter can't write
+			const auto& _swizzle = _expr.get<GLSLExpression::Swizzle>();
+			const auto _type = _swizzle.what.type(_context);
+			const auto _count = std::ranges::distance(_swizzle.swizzle_.begin(), std::ranges::find(_swizzle.swizzle_, 255));
+			const auto _size = (is_matrix(_type)) ? size_t(4) : (is_vector(_type)) ? vec_size(_type) : size_t(0);
+			if (_count == 0 || (is_matrix(_type) && _count != 1) ||
+				!std::ranges::all_of(_swizzle.swizzle_ | std::views::take(_count), [_size](uint8_t n) { return n < _size; }))
+			{
+				return GLSLType::glsl_error;
+			};
+			return _swizzle.result_type(_context);
+		};
+		case GLSLExpressionType::select:
+			return _expr.get<GLSLExpression::Select>().result_type(_context);
+		default:
+			return GLSLType::glsl_error;
+		};
+	};
+
+	bool deduce_auto(GLSLContext& _context, GLSLParams& _params)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::deduce_auto);
+
+		// Every statement in program order, a variable's type comes from the first one writing it
+		auto _statements = std::vector<const GLSLStatement*>();
+		const auto _gather = [&_statements](std::span<const GLSLStatement> _from)
+		{
+			for_each_statement(_from, [&_statements](const GLSLStatement& v)
+				{
+					_statements.push_back(&v);
+				});
+		};
+		_gather(_params.globals);
+		for (auto& _function : _params.functions)
+		{
+			_gather(_function.body());
+		};
+		_gather(_params.main_fn.body());
+
+		struct Definition
+		{
+			const GLSLStatement* statement;
+
+			// Undeduced variables the statement still reads
+			size_t pending = 0;
+		};
+
+		auto _definitions = std::vector<Definition>();
+		auto _definitionOf = std::unordered_map<GLSLVariableID::rep, size_t>();
+		for (auto _statement : _statements)
+		{
+			if (_statement->has_dest() && _context.type(_statement->dest) == GLSLType::glsl_auto &&
+				_definitionOf.try_emplace(_statement->dest.get(), _definitions.size()).second)
+			{
+				_definitions.push_back(Definition{ _statement });
+			};
+		};
+
+		// Def-use edges, from each undeduced variable to the definitions reading it
+		auto _users = std::vector<std::vector<size_t>>(_definitions.size());
+		auto _worklist = std::vector<size_t>();
+		for (size_t n = 0; n != _definitions.size(); ++n)
+		{
+			auto& _definition = _definitions[n];
+			for_each_expression(_definition.statement->expr, [&](const GLSLExpression& _node)
+				{
+					for_each_param(_node, [&](const GLSLExpression::Parameter& _param)
+						{
+							if (!_param.is_variable())
+							{
+								return;
+							};
+
+							const auto it = _definitionOf.find(_param.id().get());
+							if (it != _definitionOf.end())
+							{
+								_users[it->second].push_back(n);
+								++_definition.pending;
+							};
+						});
+				});
+
+			if (_definition.pending == 0)
+			{
+				_worklist.push_back(n);
+			};
+		};
+
+		// Deduce definitions once everything they read is known, each statement is checked
+		// once and each edge followed once.
+		size_t _deduced = 0;
+		while (!_worklist.empty())
+		{
+			const auto n = _worklist.back();
+			_worklist.pop_back();
+
+			const auto& _statement = *_definitions[n].statement;
+			const auto _type = checked_result_type(_context, _statement.expr);
+			if (_type == GLSLType::glsl_auto || _type == GLSLType::glsl_error || _type == GLSLType::glsl_void)
+			{
+				return false;
+			};
+
+			_context.set_deduced_type(_statement.dest, _type);
+			++_deduced;
+
+			for (auto _user : _users[n])
+			{
+				if (--_definitions[_user].pending == 0)
+				{
+					_worklist.push_back(_user);
+				};
+			};
+		};
+
+		// Anything left depends on itself
+		if (_deduced != _definitions.size())
+		{
+			return false;
+		};
+
+		// Or is never written at all
+		return std::ranges::none_of(_context.variables(), [](const GLSLVariable& v)
+			{
+				return !v.builtin() && v.type() == GLSLType::glsl_auto;
+			});
+	};
+
+	namespace
+	{
+		/**
+		 * @brief Writes a variable's precision qualifier followed by a space, if it has one.
+		*/
+		void write_precision(std::ostream& _ostr, const GLSLContext& _context, GLSLVariableID _id)
+		{
+			const auto _var = _context.find(_id);
+			if (_var && _var->precision() != GLSLPrecision::none)
+			{
+				_ostr << glsl_precision_name(_var->precision()) << ' ';
+			};
+		};
+
+		/**
+		 * @brief Writes a loop or branch up to and including the brace opening its first body.
+		*/
+		void write_block_open(std::ostream& _ostr, const GLSLContext& _context, const GLSLStatement& v,
+			GLSLLanguage _language, size_t _indent)
+		{
+			if (v.type == GLSLStatementType::for_loop)
+			{
+				const auto _name = _context.name(v.dest);
+				_ostr << "for (";
+				if (_language == GLSLLanguage::glsl)
+				{
+					write_precision(_ostr, _context, v.dest);
+				};
+				_ostr << _context.type(v.dest) << ' ' << _name << " = " << v.loop.begin << "; "
+					<< _name << ((v.loop.step > 0) ? " < " : " > ");
+				if (!generate_expression_string(_ostr, _context, v.expr, _language))
+				{
+					abort();
+				};
+				_ostr << "; " << _name << " += " << v.loop.step << ")\n";
+			}
+			else
+			{
+				_ostr << "if (";
+				if (!generate_expression_string(_ostr, _context, v.expr, _language))
+				{
+					abort();
+				};
+				_ostr << ")\n";
+			};
+			_ostr << std::string(_indent, '\t') << "{\n";
+		};
+
+		/**
+		 * @brief Writes the end of a branch's taken arm up to and including the brace opening its else arm.
+		*/
+		void write_else_open(std::ostream& _ostr, size_t _indent)
+		{
+			const auto _tabs = std::string(_indent, '\t');
+			_ostr << _tabs << "}\n" << _tabs << "else\n" << _tabs << "{\n";
+		};
+	};
+
+	void generate_statement_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLStatement& v, GLSLLanguage _language,
+		size_t _indent)
+	{
+		if (!v.expr.check_validity(_context))
+		{
+			HUBRIS_ASSERT(false);
+		};
+
+		switch (v.type)
+		{
+		case GLSLStatementType::assignment:
+			_ostr << _context.name(v.dest) << " = ";
+			break;
+		case GLSLStatementType::declaration:
+		{
+			const auto _var = _context.find(v.dest);
+			if (_var && _var->is_const())
+			{
+				_ostr << "const ";
+			};
+			if (_language == GLSLLanguage::glsl)
+			{
+				write_precision(_ostr, _context, v.dest);
+			};
+			_ostr << _context.type(v.dest) << ' ' << _context.name(v.dest) << " = ";
+		};
+		break;
+		case GLSLStatementType::return_value:
+			_ostr << "return ";
+			break;
+		case GLSLStatementType::for_loop:
+			[[fallthrough]];
+		case GLSLStatementType::if_else:
+		{
+			write_block_open(_ostr, _context, v, _language, _indent);
+
+			const auto _tabs = std::string(_indent, '\t');
+			const auto _body = [&](std::span<const GLSLStatement> _statements)
+			{
+				for (auto& _statement : _statements)
+				{
+					_ostr << _tabs << '\t';
+					generate_statement_string(_ostr, _context, _statement, _language, _indent + 1);
+				};
+			};
+			_body(v.body);
+			if (!v.else_body.empty())
+			{
+				write_else_open(_ostr, _indent);
+				_body(v.else_body);
+			};
+			_ostr << _tabs << "};\n";
+		};
+		return;
+		default:
+			abort();
+			break;
+		};
+
+		if (!generate_expression_string(_ostr, _context, v.expr, _language))
+		{
+			abort();
+		};
+
+		_ostr << ";\n";
+	};
+
+	size_t statement_size(std::span<const GLSLStatement> _statements)
+	{
+		size_t _size = 0;
+		for_each_statement(_statements, [&_size](const GLSLStatement& _statement)
+			{
+				++_size;
+				for_each_expression(_statement.expr, [&_size](const GLSLExpression&)
+					{
+						++_size;
+					});
+			});
+		return _size;
+	};
+
+	std::optional<int64_t> loop_trip_count(const GLSLStatement& _loop)
+	{
+		if (_loop.expr.type() != GLSLExpressionType::identity)
+		{
+			return std::nullopt;
+		};
+		const auto& _bound = _loop.expr.get<GLSLExpression::Identity>().param;
+		if (!_bound.is_literal() || _bound.literal().type() != GLSLType::glsl_int)
+		{
+			return std::nullopt;
+		};
+
+		// The body must not move the induction variable
+		bool _written = false;
+		for_each_statement(_loop.body, [&](const GLSLStatement& _statement)
+			{
+				_written = _written || (_statement.has_dest() && _statement.dest == _loop.dest);
+			});
+		if (_written)
+		{
+			return std::nullopt;
+		};
+
+		const auto _begin = int64_t(_loop.loop.begin);
+		const auto _end = int64_t(_bound.literal().vec1<int>());
+		const auto _step = int64_t(_loop.loop.step);
+		if (_step > 0)
+		{
+			return (_end > _begin) ? (_end - _begin + _step - 1) / _step : 0;
+		}
+		else
+		{
+			return (_begin > _end) ? (_begin - _end - _step - 1) / -_step : 0;
+		};
+	};
+
+	namespace
+	{
+		void substitute_param(GLSLExpression::Parameter& _param, const std::map<GLSLVariableID, GLSLExpression::Parameter>& _with)
+		{
+			if (_param.is_expression())
+			{
+				for_each_param(_param.expr(), [&_with](GLSLExpression::Parameter& _child)
+					{
+						substitute_param(_child, _with);
+					});
+			}
+			else if (_param.is_variable())
+			{
+				if (const auto it = _with.find(_param.id()); it != _with.end())
+				{
+					_param = it->second.clone();
+				};
+			};
+		};
+	};
+
+	void substitute_variables(GLSLExpression& _expr, const std::map<GLSLVariableID, GLSLExpression::Parameter>& _with)
+	{
+		for_each_param(_expr, [&_with](GLSLExpression::Parameter& _param)
+			{
+				substitute_param(_param, _with);
+			});
+	};
+
+	bool calls_user_functions(const GLSLContext& _context, const GLSLExpression& _expr)
+	{
+		bool _calls = false;
+		for_each_expression(_expr, [&_context, &_calls](const GLSLExpression& _node)
+			{
+				if (_node.type() == GLSLExpressionType::function_call)
+				{
+					const auto _function = _context.find(_node.get<GLSLExpression::FunctionCall>().function);
+					_calls = _calls || !_function || !_function->builtin();
+				};
+			});
+		return _calls;
+	};
+
+	void generate_function_signature(std::ostream& _ostr, const GLSLContext& _context, const GLSLFunction& _function)
+	{
+		_ostr << _function.return_type() << ' ' << _function.name() << '(';
+
+		size_t n = 0;
+		for (auto& _param : _function.params())
+		{
+			if (n != 0)
+			{
+				_ostr << ", ";
+			};
+			write_precision(_ostr, _context, _param);
+			_ostr << _context.type(_param) << ' ' << _context.name(_param);
+			++n;
+		};
+
+		_ostr << ')';
+	};
+
+	GLSLEmitCursor::GLSLEmitCursor(const GLSLContext& _context, const GLSLParams& _params) :
+		GLSLEmitCursor(_context, _params, GLSLTarget::from_params(_params), GLSLShaderStage::vertex)
+	{};
+	GLSLEmitCursor::GLSLEmitCursor(const GLSLContext& _context, const GLSLParams& _params, const GLSLTarget& _target,
+		GLSLShaderStage _stage) :
+		context_(&_context),
+		params_(&_params),
+		target_(_target),
+		stage_(_stage),
+		variable_(_context.variables().begin())
+	{};
+
+	void GLSLEmitCursor::enter(Section _section)
+	{
+		this->section_ = _section;
+		this->variable_ = this->context_->variables().begin();
+		this->index_ = 0;
+	};
+
+	bool GLSLEmitCursor::find_variable()
+	{
+		const auto _end = this->context_->variables().end();
+		for (; this->variable_ != _end; ++this->variable_)
+		{
+			auto& v = *this->variable_;
+			switch (this->section_)
+			{
+			case Section::inputs:
+				if (v.inout() == GLSLInOut::in && !v.builtin()) { return true; };
+				break;
+			case Section::outputs:
+				if (v.inout() == GLSLInOut::out && !v.builtin()) { return true; };
+				break;
+			case Section::uniforms:
+				if (v.uniform()) { return true; };
+				break;
+			default:
+				break;
+			};
+		};
+		return false;
+	};
+
+	void GLSLEmitCursor::write_layout(std::ostream& _ostr) const
+	{
+		switch (this->section_)
+		{
+		case Section::inputs:
+			// Only the inputs and outputs bound by the API, those between stages match by name
+			if (this->target_.explicit_locations && this->stage_ == GLSLShaderStage::vertex)
+			{
+				_ostr << "layout(location = " << this->index_ << ") ";
+			};
+			break;
+		case Section::outputs:
+			if (this->target_.explicit_locations && this->stage_ == GLSLShaderStage::fragment)
+			{
+				_ostr << "layout(location = " << this->index_ << ") ";
+			};
+			break;
+		case Section::uniforms:
+			if (this->target_.explicit_bindings && is_sampler((*this->variable_).type()))
+			{
+				_ostr << "layout(binding = " << this->index_ << ") ";
+			};
+			break;
+		default:
+			break;
+		};
+	};
+
+	bool GLSLEmitCursor::step(std::ostream& _ostr)
+	{
+		switch (this->section_)
+		{
+		case Section::version:
+			if (this->target_.profile == GLSLProfile::es)
+			{
+				// GLSL ES 3.00 and up, find_missing_features() rejects older ES targets
+				_ostr << "#version " << this->target_.version << " es\n\n";
+
+				// Fragment shaders have no default float precision, sampler2DArray has none at all
+				const auto _float = (this->params_->float_precision != GLSLPrecision::none) ?
+					this->params_->float_precision : GLSLPrecision::highp;
+				const auto _int = this->params_->int_precision;
+				_ostr << "precision " << glsl_precision_name(_float) << " float;\n" <<
+					"precision " << glsl_precision_name(_float) << " sampler2DArray;\n";
+				if (_int != GLSLPrecision::none)
+				{
+					_ostr << "precision " << glsl_precision_name(_int) << " int;\n";
+				};
+				_ostr << '\n';
+			}
+			else
+			{
+				_ostr << "#version " << this->target_.version << " core\n\n";
+			};
+			this->enter(Section::inputs);
+			break;
+
+		case Section::inputs:
+			[[fallthrough]];
+		case Section::outputs:
+			if (this->find_variable())
+			{
+				auto& v = *this->variable_;
+				this->write_layout(_ostr);
+				_ostr << ((this->section_ == Section::inputs) ? "in " : "out ");
+				write_precision(_ostr, *this->context_, v.id());
+				_ostr << v.type() << ' ' << v.name() <<
+					"; // id = " << v.id().get() << '\n';
+				++this->variable_;
+				++this->index_;
+			}
+			else
+			{
+				if (this->index_ != 0)
+				{
+					_ostr << '\n';
+				};
+				this->enter((this->section_ == Section::inputs) ? Section::outputs : Section::uniforms);
+			};
+			break;
+
+		case Section::uniforms:
+			if (this->find_variable())
+			{
+				auto& v = *this->variable_;
+				this->write_layout(_ostr);
+				_ostr << "uniform ";
+				write_precision(_ostr, *this->context_, v.id());
+				_ostr << v.type() << ' ' << v.name() << ";\n";
+				if (is_sampler(v.type()))
+				{
+					++this->index_;
+				};
+				++this->variable_;
+			}
+			else
+			{
+				this->enter(Section::globals);
+			};
+			break;
+
+		case Section::globals:
+		{
+			auto& _globals = this->params_->globals;
+			if (this->index_ != _globals.size())
+			{
+				generate_statement_string(_ostr, *this->context_, _globals[this->index_]);
+				++this->index_;
+			}
+			else
+			{
+				if (!_globals.empty())
+				{
+					_ostr << '\n';
+				};
+				this->enter(Section::functions);
+			};
+		};
+		break;
+
+		case Section::functions:
+		{
+			// User defined functions, then main
+			auto& _functions = this->params_->functions;
+			const bool _isMain = this->function_ == _functions.size();
+			auto& _function = (_isMain) ? this->params_->main_fn : _functions[this->function_];
+
+			if (!this->in_body_)
+			{
+				generate_function_signature(_ostr, *this->context_, _function);
+				_ostr << "\n{\n";
+				this->in_body_ = true;
+				this->index_ = 0;
+			}
+			else if (!this->blocks_.empty())
+			{
+				// Statements within a block are indented one further than the block itself
+				const auto _indent = this->blocks_.size();
+				auto& _block = this->blocks_.back();
+				const auto& _statement = *_block.statement;
+				const auto _statements = std::span<const GLSLStatement>((_block.else_arm) ? _statement.else_body : _statement.body);
+
+				if (_block.index != _statements.size())
+				{
+					const auto& _next = _statements[_block.index];
+					++_block.index;
+					_ostr << std::string(_indent + 1, '\t');
+					this->write_statement(_ostr, _next, _indent + 1);
+				}
+				else if (!_block.else_arm && !_statement.else_body.empty())
+				{
+					write_else_open(_ostr, _indent);
+					_block.else_arm = true;
+					_block.index = 0;
+				}
+				else
+				{
+					_ostr << std::string(_indent, '\t') << "};\n";
+					this->blocks_.pop_back();
+				};
+			}
+			else if (const auto _body = _function.body(); this->index_ != _body.size())
+			{
+				_ostr << '\t';
+				this->write_statement(_ostr, _body[this->index_], 1);
+				++this->index_;
+			}
+			else
+			{
+				_ostr << "};\n";
+				this->in_body_ = false;
+				if (_isMain)
+				{
+					this->section_ = Section::done;
+				}
+				else
+				{
+					_ostr << '\n';
+					++this->function_;
+				};
+			};
+		};
+		break;
+
+		case Section::done:
+			return false;
+		};
+
+		return true;
+	};
+
+	void GLSLEmitCursor::write_statement(std::ostream& _ostr, const GLSLStatement& _statement, size_t _indent)
+	{
+		if (_statement.type != GLSLStatementType::for_loop && _statement.type != GLSLStatementType::if_else)
+		{
+			generate_statement_string(_ostr, *this->context_, _statement, GLSLLanguage::glsl, _indent);
+			return;
+		};
+
+		if (!_statement.expr.check_validity(*this->context_))
+		{
+			HUBRIS_ASSERT(false);
+		};
+		write_block_open(_ostr, *this->context_, _statement, GLSLLanguage::glsl, _indent);
+		this->blocks_.push_back(Block{ &_statement });
+	};
+
+	void generate_glsl(const GLSLContext& _context, const GLSLParams& _params, std::ostream& _ostr)
+	{
+		generate_glsl(_context, _params, GLSLTarget::from_params(_params), GLSLShaderStage::vertex, _ostr);
+	};
+
+	void generate_glsl(const GLSLContext& _context, const GLSLParams& _params, const GLSLTarget& _target,
+		GLSLShaderStage _stage, std::ostream& _ostr)
+	{
+		const auto _phase = GLSLScopedPhase(GLSLPhase::emit);
+		const auto _site = GLSLScopedAllocSite(GLSLAllocSite::emit);
+
+		// Only query the stream position when counting, tellp() may be slow or unsupported.
+		const auto _start = (active_stats()) ? _ostr.tellp() : std::ostream::pos_type(-1);
+
+		auto _cursor = GLSLEmitCursor(_context, _params, _target, _stage);
+		while (_cursor.step(_ostr)) {};
+
+		if (_start != std::ostream::pos_type(-1))
+		{
+			if (const auto _end = _ostr.tellp(); _end != std::ostream::pos_type(-1))
+			{
+				count_stat(GLSLCounter::bytes_emitted, static_cast<uint64_t>(_end - _start));
+			};
+		};
+	};
+};
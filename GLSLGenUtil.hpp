@@ -3,6 +3,7 @@
 /** @file */
 
 #include "utility.hpp"
+#include "GLSLGenStats.hpp"
 
 #include <jclib/concepts.h>
 #include <jclib/functional.h>
@@ -22,6 +23,7 @@
 #include <list>
 #include <vector>
 #include <span>
+#include <limits>
 #include <optional>
 
 namespace glsl
@@ -33,6 +35,50 @@ namespace glsl
 		out = 2,
 	};
 
+	/**
+	 * @brief GLSL language profile written in the "#version" directive.
+	*/
+	enum class GLSLProfile : uint8_t
+	{
+		core = 0,
+
+		// OpenGL ES, precision qualifiers apply
+		es,
+	};
+
+	/**
+	 * @brief Shader stage, selects the builtin variables a shader source can reference.
+	*/
+	enum class GLSLShaderStage
+	{
+		vertex = 0,
+		fragment,
+	};
+
+	/**
+	 * @brief GLSL ES precision qualifier.
+	*/
+	enum class GLSLPrecision : uint8_t
+	{
+		// No qualifier, the default precision declared for the type applies
+		none = 0,
+
+		// Floats within (-2, 2) to 2^-8, ints within [-2^8, 2^8 - 1]
+		lowp,
+
+		// Floats within (-2^14, 2^14) to a relative 2^-10, ints within [-2^15, 2^15 - 1]
+		mediump,
+
+		// 32 bit floats and ints
+		highp,
+	};
+
+	constexpr std::string_view glsl_precision_name(GLSLPrecision _precision)
+	{
+		constexpr std::string_view _names[] = { "", "lowp", "mediump", "highp" };
+		return _names[static_cast<size_t>(_precision)];
+	};
+
 	enum class GLSLType
 	{
 		/**
@@ -179,6 +225,40 @@ namespace glsl
 		};
 	}
 
+	/**
+	 * @brief Gets the type for a GLSL type name, the inverse of glsl_typename().
+	 * @param _name GLSL type name, ie. "vec3".
+	 * @return GLSL type, or glsl_error if the name is not a known type.
+	*/
+	constexpr GLSLType glsl_type_from_name(std::string_view _name)
+	{
+		constexpr auto _types = std::array
+		{
+			GLSLType::glsl_void,
+			GLSLType::glsl_bool,
+			GLSLType::glsl_int,
+			GLSLType::glsl_float,
+			GLSLType::glsl_vec2,
+			GLSLType::glsl_vec3,
+			GLSLType::glsl_vec4,
+			GLSLType::glsl_double,
+			GLSLType::glsl_dvec2,
+			GLSLType::glsl_dvec3,
+			GLSLType::glsl_dvec4,
+			GLSLType::glsl_mat4,
+			GLSLType::glsl_sampler_2D,
+			GLSLType::glsl_sampler_2D_array,
+		};
+		for (auto& _type : _types)
+		{
+			if (glsl_typename(_type) == _name)
+			{
+				return _type;
+			};
+		};
+		return GLSLType::glsl_error;
+	};
+
 	constexpr size_t vec_size(GLSLType _type)
 	{
 		switch (_type)
@@ -298,6 +378,10 @@ namespace glsl
 		{
 			return this->const_;
 		};
+		GLSLPrecision precision() const
+		{
+			return this->precision_;
+		};
 
 		/**
 		 * @brief Checks if the variable can be written to.
@@ -346,6 +430,11 @@ namespace glsl
 			this->const_ = _const;
 			return *this;
 		};
+		GLSLVariable& set_precision(GLSLPrecision _precision)
+		{
+			this->precision_ = _precision;
+			return *this;
+		};
 
 		GLSLVariable() = default;
 
@@ -369,6 +458,7 @@ namespace glsl
 		bool builtin_ = false;
 		bool uniform_ = false;
 		bool const_ = false;
+		GLSLPrecision precision_ = GLSLPrecision::none;
 	};
 
 
@@ -451,6 +541,24 @@ namespace glsl
 	constexpr static GLSLFunctionOverloadRating rating_match_v = std::numeric_limits<GLSLFunctionOverloadRating>::max();
 	constexpr static GLSLFunctionOverloadRating rating_no_match_v = std::numeric_limits<GLSLFunctionOverloadRating>::min();
 
+	/**
+	 * @brief Estimated cost of calling a builtin function overload, see estimate_cost().
+	*/
+	struct GLSLFunctionCost
+	{
+		// Plain arithmetic instructions
+		uint32_t alu = 0;
+
+		// Special function unit instructions, ie. sin, exp2, log2 and reciprocals
+		uint32_t transcendental = 0;
+
+		// Texture fetches
+		uint32_t texture = 0;
+
+		// The cost is per component of the widest argument, ie. dot(vec3, vec3) costs 3 times as much
+		bool per_component = true;
+	};
+
 	struct GLSLFunctionDecl
 	{
 	private:
@@ -466,6 +574,9 @@ namespace glsl
 			std::vector<GLSLFunctionParameter> params{};
 			GLSLType return_type;
 
+			// Only meaningful for builtins
+			GLSLFunctionCost cost{};
+
 			Overload& add_param(GLSLType _type)
 			{
 				this->params.push_back(GLSLFunctionParameter(_type));
@@ -479,7 +590,7 @@ namespace glsl
 
 			bool invocable(std::span<const GLSLType> _params) const
 			{
-				if (this->params.size() != _params.size()) {
+				if (this->params.size() != _params.size() || !this->generics_agree(_params)) {
 					return false;
 				};
 
@@ -496,9 +607,38 @@ namespace glsl
 
 
 
+			/**
+			 * @brief Checks that parameters sharing a generic type category are given the same type,
+			 *	ie. dot(genType, genType) takes two vec2s but not a vec2 and a float.
+			*/
+			bool generics_agree(std::span<const GLSLType> _params) const
+			{
+				const auto _count = std::min(_params.size(), this->params.size());
+				for (size_t n = 0; n != _count; ++n)
+				{
+					if (!this->params[n].is_generic() || _params[n] == GLSLType::glsl_auto)
+					{
+						continue;
+					};
+					for (size_t i = n + 1; i != _count; ++i)
+					{
+						if (this->params[i].is_generic() && this->params[i].get_generic() == this->params[n].get_generic() &&
+							_params[i] != GLSLType::glsl_auto && _params[i] != _params[n])
+						{
+							return false;
+						};
+					};
+				};
+				return true;
+			};
+
 			OverloadRating rate_parameter_match(std::span<const GLSLType> _params) const
 			{
-				if (this->invocable(_params))
+				if (!this->generics_agree(_params))
+				{
+					return rating_no_match_v;
+				}
+				else if (this->invocable(_params))
 				{
 					return rating_match_v;
 				}
@@ -665,27 +805,28 @@ namespace glsl
 				{};
 			};
 
+			count_stat(GLSLCounter::overload_evaluations, this->overloads_.size());
+			const auto _site = GLSLScopedAllocSite(GLSLAllocSite::overloads);
+
 			auto _overloads = std::vector<Data>(this->overloads_.size());
 			std::ranges::copy(this->overloads_, _overloads.begin());
 
 			for (auto& v : _overloads) { v.rate(_params); };
 
 			// Remove none-matches
-			std::erase_if(_overloads, (jc::member & &Data::rating) | jc::equals & 0);
+			std::erase_if(_overloads, (jc::member & &Data::rating) | jc::equals & rating_no_match_v);
 			
 			if (_overloads.empty())
 			{
 				return nullptr;
 			};
 
-			// Sort by rating
-			const auto _comparisonFn = [&_params](const Data& lhs, const Data& rhs) -> int
+			// Sort by rating, best first, ties keep their declaration order
+			const auto _comparisonFn = [](const Data& lhs, const Data& rhs) -> bool
 			{
-				const auto l = lhs.rating;
-				const auto r = rhs.rating;
-				return r - l;
+				return lhs.rating > rhs.rating;
 			};
-			std::ranges::sort(_overloads, _comparisonFn);
+			std::ranges::stable_sort(_overloads, _comparisonFn);
 
 			// Return best (front)
 			return _overloads.front().overload;
@@ -715,6 +856,15 @@ namespace glsl
 			return this->name_;
 		}
 
+		/**
+		 * @brief Gets the overloads defined for the function.
+		 * @return Span of overloads in the order they were added.
+		*/
+		std::span<const Overload> overloads() const
+		{
+			return this->overloads_;
+		};
+
 		GLSLFunctionDecl& set_name(const std::string& _name)
 		{
 			this->name_ = _name;
@@ -742,6 +892,16 @@ namespace glsl
 			return *this;
 		};
 
+		/**
+		 * @brief Sets the cost of the overload added last.
+		*/
+		GLSLFunctionDecl& set_cost(GLSLFunctionCost _cost)
+		{
+			HUBRIS_ASSERT(!this->overloads_.empty());
+			this->overloads_.back().cost = _cost;
+			return *this;
+		};
+
 
 		GLSLFunctionDecl(ID _id, const std::string& _name, GLSLType _returnType) :
 			id_(_id), name_(_name), overloads_{}
@@ -804,6 +964,16 @@ namespace glsl
 		template <typename T = float>
 		std::array<T, 4> vec4() const { return this->arr<T>(); }
 
+		/**
+		 * @brief Compares type and value, floating point components are compared bitwise.
+		*/
+		bool operator==(const GLSLLiteral& other) const noexcept;
+
+		/**
+		 * @brief Hashes the type and value, consistent with operator==.
+		*/
+		size_t hash() const noexcept;
+
 
 
 		explicit GLSLLiteral(GLSLType _type, std::array<bool, 4> _parts) :
@@ -892,6 +1062,7 @@ namespace glsl
 		};
 		GLSLVariable* new_variable(GLSLVariableID _id, const std::string& _name, GLSLType _type)
 		{
+			const auto _site = GLSLScopedAllocSite(GLSLAllocSite::symbols);
 			auto _var = GLSLVariable(_id, _name, _type);
 			auto [it, _good] = this->variables_.insert_or_assign(_id, _var);
 			return &it->second;
@@ -921,6 +1092,7 @@ namespace glsl
 
 		GLSLFunctionDecl* new_function(const std::string& _name, GLSLType _returnType)
 		{
+			const auto _site = GLSLScopedAllocSite(GLSLAllocSite::symbols);
 			const auto _id = this->new_function_id();
 			auto _decl = GLSLFunctionDecl(_id, _name, _returnType);
 			auto [it, _good] = this->functions_.insert_or_assign(_id, std::move(_decl));
@@ -1043,7 +1215,39 @@ namespace glsl
 			return (_var) ? _var->type() : GLSLType::glsl_auto;
 		};
 
-	private:
+		/**
+		 * @brief Adds a variable using the ID it already holds.
+		 *
+		 * Used when restoring a saved context, the ID counter is bumped so that
+		 * newly created symbols never collide with restored ones.
+		 *
+		 * @param _var Variable to insert.
+		 * @return Pointer to the inserted variable.
+		*/
+		GLSLVariable* restore_variable(GLSLVariable _var)
+		{
+			const auto _id = _var.id();
+			this->id_counter_ = std::max(this->id_counter_, _id.get());
+			auto [it, _good] = this->variables_.insert_or_assign(_id, std::move(_var));
+			return &it->second;
+		};
+
+		/**
+		 * @brief Adds a function declaration using the ID it already holds.
+		 *
+		 * Used when restoring a saved context, see restore_variable().
+		 *
+		 * @param _decl Function declaration to insert.
+		 * @return Pointer to the inserted declaration.
+		*/
+		GLSLFunctionDecl* restore_function(GLSLFunctionDecl _decl)
+		{
+			const auto _id = _decl.id();
+			this->id_counter_ = std::max(this->id_counter_, _id.get());
+			auto [it, _good] = this->functions_.insert_or_assign(_id, std::move(_decl));
+			return &it->second;
+		};
+
 		auto variables()
 		{
 			return this->variables_ | std::views::values;
@@ -1053,6 +1257,8 @@ namespace glsl
 			return this->variables_ | std::views::values;
 		};
 
+	private:
+
 		auto filter_variables_inout(GLSLInOut _inOut, bool _builtin)
 		{
 			return this->variables() | std::views::filter([_inOut, _builtin](auto& v)
@@ -1096,6 +1302,7 @@ namespace glsl
 
 		GLSLVariableID id(const std::string& _name) const
 		{
+			count_stat(GLSLCounter::lookups);
 			auto& vs = this->variables_;
 			for (auto& [_id, _var] : vs)
 			{
@@ -1108,6 +1315,7 @@ namespace glsl
 		};
 		GLSLFunctionID function_id(const std::string& _name) const
 		{
+			count_stat(GLSLCounter::lookups);
 			auto& vs = this->functions_;
 			for (auto& [_id, _var] : vs)
 			{
@@ -1119,6 +1327,26 @@ namespace glsl
 			return GLSLFunctionID();
 		};
 
+		/**
+		 * @brief Removes a variable from the context.
+		 * @param _id Variable ID.
+		 * @return True if a variable was removed, false otherwise.
+		*/
+		bool erase(GLSLVariableID _id)
+		{
+			return this->variables_.erase(_id) != 0;
+		};
+
+		/**
+		 * @brief Removes a function declaration from the context.
+		 * @param _id Function ID.
+		 * @return True if a function was removed, false otherwise.
+		*/
+		bool erase(GLSLFunctionID _id)
+		{
+			return this->functions_.erase(_id) != 0;
+		};
+
 		void set_deduced_type(GLSLVariableID _varID, GLSLType _type)
 		{
 			auto _var = this->find(_varID);
@@ -1170,6 +1398,22 @@ namespace glsl
 		not_equal,
 		neq = not_equal,
 
+		// a < b
+		less,
+		lt = less,
+
+		// a <= b
+		less_equal,
+		le = less_equal,
+
+		// a > b
+		greater,
+		gt = greater,
+
+		// a >= b
+		greater_equal,
+		ge = greater_equal,
+
 	};
 	
 	/**
@@ -1200,6 +1444,18 @@ namespace glsl
 		function_call,
 		binary_op,
 		swizzle,
+		select,
+	};
+
+	/**
+	 * @brief Language written by the expression generator.
+	*/
+	enum class GLSLLanguage
+	{
+		glsl = 0,
+
+		// C++ using the vector types declared by generate_cpp().
+		cpp,
 	};
 
 	struct GLSLExpression
@@ -1233,6 +1489,10 @@ namespace glsl
 
 			GLSLType type(const GLSLContext& _context) const;
 
+			const GLSLLiteral& literal() const
+			{
+				return std::get<GLSLLiteral>(this->vt_);
+			};
 
 			GLSLExpression& expr()
 			{
@@ -1243,7 +1503,23 @@ namespace glsl
 				return *std::get<1>(this->vt_);
 			};
 
-			bool generate(std::ostream& _ostr, const GLSLContext& _context) const;
+			bool generate(std::ostream& _ostr, const GLSLContext& _context, GLSLLanguage _language = GLSLLanguage::glsl) const;
+
+			/**
+			 * @brief Creates a deep copy of the parameter.
+			 * @return Copied parameter.
+			*/
+			Parameter clone() const;
+
+			/**
+			 * @brief Structural equality, expression parameters compare their trees.
+			*/
+			bool operator==(const Parameter& other) const;
+
+			/**
+			 * @brief Structural hash, consistent with operator==.
+			*/
+			size_t hash() const;
 
 			Parameter() :
 				vt_(GLSLVariableID(0))
@@ -1313,6 +1589,11 @@ namespace glsl
 				return this->to_;
 			};
 
+			GLSLType to_type() const
+			{
+				return this->to_;
+			};
+
 			Cast() :
 				param{},
 				to_{ GLSLType::glsl_error }
@@ -1466,8 +1747,27 @@ namespace glsl
 
 		};
 
+		/**
+		 * @brief Picks one of two values of the same type by a bool, written as "c ? a : b".
+		*/
+		struct Select : public ExprBase
+		{
+			Parameter condition;
+			Parameter if_true;
+			Parameter if_false;
+
+			GLSLType result_type(const GLSLContext& _context) const;
+
+			Select() = default;
+			Select(Parameter _condition, Parameter _ifTrue, Parameter _ifFalse) :
+				condition(std::move(_condition)),
+				if_true(std::move(_ifTrue)),
+				if_false(std::move(_ifFalse))
+			{};
+		};
+
 	private:
-		using variant_type = std::variant<Identity, Cast, FunctionCall, BinaryOp, Swizzle>;
+		using variant_type = std::variant<Identity, Cast, FunctionCall, BinaryOp, Swizzle, Select>;
 	public:
 
 		GLSLExpressionType type() const
@@ -1531,6 +1831,35 @@ namespace glsl
 				this->vt_);
 			return _result;
 		};
+
+		/**
+		 * @brief Creates a deep copy of the expression tree.
+		 *
+		 * The copy is never shared, even if this expression is.
+		 *
+		 * @return Copied expression.
+		*/
+		GLSLExpression clone() const;
+
+		/**
+		 * @brief Structural equality, compares the whole tree.
+		 *
+		 * Shared subtrees are compared by address first, so trees built from the same
+		 * GLSLExpressionPool compare without walking their common nodes.
+		*/
+		bool operator==(const GLSLExpression& other) const;
+
+		/**
+		 * @brief Structural hash of the whole tree, consistent with operator==.
+		*/
+		size_t hash() const;
+
+		/**
+		 * @brief Checks if the node is owned by more than one parameter (see GLSLExpressionPool).
+		 *
+		 * Shared nodes must not be modified, clone() them first.
+		*/
+		bool shared() const noexcept { return this->refs_ != 0; };
 		
 
 
@@ -1544,21 +1873,1028 @@ namespace glsl
 			std::move_constructible<std::remove_cvref_t<T>>)
 		static UniqueExpression make_unique(T&& _expr)
 		{
+			count_stat(GLSLCounter::nodes);
+			const auto _site = GLSLScopedAllocSite(GLSLAllocSite::nodes);
 			return UniqueExpression(new GLSLExpression(std::forward<T>(_expr)));
 		};
+		static UniqueExpression make_unique(GLSLExpression&& _expr)
+		{
+			count_stat(GLSLCounter::nodes);
+			const auto _site = GLSLScopedAllocSite(GLSLAllocSite::nodes);
+			return UniqueExpression(new GLSLExpression(std::move(_expr)));
+		};
 
 		GLSLExpression() :
 			vt_(Identity{  })
 		{};
 
-		GLSLExpression(GLSLExpression&& other) noexcept = default;
-		GLSLExpression& operator=(GLSLExpression&& other) noexcept = default;
+		// Ownership is not moved, only the node's value.
+		GLSLExpression(GLSLExpression&& other) noexcept :
+			vt_(std::move(other.vt_))
+		{};
+		GLSLExpression& operator=(GLSLExpression&& other) noexcept
+		{
+			this->vt_ = std::move(other.vt_);
+			return *this;
+		};
 
 	private:
+		friend GLSLExpressionDeleter;
+		friend struct GLSLExpressionPool;
+
 		variant_type vt_;
+
+		// Number of owners beyond the first, non-zero only for pooled nodes
+		uint32_t refs_ = 0;
+	};
+
+	/**
+	 * @brief Combines a hash value into a seed.
+	*/
+	constexpr size_t hash_combine(size_t _seed, size_t _value) noexcept
+	{
+		return _seed ^ (_value + 0x9e3779b97f4a7c15ull + (_seed << 6) + (_seed >> 2));
+	};
+
+	/**
+	 * @brief Hashes a single expression node, child expressions are hashed with the given function.
+	 *
+	 * Used by GLSLExpression::hash() and by GLSLExpressionPool, which passes cached child hashes.
+	 *
+	 * @param _expr Expression node.
+	 * @param _childHash Invoked with each child GLSLExpression, returns its hash.
+	 * @return Node hash.
+	*/
+	template <typename FnT>
+	inline size_t hash_expression_node(const GLSLExpression& _expr, FnT&& _childHash);
+
+
+
+	/**
+	 * @brief Writes an expression as source code.
+	 * @param _ostr Output stream.
+	 * @param _context Context holding the symbols.
+	 * @param _expr Expression to write.
+	 * @param _language Language to write, GLSL by default.
+	 * @return True on success, false otherwise.
+	*/
+	bool generate_expression_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLExpression& _expr,
+		GLSLLanguage _language = GLSLLanguage::glsl);
+
+	/**
+	 * @brief Calls a function for each parameter directly held by an expression.
+	 * @param _expr Expression, may be const.
+	 * @param _fn Invoked with each (possibly const) GLSLExpression::Parameter.
+	*/
+	template <typename ExprT, typename FnT>
+	inline void for_each_param(ExprT& _expr, FnT&& _fn)
+	{
+		switch (_expr.type())
+		{
+		case GLSLExpressionType::identity:
+			_fn(_expr.template get<GLSLExpression::Identity>().param);
+			break;
+		case GLSLExpressionType::cast:
+			_fn(_expr.template get<GLSLExpression::Cast>().param);
+			break;
+		case GLSLExpressionType::function_call:
+			for (auto& v : _expr.template get<GLSLExpression::FunctionCall>().params)
+			{
+				_fn(v);
+			};
+			break;
+		case GLSLExpressionType::binary_op:
+			_fn(_expr.template get<GLSLExpression::BinaryOp>().lhs);
+			_fn(_expr.template get<GLSLExpression::BinaryOp>().rhs);
+			break;
+		case GLSLExpressionType::swizzle:
+			_fn(_expr.template get<GLSLExpression::Swizzle>().what);
+			break;
+		case GLSLExpressionType::select:
+			_fn(_expr.template get<GLSLExpression::Select>().condition);
+			_fn(_expr.template get<GLSLExpression::Select>().if_true);
+			_fn(_expr.template get<GLSLExpression::Select>().if_false);
+			break;
+		default:
+			abort();
+			break;
+		};
+	};
+
+	/**
+	 * @brief Calls a function for every expression node in a tree, parents before children.
+	 * @param _expr Root expression, may be const.
+	 * @param _fn Invoked with each (possibly const) GLSLExpression.
+	*/
+	template <typename ExprT, typename FnT>
+	inline void for_each_expression(ExprT& _expr, FnT&& _fn)
+	{
+		_fn(_expr);
+		for_each_param(_expr, [&_fn](auto& _param)
+			{
+				if (_param.is_expression())
+				{
+					for_each_expression(_param.expr(), _fn);
+				};
+			});
+	};
+
+	template <typename FnT>
+	inline size_t hash_expression_node(const GLSLExpression& _expr, FnT&& _childHash)
+	{
+		auto _hash = static_cast<size_t>(_expr.type());
+		switch (_expr.type())
+		{
+		case GLSLExpressionType::cast:
+			_hash = hash_combine(_hash, static_cast<size_t>(_expr.get<GLSLExpression::Cast>().to_type()));
+			break;
+		case GLSLExpressionType::function_call:
+			_hash = hash_combine(_hash, _expr.get<GLSLExpression::FunctionCall>().function.get());
+			break;
+		case GLSLExpressionType::binary_op:
+			_hash = hash_combine(_hash, static_cast<size_t>(_expr.get<GLSLExpression::BinaryOp>().op));
+			break;
+		case GLSLExpressionType::swizzle:
+			for (auto& v : _expr.get<GLSLExpression::Swizzle>().swizzle_)
+			{
+				_hash = hash_combine(_hash, v);
+			};
+			break;
+		default:
+			break;
+		};
+
+		for_each_param(_expr, [&_hash, &_childHash](const GLSLExpression::Parameter& _param)
+			{
+				if (_param.is_expression())
+				{
+					_hash = hash_combine(_hash, _childHash(_param.expr()));
+				}
+				else if (_param.is_literal())
+				{
+					_hash = hash_combine(_hash, _param.literal().hash());
+				}
+				else
+				{
+					_hash = hash_combine(_hash, ~static_cast<size_t>(_param.id().get()));
+				};
+			});
+		return _hash;
+	};
+
+
+
+	enum class GLSLStatementType
+	{
+		declaration = 1,
+		assignment,
+
+		// return <expr>, dest is unused.
+		return_value,
+
+		// Counted loop, see GLSLStatement::Loop.
+		for_loop,
+
+		// if (expr) { body } else { else_body }, dest is unused and expr is a bool.
+		if_else,
 	};
 
 
 
-	bool generate_expression_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLExpression& _expr);
+	struct GLSLStatement
+	{
+		using Type = GLSLStatementType;
+
+		GLSLVariableID dest;
+		GLSLExpression expr;
+
+		/**
+		 * @brief The type of statement.
+		*/
+		GLSLStatementType type;
+
+		/**
+		 * @brief Header of a for_loop statement.
+		 *
+		 *	for (int dest = begin; dest < expr; dest += step) { body }
+		 *
+		 * dest is the int induction variable and expr the exclusive bound, counted down to
+		 * instead for a negative step. The trip count is known at compile time when the bound
+		 * is an int literal.
+		*/
+		struct Loop
+		{
+			int32_t begin = 0;
+			int32_t step = 1;
+		};
+		Loop loop{};
+
+		/**
+		 * @brief Statements of a for_loop or the taken arm of an if_else, which may not return.
+		*/
+		std::vector<GLSLStatement> body{};
+
+		/**
+		 * @brief Statements of the else arm of an if_else, may be empty.
+		*/
+		std::vector<GLSLStatement> else_body{};
+
+		/**
+		 * @brief Creates a deep copy of the statement.
+		 * @return Copied statement.
+		*/
+		GLSLStatement clone() const
+		{
+			auto _out = GLSLStatement(this->type);
+			_out.dest = this->dest;
+			_out.expr = this->expr.clone();
+			_out.loop = this->loop;
+			_out.body.reserve(this->body.size());
+			for (auto& v : this->body)
+			{
+				_out.body.push_back(v.clone());
+			};
+			_out.else_body.reserve(this->else_body.size());
+			for (auto& v : this->else_body)
+			{
+				_out.else_body.push_back(v.clone());
+			};
+			return _out;
+		};
+
+		/**
+		 * @brief Checks if dest names a variable, returns and branches leave it unused.
+		*/
+		bool has_dest() const noexcept
+		{
+			return this->type != GLSLStatementType::return_value && this->type != GLSLStatementType::if_else;
+		};
+
+		explicit GLSLStatement(GLSLStatementType _type) :
+			type(_type)
+		{};
+
+	};
+
+	/**
+	 * @brief Writes a statement as source code, followed by ";" and a newline.
+	 * @param _ostr Output stream.
+	 * @param _context Context holding the symbols.
+	 * @param _statement Statement to write.
+	 * @param _language Language to write, GLSL by default.
+	 * @param _indent Tabs the caller already wrote before the statement, nested bodies are indented one further.
+	*/
+	void generate_statement_string(std::ostream& _ostr, const GLSLContext& _context, const GLSLStatement& _statement,
+		GLSLLanguage _language = GLSLLanguage::glsl, size_t _indent = 1);
+
+	/**
+	 * @brief Calls a function for every statement in a list, loops and branches before their bodies.
+	 * @param _statements Statements, may be const.
+	 * @param _fn Invoked with each (possibly const) GLSLStatement.
+	*/
+	template <typename StatementsT, typename FnT>
+	inline void for_each_statement(StatementsT&& _statements, FnT&& _fn)
+	{
+		for (auto& v : _statements)
+		{
+			_fn(v);
+			if (!v.body.empty())
+			{
+				for_each_statement(v.body, _fn);
+			};
+			if (!v.else_body.empty())
+			{
+				for_each_statement(v.else_body, _fn);
+			};
+		};
+	};
+
+	/**
+	 * @brief Size of a statement list used by the optimization heuristics, statements plus expression nodes.
+	*/
+	size_t statement_size(std::span<const GLSLStatement> _statements);
+
+	/**
+	 * @brief Gets the number of iterations a for_loop runs for, if known at compile time.
+	 *
+	 * Known when the bound is an int literal and the body never assigns the induction variable.
+	*/
+	std::optional<int64_t> loop_trip_count(const GLSLStatement& _loop);
+
+	/**
+	 * @brief Replaces variables within an expression tree.
+	 *
+	 * Substitutes are copied at each use and are not visited themselves, so they may refer
+	 * to the variable they replace.
+	 *
+	 * @param _expr Expression, must not be shared.
+	 * @param _with Substitute for each replaced variable.
+	*/
+	void substitute_variables(GLSLExpression& _expr, const std::map<GLSLVariableID, GLSLExpression::Parameter>& _with);
+
+	/**
+	 * @brief Checks if an expression tree calls a user function, which may write globals or outputs.
+	 *
+	 * Such an expression must be evaluated exactly where and when the source asks for it.
+	*/
+	bool calls_user_functions(const GLSLContext& _context, const GLSLExpression& _expr);
+
+
+	struct GLSLFunction
+	{
+	public:
+
+		GLSLFunction& set_name(const std::string& _name)
+		{
+			this->name_ = _name;
+			return *this;
+		};
+
+		std::string_view name() const
+		{
+			return this->name_;
+		}
+		GLSLType return_type() const
+		{
+			return this->return_type_;
+		};
+		GLSLFunction& set_return_type(GLSLType _type)
+		{
+			this->return_type_ = _type;
+			return *this;
+		};
+
+		/**
+		 * @brief Gets the ID of the declaration this function defines.
+		 *
+		 * Null for main, which has no declaration in the context.
+		 *
+		 * @return Function ID.
+		*/
+		GLSLFunctionID id() const
+		{
+			return this->id_;
+		};
+		GLSLFunction& set_id(GLSLFunctionID _id)
+		{
+			this->id_ = _id;
+			return *this;
+		};
+
+		/**
+		 * @brief Gets the variables bound to the function's parameters, in order.
+		*/
+		std::span<const GLSLVariableID> params() const
+		{
+			return this->params_;
+		};
+		GLSLFunction& add_param(GLSLVariableID _param)
+		{
+			this->params_.push_back(_param);
+			return *this;
+		};
+
+		auto body()
+		{
+			return std::span(this->body_);
+		};
+		auto body() const
+		{
+			return std::span(this->body_);
+		};
+
+		void append(GLSLStatement _statement)
+		{
+			this->body_.push_back(std::move(_statement));
+		};
+
+		/**
+		 * @brief Replaces every statement of the function, used by passes rewriting the body.
+		*/
+		void set_body(std::vector<GLSLStatement> _body)
+		{
+			this->body_ = std::move(_body);
+		};
+
+		GLSLFunction(const std::string& _name) :
+			name_(_name)
+		{};
+		GLSLFunction() = default;
+
+	private:
+		std::string name_;
+		std::vector<GLSLStatement> body_{};
+		std::vector<GLSLVariableID> params_{};
+		GLSLType return_type_ = GLSLType::glsl_void;
+		GLSLFunctionID id_{};
+	};
+
+	struct GLSLParams
+	{
+	public:
+
+		auto inputs(bool _builtin = false) const
+		{
+			return this->context_->inputs(_builtin);
+		};
+		auto outputs(bool _builtin = false) const
+		{
+			return this->context_->outputs(_builtin);
+		};
+		auto uniforms() const
+		{
+			return this->context_->uniforms();
+		};
+
+		auto get_name(GLSLVariableID _varID) const
+		{
+			return this->context_->name(_varID);
+		};
+		auto get_type(GLSLVariableID _varID) const
+		{
+			return this->context_->type(_varID);
+		};
+
+		GLSLVariableID id(const std::string& _name) const
+		{
+			return this->context_->id(_name);
+		};
+
+		/**
+		 * @brief Defines a new function, its declaration and parameter variables are added to the context.
+		 * @param _name Name of the function.
+		 * @param _returnType Type returned by the function.
+		 * @param _params Name and type of each parameter.
+		 * @return The new function definition.
+		*/
+		GLSLFunction& define_function(const std::string& _name, GLSLType _returnType,
+			std::initializer_list<std::pair<std::string_view, GLSLType>> _params = {})
+		{
+			return this->define_function(_name, _returnType,
+				std::span<const std::pair<std::string_view, GLSLType>>(_params.begin(), _params.size()));
+		};
+		GLSLFunction& define_function(const std::string& _name, GLSLType _returnType,
+			std::span<const std::pair<std::string_view, GLSLType>> _params)
+		{
+			auto _decl = this->context_->new_function(_name, _returnType);
+			auto _overloadParams = std::vector<GLSLFunctionParameter>{};
+
+			auto& _function = this->functions.emplace_back(_name);
+			_function.set_id(_decl->id()).set_return_type(_returnType);
+			for (auto& [_paramName, _paramType] : _params)
+			{
+				auto _var = this->context_->new_variable(std::string(_paramName), _paramType);
+				_function.add_param(_var->id());
+				_overloadParams.push_back(GLSLFunctionParameter(_paramType));
+			};
+
+			_decl->add_overload(_returnType, std::span<const GLSLFunctionParameter>(_overloadParams));
+			return _function;
+		};
+
+		/**
+		 * @brief Finds the definition for a function declaration.
+		 * @param _id Function ID.
+		 * @return Pointer to the definition, or null if not defined.
+		*/
+		GLSLFunction* find_function(GLSLFunctionID _id)
+		{
+			const auto it = std::ranges::find(this->functions, _id, &GLSLFunction::id);
+			return (it != this->functions.end()) ? &*it : nullptr;
+		};
+		const GLSLFunction* find_function(GLSLFunctionID _id) const
+		{
+			const auto it = std::ranges::find(this->functions, _id, &GLSLFunction::id);
+			return (it != this->functions.end()) ? &*it : nullptr;
+		};
+
+		/**
+		 * @brief Checks if a function may call another, see functions.
+		 * @param _caller Function making the call, either main_fn or one of functions.
+		 * @param _callee Function being called.
+		 * @return True if the callee is a builtin or defined before the caller.
+		*/
+		bool may_call(const GLSLFunction& _caller, GLSLFunctionID _callee) const
+		{
+			const auto _decl = this->context_->find(_callee);
+			if (!_decl)
+			{
+				return false;
+			};
+			if (_decl->builtin())
+			{
+				return true;
+			};
+
+			// Main is emitted last and may call any user function
+			const auto _end = (&_caller == &this->main_fn) ?
+				this->functions.end() :
+				std::ranges::find(this->functions, _caller.id(), &GLSLFunction::id);
+			return std::ranges::find(this->functions.begin(), _end, _callee, &GLSLFunction::id) != _end;
+		};
+
+		/**
+		 * @brief Global declarations (ie. constants), emitted before any function.
+		*/
+		std::vector<GLSLStatement> globals{};
+
+		/**
+		 * @brief User defined functions, emitted before main in this order.
+		 *
+		 * A function may only call functions that come before it, see may_call().
+		*/
+		std::vector<GLSLFunction> functions{};
+
+		GLSLFunction main_fn{ "main" };
+
+		int version = 330;
+		GLSLProfile profile = GLSLProfile::core;
+
+		/**
+		 * @brief Default precisions declared for floats and ints by GLSL ES shaders, see infer_precision().
+		*/
+		GLSLPrecision float_precision = GLSLPrecision::highp;
+		GLSLPrecision int_precision = GLSLPrecision::highp;
+
+		bool check() const
+		{
+			const auto _phase = GLSLScopedPhase(GLSLPhase::check);
+			for (auto& i : inputs())
+			{
+				for (auto& o : outputs())
+				{
+					if (i.name() == o.name())
+					{
+						return false;
+					};
+				};
+			};
+
+			return true;
+		};
+
+		GLSLParams(GLSLContext& _context) :
+			context_(&_context)
+		{};
+
+	private:
+		GLSLContext* context_{};
+	};
+
+	/**
+	 * @brief Most a shader may cost on a target, see estimate_cost(). Unlimited by default.
+	*/
+	struct GLSLCostBudget
+	{
+		double alu = std::numeric_limits<double>::infinity();
+		double transcendental = std::numeric_limits<double>::infinity();
+		double texture = std::numeric_limits<double>::infinity();
+		size_t interpolants = std::numeric_limits<size_t>::max();
+	};
+
+	/**
+	 * @brief Language version and syntax a shader's source is written for.
+	 *
+	 * The same IR can be written for several targets, see generate_glsl_targets().
+	*/
+	struct GLSLTarget
+	{
+		// Short name, ie. to tell the outputs apart
+		std::string_view name{};
+
+		int version = 330;
+		GLSLProfile profile = GLSLProfile::core;
+
+		/**
+		 * @brief Writes "layout(location = N)" on vertex inputs and fragment outputs, numbered in
+		 *	declaration order. Inputs and outputs between stages keep matching by name.
+		*/
+		bool explicit_locations = false;
+
+		/**
+		 * @brief Writes "layout(binding = N)" on samplers, numbered in declaration order. Needs
+		 *	GLSL 4.20 or GLSL ES 3.10.
+		*/
+		bool explicit_bindings = false;
+
+		/**
+		 * @brief Estimated cost the shader must stay within, generate_glsl_targets() writes
+		 *	nothing for the target otherwise.
+		*/
+		GLSLCostBudget budget{};
+
+		// OpenGL 3.3 core profile
+		static constexpr GLSLTarget gl33() { return { "gl33", 330, GLSLProfile::core, true, false }; };
+
+		// OpenGL 4.5 core profile
+		static constexpr GLSLTarget gl45() { return { "gl45", 450, GLSLProfile::core, true, true }; };
+
+		// OpenGL ES 3.0
+		static constexpr GLSLTarget es30() { return { "es30", 300, GLSLProfile::es, true, false }; };
+
+		/**
+		 * @brief Gets the target named by a shader's own version and profile, without explicit layouts.
+		*/
+		static GLSLTarget from_params(const GLSLParams& _params)
+		{
+			return { "", _params.version, _params.profile };
+		};
+	};
+
+
+
+	/**
+	 * @brief Adds the builtin vertex shader inputs and outputs to a context.
+	 * @param _context Context to add the variables to.
+	*/
+	void add_builtin_vertex_shader_variables(GLSLContext& _context);
+
+	/**
+	 * @brief Adds the builtin fragment shader inputs and outputs to a context.
+	 * @param _context Context to add the variables to.
+	*/
+	void add_builtin_fragment_shader_variables(GLSLContext& _context);
+
+	/**
+	 * @brief Adds the builtin functions to a context.
+	 * @param _context Context to add the functions to.
+	*/
+	void add_builtin_functions(GLSLContext& _context);
+
+	/**
+	 * @brief Gets an expression's type, checking each node before asking its parent.
+	 *
+	 * Unlike GLSLExpression::result_type(), ill-formed nodes such as out of range swizzles
+	 * or casts from samplers are reported instead of asserting.
+	 *
+	 * @return The type, glsl_auto if it reads an undeduced variable or glsl_error if ill-formed.
+	*/
+	GLSLType checked_result_type(const GLSLContext& _context, const GLSLExpression& _expr);
+
+	/**
+	 * @brief Deduces the type of auto variables from the statements that write them.
+	 *
+	 * A variable's type comes from the first statement writing it, across the globals, the
+	 * functions and main in that order. Statements are deduced as soon as every auto variable
+	 * they read is known, so chains of auto variables resolve in any order in linear time.
+	 *
+	 * @param _context Context holding the variables.
+	 * @param _params Shader parameters.
+	 * @return True on success, false if a writing statement is ill-formed, auto variables
+	 *	depend on each other or a non-builtin variable is left auto because nothing writes it.
+	*/
+	bool deduce_auto(GLSLContext& _context, GLSLParams& _params);
+
+	/**
+	 * @brief Writes a function's return type, name and parameter list.
+	 * @param _ostr Output stream.
+	 * @param _context Context holding the symbols.
+	 * @param _function Function definition.
+	*/
+	void generate_function_signature(std::ostream& _ostr, const GLSLContext& _context, const GLSLFunction& _function);
+
+	/**
+	 * @brief Writes the GLSL source for a shader.
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	 * @param _ostr Output stream.
+	*/
+	void generate_glsl(const GLSLContext& _context, const GLSLParams& _params, std::ostream& _ostr);
+
+	/**
+	 * @brief Writes the GLSL source for a shader in a target's version and syntax.
+	 *
+	 * The version and profile come from the target instead of the params. GLSL ES targets
+	 * always declare a default float precision, fragment shaders have none otherwise.
+	 * Precision qualifiers are written for every target, GLSL 1.30 and up accept them.
+	 *
+	 * @param _context Context holding the symbols.
+	 * @param _params Shader parameters.
+	 * @param _target Version and syntax to write.
+	 * @param _stage Stage of the shader, decides which inputs and outputs get explicit locations.
+	 * @param _ostr Output stream.
+	*/
+	void generate_glsl(const GLSLContext& _context, const GLSLParams& _params, const GLSLTarget& _target,
+		GLSLShaderStage _stage, std::ostream& _ostr);
+
+	/**
+	 * @brief Position within the GLSL source of a shader, writes it one declaration or statement at a time.
+	 *
+	 * Loops and branches are stepped into, their header, each statement of their bodies and
+	 * their closing brace are written by separate steps.
+	 *
+	 * generate_glsl() runs a cursor to the end in one go, GLSLChunkedEmitter interleaves it with
+	 * the consumer of its output. The context and params must not be modified while a cursor is
+	 * in use.
+	*/
+	struct GLSLEmitCursor
+	{
+	public:
+
+		bool done() const noexcept
+		{
+			return this->section_ == Section::done;
+		};
+
+		/**
+		 * @brief Writes the next piece of the source.
+		 * @param _ostr Output stream.
+		 * @return False if the whole source was already written, true otherwise.
+		*/
+		bool step(std::ostream& _ostr);
+
+		GLSLEmitCursor(const GLSLContext& _context, const GLSLParams& _params);
+		GLSLEmitCursor(const GLSLContext& _context, const GLSLParams& _params, const GLSLTarget& _target,
+			GLSLShaderStage _stage);
+
+	private:
+
+		enum class Section : uint8_t
+		{
+			version,
+			inputs,
+			outputs,
+			uniforms,
+			globals,
+			functions,
+			done,
+		};
+
+		using variable_iterator = std::ranges::iterator_t<decltype(std::declval<const GLSLContext&>().variables())>;
+
+		/**
+		 * @brief Moves to the next variable declared in the current section.
+		 * @return False if there are no more.
+		*/
+		bool find_variable();
+
+		void enter(Section _section);
+
+		/**
+		 * @brief Writes the layout qualifier of the current variable, if the target wants one.
+		*/
+		void write_layout(std::ostream& _ostr) const;
+
+		/**
+		 * @brief Writes a function body statement, only the opening of a loop or branch which is then stepped into.
+		 * @param _indent Tabs already written before the statement.
+		*/
+		void write_statement(std::ostream& _ostr, const GLSLStatement& _statement, size_t _indent);
+
+		/**
+		 * @brief Loop or branch being written, with the position within its current body.
+		*/
+		struct Block
+		{
+			const GLSLStatement* statement;
+			size_t index = 0;
+			bool else_arm = false;
+		};
+
+		const GLSLContext* context_;
+		const GLSLParams* params_;
+		GLSLTarget target_;
+		GLSLShaderStage stage_;
+		Section section_ = Section::version;
+		variable_iterator variable_;
+
+		// Declarations written in the section (samplers only among uniforms), or the global / statement index
+		size_t index_ = 0;
+
+		// Index into params.functions, main comes after them
+		size_t function_ = 0;
+		bool in_body_ = false;
+
+		// Loops and branches entered within the function body, innermost last
+		std::vector<Block> blocks_{};
+	};
+
+
+
+	struct GLSLFunctionBuilder
+	{
+	public:
+
+		GLSLFunctionBuilder& append_statement(GLSLStatement _statement)
+		{
+			this->function_->append(std::move(_statement));
+			return *this;
+		};
+
+		GLSLFunctionBuilder& assign(GLSLContext& _context, GLSLVariableID _dest, GLSLExpression::Parameter _param)
+		{
+			auto _statement = GLSLStatement(GLSLStatementType::assignment);
+			_statement.dest = _dest;
+
+			const auto _paramType = _param.type(_context);
+			const auto _destType = _context.type(_dest);
+
+			HUBRIS_ASSERT(_paramType != GLSLType::glsl_error);
+			HUBRIS_ASSERT(_paramType != GLSLType::glsl_auto);
+			HUBRIS_ASSERT(_destType != GLSLType::glsl_error);
+
+			if (_paramType == _destType || _destType == GLSLType::glsl_auto)
+			{
+				if (_destType == GLSLType::glsl_auto)
+				{
+					_context.set_deduced_type(_dest, _paramType);
+				};
+
+				auto _expr = GLSLExpression::Identity();
+				_expr.param = std::move(_param);
+				_statement.expr = std::move(_expr);
+			}
+			else
+			{
+				_statement.expr = GLSLExpression::Cast(_destType, std::move(_param));
+			};
+
+			return this->append_statement(std::move(_statement));
+		};
+		GLSLFunctionBuilder& declare(GLSLContext& _context, GLSLVariableID _dest, GLSLExpression::Parameter _param)
+		{
+			auto _statement = GLSLStatement(GLSLStatementType::declaration);
+			_statement.dest = _dest;
+
+			const auto _destType = _context.type(_dest);
+			const auto _paramType = _param.type(_context);
+
+			HUBRIS_ASSERT(_destType != GLSLType::glsl_error);
+			HUBRIS_ASSERT(_paramType != GLSLType::glsl_error);
+
+			if (_paramType == _destType || _destType == GLSLType::glsl_auto)
+			{
+				if (_destType == GLSLType::glsl_auto)
+				{
+					_context.set_deduced_type(_dest, _paramType);
+				};
+
+				auto _expr = GLSLExpression::Identity();
+				_expr.param = std::move(_param);
+				_statement.expr = std::move(_expr);
+			}
+			else
+			{
+				_statement.expr = GLSLExpression::Cast(_destType, std::move(_param));
+			};
+
+			return this->append_statement(std::move(_statement));
+		};
+		GLSLFunctionBuilder& return_value(GLSLContext& _context, GLSLExpression::Parameter _param)
+		{
+			auto _statement = GLSLStatement(GLSLStatementType::return_value);
+
+			const auto _returnType = this->function_->return_type();
+			const auto _paramType = _param.type(_context);
+
+			HUBRIS_ASSERT(_returnType != GLSLType::glsl_void);
+			HUBRIS_ASSERT(_paramType != GLSLType::glsl_error);
+
+			if (_paramType == _returnType)
+			{
+				_statement.expr = GLSLExpression::Identity(std::move(_param));
+			}
+			else
+			{
+				_statement.expr = GLSLExpression::Cast(_returnType, std::move(_param));
+			};
+
+			return this->append_statement(std::move(_statement));
+		};
+
+		/**
+		 * @brief Appends a counted loop, see GLSLStatement::Loop.
+		 *
+		 *	_main.for_loop(_context, _i, 0, GLSLLiteral(4), 1, [&](GLSLFunctionBuilder& _body)
+		 *		{
+		 *			_body.assign(...);
+		 *		});
+		 *
+		 * @param _index Induction variable, int or auto.
+		 * @param _begin First value of the induction variable.
+		 * @param _end Exclusive bound, an int.
+		 * @param _step Added after each iteration, must not be 0.
+		 * @param _fn Invoked with a builder appending to the loop body, which may not return.
+		*/
+		template <typename FnT> requires std::invocable<FnT&, GLSLFunctionBuilder&>
+		GLSLFunctionBuilder& for_loop(GLSLContext& _context, GLSLVariableID _index, int32_t _begin,
+			GLSLExpression::Parameter _end, int32_t _step, FnT&& _fn)
+		{
+			if (_context.type(_index) == GLSLType::glsl_auto)
+			{
+				_context.set_deduced_type(_index, GLSLType::glsl_int);
+			};
+			HUBRIS_ASSERT(_context.type(_index) == GLSLType::glsl_int);
+			HUBRIS_ASSERT(_end.type(_context) == GLSLType::glsl_int);
+			HUBRIS_ASSERT(_step != 0);
+
+			auto _statement = GLSLStatement(GLSLStatementType::for_loop);
+			_statement.dest = _index;
+			_statement.expr = GLSLExpression::Identity(std::move(_end));
+			_statement.loop.begin = _begin;
+			_statement.loop.step = _step;
+			_statement.body = build_nested(_fn);
+			return this->append_statement(std::move(_statement));
+		};
+
+		/**
+		 * @brief Appends a branch, see GLSLStatementType::if_else.
+		 *
+		 *	_main.if_else(_context, _condition,
+		 *		[&](GLSLFunctionBuilder& _then) { _then.assign(...); },
+		 *		[&](GLSLFunctionBuilder& _else) { _else.assign(...); });
+		 *
+		 * @param _condition Branch condition, a bool.
+		 * @param _thenFn Invoked with a builder appending to the arm taken if the condition holds.
+		 * @param _elseFn Invoked with a builder appending to the other arm. Neither arm may return.
+		*/
+		template <typename ThenFnT, typename ElseFnT> requires
+			(std::invocable<ThenFnT&, GLSLFunctionBuilder&> && std::invocable<ElseFnT&, GLSLFunctionBuilder&>)
+		GLSLFunctionBuilder& if_else(GLSLContext& _context, GLSLExpression::Parameter _condition,
+			ThenFnT&& _thenFn, ElseFnT&& _elseFn)
+		{
+			HUBRIS_ASSERT(_condition.type(_context) == GLSLType::glsl_bool);
+
+			auto _statement = GLSLStatement(GLSLStatementType::if_else);
+			_statement.expr = GLSLExpression::Identity(std::move(_condition));
+			_statement.body = build_nested(_thenFn);
+			_statement.else_body = build_nested(_elseFn);
+			return this->append_statement(std::move(_statement));
+		};
+
+		/**
+		 * @brief Appends a branch without an else arm.
+		*/
+		template <typename ThenFnT> requires std::invocable<ThenFnT&, GLSLFunctionBuilder&>
+		GLSLFunctionBuilder& if_then(GLSLContext& _context, GLSLExpression::Parameter _condition, ThenFnT&& _thenFn)
+		{
+			return this->if_else(_context, std::move(_condition), _thenFn, [](GLSLFunctionBuilder&) {});
+		};
+
+		GLSLExpression::UniqueExpression binary_op(GLSLContext& _context, GLSLBinaryOperator _op,
+			GLSLExpression::Parameter lhs, GLSLExpression::Parameter rhs)
+		{
+			// Check types.
+			const auto _lhsType = lhs.type(_context);
+			const auto _rhsType = rhs.type(_context);
+
+			if (_lhsType != GLSLType::glsl_auto && _rhsType != GLSLType::glsl_auto)
+			{
+				// Both parameters are not set to auto, make sure the expression is invocable
+				if (!invocable(_op, _lhsType, _rhsType))
+				{
+					// NOT invocable, try for a cast?
+					HUBRIS_ASSERT(false);
+				};
+			};
+
+			// Construct the expression
+			return GLSLExpression::make_unique(GLSLExpression::BinaryOp(_op, std::move(lhs), std::move(rhs)));
+		};
+
+		GLSLFunctionBuilder(GLSLFunction& _function) :
+			function_(&_function)
+		{};
+
+	private:
+
+		/**
+		 * @brief Builds the statements of a loop body or branch arm, which may not return.
+		*/
+		template <typename FnT>
+		static std::vector<GLSLStatement> build_nested(FnT& _fn)
+		{
+			auto _body = GLSLFunction();
+			auto _bodyBuilder = GLSLFunctionBuilder(_body);
+			_fn(_bodyBuilder);
+
+			auto _out = std::vector<GLSLStatement>();
+			_out.reserve(_body.body().size());
+			for (auto& v : _body.body())
+			{
+				HUBRIS_ASSERT(v.type != GLSLStatementType::return_value);
+				_out.push_back(std::move(v));
+			};
+			return _out;
+		};
+
+		GLSLFunction* function_;
+	};
+
+
+	struct GLSLGen
+	{
+		GLSLContext context;
+		GLSLParams params;
+
+		/**
+		 * @brief Phase times and counters, only collected while a GLSLStatsScope for them is active.
+		*/
+		GLSLStats stats{};
+
+		GLSLGen() :
+			context(),
+			params(this->context)
+		{};
+	};
 };
@@ -0,0 +1,276 @@
+#include "GLSLGenWatch.hpp"
+#include "GLSLGenParse.hpp"
+#include "GLSLGenStream.hpp"
+
+#include <map>
+#include <format>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+	#include <poll.h>
+	#include <unistd.h>
+	#include <sys/inotify.h>
+#endif
+
+namespace glsl
+{
+	GLSLBuiltinRegistry::GLSLBuiltinRegistry()
+	{
+		auto& _vertex = this->contexts_[static_cast<size_t>(GLSLShaderStage::vertex)];
+		add_builtin_vertex_shader_variables(_vertex);
+		add_builtin_functions(_vertex);
+
+		auto& _fragment = this->contexts_[static_cast<size_t>(GLSLShaderStage::fragment)];
+		add_builtin_fragment_shader_variables(_fragment);
+		add_builtin_functions(_fragment);
+	};
+
+
+
+	namespace
+	{
+		std::filesystem::path canonical_or_self(const std::filesystem::path& _path)
+		{
+			std::error_code _err{};
+			auto _out = std::filesystem::weakly_canonical(_path, _err);
+			return (_err) ? _path : _out;
+		};
+
+		double milliseconds_since(std::chrono::steady_clock::time_point _start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		};
+	};
+
+	GLSLWatcher::GLSLWatcher(std::vector<GLSLWatchTarget> _targets, std::ostream& _log) :
+		log_(&_log)
+	{
+		this->targets_.reserve(_targets.size());
+		for (auto& _target : _targets)
+		{
+			auto _sourcePath = canonical_or_self(_target.input);
+			HUBRIS_ASSERT(_sourcePath != canonical_or_self(_target.output));
+			this->targets_.push_back(Target{ std::move(_target), std::move(_sourcePath) });
+		};
+	};
+
+	bool GLSLWatcher::build(size_t _index)
+	{
+		auto& _target = this->targets_.at(_index);
+		const auto& _input = _target.target.input;
+		auto& _log = *this->log_;
+
+		// Copied rather than mapped, an editor truncating the file mid-parse would fault a mapping
+		auto _source = std::string();
+		if (!read_file(_target.source_path, _source))
+		{
+			_log << std::format("{}: error: failed to open file\n", _input.string());
+			return false;
+		};
+
+		auto _gen = GLSLGen();
+		_gen.context = this->builtins_.context(_target.target.stage);
+
+		const auto _parsed = parse_glsl(_source, _gen.context, _gen.params);
+		if (!_parsed)
+		{
+			_log << std::format("{}:{}:{}: error: {}\n", _input.string(), _parsed.line, _parsed.column, _parsed.error);
+			return false;
+		};
+		if (!_gen.params.check() || !deduce_auto(_gen.context, _gen.params))
+		{
+			_log << std::format("{}: error: shader failed to check\n", _input.string());
+			return false;
+		};
+
+		// Emit into a scratch string, keeping the previous output to compare against
+		auto _output = std::string();
+		_output.reserve(_target.output.size());
+		stream_glsl(_gen.context, _gen.params, [&_output](std::string_view _chunk)
+			{
+				_output.append(_chunk);
+			});
+
+		if (_target.written && _output == _target.output)
+		{
+			return true;
+		};
+
+		if (!write_file_atomic(_target.target.output, _output))
+		{
+			_log << std::format("{}: error: failed to write output\n", _target.target.output.string());
+			return false;
+		};
+		_target.output = std::move(_output);
+		_target.written = true;
+		return true;
+	};
+
+	size_t GLSLWatcher::build_all()
+	{
+		size_t _failed = 0;
+		for (size_t n = 0; n != this->targets_.size(); ++n)
+		{
+			if (!this->build(n))
+			{
+				++_failed;
+			};
+		};
+		return _failed;
+	};
+
+	void GLSLWatcher::mark_dirty(const std::filesystem::path& _path, std::vector<bool>& _dirty) const
+	{
+		for (size_t n = 0; n != this->targets_.size(); ++n)
+		{
+			if (this->targets_[n].source_path == _path)
+			{
+				_dirty[n] = true;
+			};
+		};
+	};
+
+	void GLSLWatcher::rebuild(std::vector<bool>& _dirty, clock::time_point _changed)
+	{
+		for (size_t n = 0; n != this->targets_.size(); ++n)
+		{
+			if (!_dirty[n])
+			{
+				continue;
+			};
+			_dirty[n] = false;
+
+			if (this->build(n))
+			{
+				*this->log_ << std::format("{}: rebuilt in {:.3f} ms\n",
+					this->targets_[n].target.output.string(), milliseconds_since(_changed));
+			};
+		};
+		this->log_->flush();
+	};
+
+	bool GLSLWatcher::run(const std::atomic<bool>& _stop)
+	{
+		this->build_all();
+		this->log_->flush();
+
+#ifdef __linux__
+		return this->run_inotify(_stop);
+#else
+		return this->run_polling(_stop);
+#endif
+	};
+
+	bool GLSLWatcher::run_inotify(const std::atomic<bool>& _stop)
+	{
+#ifdef __linux__
+		const auto _fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (_fd < 0)
+		{
+			*this->log_ << "error: inotify unavailable, polling instead\n";
+			return this->run_polling(_stop);
+		};
+
+		// Watch directories rather than files, editors often save by renaming a new file
+		// over the old one which would silently end a watch on the file itself.
+		auto _directories = std::map<int, std::filesystem::path>();
+		for (const auto& _target : this->targets_)
+		{
+			const auto _dir = _target.source_path.parent_path();
+			const auto _wd = ::inotify_add_watch(_fd, _dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (_wd < 0)
+			{
+				*this->log_ << std::format("{}: error: cannot watch directory\n", _dir.string());
+				::close(_fd);
+				return false;
+			};
+			_directories.insert_or_assign(_wd, _dir);
+		};
+
+		auto _dirty = std::vector<bool>(this->targets_.size(), false);
+		alignas(inotify_event) char _buffer[16 * 1024];
+
+		while (!_stop.load(std::memory_order_relaxed))
+		{
+			// Wake up regularly to notice a stop request
+			auto _pfd = pollfd{ _fd, POLLIN, 0 };
+			if (::poll(&_pfd, 1, 100) <= 0)
+			{
+				continue;
+			};
+			const auto _changed = clock::now();
+
+			// Drain everything already queued so a burst of events is one rebuild
+			bool _any = false;
+			while (true)
+			{
+				const auto _size = ::read(_fd, _buffer, sizeof(_buffer));
+				if (_size <= 0)
+				{
+					break;
+				};
+
+				for (ssize_t _offset = 0; _offset < _size;)
+				{
+					const auto _event = reinterpret_cast<const inotify_event*>(_buffer + _offset);
+					_offset += sizeof(inotify_event) + _event->len;
+
+					const auto it = _directories.find(_event->wd);
+					if (it == _directories.end() || _event->len == 0)
+					{
+						continue;
+					};
+					this->mark_dirty(it->second / _event->name, _dirty);
+					_any = true;
+				};
+			};
+
+			if (_any)
+			{
+				this->rebuild(_dirty, _changed);
+			};
+		};
+
+		::close(_fd);
+		return true;
+#else
+		return this->run_polling(_stop);
+#endif
+	};
+
+	bool GLSLWatcher::run_polling(const std::atomic<bool>& _stop)
+	{
+		std::error_code _err{};
+		for (auto& _target : this->targets_)
+		{
+			_target.write_time = std::filesystem::last_write_time(_target.source_path, _err);
+		};
+
+		auto _dirty = std::vector<bool>(this->targets_.size(), false);
+		while (!_stop.load(std::memory_order_relaxed))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			const auto _changed = clock::now();
+
+			bool _any = false;
+			for (size_t n = 0; n != this->targets_.size(); ++n)
+			{
+				auto& _target = this->targets_[n];
+				const auto _writeTime = std::filesystem::last_write_time(_target.source_path, _err);
+				if (!_err && _writeTime != _target.write_time)
+				{
+					_target.write_time = _writeTime;
+					_dirty[n] = true;
+					_any = true;
+				};
+			};
+
+			if (_any)
+			{
+				this->rebuild(_dirty, _changed);
+			};
+		};
+		return true;
+	};
+};
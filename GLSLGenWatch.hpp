@@ -0,0 +1,141 @@
+#pragma once
+
+/** @file */
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenFile.hpp"
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <filesystem>
+
+namespace glsl
+{
+	/**
+	 * @brief Contexts holding only the builtins of each shader stage.
+	 *
+	 * Built once and copied into every shader generated for a stage, instead of declaring
+	 * every builtin function again for each shader.
+	*/
+	struct GLSLBuiltinRegistry
+	{
+	public:
+
+		const GLSLContext& context(GLSLShaderStage _stage) const noexcept
+		{
+			return this->contexts_[static_cast<size_t>(_stage)];
+		};
+
+		GLSLBuiltinRegistry();
+
+	private:
+		std::array<GLSLContext, 2> contexts_{};
+	};
+
+	/**
+	 * @brief A GLSL source regenerated into an output file.
+	*/
+	struct GLSLWatchTarget
+	{
+		std::filesystem::path input{};
+		std::filesystem::path output{};
+		GLSLShaderStage stage = GLSLShaderStage::vertex;
+	};
+
+	/**
+	 * @brief Regenerates output files whenever their sources change.
+	 *
+	 * Sources are parsed against the stage's builtins, checked and written back out through
+	 * the emitter. The builtin registry and each target's last output are kept between
+	 * rebuilds, so a change only costs reading, parsing and emitting the targets reading the
+	 * changed file. Sources are read into memory rather than mapped, as an editor may
+	 * truncate one while it is being parsed. Outputs are replaced atomically and only written
+	 * when their contents change.
+	 *
+	 * On Linux changes are picked up through inotify on the sources' directories, which also
+	 * catches editors saving through a rename. Elsewhere the sources are polled.
+	*/
+	struct GLSLWatcher
+	{
+	public:
+
+		/**
+		 * @brief Rebuilds a single target.
+		 * @param _index Index of the target.
+		 * @return True if the output is up to date, false if the source failed to build or
+		 *	the output could not be written.
+		*/
+		bool build(size_t _index);
+
+		/**
+		 * @brief Rebuilds every target.
+		 * @return Number of targets that failed.
+		*/
+		size_t build_all();
+
+		/**
+		 * @brief Rebuilds targets as their sources change until stopped.
+		 *
+		 * Every target is built once first. Changes arriving together are coalesced into a
+		 * single rebuild of each affected target.
+		 *
+		 * @param _stop Checked between waits, set to return.
+		 * @return True if stopped, false if watching the sources failed.
+		*/
+		bool run(const std::atomic<bool>& _stop);
+
+		size_t size() const noexcept { return this->targets_.size(); };
+
+		/**
+		 * @param _targets Targets to build, sources must not also be outputs.
+		 * @param _log Receives one line per rebuild and any errors.
+		*/
+		GLSLWatcher(std::vector<GLSLWatchTarget> _targets, std::ostream& _log);
+
+		GLSLWatcher(const GLSLWatcher&) = delete;
+		GLSLWatcher& operator=(const GLSLWatcher&) = delete;
+
+	private:
+
+		using clock = std::chrono::steady_clock;
+
+		struct Target
+		{
+			GLSLWatchTarget target{};
+
+			// Canonical source path, used to match change events
+			std::filesystem::path source_path{};
+
+			// Last generated source, compared to skip rewriting identical outputs
+			std::string output{};
+			bool written = false;
+
+			// Last write time seen by the polling fallback
+			std::filesystem::file_time_type write_time{};
+		};
+
+		/**
+		 * @brief Marks the targets reading a changed file.
+		 * @param _path Canonical path to the changed file.
+		 * @param _dirty Set for each affected target.
+		*/
+		void mark_dirty(const std::filesystem::path& _path, std::vector<bool>& _dirty) const;
+
+		/**
+		 * @brief Rebuilds the dirty targets and clears them.
+		 * @param _changed When the first change of the batch was seen.
+		*/
+		void rebuild(std::vector<bool>& _dirty, clock::time_point _changed);
+
+		bool run_inotify(const std::atomic<bool>& _stop);
+		bool run_polling(const std::atomic<bool>& _stop);
+
+		GLSLBuiltinRegistry builtins_{};
+		std::vector<Target> targets_{};
+		std::ostream* log_;
+	};
+};
@@ -0,0 +1,624 @@
+/*
+	Microbenchmarks for the generator's hot paths.
+
+	Usage:
+		GLSLGenBench [--json <path>] [--baseline <path>] [--threshold <percent>]
+			[--filter <substring>] [--min-time <seconds>] [--trace <path>] [--perf]
+
+	Results are written as JSON to the given path, or stdout if no path is given. When a
+	baseline (a previous JSON result) is given, every benchmark is compared against it and
+	the process exits with 1 if any is slower by more than the threshold. The eval/ benchmarks
+	also report the batch evaluator's invocations per second.
+
+	After the benchmarks, a batch of synthetic shaders is generated once with stats enabled and
+	the phase summary is printed. --trace writes that batch as Chrome trace-event JSON, --perf
+	samples performance counters around each phase and prints them as a table.
+*/
+
+#include "GLSLGenUtil.hpp"
+#include "GLSLGenEval.hpp"
+#include "GLSLGenParse.hpp"
+#include "GLSLGenStream.hpp"
+
+#include <map>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+using namespace glsl;
+
+namespace
+{
+	/**
+	 * @brief Keeps the optimizer from discarding a benchmarked result.
+	*/
+	template <typename T>
+	inline void keep(const T& _value)
+	{
+		// The pointer itself is volatile, so both the store and the read back are kept
+		static const void* volatile sink_ = nullptr;
+		sink_ = &_value;
+		static_cast<void>(sink_);
+	};
+
+	struct BenchOptions
+	{
+		std::string json_path{};
+		std::string baseline_path{};
+		std::string trace_path{};
+		bool perf = false;
+		std::string filter{};
+		double threshold = 10.0;
+		double min_time = 0.05;
+		size_t samples = 5;
+	};
+
+	struct BenchResult
+	{
+		std::string name;
+		size_t iterations = 0;
+
+		// Median and fastest sample.
+		double ns_per_op = 0.0;
+		double min_ns_per_op = 0.0;
+
+		// Heap use of a single op, only measured with the allocation hook installed
+		uint64_t allocs_per_op = 0;
+		uint64_t bytes_per_op = 0;
+
+		// Throughput of a single op, only for benchmarks with a rate
+		double invocations_per_second = 0.0;
+	};
+
+	struct Benchmark
+	{
+		std::string name;
+		std::function<void()> op;
+
+		// Invocations per second of the last op, if the benchmark measures a rate
+		std::function<double()> rate{};
+	};
+
+	/**
+	 * @brief Times a benchmark, the iteration count is grown until one sample takes at least min_time.
+	*/
+	BenchResult run_benchmark(const Benchmark& _bench, const BenchOptions& _options)
+	{
+		using clock = std::chrono::steady_clock;
+
+		const auto _time = [&_bench](size_t _iterations)
+		{
+			const auto _start = clock::now();
+			for (size_t n = 0; n != _iterations; ++n)
+			{
+				_bench.op();
+			};
+			return std::chrono::duration<double>(clock::now() - _start).count();
+		};
+
+		// Warm up and calibrate
+		size_t _iterations = 1;
+		while (true)
+		{
+			const auto _seconds = _time(_iterations);
+			if (_seconds >= _options.min_time || _iterations >= (size_t(1) << 30))
+			{
+				break;
+			};
+			_iterations = (_seconds <= 0.0) ? _iterations * 10 :
+				std::max(_iterations + 1, (size_t)((double)_iterations * 1.2 * _options.min_time / _seconds));
+		};
+
+		auto _samples = std::vector<double>{};
+		for (size_t n = 0; n != _options.samples; ++n)
+		{
+			_samples.push_back(_time(_iterations) * 1e9 / (double)_iterations);
+		};
+		std::ranges::sort(_samples);
+
+		auto _result = BenchResult{};
+		_result.name = _bench.name;
+		_result.iterations = _iterations;
+		_result.ns_per_op = _samples[_samples.size() / 2];
+		_result.min_ns_per_op = _samples.front();
+
+		if (allocation_hook_installed())
+		{
+			auto _stats = GLSLStats();
+			{
+				const auto _scope = GLSLStatsScope(_stats);
+				_bench.op();
+			};
+			_result.allocs_per_op = _stats.allocations().count;
+			_result.bytes_per_op = _stats.allocations().bytes;
+		};
+
+		if (_bench.rate)
+		{
+			_bench.op();
+			_result.invocations_per_second = _bench.rate();
+		};
+		return _result;
+	};
+
+
+
+	/**
+	 * @brief Builds a shader with the given number of arithmetic statements in main.
+	*/
+	void make_synthetic_shader(GLSLGen& _gen, size_t _statements)
+	{
+		auto& _context = _gen.context;
+		add_builtin_vertex_shader_variables(_context);
+		add_builtin_functions(_context);
+
+		const auto _in = _context.new_variable("in_pos", GLSLType::glsl_vec3)->set_inout(GLSLInOut::in).id();
+		const auto _out = _context.new_variable("out_pos", GLSLType::glsl_vec3)->set_inout(GLSLInOut::out).id();
+		const auto _scale = _context.new_variable("scale", GLSLType::glsl_float)->set_uniform().id();
+
+		auto _main = GLSLFunctionBuilder(_gen.params.main_fn);
+		auto _last = _in;
+		for (size_t n = 0; n != _statements; ++n)
+		{
+			const auto _var = _context.new_variable()->id();
+			auto _scaled = _main.binary_op(_context, GLSLBinaryOperator::mult, _last, _scale);
+			_main.declare(_context, _var,
+				_main.binary_op(_context, GLSLBinaryOperator::add, std::move(_scaled), GLSLLiteral(1.0f, 2.0f, 3.0f)));
+			_last = _var;
+		};
+		_main.assign(_context, _out, _last);
+	};
+
+	/**
+	 * @brief Shader run by the eval/ benchmarks, a vec3 transform, a dot product and a sine per invocation.
+	*/
+	constexpr auto eval_source_v = std::string_view(
+		"#version 330 core\n"
+		"in vec3 in_pos;\n"
+		"uniform vec3 scale;\n"
+		"uniform vec3 offset;\n"
+		"out float out_value;\n"
+		"void main()\n"
+		"{\n"
+		"\tvec3 p = in_pos * scale + offset;\n"
+		"\tout_value = sin(dot(p, p));\n"
+		"}\n");
+
+	/**
+	 * @brief Batch evaluator compiled for eval_source_v with its inputs and outputs bound.
+	*/
+	struct EvalBench
+	{
+		GLSLGen gen{};
+		GLSLBatchEvaluator eval{};
+		std::array<std::vector<float>, 3> in{};
+		std::vector<float> out{};
+		GLSLEvalResult last{};
+
+		explicit EvalBench(size_t _invocations)
+		{
+			auto& _context = this->gen.context;
+			add_builtin_functions(_context);
+			HUBRIS_ASSERT(parse_glsl(eval_source_v, _context, this->gen.params));
+			HUBRIS_ASSERT(this->eval.compile(_context, this->gen.params.main_fn));
+
+			for (size_t c = 0; c != this->in.size(); ++c)
+			{
+				this->in[c].resize(_invocations);
+				for (size_t n = 0; n != _invocations; ++n)
+				{
+					this->in[c][n] = (float)((n * 7 + c * 13) % 101) * 0.01f;
+				};
+			};
+			this->out.resize(_invocations);
+
+			HUBRIS_ASSERT(this->eval.bind_input(_context.id("in_pos"), { this->in[0].data(), this->in[1].data(), this->in[2].data() }));
+			HUBRIS_ASSERT(this->eval.bind_output(_context.id("out_value"), { this->out.data() }));
+			HUBRIS_ASSERT(this->eval.set_uniform(_context.id("scale"), { 2.0f, 0.5f, 1.5f }));
+			HUBRIS_ASSERT(this->eval.set_uniform(_context.id("offset"), { 0.25f, -1.0f, 0.0f }));
+		};
+	};
+
+	std::vector<Benchmark> make_benchmarks()
+	{
+		auto _benchmarks = std::vector<Benchmark>{};
+
+		_benchmarks.push_back({ "context/construct_builtins", []()
+			{
+				auto _context = GLSLContext();
+				add_builtin_vertex_shader_variables(_context);
+				add_builtin_functions(_context);
+				keep(_context);
+			} });
+
+		// Lookups run against a context holding the builtins plus some user variables.
+		static auto _lookupContext = []()
+		{
+			auto _context = GLSLContext();
+			add_builtin_vertex_shader_variables(_context);
+			add_builtin_functions(_context);
+			for (size_t n = 0; n != 100; ++n)
+			{
+				_context.new_variable("user_" + std::to_string(n), GLSLType::glsl_vec4);
+			};
+			return _context;
+		}();
+		_benchmarks.push_back({ "lookup/id", []()
+			{
+				keep(_lookupContext.id("user_99"));
+			} });
+		_benchmarks.push_back({ "lookup/id_missing", []()
+			{
+				keep(_lookupContext.id("not_declared"));
+			} });
+		_benchmarks.push_back({ "lookup/function_id", []()
+			{
+				keep(_lookupContext.function_id("texture"));
+			} });
+
+		_benchmarks.push_back({ "overload/find_best_overload_generic", []()
+			{
+				static const auto _params = std::array{ GLSLType::glsl_vec3, GLSLType::glsl_vec3 };
+				static const auto _decl = _lookupContext.find(_lookupContext.function_id("dot"));
+				keep(_decl->find_best_overload(_params));
+			} });
+		_benchmarks.push_back({ "overload/find_best_overload_exact", []()
+			{
+				static const auto _params = std::array{ GLSLType::glsl_sampler_2D_array, GLSLType::glsl_vec3 };
+				static const auto _decl = _lookupContext.find(_lookupContext.function_id("texture"));
+				keep(_decl->find_best_overload(_params));
+			} });
+		_benchmarks.push_back({ "overload/resolve_params_cast", []()
+			{
+				// cos(int) resolves to cos(float) with an inserted cast.
+				static const auto _function = _lookupContext.function_id("cos");
+				static const auto _param = _lookupContext.new_variable("int_param", GLSLType::glsl_int)->id();
+				auto _call = GLSLExpression::FunctionCall(_function).add_param(_param).resolve_params(_lookupContext);
+				keep(_call);
+			} });
+
+		for (size_t _statements : { 10, 1000, 100000 })
+		{
+			auto _gen = std::make_shared<GLSLGen>();
+			make_synthetic_shader(*_gen, _statements);
+
+			_benchmarks.push_back({ "generate_glsl/" + std::to_string(_statements), [_gen]()
+				{
+					static auto _ostr = std::ostringstream();
+					_ostr.str(std::string());
+					generate_glsl(_gen->context, _gen->params, _ostr);
+					keep(_ostr);
+				} });
+		};
+
+		{
+			auto _gen = std::make_shared<GLSLGen>();
+			make_synthetic_shader(*_gen, 100000);
+
+			// Same shader as generate_glsl/100000, consumed chunk by chunk instead of collected.
+			_benchmarks.push_back({ "stream_glsl/100000", [_gen]()
+				{
+					size_t _hash = 0;
+					stream_glsl(_gen->context, _gen->params, [&_hash](std::string_view _chunk)
+						{
+							_hash ^= std::hash<std::string_view>{}(_chunk);
+						});
+					keep(_hash);
+				} });
+		};
+
+		for (size_t _invocations : { 1024, 65536 })
+		{
+			auto _bench = std::make_shared<EvalBench>(_invocations);
+			_benchmarks.push_back({ "eval/transform_dot_sin/" + std::to_string(_invocations), [_bench]()
+				{
+					_bench->last = _bench->eval.run(_bench->out.size());
+					keep(_bench->out);
+				},
+				[_bench]()
+				{
+					return _bench->last.invocations_per_second();
+				} });
+		};
+
+		return _benchmarks;
+	};
+
+
+
+	void write_json(std::ostream& _ostr, const std::vector<BenchResult>& _results)
+	{
+		const auto _flags = _ostr.flags();
+		const auto _precision = _ostr.precision();
+		_ostr << std::fixed << std::setprecision(3);
+		_ostr << "{\n\t\"benchmarks\": [\n";
+		for (size_t n = 0; n != _results.size(); ++n)
+		{
+			const auto& v = _results[n];
+			_ostr << "\t\t{ \"name\": \"" << v.name << "\", \"iterations\": " << v.iterations
+				<< ", \"ns_per_op\": " << v.ns_per_op << ", \"min_ns_per_op\": " << v.min_ns_per_op;
+			if (allocation_hook_installed())
+			{
+				_ostr << ", \"allocs_per_op\": " << v.allocs_per_op << ", \"bytes_per_op\": " << v.bytes_per_op;
+			};
+			if (v.invocations_per_second > 0.0)
+			{
+				_ostr << ", \"invocations_per_second\": " << v.invocations_per_second;
+			};
+			_ostr << " }"
+				<< ((n + 1 != _results.size()) ? ",\n" : "\n");
+		};
+		_ostr << "\t]\n}\n";
+		_ostr.flags(_flags);
+		_ostr.precision(_precision);
+	};
+
+	/**
+	 * @brief Reads the name and ns_per_op of every benchmark in a JSON result written by write_json().
+	*/
+	std::map<std::string, double> read_baseline(std::string_view _json)
+	{
+		auto _out = std::map<std::string, double>{};
+
+		const auto _value = [&_json](size_t _from, std::string_view _key) -> std::string_view
+		{
+			const auto _keyPos = _json.find(_key, _from);
+			if (_keyPos == _json.npos)
+			{
+				return std::string_view();
+			};
+			auto _pos = _json.find(':', _keyPos + _key.size());
+			if (_pos == _json.npos)
+			{
+				return std::string_view();
+			};
+			_pos = _json.find_first_not_of(" \t\r\n", _pos + 1);
+			const auto _end = _json.find_first_of(",}\r\n", _pos);
+			return _json.substr(_pos, _end - _pos);
+		};
+
+		size_t _pos = 0;
+		while ((_pos = _json.find('{', _pos + 1)) != _json.npos)
+		{
+			const auto _objectEnd = _json.find('}', _pos);
+			auto _name = _value(_pos, "\"name\"");
+			auto _ns = _value(_pos, "\"ns_per_op\"");
+			if (_name.size() < 2 || _ns.empty() || _name.data() > _json.data() + _objectEnd)
+			{
+				continue;
+			};
+
+			double _nsValue = 0.0;
+			if (std::from_chars(_ns.data(), _ns.data() + _ns.size(), _nsValue).ec == std::errc{})
+			{
+				_out.insert_or_assign(std::string(_name.substr(1, _name.size() - 2)), _nsValue);
+			};
+		};
+		return _out;
+	};
+
+	/**
+	 * @brief Prints a comparison table to stderr.
+	 * @return True if any benchmark regressed past the threshold.
+	*/
+	bool compare(const std::vector<BenchResult>& _results, const std::map<std::string, double>& _baseline, double _threshold)
+	{
+		bool _regressed = false;
+		std::fprintf(stderr, "%-40s %14s %14s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+		for (auto& v : _results)
+		{
+			const auto it = _baseline.find(v.name);
+			if (it == _baseline.end() || it->second <= 0.0)
+			{
+				std::fprintf(stderr, "%-40s %14s %14.1f %9s\n", v.name.c_str(), "-", v.ns_per_op, "new");
+				continue;
+			};
+
+			const auto _change = (v.ns_per_op - it->second) / it->second * 100.0;
+			const char* _flag = "";
+			if (_change > _threshold)
+			{
+				_flag = "  REGRESSION";
+				_regressed = true;
+			}
+			else if (_change < -_threshold)
+			{
+				_flag = "  improved";
+			};
+			std::fprintf(stderr, "%-40s %14.1f %14.1f %+8.1f%%%s\n",
+				v.name.c_str(), it->second, v.ns_per_op, _change, _flag);
+		};
+		return _regressed;
+	};
+
+	/**
+	 * @brief Generates a batch of synthetic shaders with stats enabled.
+	 * @return Stats aggregated over the batch.
+	*/
+	GLSLStats run_stats_batch(bool _trace, const GLSLPerfCounters* _perf)
+	{
+		auto _batch = GLSLStats();
+		bool _first = true;
+		for (size_t _statements : { 10, 1000, 10000 })
+		{
+			auto _gen = GLSLGen();
+			_gen.stats.set_trace(_trace).set_perf_counters(_perf);
+			{
+				const auto _scope = GLSLStatsScope(_gen.stats);
+				{
+					const auto _phase = GLSLScopedPhase(GLSLPhase::build);
+					make_synthetic_shader(_gen, _statements);
+				};
+				_gen.params.check();
+				deduce_auto(_gen.context, _gen.params);
+
+				auto _ostr = std::ostringstream();
+				generate_glsl(_gen.context, _gen.params, _ostr);
+			};
+
+			if (_first)
+			{
+				_batch = std::move(_gen.stats);
+				_first = false;
+			}
+			else
+			{
+				_batch.merge(_gen.stats);
+			};
+		};
+		return _batch;
+	};
+
+	bool parse_options(int _nargs, const char* const* _vargs, BenchOptions& _options)
+	{
+		for (int n = 1; n < _nargs; ++n)
+		{
+			const auto _arg = std::string_view(_vargs[n]);
+			if (_arg == "--perf")
+			{
+				_options.perf = true;
+				continue;
+			};
+
+			if (n + 1 >= _nargs)
+			{
+				std::fprintf(stderr, "missing value for %s\n", _vargs[n]);
+				return false;
+			};
+			const auto _value = std::string_view(_vargs[++n]);
+
+			if (_arg == "--json")
+			{
+				_options.json_path = _value;
+			}
+			else if (_arg == "--baseline")
+			{
+				_options.baseline_path = _value;
+			}
+			else if (_arg == "--trace")
+			{
+				_options.trace_path = _value;
+			}
+			else if (_arg == "--filter")
+			{
+				_options.filter = _value;
+			}
+			else if (_arg == "--threshold")
+			{
+				std::from_chars(_value.data(), _value.data() + _value.size(), _options.threshold);
+			}
+			else if (_arg == "--min-time")
+			{
+				std::from_chars(_value.data(), _value.data() + _value.size(), _options.min_time);
+			}
+			else
+			{
+				std::fprintf(stderr, "unknown option %s\n", _vargs[n - 1]);
+				return false;
+			};
+		};
+		return true;
+	};
+};
+
+int main(int _nargs, const char* _vargs[])
+{
+	auto _options = BenchOptions{};
+	if (!parse_options(_nargs, _vargs, _options))
+	{
+		return 2;
+	};
+
+	auto _results = std::vector<BenchResult>{};
+	for (auto& v : make_benchmarks())
+	{
+		if (!_options.filter.empty() && v.name.find(_options.filter) == std::string::npos)
+		{
+			continue;
+		};
+
+		_results.push_back(run_benchmark(v, _options));
+		const auto& _result = _results.back();
+		if (allocation_hook_installed())
+		{
+			std::fprintf(stderr, "%-40s %14.1f ns/op %10llu allocs/op %12llu B/op\n", v.name.c_str(), _result.ns_per_op,
+				(unsigned long long)_result.allocs_per_op, (unsigned long long)_result.bytes_per_op);
+		}
+		else
+		{
+			std::fprintf(stderr, "%-40s %14.1f ns/op\n", v.name.c_str(), _result.ns_per_op);
+		};
+		if (_result.invocations_per_second > 0.0)
+		{
+			std::fprintf(stderr, "%-40s %14.3e invocations/s\n", "", _result.invocations_per_second);
+		};
+	};
+
+	if (_options.json_path.empty())
+	{
+		write_json(std::cout, _results);
+	}
+	else
+	{
+		auto _file = std::ofstream(_options.json_path);
+		write_json(_file, _results);
+	};
+
+	{
+		auto _perf = GLSLPerfCounters();
+		if (_options.perf)
+		{
+			if (!_perf.open())
+			{
+				std::fprintf(stderr, "performance counters are unavailable\n");
+			}
+			else if (!_perf.hardware())
+			{
+				std::fprintf(stderr, "hardware counters are unavailable, using software counters\n");
+			};
+		};
+
+		const auto _stats = run_stats_batch(!_options.trace_path.empty(), _perf.good() ? &_perf : nullptr);
+		std::cerr << '\n';
+		_stats.write_summary(std::cerr);
+		std::cerr << '\n';
+		if (_perf.good())
+		{
+			_stats.write_perf_summary(std::cerr);
+			std::cerr << '\n';
+		};
+		if (!_options.trace_path.empty())
+		{
+			auto _file = std::ofstream(_options.trace_path);
+			_stats.write_chrome_trace(_file);
+		};
+	};
+
+	if (!_options.baseline_path.empty())
+	{
+		auto _file = std::ifstream(_options.baseline_path);
+		const auto _json = std::string(std::istreambuf_iterator<char>(_file), std::istreambuf_iterator<char>());
+		const auto _baseline = read_baseline(_json);
+		if (_baseline.empty())
+		{
+			std::fprintf(stderr, "no results in baseline %s\n", _options.baseline_path.c_str());
+			return 2;
+		};
+		if (compare(_results, _baseline, _options.threshold))
+		{
+			return 1;
+		};
+	};
+
+	return 0;
+};
@@ -1,9 +1,9 @@
 #version 330 core
 
-in vec4 frag_col; // id = 11
-in vec3 frag_uvs; // id = 12
+in vec4 frag_col; // id = 12
+in vec3 frag_uvs; // id = 13
 
-out vec4 color; // id = 13
+out vec4 color; // id = 14
 
 uniform sampler2DArray test_texture;
 void main()
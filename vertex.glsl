@@ -1,16 +1,16 @@
 #version 330 core
 
-in vec3 in_pos; // id = 10
-in vec2 in_uvs; // id = 11
-in vec4 in_col; // id = 12
+in vec3 in_pos; // id = 11
+in vec2 in_uvs; // id = 12
+in vec4 in_col; // id = 13
 
-out vec2 frag_uvs; // id = 13
-out vec4 frag_col; // id = 14
+out vec2 frag_uvs; // id = 14
+out vec4 frag_col; // id = 15
 
 void main()
 {
 	frag_uvs = in_uvs;
 	frag_col = in_col;
 	gl_Position = vec4(in_pos.xyz, 1.0);
-	float _var15 = cos(in_pos.x);
+	float _var16 = cos(in_pos.x);
 };